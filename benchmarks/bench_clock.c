@@ -0,0 +1,76 @@
+/**
+ * @file bench_clock.c
+ * @brief 时间源开销微基准
+ * 
+ * 对每种时间源连续调用 em_time_ns，输出单次调用的平均耗时。
+ * 
+ * 编译: gcc -O2 -o bench_clock bench_clock.c ../src/event_manager.c -I../include -lpthread
+ */
+
+#define _POSIX_C_SOURCE 199309L  /* for clock_gettime */
+#include <stdio.h>
+#include <stdint.h>
+#include <time.h>
+#include "event_manager.h"
+
+#define ITERATIONS  10000000
+
+static const char* source_name(em_clock_source_t source)
+{
+    switch (source) {
+        case EM_CLOCK_MONOTONIC:        return "CLOCK_MONOTONIC";
+        case EM_CLOCK_MONOTONIC_COARSE: return "CLOCK_MONOTONIC_COARSE";
+        case EM_CLOCK_TSC:              return "TSC";
+        default:                        return "unknown";
+    }
+}
+
+static uint64_t wall_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static void bench_source(em_clock_source_t source)
+{
+    em_config_t cfg;
+    em_config_init(&cfg);
+    cfg.clock_source = source;
+    
+    em_handle_t em = em_create_with_config(&cfg);
+    if (em == NULL) {
+        printf("%-24s 创建失败\n", source_name(source));
+        return;
+    }
+    
+    em_clock_source_t actual = em_get_clock_source(em);
+    
+    /* 累加结果，防止调用被优化掉 */
+    volatile uint64_t sink = 0;
+    uint64_t start = wall_ns();
+    for (int i = 0; i < ITERATIONS; i++) {
+        sink += em_time_ns(em);
+    }
+    uint64_t elapsed = wall_ns() - start;
+    (void)sink;
+    
+    printf("%-24s %6.2f ns/次", source_name(source), (double)elapsed / ITERATIONS);
+    if (actual != source) {
+        printf("  (不可用，已回退到 %s)", source_name(actual));
+    }
+    printf("\n");
+    
+    em_destroy(em);
+}
+
+int main(void)
+{
+    printf("=== 时间源开销 (%d 次调用) ===\n\n", ITERATIONS);
+    
+    bench_source(EM_CLOCK_MONOTONIC);
+    bench_source(EM_CLOCK_MONOTONIC_COARSE);
+    bench_source(EM_CLOCK_TSC);
+    
+    return 0;
+}
@@ -0,0 +1,206 @@
+/**
+ * @file bench_locks.c
+ * @brief 管理器锁类型对比基准
+ * 
+ * 对每种锁类型运行几种典型负载，输出每次操作的平均耗时(所有线程合计的吞吐折算)：
+ * 
+ * - 同步分发：em_publish_sync，分发时复制订阅者
+ * - 查询：em_get_stats 与 em_get_subscriber_count 交替
+ * - 读多写少：95% 同步分发，5% 订阅/取消订阅
+ * - 异步发布：em_publish_async，另一线程运行事件循环消费
+ * 
+ * EM_LOCK_NONE 只能在单线程中使用，只运行单线程的同步负载。
+ * 
+ * 编译: gcc -O2 -o bench_locks bench_locks.c ../src/event_manager.c -I../include -lpthread
+ */
+
+#define _POSIX_C_SOURCE 199309L  /* for clock_gettime */
+#include <stdio.h>
+#include <stdint.h>
+#include <time.h>
+#include <pthread.h>
+#include <sched.h>
+#include "event_manager.h"
+
+#define ITERATIONS      200000      /* 每个线程的操作次数 */
+#define MAX_THREADS     4
+
+typedef enum {
+    MIX_DISPATCH,
+    MIX_QUERY,
+    MIX_READ_MOSTLY,
+    MIX_ASYNC,
+    MIX_COUNT
+} mix_t;
+
+static const char* mix_names[MIX_COUNT] = { "同步分发", "查询", "读多写少", "异步发布" };
+
+typedef struct {
+    em_handle_t em;
+    mix_t       mix;
+    int         index;
+} worker_arg_t;
+
+static uint64_t wall_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static const char* lock_name(em_lock_type_t type)
+{
+    switch (type) {
+        case EM_LOCK_MUTEX:     return "MUTEX";
+        case EM_LOCK_RWLOCK:    return "RWLOCK";
+        case EM_LOCK_SPIN:      return "SPIN";
+        case EM_LOCK_NONE:      return "NONE";
+        default:                return "unknown";
+    }
+}
+
+static void noop_callback(em_event_id_t id, em_event_data_t data, void* user)
+{
+    (void)id; (void)data; (void)user;
+}
+
+static void* worker(void* p)
+{
+    worker_arg_t* arg = (worker_arg_t*)p;
+    em_handle_t em = arg->em;
+    em_event_id_t own = (em_event_id_t)(10 + arg->index);  /* 每个线程订阅自己的事件 */
+    em_stats_t stats;
+    
+    for (int i = 0; i < ITERATIONS; i++) {
+        switch (arg->mix) {
+            case MIX_DISPATCH:
+                em_publish_sync(em, 0, NULL);
+                break;
+            case MIX_QUERY:
+                if (i & 1) {
+                    em_get_stats(em, &stats);
+                } else {
+                    em_get_subscriber_count(em, 0);
+                }
+                break;
+            case MIX_READ_MOSTLY:
+                if (i % 20 == 0) {
+                    em_subscribe(em, own, noop_callback, NULL, EM_PRIORITY_NORMAL);
+                    em_unsubscribe(em, own, noop_callback);
+                } else {
+                    em_publish_sync(em, 0, NULL);
+                }
+                break;
+            case MIX_ASYNC:
+                while (em_publish_async(em, 0, NULL, 0, EM_PRIORITY_NORMAL) == EM_ERR_QUEUE_FULL) {
+                    sched_yield();  /* 让出 CPU 给事件循环 */
+                }
+                break;
+            default:
+                break;
+        }
+    }
+    return NULL;
+}
+
+static void* loop_thread(void* p)
+{
+    em_run_loop((em_handle_t)p);
+    return NULL;
+}
+
+/* 返回每次操作的平均耗时(纳秒)，失败返回负数 */
+static double run_mix(em_lock_type_t type, mix_t mix, int threads)
+{
+    em_config_t cfg;
+    em_config_init(&cfg);
+    cfg.lock_type = type;
+    em_handle_t em = em_create_with_config(&cfg);
+    if (em == NULL) {
+        return -1.0;
+    }
+    
+    em_subscribe(em, 0, noop_callback, NULL, EM_PRIORITY_HIGH);
+    em_subscribe(em, 0, noop_callback, NULL, EM_PRIORITY_LOW);
+    
+    pthread_t loop;
+    if (mix == MIX_ASYNC && pthread_create(&loop, NULL, loop_thread, em) != 0) {
+        em_destroy(em);
+        return -1.0;
+    }
+    
+    pthread_t tids[MAX_THREADS];
+    worker_arg_t args[MAX_THREADS];
+    uint64_t start = wall_ns();
+    if (threads == 1) {
+        args[0] = (worker_arg_t){ em, mix, 0 };
+        worker(&args[0]);
+    } else {
+        for (int i = 0; i < threads; i++) {
+            args[i] = (worker_arg_t){ em, mix, i };
+            pthread_create(&tids[i], NULL, worker, &args[i]);
+        }
+        for (int i = 0; i < threads; i++) {
+            pthread_join(tids[i], NULL);
+        }
+    }
+    uint64_t elapsed = wall_ns() - start;
+    
+    if (mix == MIX_ASYNC) {
+        em_stop_loop(em);
+        pthread_join(loop, NULL);
+    }
+    em_destroy(em);
+    
+    return (double)elapsed / ((double)ITERATIONS * threads);
+}
+
+int main(void)
+{
+    em_lock_type_t types[] = { EM_LOCK_MUTEX, EM_LOCK_RWLOCK, EM_LOCK_SPIN, EM_LOCK_NONE };
+    int thread_counts[] = { 1, MAX_THREADS };
+    
+    printf("=== 管理器锁类型对比 (每线程 %d 次操作，单位 ns/次) ===\n\n", ITERATIONS);
+    printf("%-8s %-6s", "锁", "线程");
+    for (int m = 0; m < MIX_COUNT; m++) {
+        printf(" %12s", mix_names[m]);
+    }
+    printf("\n");
+    
+    for (size_t t = 0; t < sizeof(types) / sizeof(types[0]); t++) {
+        /* 请求的锁不可用时会回退，按实际类型标注 */
+        em_config_t cfg;
+        em_config_init(&cfg);
+        cfg.lock_type = types[t];
+        em_handle_t probe = em_create_with_config(&cfg);
+        em_lock_type_t actual = probe != NULL ? em_get_lock_type(probe) : types[t];
+        if (probe != NULL) {
+            em_destroy(probe);
+        }
+        
+        for (size_t c = 0; c < sizeof(thread_counts) / sizeof(thread_counts[0]); c++) {
+            int threads = thread_counts[c];
+            if (types[t] == EM_LOCK_NONE && threads > 1) {
+                continue;
+            }
+            
+            printf("%-8s %-6d", lock_name(actual), threads);
+            for (int m = 0; m < MIX_COUNT; m++) {
+                if (types[t] == EM_LOCK_NONE && m == MIX_ASYNC) {
+                    printf(" %12s", "-");
+                    continue;
+                }
+                double ns = run_mix(types[t], (mix_t)m, threads);
+                if (ns < 0) {
+                    printf(" %12s", "失败");
+                } else {
+                    printf(" %12.1f", ns);
+                }
+            }
+            printf("\n");
+            fflush(stdout);
+        }
+    }
+    
+    return 0;
+}
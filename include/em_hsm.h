@@ -0,0 +1,236 @@
+/**
+ * @file em_hsm.h
+ * @brief 表驱动的层次状态机
+ * 
+ * 状态、转换以及进入/退出动作都用静态表声明，引擎在创建时预先计算
+ * (状态, 事件) → 转换 的查找表，分发一个事件只需一次查表，不再需要在回调里
+ * 写嵌套的 switch：
+ * 
+ * - 子状态没有处理的事件由父状态处理，查找表中已经包含了这一继承关系
+ * - 同一状态、同一事件可以有多条带守卫条件的转换，按表中顺序取第一条守卫成立的
+ * - 转换为外部转换：退出到源状态和目标状态的最近公共父状态，执行转换动作，
+ *   再逐级进入目标状态及其初始子状态
+ * - 运行到完成：转换过程中到达同一状态机的事件排在当前事件之后处理
+ * 
+ * 同一事件管理器上的所有状态机共用订阅：每个事件ID只订阅一次，由引擎转发给
+ * 处理该事件的状态机。
+ * 
+ * @author 梦里不知身是客
+ * @version 1.0.0
+ * @date 2026
+ * @copyright MIT License
+ */
+
+#ifndef EM_HSM_H
+#define EM_HSM_H
+
+#include "event_manager.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*============================================================================
+ *                              配置宏定义
+ *============================================================================*/
+
+/** 每个状态机最多的状态数 */
+#ifndef EM_HSM_MAX_STATES
+#define EM_HSM_MAX_STATES           32
+#endif
+
+/** 状态的最大嵌套深度 */
+#ifndef EM_HSM_MAX_DEPTH
+#define EM_HSM_MAX_DEPTH            8
+#endif
+
+/** 转换过程中到达的事件的延后队列容量 */
+#ifndef EM_HSM_DEFER_SIZE
+#define EM_HSM_DEFER_SIZE           16
+#endif
+
+/** 延后的事件可复制的最大数据长度(字节) */
+#ifndef EM_HSM_DEFER_DATA_SIZE
+#define EM_HSM_DEFER_DATA_SIZE      32
+#endif
+
+/** 表示"无"的状态编号(顶层状态的父状态、叶子状态的初始子状态、内部转换的目标) */
+#define EM_HSM_NONE                 (-1)
+
+/** 创建时进入初始状态的动作收到的事件ID */
+#define EM_HSM_NO_EVENT             ((em_event_id_t)-1)
+
+/*============================================================================
+ *                              类型定义
+ *============================================================================*/
+
+/**
+ * @brief 状态机句柄(不透明指针)
+ */
+typedef struct em_hsm em_hsm_t;
+
+/**
+ * @brief 动作函数(进入、退出或转换动作)
+ * 
+ * @param hsm 状态机
+ * @param event_id 触发的事件ID(创建时进入初始状态为 EM_HSM_NO_EVENT)
+ * @param data 事件数据
+ * @param user_data 创建时传入的用户数据
+ */
+typedef void (*em_hsm_action_t)(em_hsm_t* hsm, em_event_id_t event_id,
+                                em_event_data_t data, void* user_data);
+
+/**
+ * @brief 守卫条件
+ * 
+ * @return bool 返回true时执行该转换
+ */
+typedef bool (*em_hsm_guard_t)(em_hsm_t* hsm, em_event_id_t event_id,
+                               em_event_data_t data, void* user_data);
+
+/**
+ * @brief 状态(在状态表中的下标即状态编号)
+ */
+typedef struct {
+    const char*     name;       /**< 名称(可为NULL) */
+    int             parent;     /**< 父状态(EM_HSM_NONE 表示顶层状态) */
+    int             initial;    /**< 初始子状态，必须是直接子状态(EM_HSM_NONE 表示叶子状态) */
+    em_hsm_action_t entry;      /**< 进入动作(可为NULL) */
+    em_hsm_action_t exit;       /**< 退出动作(可为NULL) */
+} em_hsm_state_t;
+
+/**
+ * @brief 转换
+ */
+typedef struct {
+    int             source;     /**< 源状态(当前状态或其祖先是源状态时生效) */
+    em_event_id_t   event_id;   /**< 触发的事件ID */
+    int             target;     /**< 目标状态(EM_HSM_NONE 表示内部转换：只执行动作，不退出也不进入) */
+    em_hsm_guard_t  guard;      /**< 守卫条件(可为NULL) */
+    em_hsm_action_t action;     /**< 转换动作(可为NULL) */
+} em_hsm_transition_t;
+
+/**
+ * @brief 状态机配置
+ * 
+ * 状态表和转换表在创建时被复制，之后可以释放。
+ */
+typedef struct {
+    const em_hsm_state_t*       states;             /**< 状态表 */
+    int                         state_count;        /**< 状态数(1 ~ EM_HSM_MAX_STATES) */
+    const em_hsm_transition_t*  transitions;        /**< 转换表 */
+    int                         transition_count;   /**< 转换数 */
+    int                         initial;            /**< 初始状态 */
+    void*                       user_data;          /**< 传给动作和守卫的用户数据 */
+} em_hsm_config_t;
+
+/**
+ * @brief 状态机统计信息
+ */
+typedef struct {
+    uint64_t events;            /**< 分发给状态机的事件数 */
+    uint64_t transitions;       /**< 执行的转换数(含内部转换) */
+    uint64_t unhandled;         /**< 没有匹配的转换而被忽略的事件数 */
+    uint64_t deferred;          /**< 转换过程中到达而延后处理的事件数 */
+    uint64_t dropped;           /**< 延后队列已满或数据无法复制而丢弃的事件数 */
+} em_hsm_stats_t;
+
+/*============================================================================
+ *                              API函数声明
+ *============================================================================*/
+
+/**
+ * @brief 创建状态机并进入初始状态
+ * 
+ * 校验状态表和转换表，计算查找表，然后在调用线程中逐级执行初始状态的进入动作。
+ * handle 非NULL时订阅转换表中出现的事件ID，由该管理器的分发线程驱动状态机。
+ * 
+ * @param handle 事件管理器句柄(NULL表示不订阅，只通过 em_hsm_dispatch 驱动)
+ * @param config 配置
+ * @return em_hsm_t* 状态机，表无效(父状态成环、嵌套过深、初始子状态不是直接子状态、
+ *                   编号越界)或订阅失败时返回NULL
+ * 
+ * @code
+ * enum { S_OFF, S_ON, S_IDLE, S_BUSY };
+ * static const em_hsm_state_t states[] = {
+ *     [S_OFF]  = { "off",  EM_HSM_NONE, EM_HSM_NONE, NULL,     NULL },
+ *     [S_ON]   = { "on",   EM_HSM_NONE, S_IDLE,      power_on, power_off },
+ *     [S_IDLE] = { "idle", S_ON,        EM_HSM_NONE, NULL,     NULL },
+ *     [S_BUSY] = { "busy", S_ON,        EM_HSM_NONE, NULL,     NULL },
+ * };
+ * static const em_hsm_transition_t transitions[] = {
+ *     { S_OFF,  EVENT_POWER, S_ON,   NULL,     NULL },
+ *     { S_ON,   EVENT_POWER, S_OFF,  NULL,     NULL },    // idle 和 busy 都继承
+ *     { S_IDLE, EVENT_JOB,   S_BUSY, has_work, start_job },
+ *     { S_BUSY, EVENT_DONE,  S_IDLE, NULL,     NULL },
+ * };
+ * em_hsm_config_t cfg = { states, 4, transitions, 4, S_OFF, &device };
+ * em_hsm_t* hsm = em_hsm_create(em, &cfg);
+ * @endcode
+ */
+em_hsm_t* em_hsm_create(em_handle_t handle, const em_hsm_config_t* config);
+
+/**
+ * @brief 销毁状态机(不执行退出动作)
+ * 
+ * @param hsm 状态机
+ * @return em_error_t 错误码
+ * 
+ * @note 应在事件管理器销毁之前调用。不能在本状态机的动作或守卫中调用；
+ *       其他线程可能正在分发该状态机订阅的事件时，应先停止事件循环。
+ *       同一管理器上最后一个状态机销毁时释放共用的订阅集合。
+ */
+em_error_t em_hsm_destroy(em_hsm_t* hsm);
+
+/**
+ * @brief 向状态机分发一个事件
+ * 
+ * 在调用线程中完成查表和转换。在本状态机的动作中调用时，事件放入延后队列，当前事件
+ * 处理完后再处理，data_size 字节的数据复制到延后队列中(data_size 为0时只保存指针，
+ * 由调用方保证数据届时仍然有效)。
+ * 
+ * 动作中同步发布的事件被管理器转发回本状态机时，数据长度未知且在回调返回后失效：
+ * 不带数据的事件照常延后，带数据的事件被丢弃并计入 dropped。需要携带数据时
+ * 应直接调用本函数或改用 em_publish_async。
+ * 
+ * @param hsm 状态机
+ * @param event_id 事件ID
+ * @param data 事件数据
+ * @param data_size 延后时复制的数据长度(0表示只保存指针，不超过 EM_HSM_DEFER_DATA_SIZE)
+ * @return em_error_t EM_OK 表示已处理或已延后，EM_ERR_NOT_FOUND 表示当前状态没有匹配的转换，
+ *                    延后队列已满返回 EM_ERR_QUEUE_FULL，需要延后而数据超长返回 EM_ERR_NOT_SUPPORTED
+ */
+em_error_t em_hsm_dispatch(em_hsm_t* hsm, em_event_id_t event_id,
+                           em_event_data_t data, size_t data_size);
+
+/**
+ * @brief 获取当前(叶子)状态
+ * 
+ * @param hsm 状态机
+ * @return int 状态编号，参数无效返回 EM_HSM_NONE
+ */
+int em_hsm_current(em_hsm_t* hsm);
+
+/**
+ * @brief 判断当前是否处于某状态(当前状态是该状态或其子孙状态)
+ * 
+ * @param hsm 状态机
+ * @param state 状态编号
+ * @return bool 是否处于该状态
+ */
+bool em_hsm_in_state(em_hsm_t* hsm, int state);
+
+/**
+ * @brief 获取状态机统计信息
+ * 
+ * @param hsm 状态机
+ * @param stats 输出
+ * @return em_error_t 错误码
+ */
+em_error_t em_hsm_get_stats(em_hsm_t* hsm, em_hsm_stats_t* stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* EM_HSM_H */
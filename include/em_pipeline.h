@@ -0,0 +1,203 @@
+/**
+ * @file em_pipeline.h
+ * @brief 多级流水线
+ * 
+ * 流水线由若干级(stage)串联而成，相邻两级之间用有界的单生产者/单消费者
+ * 无锁环形队列连接，各级之间不再经过事件管理器的共享队列和互斥锁。
+ * 
+ * - 每一级可以运行在独立(可绑定CPU)的线程上，也可以作为任务由共享的任务线程轮流执行
+ * - 下游队列满时上游阻塞等待，背压逐级传递到 em_pipeline_push
+ * - 等待数据或空位时短暂自旋后在队列上休眠，由另一侧唤醒，空闲时不占用CPU
+ * - 提供每一级的吞吐量和队列占用统计
+ * 
+ * @author 梦里不知身是客
+ * @version 1.0.0
+ * @date 2026
+ * @copyright MIT License
+ */
+
+#ifndef EM_PIPELINE_H
+#define EM_PIPELINE_H
+
+#include "event_manager.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*============================================================================
+ *                              配置宏定义
+ *============================================================================*/
+
+/** 流水线最大级数 */
+#ifndef EM_PIPELINE_MAX_STAGES
+#define EM_PIPELINE_MAX_STAGES      8
+#endif
+
+/** 级间队列默认容量(向上取整为2的幂) */
+#ifndef EM_PIPELINE_DEFAULT_CAPACITY
+#define EM_PIPELINE_DEFAULT_CAPACITY    256
+#endif
+
+/*============================================================================
+ *                              类型定义
+ *============================================================================*/
+
+/**
+ * @brief 级的运行方式
+ */
+typedef enum {
+    EM_STAGE_THREAD = 0,    /**< 独立线程(可绑定CPU) */
+    EM_STAGE_TASK   = 1     /**< 任务 - 由共享的任务线程轮流执行 */
+} em_stage_mode_t;
+
+/**
+ * @brief 级处理函数
+ * 
+ * @param item 输入数据项
+ * @param user_data 用户数据
+ * @return void* 传给下一级的数据项；返回NULL表示数据项已被消费或丢弃。
+ *               最后一级的返回值被忽略，最后一级应自行消费数据项
+ *               (例如发布到事件管理器)
+ */
+typedef void* (*em_stage_fn_t)(void* item, void* user_data);
+
+/**
+ * @brief 级配置
+ * 
+ * 应先用 em_stage_config_init 初始化再修改需要的字段；
+ * 直接清零的配置 cpu 为 0，线程方式的级会被绑定到 CPU 0。
+ */
+typedef struct {
+    const char*     name;       /**< 名称(可为NULL) */
+    em_stage_fn_t   fn;         /**< 处理函数 */
+    void*           user_data;  /**< 用户数据 */
+    em_stage_mode_t mode;       /**< 运行方式 */
+    int             cpu;        /**< 绑定的CPU编号(-1表示不绑定，仅线程方式有效) */
+    size_t          capacity;   /**< 输入队列容量(0表示使用默认值) */
+} em_stage_config_t;
+
+/**
+ * @brief 级统计信息
+ */
+typedef struct {
+    uint64_t items_in;          /**< 已取出的数据项数 */
+    uint64_t items_out;         /**< 已传给下一级(或最后一级已处理)的数据项数 */
+    uint64_t items_dropped;     /**< 处理函数返回NULL的数据项数 */
+    uint64_t stalls;            /**< 输入队列满导致上游等待的次数(背压) */
+    uint64_t throughput;        /**< 启动以来的平均吞吐量(数据项/秒) */
+    uint32_t queue_current;     /**< 输入队列当前占用 */
+    uint32_t queue_max;         /**< 输入队列占用峰值 */
+    uint32_t queue_capacity;    /**< 输入队列容量 */
+} em_stage_stats_t;
+
+/**
+ * @brief 流水线句柄(不透明指针)
+ */
+typedef struct em_pipeline em_pipeline_t;
+
+/*============================================================================
+ *                              API函数声明
+ *============================================================================*/
+
+#if EM_ENABLE_THREADING
+
+/**
+ * @brief 初始化级配置为默认值
+ * 
+ * 线程方式、不绑定CPU(cpu = -1)、使用默认队列容量，其余字段清零。
+ * 
+ * @param config 级配置
+ */
+void em_stage_config_init(em_stage_config_t* config);
+
+/**
+ * @brief 创建流水线
+ * 
+ * @return em_pipeline_t* 流水线，失败返回NULL
+ */
+em_pipeline_t* em_pipeline_create(void);
+
+/**
+ * @brief 销毁流水线(如仍在运行会先停止)
+ * 
+ * @param pipeline 流水线
+ * @return em_error_t 错误码
+ */
+em_error_t em_pipeline_destroy(em_pipeline_t* pipeline);
+
+/**
+ * @brief 在末尾追加一级
+ * 
+ * @param pipeline 流水线
+ * @param config 级配置
+ * @return int 级编号(从0开始)，失败返回-1
+ * 
+ * @note 只能在 em_pipeline_start 之前调用
+ */
+int em_pipeline_add_stage(em_pipeline_t* pipeline, const em_stage_config_t* config);
+
+/**
+ * @brief 启动流水线
+ * 
+ * @param pipeline 流水线
+ * @return em_error_t 错误码
+ */
+em_error_t em_pipeline_start(em_pipeline_t* pipeline);
+
+/**
+ * @brief 停止流水线
+ * 
+ * 已推入的数据项会被逐级处理完，然后各级线程退出。
+ * 
+ * @param pipeline 流水线
+ * @return em_error_t 错误码
+ */
+em_error_t em_pipeline_stop(em_pipeline_t* pipeline);
+
+/**
+ * @brief 向第一级推入数据项(队列满时阻塞，直到有空位)
+ * 
+ * @param pipeline 流水线
+ * @param item 数据项(不能为NULL)
+ * @return em_error_t 错误码
+ * 
+ * @note 第一级队列是单生产者队列，同一时刻只能有一个线程推入
+ */
+em_error_t em_pipeline_push(em_pipeline_t* pipeline, void* item);
+
+/**
+ * @brief 向第一级推入数据项(不阻塞)
+ * 
+ * @param pipeline 流水线
+ * @param item 数据项(不能为NULL)
+ * @return em_error_t 错误码，队列满返回 EM_ERR_QUEUE_FULL
+ */
+em_error_t em_pipeline_try_push(em_pipeline_t* pipeline, void* item);
+
+/**
+ * @brief 获取某一级的统计信息
+ * 
+ * @param pipeline 流水线
+ * @param stage 级编号
+ * @param stats 输出统计信息
+ * @return em_error_t 错误码
+ */
+em_error_t em_pipeline_get_stage_stats(em_pipeline_t* pipeline, int stage,
+                                       em_stage_stats_t* stats);
+
+/**
+ * @brief 获取级数
+ * 
+ * @param pipeline 流水线
+ * @return int 级数，错误时返回-1
+ */
+int em_pipeline_stage_count(em_pipeline_t* pipeline);
+
+#endif /* EM_ENABLE_THREADING */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* EM_PIPELINE_H */
@@ -0,0 +1,209 @@
+/**
+ * @file em_trace.h
+ * @brief 事件流录制与紧凑编码
+ * 
+ * 把事件流编码成紧凑的字节流，用于内存中的录制缓冲和持久化日志：
+ * 
+ * - 时间戳按与上一条记录的差值编码(zigzag + varint)
+ * - 事件ID、数据大小使用 varint；与上一条记录ID相同时省略ID
+ * - 可选：同一事件ID的数据与上一次的数据按字节异或，再对异或结果中的零字节
+ *   做游程编码，适合缓慢变化的传感器数据
+ * 
+ * 编码只依赖前面已经出现的记录，解码端可以边接收边逐条解码，不需要索引或外部库。
+ * 
+ * 流格式：
+ * @verbatim
+ * 流头   : 'E' 'M' 'T' 版本(1) 标志(1)
+ * 记录   : 头字节 [时间差 varint] [事件ID varint] [数据大小 varint] [数据]
+ * 头字节 : bit0-1 优先级, bit2 异步, bit3 事件ID同上一条, bit4 数据为异或编码, bit5 有数据
+ * 异或数据: 重复 [零字节数 varint] [字面字节数 varint] [字面字节]，直到覆盖数据大小
+ * @endverbatim
+ * 
+ * @author 梦里不知身是客
+ * @version 1.0.0
+ * @date 2026
+ * @copyright MIT License
+ */
+
+#ifndef EM_TRACE_H
+#define EM_TRACE_H
+
+#include "event_manager.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*============================================================================
+ *                              配置宏定义
+ *============================================================================*/
+
+/** 参与异或编码的最大数据大小，更大的数据原样写入 */
+#ifndef EM_TRACE_MAX_DELTA_SIZE
+#define EM_TRACE_MAX_DELTA_SIZE     256
+#endif
+
+/** 编码器输出缓冲大小，满后一次交给输出函数 */
+#ifndef EM_TRACE_BUFFER_SIZE
+#define EM_TRACE_BUFFER_SIZE        4096
+#endif
+
+/** 编码标志：同一事件ID的数据做异或差分 */
+#define EM_TRACE_XOR_DELTA          0x01
+
+/*============================================================================
+ *                              类型定义
+ *============================================================================*/
+
+/**
+ * @brief 一条记录
+ */
+typedef struct {
+    uint64_t    timestamp_ns;   /**< 时间戳(纳秒) */
+    em_event_t  event;          /**< 事件(解码时 data 指向解码器内部缓冲，下次解码前有效) */
+} em_trace_record_t;
+
+/**
+ * @brief 编码输出函数
+ * 
+ * @param bytes 编码后的字节
+ * @param size 字节数
+ * @param user_data 用户数据
+ * @return bool 写入成功返回true
+ */
+typedef bool (*em_trace_sink_t)(const void* bytes, size_t size, void* user_data);
+
+/**
+ * @brief 编码统计信息
+ */
+typedef struct {
+    uint64_t records;           /**< 已编码的记录数 */
+    uint64_t raw_bytes;         /**< 按定长格式(时间戳8+ID4+优先级和模式2+大小4+数据)计算的字节数 */
+    uint64_t encoded_bytes;     /**< 编码后的字节数(含流头) */
+    uint64_t delta_records;     /**< 数据使用异或编码的记录数 */
+    uint64_t sink_errors;       /**< 输出函数失败次数(失败时该缓冲中的数据被丢弃) */
+} em_trace_stats_t;
+
+/**
+ * @brief 编码器句柄(不透明指针)
+ */
+typedef struct em_trace_writer em_trace_writer_t;
+
+/**
+ * @brief 解码器句柄(不透明指针)
+ */
+typedef struct em_trace_reader em_trace_reader_t;
+
+/*============================================================================
+ *                              API函数声明
+ *============================================================================*/
+
+/**
+ * @brief 创建编码器
+ * 
+ * @param flags 编码标志(EM_TRACE_XOR_DELTA 或 0)
+ * @param sink 输出函数
+ * @param user_data 传给输出函数的用户数据
+ * @return em_trace_writer_t* 编码器，失败返回NULL
+ */
+em_trace_writer_t* em_trace_writer_create(uint32_t flags, em_trace_sink_t sink, void* user_data);
+
+/**
+ * @brief 输出缓冲中的数据并销毁编码器
+ * 
+ * @param writer 编码器
+ * @return em_error_t 错误码
+ * 
+ * @note 挂接在管理器上的编码器应先用 em_trace_attach(handle, NULL) 解除挂接
+ */
+em_error_t em_trace_writer_destroy(em_trace_writer_t* writer);
+
+/**
+ * @brief 编码一条记录(线程安全)
+ * 
+ * @param writer 编码器
+ * @param record 记录
+ * @return em_error_t 错误码
+ */
+em_error_t em_trace_write(em_trace_writer_t* writer, const em_trace_record_t* record);
+
+/**
+ * @brief 把缓冲中的数据交给输出函数
+ * 
+ * @param writer 编码器
+ * @return em_error_t 错误码，输出函数失败返回 EM_ERR_QUEUE_FULL
+ */
+em_error_t em_trace_flush(em_trace_writer_t* writer);
+
+/**
+ * @brief 获取编码统计信息
+ * 
+ * @param writer 编码器
+ * @param stats 输出统计信息
+ * @return em_error_t 错误码
+ */
+em_error_t em_trace_get_stats(em_trace_writer_t* writer, em_trace_stats_t* stats);
+
+/**
+ * @brief 录制管理器分发的所有事件
+ * 
+ * @param handle 事件管理器句柄
+ * @param writer 编码器(NULL表示停止录制)
+ * @return em_error_t 错误码
+ * 
+ * @code
+ * em_trace_writer_t* w = em_trace_writer_create(EM_TRACE_XOR_DELTA, write_to_file, fp);
+ * em_trace_attach(em, w);
+ * // ... 运行 ...
+ * em_trace_attach(em, NULL);
+ * em_trace_writer_destroy(w);
+ * @endcode
+ */
+em_error_t em_trace_attach(em_handle_t handle, em_trace_writer_t* writer);
+
+/**
+ * @brief 创建解码器
+ * 
+ * @return em_trace_reader_t* 解码器，失败返回NULL
+ */
+em_trace_reader_t* em_trace_reader_create(void);
+
+/**
+ * @brief 销毁解码器
+ * 
+ * @param reader 解码器
+ * @return em_error_t 错误码
+ */
+em_error_t em_trace_reader_destroy(em_trace_reader_t* reader);
+
+/**
+ * @brief 从字节流中解码下一条记录
+ * 
+ * 流头在第一次调用时读取。数据不足一条完整记录时不消耗任何字节，
+ * 调用者补充数据后从同一位置重试。
+ * 
+ * @param reader 解码器
+ * @param bytes 未消耗的字节
+ * @param size 字节数
+ * @param consumed 输出本次消耗的字节数
+ * @param record 输出记录
+ * @return em_error_t EM_OK 表示解码出一条记录，EM_ERR_QUEUE_EMPTY 表示数据不足，
+ *                    EM_ERR_INVALID_PARAM 表示流格式错误
+ * 
+ * @code
+ * size_t pos = 0, used;
+ * em_trace_record_t rec;
+ * while (em_trace_read(r, buf + pos, len - pos, &used, &rec) == EM_OK) {
+ *     pos += used;
+ *     handle_record(&rec);
+ * }
+ * @endcode
+ */
+em_error_t em_trace_read(em_trace_reader_t* reader, const void* bytes, size_t size,
+                         size_t* consumed, em_trace_record_t* record);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* EM_TRACE_H */
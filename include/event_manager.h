@@ -39,11 +39,156 @@ extern "C" {
 #define EM_MAX_SUBSCRIBERS      16
 #endif
 
+/** 每个管理器最多的订阅组数 */
+#ifndef EM_MAX_GROUPS
+#define EM_MAX_GROUPS           8
+#endif
+
+/** 每个订阅组最多的成员数(所有事件合计) */
+#ifndef EM_MAX_GROUP_MEMBERS
+#define EM_MAX_GROUP_MEMBERS    16
+#endif
+
 /** 异步事件队列大小 */
 #ifndef EM_ASYNC_QUEUE_SIZE
 #define EM_ASYNC_QUEUE_SIZE     32
 #endif
 
+/** 每个优先级异步队列可调整到的最大容量 */
+#ifndef EM_MAX_QUEUE_CAPACITY
+#define EM_MAX_QUEUE_CAPACITY   65536
+#endif
+
+/** 执行器收件箱默认容量(向上取整为2的幂) */
+#ifndef EM_EXECUTOR_DEFAULT_CAPACITY
+#define EM_EXECUTOR_DEFAULT_CAPACITY    64
+#endif
+
+/** 每个事件管理器可挂接的执行器数量上限 */
+#ifndef EM_MAX_EXECUTORS
+#define EM_MAX_EXECUTORS        8
+#endif
+
+/** Actor 每次被调度时最多连续处理的消息数 */
+#ifndef EM_ACTOR_BATCH_SIZE
+#define EM_ACTOR_BATCH_SIZE     16
+#endif
+
+/** 负载控制默认的 HIGH 排队延迟目标(微秒) */
+#ifndef EM_SHED_DEFAULT_TARGET_US
+#define EM_SHED_DEFAULT_TARGET_US       2000
+#endif
+
+/** 负载控制默认的观察窗口(微秒) */
+#ifndef EM_SHED_DEFAULT_INTERVAL_US
+#define EM_SHED_DEFAULT_INTERVAL_US     100000
+#endif
+
+/** 热点事件统计保留的事件数(按次数、按字节数各一张表) */
+#ifndef EM_TOP_EVENTS_K
+#define EM_TOP_EVENTS_K                 16
+#endif
+
+/** 热点事件统计的 count-min sketch 每行计数器数 */
+#ifndef EM_TOP_SKETCH_WIDTH
+#define EM_TOP_SKETCH_WIDTH             256
+#endif
+
+/** 热点事件统计的 count-min sketch 行数 */
+#ifndef EM_TOP_SKETCH_DEPTH
+#define EM_TOP_SKETCH_DEPTH             4
+#endif
+
+/** 老化调度默认的提升一级所需等待时间(微秒) */
+#ifndef EM_SCHED_AGING_STEP_US
+#define EM_SCHED_AGING_STEP_US          1000
+#endif
+
+/** 事件循环单批最多处理的事件数 */
+#ifndef EM_DRAIN_BATCH_MAX
+#define EM_DRAIN_BATCH_MAX              64
+#endif
+
+/** 事件循环单批分发耗时的默认目标(微秒) */
+#ifndef EM_DRAIN_LATENCY_TARGET_US
+#define EM_DRAIN_LATENCY_TARGET_US      1000
+#endif
+
+/** 事件循环线程上等待内联分发的事件数上限(em_publish_auto) */
+#ifndef EM_INLINE_DEPTH
+#define EM_INLINE_DEPTH                 16
+#endif
+
+/** em_publish_from_isr 每个事件内联复制的最大数据长度(字节，不超过255) */
+#ifndef EM_ISR_PAYLOAD_SIZE
+#define EM_ISR_PAYLOAD_SIZE             32
+#endif
+
+/** em_publish_from_isr 环形缓冲区的最大槽数 */
+#ifndef EM_ISR_RING_MAX
+#define EM_ISR_RING_MAX                 65536
+#endif
+
+/** 启用环形缓冲区后非 epoll 事件循环和工作线程单次等待的上限(微秒) */
+#ifndef EM_ISR_POLL_US
+#define EM_ISR_POLL_US                  1000
+#endif
+
+/** 弹性工作线程池的最大线程数 */
+#ifndef EM_MAX_WORKERS
+#define EM_MAX_WORKERS                  16
+#endif
+
+/** 工作线程默认的空闲停放时间(微秒) */
+#ifndef EM_WORKER_IDLE_PARK_US
+#define EM_WORKER_IDLE_PARK_US          100000
+#endif
+
+/** 自旋锁在 futex 休眠前的自旋次数 */
+#ifndef EM_LOCK_SPIN_COUNT
+#define EM_LOCK_SPIN_COUNT              100
+#endif
+
+/** 每个管理器最多注册的生产者数 */
+#ifndef EM_MAX_PRODUCERS
+#define EM_MAX_PRODUCERS                16
+#endif
+
+/** 启用自动批量时最多同时拥有暂存区的发布线程数(更多的线程直接入队，线程退出后槽位可复用) */
+#ifndef EM_MAX_STAGE_THREADS
+#define EM_MAX_STAGE_THREADS            16
+#endif
+
+/** 自动批量默认的最长暂存时间(微秒) */
+#ifndef EM_AUTO_BATCH_DEFAULT_DELAY_US
+#define EM_AUTO_BATCH_DEFAULT_DELAY_US  1000
+#endif
+
+/** em_publish_group 一组最多的事件数 */
+#ifndef EM_MAX_GROUP_SIZE
+#define EM_MAX_GROUP_SIZE               16
+#endif
+
+/** 最多同时等待的延时事件数 */
+#ifndef EM_MAX_TIMERS
+#define EM_MAX_TIMERS                   1024
+#endif
+
+/** 每个管理器最多注册的文件描述符数据源数(仅 epoll 构建) */
+#ifndef EM_MAX_FD_SOURCES
+#define EM_MAX_FD_SOURCES               8
+#endif
+
+/** 文件描述符数据源每次就绪最多读取的帧数(readv 的块数 / recvmmsg 的消息数) */
+#ifndef EM_FD_READ_BATCH
+#define EM_FD_READ_BATCH                16
+#endif
+
+/** 文件描述符数据源因数据块用尽暂停读取后，重新监听前等待的时间(微秒) */
+#ifndef EM_FD_STALL_RETRY_US
+#define EM_FD_STALL_RETRY_US            1000
+#endif
+
 /** 是否启用多线程支持 (1=启用, 0=禁用) */
 #ifndef EM_ENABLE_THREADING
 #define EM_ENABLE_THREADING     1
@@ -104,7 +249,11 @@ typedef enum {
     EM_ERR_QUEUE_EMPTY      = -6,   /**< 队列为空 */
     EM_ERR_MAX_SUBSCRIBERS  = -7,   /**< 订阅者已达上限 */
     EM_ERR_NOT_FOUND        = -8,   /**< 未找到 */
-    EM_ERR_MUTEX_FAILED     = -9    /**< 互斥锁操作失败 */
+    EM_ERR_MUTEX_FAILED     = -9,   /**< 互斥锁操作失败 */
+    EM_ERR_OVERLOADED       = -10,  /**< 过载，事件被负载控制丢弃 */
+    EM_ERR_NOT_SUPPORTED    = -11,  /**< 当前配置不支持该操作 */
+    EM_ERR_TIMEOUT          = -12,  /**< 等待超时 */
+    EM_SUPPRESSED           = 1     /**< 数据与上次相同，发布被抑制(不是错误) */
 } em_error_t;
 
 /** 事件类型ID */
@@ -133,6 +282,34 @@ typedef struct {
     em_mode_t       mode;       /**< 处理模式 */
 } em_event_t;
 
+/**
+ * @brief 事件记录钩子
+ * 
+ * 每个事件分发前调用一次(同步事件 data_size 为0)，在分发线程中执行，
+ * 可能被多个工作线程并发调用。em_trace 模块用它录制事件流。
+ * 
+ * @param event 事件(data 指向数据副本，仅在调用期间有效)
+ * @param timestamp_ns 管理器时间源的当前时间
+ * @param user_data 设置钩子时传入的用户数据
+ */
+typedef void (*em_trace_hook_t)(const em_event_t* event, uint64_t timestamp_ns, void* user_data);
+
+/**
+ * @brief 执行器(不透明类型)
+ * 
+ * 执行器持有一个无锁收件箱，订阅到执行器上的回调不会在分发线程中执行，
+ * 而是被投递到收件箱，由执行器所属的线程取出执行。
+ */
+typedef struct em_executor em_executor_t;
+
+/**
+ * @brief Actor(不透明类型)
+ * 
+ * Actor 拥有私有状态和一个 MPSC 邮箱，由共享工作线程池调度，
+ * 同一时刻最多只在一个工作线程上运行，因此处理函数访问状态无需加锁。
+ */
+typedef struct em_actor em_actor_t;
+
 /**
  * @brief 订阅者结构体
  */
@@ -141,6 +318,7 @@ typedef struct {
     void*           user_data;  /**< 用户数据 */
     em_priority_t   priority;   /**< 订阅者优先级 */
     bool            active;     /**< 是否激活 */
+    em_executor_t*  executor;   /**< 回调执行器(NULL表示在分发线程中直接执行) */
 } em_subscriber_t;
 
 /**
@@ -152,13 +330,294 @@ typedef struct {
     uint32_t async_queue_current;   /**< 当前异步队列中的事件数 */
     uint32_t async_queue_max;       /**< 异步队列峰值 */
     uint32_t subscribers_total;     /**< 总订阅者数 */
+    uint32_t executor_dropped;      /**< 因执行器收件箱已满而丢弃的回调数 */
+    uint32_t queue_wait_avg_us[EM_PRIORITY_COUNT];  /**< 各优先级排队延迟(滑动平均，微秒) */
+    uint32_t queue_wait_max_us[EM_PRIORITY_COUNT];  /**< 各优先级排队延迟峰值(微秒) */
+    uint32_t events_shed[EM_PRIORITY_COUNT];        /**< 负载控制在发布时丢弃的事件数 */
+    uint32_t shed_level;            /**< 当前丢弃级别(0=不丢弃, 1=丢弃LOW, 2=丢弃LOW和NORMAL) */
+    uint32_t drain_batch_current;   /**< 事件循环最近一批处理的事件数 */
+    uint32_t drain_batch_max;       /**< 事件循环单批处理事件数峰值 */
+    uint32_t drain_batches;         /**< 事件循环已处理的批数 */
+    uint32_t workers_active;        /**< 弹性工作线程池中未停放的线程数 */
+    uint32_t workers_peak;          /**< 弹性工作线程池活动线程数峰值 */
+    uint32_t queue_capacity[EM_PRIORITY_COUNT];     /**< 各优先级异步队列当前容量 */
+    uint32_t queue_resizes;         /**< 异步队列容量调整次数 */
+    uint32_t timers_pending;        /**< 尚未到期的延时事件数 */
+    uint32_t timers_dropped;        /**< 到期时队列已满而丢弃的延时事件数 */
+    uint32_t payload_pool_free;     /**< 数据块池当前空闲块数 */
+    uint32_t payload_pool_oversize; /**< 超过块大小而改用 malloc 的数据副本数 */
+    uint32_t payload_pool_exhausted[EM_PRIORITY_COUNT]; /**< 数据块池无可用块而失败的发布数 */
+    uint32_t auto_batch_flushes;    /**< 自动批量暂存区刷新次数 */
+    uint32_t auto_batch_dropped;    /**< 刷新时入队失败而丢弃的暂存事件数 */
+    uint32_t wake_signals;          /**< 唤醒消费者的条件变量 signal 次数 */
+    uint32_t eventfd_writes;        /**< eventfd 写入次数(仅 epoll 构建) */
+    uint32_t eventfd_reads;         /**< eventfd 读取次数(仅 epoll 构建) */
+    uint32_t wakeups;               /**< 事件循环和工作线程从等待中醒来的次数 */
+    uint32_t wakeups_empty;         /**< 醒来后没有处理任何事件的次数(超时或虚假唤醒) */
+    uint32_t wait_timeouts;         /**< 等待超时次数(epoll_wait 返回0或条件变量超时) */
+    uint32_t wakeup_events;         /**< 醒来后处理的事件数之和(除以 wakeups 即每次唤醒处理的事件数) */
+    uint32_t fd_reads;              /**< 文件描述符数据源的读系统调用次数(read/readv/recvmmsg) */
+    uint32_t fd_events;             /**< 文件描述符数据源发布的事件数 */
+    uint32_t fd_dropped;            /**< 文件描述符数据源丢弃的帧数(数据报被截断、队列满或负载控制) */
+    uint32_t fd_closed;             /**< 因对端关闭、读错误或长度前缀超限而自动移除的数据源数 */
+    uint32_t fd_stalls;             /**< 文件描述符数据源因数据块用尽而暂停读取的次数 */
+    uint32_t events_suppressed;     /**< 数据未变化而被抑制的发布数 */
+    uint32_t events_inlined;        /**< em_publish_auto 跳过队列直接分发的事件数 */
+    uint32_t isr_events;            /**< em_publish_from_isr 写入环形缓冲区的事件数 */
+    uint32_t isr_dropped;           /**< 环形缓冲区已满，或转入队列时失败而丢弃的事件数 */
 } em_stats_t;
 
+/**
+ * @brief 生产者配额配置
+ * 
+ * 每个优先级队列的容量分为各生产者的预留槽位和共享槽位。生产者在自身预留内
+ * 总能入队，超出预留的事件与未绑定生产者的事件竞争共享槽位；limit 限制
+ * 生产者在队列中同时占用的事件数。
+ */
+typedef struct {
+    uint32_t reserved[EM_PRIORITY_COUNT];   /**< 各优先级预留槽位数 */
+    uint32_t limit[EM_PRIORITY_COUNT];      /**< 各优先级占用上限(0表示不限) */
+} em_producer_config_t;
+
+/**
+ * @brief 生产者统计信息
+ */
+typedef struct {
+    uint32_t queued[EM_PRIORITY_COUNT];     /**< 当前在队列中的事件数 */
+    uint32_t rejected[EM_PRIORITY_COUNT];   /**< 因配额或共享槽位不足被拒绝的事件数 */
+    uint32_t published;                     /**< 已入队的事件数 */
+} em_producer_stats_t;
+
+/**
+ * @brief 异步队列自动扩容配置
+ * 
+ * 发布时某优先级队列的占用达到 high_watermark_pct% 时容量翻倍，不超过 max_capacity。
+ */
+typedef struct {
+    bool     enabled;               /**< 是否启用 */
+    uint32_t high_watermark_pct;    /**< 高水位(容量百分比，0表示75) */
+    uint32_t max_capacity;          /**< 容量上限(0表示 EM_MAX_QUEUE_CAPACITY) */
+} em_queue_autogrow_t;
+
+/**
+ * @brief 事件循环批量策略
+ * 
+ * em_run_loop 每次加锁取出一批事件再在锁外分发。队列持续积压时批量逐步增大以摊薄
+ * 加锁开销；HIGH 事件在分发期间到达并等待，或单批分发耗时超过目标时批量减半。
+ * min_batch 等于 max_batch 时为固定批量。
+ */
+typedef struct {
+    uint32_t min_batch;         /**< 最小批量(0表示1) */
+    uint32_t max_batch;         /**< 最大批量(0表示 EM_DRAIN_BATCH_MAX，不超过该值) */
+    uint32_t latency_target_us; /**< 单批分发耗时目标(微秒，0表示使用默认值) */
+} em_batch_policy_t;
+
+/**
+ * @brief 发布端自动批量配置
+ * 
+ * 启用后 em_publish_async 把 NORMAL/LOW 事件先放入调用线程的暂存区，攒够一批或
+ * 暂存超时后一次加锁入队并只唤醒一次消费者。发布 HIGH 事件或事件组(em_publish_group)时先刷新暂存区。
+ */
+typedef struct {
+    bool     enabled;           /**< 是否启用 */
+    uint32_t max_events;        /**< 暂存区容量(0表示 EM_MAX_GROUP_SIZE，不超过该值) */
+    uint32_t max_delay_us;      /**< 最长暂存时间(微秒，0表示使用默认值) */
+} em_auto_batch_t;
+
+/**
+ * @brief 负载控制配置
+ * 
+ * 按出队时测得的排队延迟自动调整：HIGH 事件的排队延迟在整个观察窗口内
+ * 都超过目标时，先在发布处丢弃 LOW，再丢弃 NORMAL；延迟恢复后逐级恢复。
+ */
+typedef struct {
+    bool     enabled;       /**< 是否启用 */
+    uint32_t target_us;     /**< HIGH 排队延迟目标(微秒，0表示使用默认值) */
+    uint32_t interval_us;   /**< 观察窗口(微秒，0表示使用默认值) */
+} em_shed_config_t;
+
+/**
+ * @brief 热点事件排序依据
+ */
+typedef enum {
+    EM_TOP_BY_COUNT = 0,    /**< 按发布次数 */
+    EM_TOP_BY_BYTES = 1     /**< 按数据字节数 */
+} em_top_order_t;
+
+/**
+ * @brief 热点事件(估计值，只会偏大)
+ */
+typedef struct {
+    em_event_id_t id;       /**< 事件ID */
+    uint64_t      count;    /**< 发布次数 */
+    uint64_t      bytes;    /**< 数据字节数(同步事件计0) */
+} em_top_event_t;
+
+/**
+ * @brief 内置出队调度策略
+ * 
+ * 事件仍按优先级存放在各自的队列中(同优先级先进先出)，调度策略只决定下一个从哪个优先级出队。
+ */
+typedef enum {
+    EM_SCHED_STRICT = 0,    /**< 严格优先级(默认)：HIGH 空了才处理 NORMAL，依此类推 */
+    EM_SCHED_FIFO   = 1,    /**< 全局先进先出：按入队时间出队，忽略优先级 */
+    EM_SCHED_AGING  = 2,    /**< 老化：每多等待 aging_step_us 相当于提升一级优先级 */
+    EM_SCHED_WFQ    = 3,    /**< 加权公平：积压时各优先级按 weights 比例分享出队次数 */
+    EM_SCHED_EDF    = 4     /**< 最早截止优先：截止时间为入队时间加该优先级的 deadline_us */
+} em_sched_policy_t;
+
+/**
+ * @brief 内置调度策略的参数(0表示使用默认值)
+ */
+typedef struct {
+    uint32_t aging_step_us;                 /**< AGING：提升一级所需等待时间(默认 EM_SCHED_AGING_STEP_US) */
+    uint32_t weights[EM_PRIORITY_COUNT];    /**< WFQ：各优先级权重(默认 4:2:1) */
+    uint32_t deadline_us[EM_PRIORITY_COUNT];/**< EDF：各优先级的相对截止时间(默认 1ms/10ms/100ms) */
+} em_sched_config_t;
+
+/**
+ * @brief 调度器回调看到的队列状态(不透明，只能在回调中通过 em_sched_* 函数读取)
+ */
+typedef struct em_sched_view em_sched_view_t;
+
+/**
+ * @brief 自定义调度器
+ * 
+ * 回调在持有管理器锁时调用，不能调用除 em_sched_* 以外的 API。
+ */
+typedef struct {
+    const char* name;   /**< 名称(调试用) */
+    
+    /**
+     * @brief 事件进入 priority 队列后调用(可为NULL)
+     */
+    void (*enqueue)(void* ctx, const em_sched_view_t* view, em_priority_t priority);
+    
+    /**
+     * @brief 决定接下来依次从哪些优先级出队
+     * 
+     * @param order 输出出队顺序，每个优先级出现的次数不超过 em_sched_size
+     * @param max 最多输出的个数
+     * @return int 输出的个数；返回0而队列非空时按严格优先级出队，保证不会停滞
+     */
+    int (*dequeue_batch)(void* ctx, const em_sched_view_t* view, em_priority_t* order, int max);
+} em_scheduler_ops_t;
+
+/**
+ * @brief 订阅组的成员选择策略
+ */
+typedef enum {
+    EM_GROUP_ROUND_ROBIN    = 0,    /**< 轮流投递给各成员(默认) */
+    EM_GROUP_LEAST_LOADED   = 1,    /**< 投递给正在执行的回调最少的成员 */
+    EM_GROUP_KEY_HASH       = 2     /**< 按键值哈希选择成员，同一键值总由同一成员处理 */
+} em_group_policy_t;
+
+/**
+ * @brief 订阅组的键值函数(EM_GROUP_KEY_HASH 使用)
+ * 
+ * 在持有管理器锁时调用，只应根据事件数据计算键值，不得调用事件管理器 API。
+ */
+typedef uint32_t (*em_group_key_fn_t)(em_event_id_t event_id, em_event_data_t data);
+
 /**
  * @brief 事件管理器句柄(不透明指针)
  */
 typedef struct em_manager* em_handle_t;
 
+/**
+ * @brief 弹性工作线程池配置
+ * 
+ * 队列积压达到 scale_up_depth 或最老事件的排队时间达到 scale_up_wait_us，
+ * 并且持续 scale_up_hold_us 后增加一个活动线程(优先唤醒停放的线程)；
+ * 每次扩容后需再持续一个 hold 周期才会继续扩容。
+ * 线程空闲超过 idle_park_us 且活动线程多于 min_workers 时停放。
+ * 各字段为0时使用默认值。
+ */
+typedef struct {
+    int      min_workers;       /**< 常驻线程数(默认1) */
+    int      max_workers;       /**< 最大线程数(默认且不超过 EM_MAX_WORKERS) */
+    uint32_t scale_up_depth;    /**< 扩容的队列积压阈值(默认 EM_ASYNC_QUEUE_SIZE/2) */
+    uint32_t scale_up_wait_us;  /**< 扩容的排队时间阈值(微秒，默认1000) */
+    uint32_t scale_up_hold_us;  /**< 压力需持续的时间(微秒，默认10000) */
+    uint32_t idle_park_us;      /**< 空闲停放时间(微秒，默认 EM_WORKER_IDLE_PARK_US) */
+} em_worker_pool_config_t;
+
+/**
+ * @brief 时间源
+ * 
+ * 用于排队延迟、负载控制等需要在每次发布/分发时取时间戳的功能。
+ */
+typedef enum {
+    EM_CLOCK_MONOTONIC          = 0,    /**< clock_gettime(CLOCK_MONOTONIC)，Linux 上走 vDSO */
+    EM_CLOCK_MONOTONIC_COARSE   = 1,    /**< CLOCK_MONOTONIC_COARSE，精度为一个时钟节拍 */
+    EM_CLOCK_TSC                = 2     /**< 校准后的不变 TSC(仅 x86-64，不可用时回退) */
+} em_clock_source_t;
+
+/**
+ * @brief 管理器锁类型
+ * 
+ * 保护订阅表、队列和统计信息的锁。等待(事件循环、工作线程)不依赖锁的类型。
+ */
+typedef enum {
+    EM_LOCK_MUTEX   = 0,    /**< pthread 互斥锁 */
+    EM_LOCK_RWLOCK  = 1,    /**< 读写锁：分发时复制订阅者和查询持读锁，其余持写锁 */
+    EM_LOCK_SPIN    = 2,    /**< 先自旋 EM_LOCK_SPIN_COUNT 次再 futex 休眠(仅 Linux，不可用时回退) */
+    EM_LOCK_NONE    = 3     /**< 不加锁，管理器只能在一个线程中使用 */
+} em_lock_type_t;
+
+/**
+ * @brief 创建参数
+ * 
+ * 先用 em_config_init 填充默认值再修改需要的字段。
+ */
+typedef struct {
+    em_clock_source_t clock_source;     /**< 时间源(默认 EM_CLOCK_MONOTONIC) */
+    em_lock_type_t lock_type;           /**< 管理器锁类型(默认 EM_LOCK_MUTEX) */
+    bool    virtual_time;               /**< 使用虚拟时钟，只由 em_advance_time 推进(默认 false) */
+    bool    virtual_auto_advance;       /**< 虚拟时钟下队列空闲时自动跳到下一个延时事件的到期时间 */
+    uint32_t payload_pool_blocks;       /**< 异步事件数据块池的块数(0表示不使用块池，直接 malloc) */
+    uint32_t payload_block_size;        /**< 每块的数据区大小(字节)，更大的数据改用 malloc */
+    /** 
+     * 为各优先级保留的块数：低优先级分配后必须为所有更高优先级留下各自的保留块，
+     * HIGH 可以使用全部空闲块，LOW 只能使用保留之外的部分(LOW 一项不起作用)
+     */
+    uint32_t payload_reserved[EM_PRIORITY_COUNT];
+    uint32_t isr_ring_size;             /**< em_publish_from_isr 预分配的槽数(向上取2的幂，0表示不启用) */
+} em_config_t;
+
+/**
+ * @brief 文件描述符数据源的分帧方式
+ */
+typedef enum {
+    EM_FD_FRAME_FIXED       = 0,    /**< 定长帧：每 frame_size 字节一个事件(readv 一次读入多帧) */
+    EM_FD_FRAME_LENGTH      = 1,    /**< 长度前缀帧：length_bytes 字节的大端长度后跟数据 */
+    EM_FD_FRAME_DATAGRAM    = 2     /**< 数据报：每个数据报一个事件(recvmmsg，仅套接字) */
+} em_fd_framing_t;
+
+/**
+ * @brief 文件描述符数据源配置
+ * 
+ * 数据从内核直接读入异步事件的数据块(启用数据块池时从块池分配)，
+ * 不再经过用户缓冲和 em_publish_async 的复制。
+ */
+typedef struct {
+    em_event_id_t   event_id;       /**< 发布的事件ID */
+    em_priority_t   priority;       /**< 发布的优先级 */
+    em_fd_framing_t framing;        /**< 分帧方式 */
+    uint32_t        frame_size;     /**< 定长帧的大小；长度前缀帧和数据报的最大大小 */
+    uint8_t         length_bytes;   /**< 长度前缀的字节数(1、2或4，0表示4) */
+} em_fd_source_config_t;
+
+/**
+ * @brief 长度前缀帧和数据报事件的数据布局
+ * 
+ * 回调只收到数据指针，因此变长帧的长度随数据一起交付；定长帧的数据就是帧本身。
+ */
+typedef struct {
+    uint32_t size;      /**< 帧长度 */
+    uint8_t  data[];    /**< 帧数据 */
+} em_frame_t;
+
 /*============================================================================
  *                              API函数声明
  *============================================================================*/
@@ -179,6 +638,28 @@ typedef struct em_manager* em_handle_t;
  */
 em_handle_t em_create(void);
 
+/**
+ * @brief 用默认值初始化创建参数
+ * 
+ * @param config 创建参数
+ */
+void em_config_init(em_config_t* config);
+
+/**
+ * @brief 按创建参数创建事件管理器实例
+ * 
+ * @param config 创建参数(NULL表示全部使用默认值)
+ * @return em_handle_t 事件管理器句柄，失败(包括保留块数之和不小于块数)返回NULL
+ * 
+ * @code
+ * em_config_t cfg;
+ * em_config_init(&cfg);
+ * cfg.clock_source = EM_CLOCK_TSC;
+ * em_handle_t em = em_create_with_config(&cfg);
+ * @endcode
+ */
+em_handle_t em_create_with_config(const em_config_t* config);
+
 /**
  * @brief 销毁事件管理器实例
  * 
@@ -213,6 +694,39 @@ em_error_t em_subscribe(em_handle_t handle,
                         void* user_data,
                         em_priority_t priority);
 
+/**
+ * @brief 订阅事件，并指定回调的执行器
+ * 
+ * 事件分发时不会在分发线程中调用回调，而是把调用直接投递到执行器的
+ * 无锁收件箱中，由执行器所属线程执行，从而避免回调内部再次转发。
+ * 
+ * @param handle 事件管理器句柄
+ * @param event_id 要订阅的事件ID
+ * @param callback 回调函数
+ * @param user_data 用户数据(可选)
+ * @param priority 订阅者优先级
+ * @param executor 执行器(NULL等同于 em_subscribe)
+ * @return em_error_t 错误码
+ * 
+ * @note 异步事件的数据副本会保留到执行器执行完回调后才释放；
+ *       同步事件只投递数据指针，调用者需保证数据在回调执行前有效。
+ *       同一回调可以分别订阅到不同的执行器上。
+ * 
+ * @code
+ * em_executor_t* gui = em_executor_create(NULL, 0);
+ * em_subscribe_on(em, EVENT_SENSOR, on_sensor, NULL, EM_PRIORITY_NORMAL, gui);
+ * 
+ * // GUI 线程的主循环中
+ * em_executor_run(gui, 0);
+ * @endcode
+ */
+em_error_t em_subscribe_on(em_handle_t handle,
+                           em_event_id_t event_id,
+                           em_callback_t callback,
+                           void* user_data,
+                           em_priority_t priority,
+                           em_executor_t* executor);
+
 /**
  * @brief 取消订阅事件
  * 
@@ -226,7 +740,24 @@ em_error_t em_unsubscribe(em_handle_t handle,
                           em_callback_t callback);
 
 /**
- * @brief 取消某事件的所有订阅
+ * @brief 取消指定执行器上的订阅
+ * 
+ * @param handle 事件管理器句柄
+ * @param event_id 事件ID
+ * @param callback 要取消的回调函数
+ * @param executor 订阅时指定的执行器(NULL表示 em_subscribe 的直接订阅)
+ * @return em_error_t 错误码
+ * 
+ * @note 同一回调订阅到多个执行器时，em_unsubscribe 只移除第一个匹配回调的订阅，
+ *       不区分执行器；需要取消特定执行器上的订阅时使用本函数。
+ */
+em_error_t em_unsubscribe_on(em_handle_t handle,
+                             em_event_id_t event_id,
+                             em_callback_t callback,
+                             em_executor_t* executor);
+
+/**
+ * @brief 取消某事件的所有订阅(包括订阅组成员)
  * 
  * @param handle 事件管理器句柄
  * @param event_id 事件ID
@@ -234,6 +765,68 @@ em_error_t em_unsubscribe(em_handle_t handle,
  */
 em_error_t em_unsubscribe_all(em_handle_t handle, em_event_id_t event_id);
 
+/**
+ * @brief 以订阅组成员的身份订阅事件
+ * 
+ * 普通订阅者各自收到每个事件；同一订阅组的成员互相竞争，每个事件只投递给组内
+ * 一个成员，由组的策略选择。组成员在该事件的普通订阅者之后执行。配合弹性工作
+ * 线程池，不同事件的组成员回调在不同工作线程上并行执行。
+ * 
+ * 订阅组在第一次使用时创建，默认策略为 EM_GROUP_ROUND_ROBIN，可用
+ * em_set_group_policy 修改。同一回调可以用不同的 user_data 多次加入同一组。
+ * 
+ * @param handle 事件管理器句柄
+ * @param event_id 事件ID
+ * @param group_id 订阅组ID(不能为0)
+ * @param callback 回调函数
+ * @param user_data 用户数据
+ * @return em_error_t 错误码，订阅组或成员已满返回 EM_ERR_MAX_SUBSCRIBERS
+ * 
+ * @code
+ * for (int i = 0; i < 4; i++) {
+ *     em_subscribe_group(em, EVENT_JOB, GROUP_WORKERS, on_job, &ctx[i]);
+ * }
+ * em_worker_pool_start(em, NULL);
+ * @endcode
+ */
+em_error_t em_subscribe_group(em_handle_t handle,
+                              em_event_id_t event_id,
+                              uint32_t group_id,
+                              em_callback_t callback,
+                              void* user_data);
+
+/**
+ * @brief 退出订阅组
+ * 
+ * @param handle 事件管理器句柄
+ * @param event_id 事件ID
+ * @param group_id 订阅组ID
+ * @param callback 加入时的回调函数
+ * @param user_data 加入时的用户数据
+ * @return em_error_t 错误码
+ */
+em_error_t em_unsubscribe_group(em_handle_t handle,
+                                em_event_id_t event_id,
+                                uint32_t group_id,
+                                em_callback_t callback,
+                                void* user_data);
+
+/**
+ * @brief 设置订阅组的成员选择策略(订阅组不存在时创建)
+ * 
+ * @param handle 事件管理器句柄
+ * @param group_id 订阅组ID(不能为0)
+ * @param policy 选择策略
+ * @param key_fn 键值函数(EM_GROUP_KEY_HASH 必须提供，其他策略忽略)
+ * @return em_error_t 错误码
+ * 
+ * @note 键值哈希按当前成员数取模，成员增减后部分键值会改由其他成员处理
+ */
+em_error_t em_set_group_policy(em_handle_t handle,
+                               uint32_t group_id,
+                               em_group_policy_t policy,
+                               em_group_key_fn_t key_fn);
+
 /*--------------------------- 事件发布 --------------------------------------*/
 
 /**
@@ -280,25 +873,232 @@ em_error_t em_publish_async(em_handle_t handle,
                             em_priority_t priority);
 
 /**
- * @brief 发布事件(通用接口)
+ * @brief 发布异步事件，在事件循环线程上空闲时跳过队列直接分发
+ * 
+ * 在本管理器 em_run_loop 线程分发的回调中调用时，事件不入队、不唤醒，而是在当前
+ * 回调返回后立即分发(保持运行到完成)。分发前若优先级不低于该事件的队列中
+ * (调度策略不是严格优先级时为任一队列)或本批尚未分发的事件中仍有等待的事件，
+ * 则改为正常入队，不会越过已排队的事件。其他情况等同于 em_publish_async。
  * 
  * @param handle 事件管理器句柄
- * @param event 事件结构体指针
- * @return em_error_t 错误码
+ * @param event_id 事件ID
+ * @param data 事件数据
+ * @param data_size 数据大小(0表示只复制指针)
+ * @param priority 事件优先级
+ * @return em_error_t 错误码，内联分发或入队都返回 EM_OK
+ * 
+ * @note 内联分发的事件计入统计信息的 events_inlined；等待内联分发的事件已达
+ *       EM_INLINE_DEPTH 时按 em_publish_async 入队
+ * 
+ * @code
+ * static void on_request(em_event_id_t id, em_event_data_t data, void* user) {
+ *     // 队列空闲时，on_parsed 在 on_request 返回后紧接着在同一线程执行
+ *     em_publish_auto(em, EVENT_PARSED, &msg, sizeof(msg), EM_PRIORITY_NORMAL);
+ * }
+ * @endcode
  */
-em_error_t em_publish(em_handle_t handle, const em_event_t* event);
-
-/*--------------------------- 事件处理 --------------------------------------*/
+em_error_t em_publish_auto(em_handle_t handle,
+                           em_event_id_t event_id,
+                           em_event_data_t data,
+                           size_t data_size,
+                           em_priority_t priority);
 
 /**
- * @brief 处理异步事件队列中的一个事件
+ * @brief 从信号处理函数或实时上下文发布异步事件
  * 
- * @param handle 事件管理器句柄
- * @return em_error_t EM_OK表示处理了一个事件，EM_ERR_QUEUE_EMPTY表示队列为空
+ * 异步信号安全：不加锁、不分配内存，只对创建时预分配的环形缓冲区做原子操作，
+ * 数据内联复制到槽位中，然后写 eventfd 唤醒事件循环(非 epoll 构建的事件循环和
+ * 工作线程最多每 EM_ISR_POLL_US 检查一次)。事件循环、工作线程和 em_process_all
+ * 把环中的事件按 em_publish_async 的规则(数据复制、负载控制)转入普通队列，
+ * 唤醒其他消费者，再正常分发。
  * 
- * @note 在主循环中调用此函数来处理异步事件
+ * @param handle 事件管理器句柄(需以 isr_ring_size > 0 创建)
+ * @param event_id 事件ID
+ * @param data 事件数据
+ * @param data_size 数据大小(不超过 EM_ISR_PAYLOAD_SIZE，0表示只传指针)
+ * @param priority 事件优先级
+ * @return em_error_t 错误码，环形缓冲区已满返回 EM_ERR_QUEUE_FULL，
+ *                    未启用环形缓冲区返回 EM_ERR_NOT_SUPPORTED
+ * 
+ * @note 转入队列时入队失败或被负载控制丢弃的事件不再通知调用方，计入统计信息的
+ *       isr_dropped；只在数据变化时发布(em_set_publish_on_change)对本函数不生效
+ * 
+ * @code
+ * static void on_sigusr1(int sig) {
+ *     uint32_t code = (uint32_t)sig;
+ *     em_publish_from_isr(em, EVENT_SIGNAL, &code, sizeof(code), EM_PRIORITY_HIGH);
+ * }
+ * @endcode
  */
-em_error_t em_process_one(em_handle_t handle);
+em_error_t em_publish_from_isr(em_handle_t handle,
+                               em_event_id_t event_id,
+                               em_event_data_t data,
+                               size_t data_size,
+                               em_priority_t priority);
+
+/**
+ * @brief 延时发布异步事件
+ * 
+ * 事件在 delay_ns 后进入对应优先级的异步队列。时间按管理器的时间源计算，
+ * 使用虚拟时钟时由 em_advance_time 推进。同一时间到期的事件按发布顺序入队。
+ * 
+ * @param handle 事件管理器句柄
+ * @param event_id 事件ID
+ * @param data 事件数据
+ * @param data_size 数据大小(>0时复制数据，0表示只复制指针)
+ * @param priority 事件优先级
+ * @param delay_ns 延时(纳秒)
+ * @return em_error_t 错误码，等待中的延时事件达到 EM_MAX_TIMERS 时返回 EM_ERR_QUEUE_FULL
+ */
+em_error_t em_publish_delayed(em_handle_t handle,
+                              em_event_id_t event_id,
+                              em_event_data_t data,
+                              size_t data_size,
+                              em_priority_t priority,
+                              uint64_t delay_ns);
+
+/**
+ * @brief 发布事件(通用接口)
+ * 
+ * @param handle 事件管理器句柄
+ * @param event 事件结构体指针
+ * @return em_error_t 错误码
+ */
+em_error_t em_publish(em_handle_t handle, const em_event_t* event);
+
+/**
+ * @brief 原子地发布一组异步事件
+ * 
+ * 整组只加锁一次：要么全部入队，要么全部不入队。同一优先级的事件在队列中
+ * 连续且保持数组顺序，其他生产者的事件不会插入其间。
+ * 
+ * @param handle 事件管理器句柄
+ * @param events 事件数组(mode 字段被忽略，均按异步处理；data_size>0 时复制数据)
+ * @param count 事件数量(1 ~ EM_MAX_GROUP_SIZE)
+ * @return em_error_t 错误码，任一优先级队列放不下整组时返回 EM_ERR_QUEUE_FULL
+ * 
+ * @code
+ * em_event_t group[] = {
+ *     { .id = EVENT_DOOR_OPEN,  .priority = EM_PRIORITY_NORMAL },
+ *     { .id = EVENT_LIGHT_ON,   .priority = EM_PRIORITY_NORMAL },
+ *     { .id = EVENT_ALARM_OFF,  .priority = EM_PRIORITY_NORMAL },
+ * };
+ * em_publish_group(em, group, 3);
+ * @endcode
+ */
+em_error_t em_publish_group(em_handle_t handle, const em_event_t* events, size_t count);
+
+/**
+ * @brief 设置事件只在数据变化时发布
+ * 
+ * 开启后管理器记录该事件上次成功发布的数据的 64 位哈希，em_publish_sync / em_publish_async
+ * 的数据与之相同时不复制、不入队也不分发，直接返回 EM_SUPPRESSED 并计入统计信息的
+ * events_suppressed。入队失败的发布不更新记录，下次相同的数据仍会发布。
+ * 延时发布和 em_publish_group 不受影响。
+ * 
+ * @param handle 事件管理器句柄
+ * @param event_id 事件ID
+ * @param enabled 是否开启(开启时清除上次的记录，之后的第一次发布总会通过)
+ * @param sync_size em_publish_sync 的数据字节数(同步发布不带大小；0 表示比较指针值本身，
+ *                  与 data_size 为0的异步发布相同)
+ * @return em_error_t 错误码
+ * 
+ * @note 哈希相同即视为未变化，不同数据哈希碰撞的概率约为 2^-64
+ * 
+ * @code
+ * em_set_publish_on_change(em, EVENT_REG_STATUS, true, sizeof(uint32_t));
+ * // 每个周期都发布，只有值变化时订阅者才会收到
+ * em_publish_async(em, EVENT_REG_STATUS, &reg, sizeof(reg), EM_PRIORITY_NORMAL);
+ * @endcode
+ */
+em_error_t em_set_publish_on_change(em_handle_t handle, em_event_id_t event_id,
+                                    bool enabled, size_t sync_size);
+
+/**
+ * @brief 配置发布端自动批量
+ * 
+ * 启用后调用方无需改动：em_publish_async 的 NORMAL/LOW 事件进入调用线程的暂存区，
+ * 在以下时机整批入队：
+ * - 暂存区满
+ * - 暂存时间超过 max_delay_us(由发布线程自身或事件循环/工作线程检查)
+ * - 调用 em_flush_thread
+ * - 该线程发布 HIGH 事件
+ * 
+ * 暂存的事件返回 EM_OK。刷新时队列已满的事件留在暂存区等待下次刷新，暂存区也满时
+ * em_publish_async 返回 EM_ERR_QUEUE_FULL；被负载控制或生产者配额拒绝的事件被丢弃并
+ * 计入统计信息的 auto_batch_dropped。
+ * 
+ * @param handle 事件管理器句柄
+ * @param config 配置(NULL或 enabled=false 表示关闭，关闭时刷新所有暂存区)
+ * @return em_error_t 错误码。关闭时队列已满放不下的暂存事件不会被丢弃，返回
+ *         EM_ERR_QUEUE_FULL：这些事件由事件循环在暂存超时后或所属线程的下一次发布时入队，
+ *         也可以稍后再次关闭重试
+ * 
+ * @code
+ * em_auto_batch_t cfg = { .enabled = true, .max_delay_us = 500 };
+ * em_set_auto_batch(em, &cfg);
+ * @endcode
+ */
+em_error_t em_set_auto_batch(em_handle_t handle, const em_auto_batch_t* config);
+
+/**
+ * @brief 立即刷新调用线程的自动批量暂存区
+ * 
+ * @param handle 事件管理器句柄
+ * @return em_error_t 错误码，有事件入队失败时返回第一个失败的错误码
+ *         (EM_ERR_QUEUE_FULL 表示部分事件仍留在暂存区)
+ */
+em_error_t em_flush_thread(em_handle_t handle);
+
+/**
+ * @brief 注册文件描述符数据源
+ * 
+ * fd 可读时由 em_run_loop 按分帧方式把数据直接读入事件数据块并以异步事件发布。
+ * 定长帧事件的 data 指向帧数据；长度前缀帧和数据报事件的 data 指向 em_frame_t。
+ * 注册成功后 fd 被设置为非阻塞(注册失败时保持原有标志)，仍由调用者负责关闭。
+ * 对端关闭、读错误或长度前缀超过 frame_size 时数据源被自动移除并计入统计信息。
+ * 
+ * @param handle 事件管理器句柄
+ * @param fd 文件描述符
+ * @param config 数据源配置
+ * @return int 成功返回数据源编号(>=0)，失败返回负的错误码：
+ *             非 epoll 构建返回 EM_ERR_NOT_SUPPORTED，
+ *             已有 EM_MAX_FD_SOURCES 个数据源返回 EM_ERR_MAX_SUBSCRIBERS
+ * 
+ * @note 仅在 EM_ENABLE_EPOLL=1 的 Linux 构建中可用，数据源只由 em_run_loop 读取
+ * 
+ * @code
+ * em_fd_source_config_t cfg = {
+ *     .event_id = EVENT_UART_FRAME, .priority = EM_PRIORITY_NORMAL,
+ *     .framing = EM_FD_FRAME_LENGTH, .frame_size = 512, .length_bytes = 2
+ * };
+ * int src = em_add_fd_source(em, uart_fd, &cfg);
+ * @endcode
+ */
+int em_add_fd_source(em_handle_t handle, int fd, const em_fd_source_config_t* config);
+
+/**
+ * @brief 移除文件描述符数据源
+ * 
+ * @param handle 事件管理器句柄
+ * @param source 数据源编号
+ * @return em_error_t 错误码，数据源不存在或已被自动移除返回 EM_ERR_NOT_FOUND
+ * 
+ * @note 未读满的帧被丢弃。不关闭 fd。
+ */
+em_error_t em_remove_fd_source(em_handle_t handle, int source);
+
+/*--------------------------- 事件处理 --------------------------------------*/
+
+/**
+ * @brief 处理异步事件队列中的一个事件
+ * 
+ * @param handle 事件管理器句柄
+ * @return em_error_t EM_OK表示处理了一个事件，EM_ERR_QUEUE_EMPTY表示队列为空
+ * 
+ * @note 在主循环中调用此函数来处理异步事件
+ */
+em_error_t em_process_one(em_handle_t handle);
 
 /**
  * @brief 处理异步事件队列中的所有事件
@@ -326,6 +1126,322 @@ em_error_t em_run_loop(em_handle_t handle);
  */
 em_error_t em_stop_loop(em_handle_t handle);
 
+/**
+ * @brief 等待之前发布的异步事件全部分发完成
+ * 
+ * 记录调用时各优先级的入队序号，阻塞(不轮询)直到这些事件都已出队，并且所有消费者
+ * (事件循环、工作线程、其他线程的 em_process_one)都已分发完它们。开始等待前，所有线程
+ * 暂存的自动批量事件和 em_publish_from_isr 已写入环形缓冲区的事件先入队并计入等待范围；
+ * 之后发布的事件、尚未到期的延时事件，以及因队列已满仍留在暂存区的事件不在等待范围内。
+ * 
+ * @param handle 事件管理器句柄
+ * @param timeout_ns 最长等待时间(纳秒)，UINT64_MAX 表示一直等待
+ * @return em_error_t 错误码，超时返回 EM_ERR_TIMEOUT；
+ *                    锁类型为 EM_LOCK_NONE、未启用多线程或在本管理器的回调中调用时
+ *                    返回 EM_ERR_NOT_SUPPORTED
+ * 
+ * @note 需要有其他线程在消费队列，否则只能等到超时
+ * 
+ * @code
+ * em_publish_async(em, EVENT_SHUTDOWN, NULL, 0, EM_PRIORITY_LOW);
+ * if (em_flush(em, 1000000000ull) == EM_OK) {
+ *     em_stop_loop(em);   // 之前的事件都已处理
+ * }
+ * @endcode
+ */
+em_error_t em_flush(em_handle_t handle, uint64_t timeout_ns);
+
+/**
+ * @brief 设置事件循环的批量策略
+ * 
+ * @param handle 事件管理器句柄
+ * @param policy 批量策略(NULL表示恢复默认)
+ * @return em_error_t 错误码
+ * 
+ * @note 正在运行的事件循环在下一批生效
+ */
+em_error_t em_set_batch_policy(em_handle_t handle, const em_batch_policy_t* policy);
+
+/*--------------------------- 执行器 ----------------------------------------*/
+
+/**
+ * @brief 创建执行器
+ * 
+ * @param owner 所属事件管理器。非NULL时执行器挂接到该管理器，由其
+ *              em_run_loop / em_process_all 负责执行收件箱中的回调，
+ *              投递时会唤醒该管理器的事件循环；
+ *              NULL 表示由用户线程调用 em_executor_run 轮询执行
+ * @param capacity 收件箱容量(0表示使用 EM_EXECUTOR_DEFAULT_CAPACITY)
+ * @return em_executor_t* 执行器，失败返回NULL
+ */
+em_executor_t* em_executor_create(em_handle_t owner, size_t capacity);
+
+/**
+ * @brief 销毁执行器
+ * 
+ * @param executor 执行器
+ * @return em_error_t 错误码
+ * 
+ * @note 销毁后不再接收投递，收件箱中尚未执行的回调会被丢弃。
+ *       仍有订阅指向该执行器时，内存在最后一个订阅取消后才释放。
+ *       若执行器挂接在其他管理器上，应在该管理器的事件循环停止后或在其线程中销毁。
+ */
+em_error_t em_executor_destroy(em_executor_t* executor);
+
+/**
+ * @brief 在当前线程中执行收件箱中的回调
+ * 
+ * @param executor 执行器
+ * @param max_count 最多执行的数量(<=0表示执行到收件箱为空)
+ * @return int 执行的回调数量，错误时返回-1
+ */
+int em_executor_run(em_executor_t* executor, int max_count);
+
+/**
+ * @brief 获取收件箱中等待执行的回调数量
+ * 
+ * @param executor 执行器
+ * @return int 等待数量，错误时返回-1
+ */
+int em_executor_pending(em_executor_t* executor);
+
+/*--------------------------- Actor -----------------------------------------*/
+
+#if EM_ENABLE_THREADING
+
+/**
+ * @brief 创建 Actor
+ * 
+ * @param handle 事件管理器句柄(提供共享工作线程池)
+ * @param handler 消息处理函数，user_data 参数为 state
+ * @param state Actor 私有状态
+ * @param mailbox_capacity 邮箱容量(0表示使用 EM_EXECUTOR_DEFAULT_CAPACITY)
+ * @return em_actor_t* Actor，失败返回NULL
+ * 
+ * @note Actor 不占用独立线程，只有邮箱非空时才被调度到工作线程上运行，
+ *       可以创建数万个 Actor。需调用 em_actor_pool_start 启动工作线程。
+ * 
+ * @code
+ * void counter_handler(em_event_id_t id, em_event_data_t data, void* state) {
+ *     ((counter_t*)state)->value++;   // 无需加锁
+ * }
+ * 
+ * em_actor_pool_start(em, 4);
+ * em_actor_t* actor = em_actor_create(em, counter_handler, &counter, 0);
+ * em_actor_subscribe(actor, EVENT_TICK, EM_PRIORITY_NORMAL);
+ * @endcode
+ */
+em_actor_t* em_actor_create(em_handle_t handle,
+                            em_callback_t handler,
+                            void* state,
+                            size_t mailbox_capacity);
+
+/**
+ * @brief 销毁 Actor
+ * 
+ * 取消其所有订阅并丢弃邮箱中尚未处理的消息。若 Actor 正在运行，
+ * 当前消息处理完后才释放内存，因此可以在处理函数中销毁自身。
+ * 
+ * @param actor Actor
+ * @return em_error_t 错误码
+ */
+em_error_t em_actor_destroy(em_actor_t* actor);
+
+/**
+ * @brief 向 Actor 邮箱直接发送消息
+ * 
+ * @param actor Actor
+ * @param event_id 事件ID
+ * @param data 消息数据
+ * @param data_size 数据大小(会复制数据，0表示只传递指针)
+ * @return em_error_t 错误码，邮箱已满返回 EM_ERR_QUEUE_FULL
+ */
+em_error_t em_actor_send(em_actor_t* actor,
+                         em_event_id_t event_id,
+                         em_event_data_t data,
+                         size_t data_size);
+
+/**
+ * @brief 订阅事件，事件直接投递到 Actor 邮箱
+ * 
+ * @param actor Actor
+ * @param event_id 事件ID
+ * @param priority 订阅者优先级
+ * @return em_error_t 错误码
+ */
+em_error_t em_actor_subscribe(em_actor_t* actor,
+                              em_event_id_t event_id,
+                              em_priority_t priority);
+
+/**
+ * @brief 取消 Actor 对某事件的订阅
+ * 
+ * @param actor Actor
+ * @param event_id 事件ID
+ * @return em_error_t 错误码
+ */
+em_error_t em_actor_unsubscribe(em_actor_t* actor, em_event_id_t event_id);
+
+/**
+ * @brief 获取 Actor 邮箱中等待处理的消息数量
+ * 
+ * @param actor Actor
+ * @return int 消息数量，错误时返回-1
+ */
+int em_actor_pending(em_actor_t* actor);
+
+/**
+ * @brief 启动 Actor 共享工作线程池
+ * 
+ * @param handle 事件管理器句柄
+ * @param num_workers 工作线程数量
+ * @return em_error_t 错误码，锁类型为 EM_LOCK_NONE 时返回 EM_ERR_NOT_SUPPORTED
+ */
+em_error_t em_actor_pool_start(em_handle_t handle, int num_workers);
+
+/**
+ * @brief 停止 Actor 共享工作线程池(等待工作线程退出)
+ * 
+ * @param handle 事件管理器句柄
+ * @return em_error_t 错误码
+ * 
+ * @note 不能在 Actor 处理函数中调用。已就绪的 Actor 保留在队列中，
+ *       重新启动线程池后继续运行。
+ */
+em_error_t em_actor_pool_stop(em_handle_t handle);
+
+/*--------------------------- 弹性工作线程池 --------------------------------*/
+
+/**
+ * @brief 启动消费异步队列的弹性工作线程池
+ * 
+ * 线程池代替 em_run_loop 消费异步队列，活动线程数在 min_workers 和
+ * max_workers 之间随积压自动伸缩。
+ * 
+ * @param handle 事件管理器句柄
+ * @param config 配置(NULL表示全部使用默认值)
+ * @return em_error_t 错误码，已启动返回 EM_ERR_ALREADY_INIT，
+ *                    锁类型为 EM_LOCK_NONE 时返回 EM_ERR_NOT_SUPPORTED
+ * 
+ * @code
+ * em_worker_pool_config_t cfg = { .min_workers = 1, .max_workers = 8 };
+ * em_worker_pool_start(em, &cfg);
+ * @endcode
+ */
+em_error_t em_worker_pool_start(em_handle_t handle, const em_worker_pool_config_t* config);
+
+/**
+ * @brief 停止弹性工作线程池(等待工作线程退出)
+ * 
+ * @param handle 事件管理器句柄
+ * @return em_error_t 错误码
+ * 
+ * @note 不能在回调中调用。尚未处理的事件保留在队列中。
+ */
+em_error_t em_worker_pool_stop(em_handle_t handle);
+
+#endif /* EM_ENABLE_THREADING */
+
+/*--------------------------- 负载控制 --------------------------------------*/
+
+/**
+ * @brief 配置自适应负载控制
+ * 
+ * @param handle 事件管理器句柄
+ * @param config 配置(NULL或 enabled=false 表示关闭)
+ * @return em_error_t 错误码
+ * 
+ * @note 启用后，被丢弃的 em_publish_async 返回 EM_ERR_OVERLOADED，
+ *       丢弃数量和当前级别记录在统计信息中
+ * 
+ * @code
+ * em_shed_config_t cfg = { .enabled = true, .target_us = 2000 };
+ * em_set_load_shedding(em, &cfg);
+ * @endcode
+ */
+em_error_t em_set_load_shedding(em_handle_t handle, const em_shed_config_t* config);
+
+/*--------------------------- 热点事件 --------------------------------------*/
+
+/**
+ * @brief 开启或关闭热点事件统计
+ * 
+ * 发布路径用 count-min sketch 估计每个事件ID的次数和字节数，并维护按次数、按字节数
+ * 各 EM_TOP_EVENTS_K 项的热点表，全程不加锁。内存占用与事件ID的数量无关。
+ * 
+ * @param handle 事件管理器句柄
+ * @param enabled 是否开启(开启时清零之前的统计)
+ * @return em_error_t 错误码
+ */
+em_error_t em_set_top_events(em_handle_t handle, bool enabled);
+
+/**
+ * @brief 获取最热的事件
+ * 
+ * @param handle 事件管理器句柄
+ * @param k 最多返回的个数(不超过 EM_TOP_EVENTS_K 时结果最可靠)
+ * @param order 排序依据
+ * @param out 输出数组(至少 k 项)，按 order 从大到小排列
+ * @return int 输出的个数，错误时返回负的错误码
+ * 
+ * @note 统计包含因队列满或负载控制被拒绝的发布；关闭后保留最后的结果
+ * 
+ * @code
+ * em_set_top_events(em, true);
+ * // ... 运行 ...
+ * em_top_event_t top[5];
+ * int n = em_get_top_events(em, 5, EM_TOP_BY_BYTES, top);
+ * @endcode
+ */
+int em_get_top_events(em_handle_t handle, int k, em_top_order_t order, em_top_event_t* out);
+
+/*--------------------------- 调度策略 --------------------------------------*/
+
+/**
+ * @brief 选择内置的出队调度策略
+ * 
+ * @param handle 事件管理器句柄
+ * @param policy 调度策略
+ * @param config 参数(NULL表示全部使用默认值)
+ * @return em_error_t 错误码
+ * 
+ * @code
+ * em_sched_config_t cfg = { .weights = { 8, 2, 1 } };
+ * em_set_scheduler(em, EM_SCHED_WFQ, &cfg);
+ * @endcode
+ */
+em_error_t em_set_scheduler(em_handle_t handle, em_sched_policy_t policy,
+                            const em_sched_config_t* config);
+
+/**
+ * @brief 安装自定义调度器
+ * 
+ * @param handle 事件管理器句柄
+ * @param ops 调度器(NULL表示恢复严格优先级)，需在管理器销毁或替换前保持有效
+ * @param ctx 传给回调的上下文
+ * @return em_error_t 错误码
+ */
+em_error_t em_set_scheduler_ops(em_handle_t handle, const em_scheduler_ops_t* ops, void* ctx);
+
+/**
+ * @brief 队列中该优先级的事件数(只能在调度器回调中调用)
+ */
+uint32_t em_sched_size(const em_sched_view_t* view, em_priority_t priority);
+
+/**
+ * @brief 查看该优先级队列中第 index 个事件(0为队首，只能在调度器回调中调用)
+ * 
+ * @param enqueue_ns 输出入队时间(可为NULL)
+ * @return const em_event_t* 事件，index 超出范围返回NULL
+ */
+const em_event_t* em_sched_peek(const em_sched_view_t* view, em_priority_t priority,
+                                uint32_t index, uint64_t* enqueue_ns);
+
+/**
+ * @brief 调度时刻的管理器时间(纳秒，只能在调度器回调中调用)
+ */
+uint64_t em_sched_now(const em_sched_view_t* view);
+
 /*--------------------------- 工具函数 --------------------------------------*/
 
 /**
@@ -350,7 +1466,7 @@ em_error_t em_reset_stats(em_handle_t handle);
  * 
  * @param handle 事件管理器句柄
  * @param event_id 事件ID
- * @return int 订阅者数量，错误时返回-1
+ * @return int 订阅者数量(包括订阅组成员)，错误时返回-1
  */
 int em_get_subscriber_count(em_handle_t handle, em_event_id_t event_id);
 
@@ -372,13 +1488,135 @@ bool em_has_subscribers(em_handle_t handle, em_event_id_t event_id);
 int em_get_queue_size(em_handle_t handle);
 
 /**
- * @brief 清空异步事件队列
+ * @brief 清空异步事件队列(同时取消未到期的延时事件)
  * 
  * @param handle 事件管理器句柄
  * @return em_error_t 错误码
  */
 em_error_t em_clear_queue(em_handle_t handle);
 
+/**
+ * @brief 在线调整某优先级异步队列的容量
+ * 
+ * 可增大或缩小。迁移在管理器锁内完成，可与发布和处理并发调用，不会改变事件顺序。
+ * 
+ * @param handle 事件管理器句柄
+ * @param priority 优先级
+ * @param capacity 新容量(1 ~ EM_MAX_QUEUE_CAPACITY)
+ * @return em_error_t 错误码，新容量小于队列中的事件数时返回 EM_ERR_QUEUE_FULL
+ */
+em_error_t em_resize_queue(em_handle_t handle, em_priority_t priority, size_t capacity);
+
+/**
+ * @brief 配置异步队列自动扩容
+ * 
+ * @param handle 事件管理器句柄
+ * @param config 配置(NULL或 enabled=false 表示关闭)
+ * @return em_error_t 错误码
+ */
+em_error_t em_set_queue_autogrow(em_handle_t handle, const em_queue_autogrow_t* config);
+
+/*--------------------------- 生产者配额 ------------------------------------*/
+
+/**
+ * @brief 注册生产者
+ * 
+ * @param handle 事件管理器句柄
+ * @param config 配额配置
+ * @return int 生产者编号(>=0)，失败返回负的错误码：预留之和超过队列容量返回
+ *             EM_ERR_QUEUE_FULL，生产者已达 EM_MAX_PRODUCERS 返回 EM_ERR_MAX_SUBSCRIBERS
+ */
+int em_producer_register(em_handle_t handle, const em_producer_config_t* config);
+
+/**
+ * @brief 注销生产者，归还其预留槽位
+ * 
+ * @param handle 事件管理器句柄
+ * @param producer 生产者编号
+ * @return em_error_t 错误码
+ */
+em_error_t em_producer_unregister(em_handle_t handle, int producer);
+
+/**
+ * @brief 将调用线程绑定为某个生产者
+ * 
+ * 绑定是线程局部的，之后该线程的 em_publish_async / em_publish_group 按该生产者的
+ * 配额入队。每个线程同一时刻只绑定一个管理器上的一个生产者。
+ * 
+ * @param handle 事件管理器句柄
+ * @param producer 生产者编号(-1表示解除绑定)
+ * @return em_error_t 错误码
+ * 
+ * @code
+ * em_producer_config_t cfg = { .reserved = { 2, 8, 0 } };
+ * int id = em_producer_register(em, &cfg);
+ * em_producer_bind(em, id);   // 在生产者线程中调用
+ * @endcode
+ */
+em_error_t em_producer_bind(em_handle_t handle, int producer);
+
+/**
+ * @brief 获取生产者统计信息
+ * 
+ * @param handle 事件管理器句柄
+ * @param producer 生产者编号
+ * @param stats 输出统计信息
+ * @return em_error_t 错误码
+ */
+em_error_t em_get_producer_stats(em_handle_t handle, int producer, em_producer_stats_t* stats);
+
+/**
+ * @brief 读取管理器时间源的当前时间
+ * 
+ * @param handle 事件管理器句柄
+ * @return uint64_t 单调时间(纳秒)，错误时返回0
+ */
+uint64_t em_time_ns(em_handle_t handle);
+
+/**
+ * @brief 获取管理器实际使用的时间源
+ * 
+ * @param handle 事件管理器句柄
+ * @return em_clock_source_t 时间源(请求的时间源不可用时为 EM_CLOCK_MONOTONIC)
+ */
+em_clock_source_t em_get_clock_source(em_handle_t handle);
+
+/**
+ * @brief 获取管理器实际使用的锁类型
+ * 
+ * @param handle 事件管理器句柄
+ * @return em_lock_type_t 锁类型(请求的锁不可用时为 EM_LOCK_MUTEX，未启用线程时为 EM_LOCK_NONE)
+ */
+em_lock_type_t em_get_lock_type(em_handle_t handle);
+
+/**
+ * @brief 推进虚拟时钟
+ * 
+ * 到期的延时事件随即进入异步队列。
+ * 
+ * @param handle 事件管理器句柄
+ * @param delta_ns 推进的时间(纳秒)
+ * @return em_error_t 错误码，未启用虚拟时钟时返回 EM_ERR_NOT_SUPPORTED
+ * 
+ * @code
+ * em_advance_time(em, 5 * 1000000000ull);  // 模拟经过5秒
+ * em_process_all(em);
+ * @endcode
+ */
+em_error_t em_advance_time(em_handle_t handle, uint64_t delta_ns);
+
+/**
+ * @brief 设置事件记录钩子
+ * 
+ * @param handle 事件管理器句柄
+ * @param hook 钩子(NULL表示移除)
+ * @param user_data 传给钩子的用户数据
+ * @return em_error_t 错误码
+ * 
+ * @note 替换钩子时正在分发的线程可能仍在调用旧钩子，应在停止分发后再销毁旧钩子的资源
+ */
+em_error_t em_set_trace_hook(em_handle_t handle, em_trace_hook_t hook, void* user_data);
+
 /**
  * @brief 获取错误码对应的字符串描述
  * 
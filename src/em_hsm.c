@@ -0,0 +1,638 @@
+/**
+ * @file em_hsm.c
+ * @brief 表驱动的层次状态机实现
+ * 
+ * @author 梦里不知身是客
+ * @version 1.0.0
+ * @date 2026
+ * @copyright MIT License
+ */
+
+#define _GNU_SOURCE  /* for PTHREAD_MUTEX_RECURSIVE */
+#include "em_hsm.h"
+#include <stdlib.h>
+#include <string.h>
+
+#if EM_ENABLE_THREADING
+#include <pthread.h>
+#endif
+
+/*============================================================================
+ *                              内部数据结构
+ *============================================================================*/
+
+typedef struct em_hsm_hub em_hsm_hub_t;
+
+/**
+ * @brief 延后处理的事件
+ */
+typedef struct {
+    em_event_id_t   id;
+    em_event_data_t data;                       /**< 数据指针(已复制时指向 copy) */
+    size_t          size;                       /**< 复制的数据长度(0表示只保存指针) */
+    unsigned char   copy[EM_HSM_DEFER_DATA_SIZE];
+} em_hsm_deferred_t;
+
+/**
+ * @brief 状态机
+ * 
+ * 查找表 lookup[状态][事件] 是第一条候选转换的下标，next[转换] 是下一条候选：
+ * 先是同一源状态、同一事件的其他转换(按表中顺序)，然后接上父状态的候选链。
+ */
+struct em_hsm {
+    em_hsm_state_t          states[EM_HSM_MAX_STATES];
+    int                     state_count;
+    em_hsm_transition_t*    transitions;
+    int                     transition_count;
+    int*                    next;
+    int*                    lookup;         /**< state_count × EM_MAX_EVENT_TYPES */
+    bool                    handles[EM_MAX_EVENT_TYPES];    /**< 转换表中出现的事件 */
+    void*                   user_data;
+    int                     current;        /**< 当前叶子状态 */
+    
+    /* 运行到完成 */
+    bool                    busy;
+    em_hsm_deferred_t       deferred[EM_HSM_DEFER_SIZE];
+    int                     deferred_head;
+    int                     deferred_count;
+    
+    em_hsm_stats_t          stats;
+    
+    /* 同一管理器上的状态机共用订阅和锁；未订阅的状态机使用自己的锁 */
+    em_hsm_hub_t*           hub;
+    em_hsm_t*               hub_next;
+#if EM_ENABLE_THREADING
+    pthread_mutex_t         own_lock;
+    pthread_mutex_t*        lock;           /**< 递归锁，允许动作中再次分发 */
+#endif
+};
+
+/**
+ * @brief 一个事件管理器上的状态机集合
+ * 
+ * 每个事件ID只订阅一次，user_data 指向集合，回调转发给处理该事件的状态机。
+ * 转发期间持有集合的锁，同一集合中的状态机串行执行。
+ * 
+ * 最后一个状态机移出时集合随之释放，此时所有事件的引用都已归零、订阅都已取消。
+ * 管理器在锁外调用回调，因此 em_hsm_destroy 要求调用前不再有转发在执行(事件循环已停止)。
+ */
+struct em_hsm_hub {
+    em_handle_t             handle;
+    em_hsm_t*               machines;
+    int                     refs[EM_MAX_EVENT_TYPES];   /**< 处理各事件的状态机数 */
+    em_hsm_hub_t*           next;
+#if EM_ENABLE_THREADING
+    pthread_mutex_t         lock;
+#endif
+};
+
+static em_hsm_hub_t* g_hubs = NULL;
+
+#if EM_ENABLE_THREADING
+static pthread_mutex_t g_hubs_lock = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+
+/*============================================================================
+ *                              锁
+ *============================================================================*/
+
+#if EM_ENABLE_THREADING
+static bool recursive_lock_init(pthread_mutex_t* lock)
+{
+    pthread_mutexattr_t attr;
+    if (pthread_mutexattr_init(&attr) != 0) {
+        return false;
+    }
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+    bool ok = pthread_mutex_init(lock, &attr) == 0;
+    pthread_mutexattr_destroy(&attr);
+    return ok;
+}
+#endif
+
+static inline void hsm_lock(em_hsm_t* hsm)
+{
+#if EM_ENABLE_THREADING
+    pthread_mutex_lock(hsm->lock);
+#else
+    (void)hsm;
+#endif
+}
+
+static inline void hsm_unlock(em_hsm_t* hsm)
+{
+#if EM_ENABLE_THREADING
+    pthread_mutex_unlock(hsm->lock);
+#else
+    (void)hsm;
+#endif
+}
+
+static inline void hub_lock(em_hsm_hub_t* hub)
+{
+#if EM_ENABLE_THREADING
+    pthread_mutex_lock(&hub->lock);
+#else
+    (void)hub;
+#endif
+}
+
+static inline void hub_unlock(em_hsm_hub_t* hub)
+{
+#if EM_ENABLE_THREADING
+    pthread_mutex_unlock(&hub->lock);
+#else
+    (void)hub;
+#endif
+}
+
+static inline void registry_lock(void)
+{
+#if EM_ENABLE_THREADING
+    pthread_mutex_lock(&g_hubs_lock);
+#endif
+}
+
+static inline void registry_unlock(void)
+{
+#if EM_ENABLE_THREADING
+    pthread_mutex_unlock(&g_hubs_lock);
+#endif
+}
+
+/*============================================================================
+ *                              表校验与查找表
+ *============================================================================*/
+
+/** 状态的嵌套深度(顶层为0)，父状态越界、成环或嵌套过深返回-1 */
+static int state_depth(const em_hsm_state_t* states, int count, int s)
+{
+    int depth = 0;
+    for (int p = states[s].parent; p != EM_HSM_NONE; p = states[p].parent) {
+        if (p < 0 || p >= count || ++depth >= EM_HSM_MAX_DEPTH) {
+            return -1;
+        }
+    }
+    return depth;
+}
+
+static bool validate_config(const em_hsm_config_t* config)
+{
+    if (config->states == NULL || config->state_count < 1 ||
+        config->state_count > EM_HSM_MAX_STATES || config->transition_count < 0 ||
+        (config->transition_count > 0 && config->transitions == NULL) ||
+        config->initial < 0 || config->initial >= config->state_count) {
+        return false;
+    }
+    
+    int count = config->state_count;
+    for (int s = 0; s < count; s++) {
+        const em_hsm_state_t* state = &config->states[s];
+        if (state_depth(config->states, count, s) < 0) {
+            return false;
+        }
+        if (state->initial != EM_HSM_NONE &&
+            (state->initial < 0 || state->initial >= count ||
+             config->states[state->initial].parent != s)) {
+            return false;
+        }
+    }
+    
+    for (int t = 0; t < config->transition_count; t++) {
+        const em_hsm_transition_t* tr = &config->transitions[t];
+        if (tr->source < 0 || tr->source >= count || tr->event_id >= EM_MAX_EVENT_TYPES ||
+            (tr->target != EM_HSM_NONE && (tr->target < 0 || tr->target >= count))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief 计算查找表
+ * 
+ * 按深度从浅到深处理状态，每个状态先继承父状态的候选链，再把自己的转换
+ * 逆序插到链头，使同一状态的转换保持表中顺序并排在父状态的转换之前。
+ */
+static void build_lookup(em_hsm_t* hsm)
+{
+    for (int depth = 0; depth < EM_HSM_MAX_DEPTH; depth++) {
+        for (int s = 0; s < hsm->state_count; s++) {
+            if (state_depth(hsm->states, hsm->state_count, s) != depth) {
+                continue;
+            }
+            
+            int* row = &hsm->lookup[s * EM_MAX_EVENT_TYPES];
+            int parent = hsm->states[s].parent;
+            for (int e = 0; e < EM_MAX_EVENT_TYPES; e++) {
+                row[e] = parent != EM_HSM_NONE ? hsm->lookup[parent * EM_MAX_EVENT_TYPES + e] : -1;
+            }
+            for (int t = hsm->transition_count - 1; t >= 0; t--) {
+                const em_hsm_transition_t* tr = &hsm->transitions[t];
+                if (tr->source == s) {
+                    hsm->next[t] = row[tr->event_id];
+                    row[tr->event_id] = t;
+                }
+            }
+        }
+    }
+}
+
+/*============================================================================
+ *                              转换
+ *============================================================================*/
+
+static inline void run_action(em_hsm_t* hsm, em_hsm_action_t action,
+                              em_event_id_t event_id, em_event_data_t data)
+{
+    if (action != NULL) {
+        action(hsm, event_id, data, hsm->user_data);
+    }
+}
+
+/** 状态 s 是否为 ancestor 或其子孙 */
+static bool is_within(const em_hsm_t* hsm, int s, int ancestor)
+{
+    for (; s != EM_HSM_NONE; s = hsm->states[s].parent) {
+        if (s == ancestor) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/** 转换的作用域：同时是源状态和目标状态真祖先的最深状态，没有时为 EM_HSM_NONE */
+static int transition_domain(const em_hsm_t* hsm, int source, int target)
+{
+    int target_parent = hsm->states[target].parent;
+    for (int s = hsm->states[source].parent; s != EM_HSM_NONE; s = hsm->states[s].parent) {
+        if (is_within(hsm, target_parent, s)) {
+            return s;
+        }
+    }
+    return EM_HSM_NONE;
+}
+
+/** 从作用域(不含)逐级进入 target，再沿初始子状态进入到叶子状态 */
+static void enter_from(em_hsm_t* hsm, int domain, int target,
+                       em_event_id_t event_id, em_event_data_t data)
+{
+    int path[EM_HSM_MAX_DEPTH];
+    int depth = 0;
+    for (int s = target; s != domain; s = hsm->states[s].parent) {
+        path[depth++] = s;
+    }
+    while (depth > 0) {
+        run_action(hsm, hsm->states[path[--depth]].entry, event_id, data);
+    }
+    
+    int s = target;
+    while (hsm->states[s].initial != EM_HSM_NONE) {
+        s = hsm->states[s].initial;
+        run_action(hsm, hsm->states[s].entry, event_id, data);
+    }
+    hsm->current = s;
+}
+
+static void take_transition(em_hsm_t* hsm, const em_hsm_transition_t* tr,
+                            em_event_id_t event_id, em_event_data_t data)
+{
+    hsm->stats.transitions++;
+    if (tr->target == EM_HSM_NONE) {
+        run_action(hsm, tr->action, event_id, data);
+        return;
+    }
+    
+    /* 当前状态是源状态或其子孙，从当前状态逐级退出到作用域 */
+    int domain = transition_domain(hsm, tr->source, tr->target);
+    for (int s = hsm->current; s != domain; s = hsm->states[s].parent) {
+        run_action(hsm, hsm->states[s].exit, event_id, data);
+    }
+    run_action(hsm, tr->action, event_id, data);
+    enter_from(hsm, domain, tr->target, event_id, data);
+}
+
+/** 处理一个事件，没有匹配的转换返回false */
+static bool process_event(em_hsm_t* hsm, em_event_id_t event_id, em_event_data_t data)
+{
+    hsm->stats.events++;
+    
+    int t = hsm->lookup[hsm->current * EM_MAX_EVENT_TYPES + (int)event_id];
+    for (; t >= 0; t = hsm->next[t]) {
+        const em_hsm_transition_t* tr = &hsm->transitions[t];
+        if (tr->guard == NULL || tr->guard(hsm, event_id, data, hsm->user_data)) {
+            take_transition(hsm, tr, event_id, data);
+            return true;
+        }
+    }
+    
+    hsm->stats.unhandled++;
+    return false;
+}
+
+/** 处理转换过程中延后的事件(调用者持有锁且已置 busy) */
+static void drain_deferred(em_hsm_t* hsm)
+{
+    while (hsm->deferred_count > 0) {
+        em_hsm_deferred_t item = hsm->deferred[hsm->deferred_head];
+        hsm->deferred_head = (hsm->deferred_head + 1) % EM_HSM_DEFER_SIZE;
+        hsm->deferred_count--;
+        process_event(hsm, item.id, item.size > 0 ? item.copy : item.data);
+    }
+}
+
+/**
+ * @brief 分发一个事件，状态机正在转换时延后处理
+ * 
+ * @param can_defer_pointer data_size 为0时能否只保存指针延后(数据在返回后仍然有效)
+ */
+static em_error_t hsm_dispatch(em_hsm_t* hsm, em_event_id_t event_id, em_event_data_t data,
+                               size_t data_size, bool can_defer_pointer)
+{
+    hsm_lock(hsm);
+    
+    /* 运行到完成：本状态机正在转换(动作中再次分发)时延后处理，数据复制到延后队列 */
+    if (hsm->busy) {
+        if (hsm->deferred_count >= EM_HSM_DEFER_SIZE) {
+            hsm->stats.dropped++;
+            hsm_unlock(hsm);
+            return EM_ERR_QUEUE_FULL;
+        }
+        if (data_size > EM_HSM_DEFER_DATA_SIZE || (data_size == 0 && !can_defer_pointer)) {
+            hsm->stats.dropped++;
+            hsm_unlock(hsm);
+            return EM_ERR_NOT_SUPPORTED;
+        }
+        int tail = (hsm->deferred_head + hsm->deferred_count) % EM_HSM_DEFER_SIZE;
+        em_hsm_deferred_t* item = &hsm->deferred[tail];
+        item->id = event_id;
+        item->data = data;
+        item->size = data_size;
+        if (data_size > 0) {
+            memcpy(item->copy, data, data_size);
+        }
+        hsm->deferred_count++;
+        hsm->stats.deferred++;
+        hsm_unlock(hsm);
+        return EM_OK;
+    }
+    
+    hsm->busy = true;
+    bool handled = process_event(hsm, event_id, data);
+    drain_deferred(hsm);
+    hsm->busy = false;
+    
+    hsm_unlock(hsm);
+    return handled ? EM_OK : EM_ERR_NOT_FOUND;
+}
+
+/*============================================================================
+ *                              订阅
+ *============================================================================*/
+
+/** 事件管理器回调：转发给集合中处理该事件的状态机 */
+static void hub_route(em_event_id_t event_id, em_event_data_t data, void* user_data)
+{
+    em_hsm_hub_t* hub = (em_hsm_hub_t*)user_data;
+    
+    /* 管理器的数据在回调返回后失效，长度未知无法复制：不能延后 */
+    hub_lock(hub);
+    for (em_hsm_t* m = hub->machines; m != NULL; m = m->hub_next) {
+        if (m->handles[event_id]) {
+            hsm_dispatch(m, event_id, data, 0, data == NULL);
+        }
+    }
+    hub_unlock(hub);
+}
+
+/** 减少前 upto 个事件的引用，最后一个引用取消订阅(调用者持有集合的锁) */
+static void hub_release_events(em_hsm_hub_t* hub, const em_hsm_t* hsm, int upto)
+{
+    for (int e = 0; e < upto; e++) {
+        if (hsm->handles[e] && --hub->refs[e] == 0) {
+            em_unsubscribe(hub->handle, (em_event_id_t)e, hub_route);
+        }
+    }
+}
+
+/** 把状态机加入所属管理器的集合，订阅集合尚未订阅的事件 */
+static bool hub_attach(em_hsm_t* hsm, em_handle_t handle)
+{
+    registry_lock();
+    
+    em_hsm_hub_t* hub = g_hubs;
+    while (hub != NULL && hub->handle != handle) {
+        hub = hub->next;
+    }
+    if (hub == NULL) {
+        hub = (em_hsm_hub_t*)calloc(1, sizeof(em_hsm_hub_t));
+        if (hub == NULL) {
+            registry_unlock();
+            return false;
+        }
+#if EM_ENABLE_THREADING
+        if (!recursive_lock_init(&hub->lock)) {
+            free(hub);
+            registry_unlock();
+            return false;
+        }
+#endif
+        hub->handle = handle;
+        hub->next = g_hubs;
+        g_hubs = hub;
+    }
+    
+    hub_lock(hub);
+    for (int e = 0; e < EM_MAX_EVENT_TYPES; e++) {
+        if (!hsm->handles[e] || hub->refs[e]++ > 0) {
+            continue;
+        }
+        if (em_subscribe(handle, (em_event_id_t)e, hub_route, hub, EM_PRIORITY_NORMAL) != EM_OK) {
+            hub_release_events(hub, hsm, e + 1);
+            hub_unlock(hub);
+            registry_unlock();
+            return false;
+        }
+    }
+    
+    hsm->hub = hub;
+    hsm->hub_next = hub->machines;
+    hub->machines = hsm;
+#if EM_ENABLE_THREADING
+    hsm->lock = &hub->lock;
+#endif
+    hub_unlock(hub);
+    
+    registry_unlock();
+    return true;
+}
+
+/** 把状态机移出集合，取消只有它处理的事件的订阅；集合中没有状态机后释放集合 */
+static void hub_detach(em_hsm_t* hsm)
+{
+    em_hsm_hub_t* hub = hsm->hub;
+    
+    registry_lock();
+    
+    hub_lock(hub);
+    em_hsm_t** link = &hub->machines;
+    while (*link != hsm) {
+        link = &(*link)->hub_next;
+    }
+    *link = hsm->hub_next;
+    hub_release_events(hub, hsm, EM_MAX_EVENT_TYPES);
+    bool empty = hub->machines == NULL;
+    hub_unlock(hub);
+    
+    if (empty) {
+        em_hsm_hub_t** prev = &g_hubs;
+        while (*prev != hub) {
+            prev = &(*prev)->next;
+        }
+        *prev = hub->next;
+#if EM_ENABLE_THREADING
+        pthread_mutex_destroy(&hub->lock);
+#endif
+        free(hub);
+    }
+    
+    registry_unlock();
+}
+
+/*============================================================================
+ *                              API实现
+ *============================================================================*/
+
+static void hsm_free(em_hsm_t* hsm)
+{
+    free(hsm->transitions);
+    free(hsm->next);
+    free(hsm->lookup);
+    free(hsm);
+}
+
+em_hsm_t* em_hsm_create(em_handle_t handle, const em_hsm_config_t* config)
+{
+    if (config == NULL || !validate_config(config)) {
+        return NULL;
+    }
+    
+    em_hsm_t* hsm = (em_hsm_t*)calloc(1, sizeof(em_hsm_t));
+    if (hsm == NULL) {
+        return NULL;
+    }
+    
+    /* 复制表(至少分配一项，避免 malloc(0)) */
+    int transitions = config->transition_count;
+    size_t slots = transitions > 0 ? (size_t)transitions : 1;
+    hsm->transitions = (em_hsm_transition_t*)malloc(slots * sizeof(em_hsm_transition_t));
+    hsm->next = (int*)malloc(slots * sizeof(int));
+    hsm->lookup = (int*)malloc((size_t)config->state_count * EM_MAX_EVENT_TYPES * sizeof(int));
+    if (hsm->transitions == NULL || hsm->next == NULL || hsm->lookup == NULL) {
+        hsm_free(hsm);
+        return NULL;
+    }
+    memcpy(hsm->states, config->states, (size_t)config->state_count * sizeof(em_hsm_state_t));
+    if (transitions > 0) {
+        memcpy(hsm->transitions, config->transitions, (size_t)transitions * sizeof(em_hsm_transition_t));
+    }
+    hsm->state_count = config->state_count;
+    hsm->transition_count = transitions;
+    hsm->user_data = config->user_data;
+    
+    build_lookup(hsm);
+    for (int t = 0; t < transitions; t++) {
+        hsm->handles[hsm->transitions[t].event_id] = true;
+    }
+    
+    /* 订阅后进入初始状态前到达的事件先延后 */
+    hsm->busy = true;
+    if (handle != NULL) {
+        if (!hub_attach(hsm, handle)) {
+            hsm_free(hsm);
+            return NULL;
+        }
+    } else {
+#if EM_ENABLE_THREADING
+        if (!recursive_lock_init(&hsm->own_lock)) {
+            hsm_free(hsm);
+            return NULL;
+        }
+        hsm->lock = &hsm->own_lock;
+#endif
+    }
+    
+    /* 进入初始状态：从顶层逐级进入，入口动作中分发的事件同样延后处理 */
+    hsm_lock(hsm);
+    enter_from(hsm, EM_HSM_NONE, config->initial, EM_HSM_NO_EVENT, NULL);
+    drain_deferred(hsm);
+    hsm->busy = false;
+    hsm_unlock(hsm);
+    
+    return hsm;
+}
+
+em_error_t em_hsm_destroy(em_hsm_t* hsm)
+{
+    if (hsm == NULL) {
+        return EM_ERR_INVALID_PARAM;
+    }
+    
+    if (hsm->hub != NULL) {
+        hub_detach(hsm);
+    } else {
+#if EM_ENABLE_THREADING
+        pthread_mutex_destroy(&hsm->own_lock);
+#endif
+    }
+    hsm_free(hsm);
+    
+    return EM_OK;
+}
+
+em_error_t em_hsm_dispatch(em_hsm_t* hsm, em_event_id_t event_id,
+                           em_event_data_t data, size_t data_size)
+{
+    if (hsm == NULL || event_id >= EM_MAX_EVENT_TYPES || (data == NULL && data_size > 0)) {
+        return EM_ERR_INVALID_PARAM;
+    }
+    
+    return hsm_dispatch(hsm, event_id, data, data_size, true);
+}
+
+int em_hsm_current(em_hsm_t* hsm)
+{
+    if (hsm == NULL) {
+        return EM_HSM_NONE;
+    }
+    
+    hsm_lock(hsm);
+    int current = hsm->current;
+    hsm_unlock(hsm);
+    return current;
+}
+
+bool em_hsm_in_state(em_hsm_t* hsm, int state)
+{
+    if (hsm == NULL || state < 0 || state >= hsm->state_count) {
+        return false;
+    }
+    
+    hsm_lock(hsm);
+    bool within = is_within(hsm, hsm->current, state);
+    hsm_unlock(hsm);
+    return within;
+}
+
+em_error_t em_hsm_get_stats(em_hsm_t* hsm, em_hsm_stats_t* stats)
+{
+    if (hsm == NULL || stats == NULL) {
+        return EM_ERR_INVALID_PARAM;
+    }
+    
+    hsm_lock(hsm);
+    *stats = hsm->stats;
+    hsm_unlock(hsm);
+    return EM_OK;
+}
@@ -0,0 +1,708 @@
+/**
+ * @file em_pipeline.c
+ * @brief 多级流水线实现
+ * 
+ * @author 梦里不知身是客
+ * @version 1.0.0
+ * @date 2026
+ * @copyright MIT License
+ */
+
+#define _GNU_SOURCE  /* for pthread_setaffinity_np */
+#include "em_pipeline.h"
+
+#if EM_ENABLE_THREADING
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+
+/*============================================================================
+ *                              调试宏
+ *============================================================================*/
+
+#if EM_ENABLE_DEBUG
+#define EM_DEBUG(fmt, ...) printf("[EM_DEBUG] " fmt "\n", ##__VA_ARGS__)
+#else
+#define EM_DEBUG(fmt, ...) ((void)0)
+#endif
+
+/** 任务线程每次轮到某一级时最多处理的数据项数 */
+#define EM_PIPELINE_TASK_BATCH  32
+
+/*============================================================================
+ *                              内部数据结构
+ *============================================================================*/
+
+/**
+ * @brief 单生产者/单消费者有界环形队列
+ * 
+ * head 只由消费者写，tail 只由生产者写，两者放在不同缓存行避免伪共享。
+ * waiters 记录在本队列上休眠的线程数，为0时写入/取出方不必加锁唤醒。
+ */
+typedef struct {
+    void**                      slots;      /**< 槽位数组 */
+    size_t                      mask;       /**< 容量掩码(容量为2的幂) */
+    _Alignas(64) atomic_size_t  head;       /**< 读位置(消费者) */
+    _Alignas(64) atomic_size_t  tail;       /**< 写位置(生产者) */
+    _Alignas(64) atomic_int     waiters;    /**< 休眠等待的线程数 */
+} em_spsc_ring_t;
+
+/**
+ * @brief 流水线中的一级
+ */
+typedef struct {
+    em_stage_config_t   config;         /**< 配置 */
+    em_spsc_ring_t      input;          /**< 输入队列 */
+    pthread_t           thread;         /**< 工作线程(线程方式) */
+    bool                thread_started; /**< 工作线程是否已启动 */
+    atomic_bool         done;           /**< 已处理完全部输入并退出 */
+    
+    /* 统计 */
+    atomic_uint_fast64_t items_in;
+    atomic_uint_fast64_t items_out;
+    atomic_uint_fast64_t items_dropped;
+    atomic_uint_fast64_t stalls;
+    atomic_uint         queue_max;
+} em_stage_t;
+
+/**
+ * @brief 流水线
+ */
+struct em_pipeline {
+    em_stage_t      stages[EM_PIPELINE_MAX_STAGES];
+    int             stage_count;
+    
+    pthread_t       task_thread;        /**< 共享任务线程 */
+    bool            task_thread_started;
+    
+    bool            started;            /**< 是否已启动 */
+    atomic_bool     stopping;           /**< 不再接受输入，处理完后退出 */
+    uint64_t        start_ns;           /**< 启动时间 */
+    atomic_uint_fast64_t stop_ns;       /**< 停止时间(0表示未停止) */
+    
+    pthread_mutex_t park_lock;          /**< 休眠/唤醒用的锁 */
+    pthread_cond_t  park_cond;          /**< 队列状态变化通知 */
+};
+
+/**
+ * @brief 休眠前再检查一次的等待条件
+ */
+typedef bool (*em_park_cond_t)(em_pipeline_t* pipeline, void* arg);
+
+/*============================================================================
+ *                              内部函数
+ *============================================================================*/
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static bool ring_init(em_spsc_ring_t* ring, size_t capacity)
+{
+    size_t cap = 2;
+    while (cap < capacity) {
+        cap <<= 1;
+    }
+    
+    ring->slots = (void**)calloc(cap, sizeof(void*));
+    if (ring->slots == NULL) {
+        return false;
+    }
+    ring->mask = cap - 1;
+    atomic_init(&ring->head, 0);
+    atomic_init(&ring->tail, 0);
+    atomic_init(&ring->waiters, 0);
+    return true;
+}
+
+static size_t ring_size(em_spsc_ring_t* ring)
+{
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+    size_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    return tail - head;
+}
+
+static bool ring_full(em_spsc_ring_t* ring)
+{
+    return ring_size(ring) > ring->mask;
+}
+
+/**
+ * @brief 生产者写入(队列满返回false)
+ */
+static bool ring_push(em_spsc_ring_t* ring, void* item, size_t* occupancy)
+{
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    size_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    if (tail - head > ring->mask) {
+        return false;
+    }
+    
+    ring->slots[tail & ring->mask] = item;
+    atomic_store_explicit(&ring->tail, tail + 1, memory_order_release);
+    *occupancy = tail + 1 - head;
+    return true;
+}
+
+/**
+ * @brief 消费者读取(队列空返回NULL)
+ */
+static void* ring_pop(em_spsc_ring_t* ring)
+{
+    size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+    if (head == tail) {
+        return NULL;
+    }
+    
+    void* item = ring->slots[head & ring->mask];
+    atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+    return item;
+}
+
+/**
+ * @brief 队列状态变化(写入、取出、上游结束)后唤醒在该队列上休眠的线程
+ * 
+ * 与 pipeline_park 配对：休眠方先登记 waiters 再检查条件，这里先改状态再读
+ * waiters，两侧的 seq_cst 屏障保证至少一方看到对方，不会漏掉唤醒。
+ */
+static void ring_notify(em_pipeline_t* pipeline, em_spsc_ring_t* ring)
+{
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_load_explicit(&ring->waiters, memory_order_relaxed) > 0) {
+        pthread_mutex_lock(&pipeline->park_lock);
+        pthread_cond_broadcast(&pipeline->park_cond);
+        pthread_mutex_unlock(&pipeline->park_lock);
+    }
+}
+
+/**
+ * @brief 在一组队列上休眠，直到其中某个队列的另一侧发出通知
+ * 
+ * 持锁登记后再检查一次条件，条件已满足则直接返回；被唤醒后也直接返回，
+ * 由调用者重新检查(广播可能来自其他队列)。
+ */
+static void pipeline_park(em_pipeline_t* pipeline, em_spsc_ring_t** rings, int count,
+                          em_park_cond_t ready, void* arg)
+{
+    pthread_mutex_lock(&pipeline->park_lock);
+    for (int i = 0; i < count; i++) {
+        atomic_fetch_add_explicit(&rings[i]->waiters, 1, memory_order_relaxed);
+    }
+    atomic_thread_fence(memory_order_seq_cst);
+    
+    if (!ready(pipeline, arg)) {
+        pthread_cond_wait(&pipeline->park_cond, &pipeline->park_lock);
+    }
+    
+    for (int i = 0; i < count; i++) {
+        atomic_fetch_sub_explicit(&rings[i]->waiters, 1, memory_order_relaxed);
+    }
+    pthread_mutex_unlock(&pipeline->park_lock);
+}
+
+/**
+ * @brief 等待时的退避：先自旋，再让出CPU，最后在队列上休眠直到被唤醒
+ */
+static void backoff(em_pipeline_t* pipeline, int* spins, em_spsc_ring_t** rings, int count,
+                    em_park_cond_t ready, void* arg)
+{
+    if (*spins < 64) {
+        (*spins)++;
+    } else if (*spins < 128) {
+        (*spins)++;
+        sched_yield();
+    } else {
+        pipeline_park(pipeline, rings, count, ready, arg);
+    }
+}
+
+/**
+ * @brief 写入某一级的输入队列，并更新占用峰值
+ */
+static bool stage_offer(em_pipeline_t* pipeline, em_stage_t* stage, void* item)
+{
+    size_t occupancy;
+    if (!ring_push(&stage->input, item, &occupancy)) {
+        return false;
+    }
+    ring_notify(pipeline, &stage->input);
+    
+    unsigned int max = atomic_load_explicit(&stage->queue_max, memory_order_relaxed);
+    while (occupancy > max &&
+           !atomic_compare_exchange_weak_explicit(&stage->queue_max, &max, (unsigned int)occupancy,
+                                                  memory_order_relaxed, memory_order_relaxed)) {
+    }
+    return true;
+}
+
+/**
+ * @brief 某一级的输入队列是否有空位
+ */
+static bool stage_has_space(em_pipeline_t* pipeline, void* arg)
+{
+    (void)pipeline;
+    return !ring_full(&((em_stage_t*)arg)->input);
+}
+
+/**
+ * @brief 写入某一级的输入队列，队列满时阻塞等待(背压)
+ */
+static void stage_offer_blocking(em_pipeline_t* pipeline, em_stage_t* stage, void* item)
+{
+    if (stage_offer(pipeline, stage, item)) {
+        return;
+    }
+    
+    atomic_fetch_add_explicit(&stage->stalls, 1, memory_order_relaxed);
+    em_spsc_ring_t* ring = &stage->input;
+    int spins = 0;
+    while (!stage_offer(pipeline, stage, item)) {
+        backoff(pipeline, &spins, &ring, 1, stage_has_space, stage);
+    }
+}
+
+/**
+ * @brief 上一级是否已结束(第一级看是否已停止输入)
+ */
+static bool upstream_finished(em_pipeline_t* pipeline, int index)
+{
+    if (index == 0) {
+        return atomic_load(&pipeline->stopping);
+    }
+    return atomic_load(&pipeline->stages[index - 1].done);
+}
+
+/**
+ * @brief 标记某一级已结束，并唤醒等待它的下一级
+ */
+static void stage_finish(em_pipeline_t* pipeline, int index)
+{
+    atomic_store(&pipeline->stages[index].done, true);
+    if (index + 1 < pipeline->stage_count) {
+        ring_notify(pipeline, &pipeline->stages[index + 1].input);
+    }
+}
+
+/**
+ * @brief 处理某一级的一个数据项
+ * 
+ * @param blocking 下游满时是否阻塞；任务方式不能阻塞，下游满时不取数据
+ * @return bool 是否处理了数据项
+ */
+static bool stage_process_one(em_pipeline_t* pipeline, int index, bool blocking)
+{
+    em_stage_t* stage = &pipeline->stages[index];
+    em_stage_t* next = (index + 1 < pipeline->stage_count) ? &pipeline->stages[index + 1] : NULL;
+    
+    if (!blocking && next != NULL && ring_full(&next->input)) {
+        return false;
+    }
+    
+    void* item = ring_pop(&stage->input);
+    if (item == NULL) {
+        return false;
+    }
+    ring_notify(pipeline, &stage->input);
+    atomic_fetch_add_explicit(&stage->items_in, 1, memory_order_relaxed);
+    
+    void* out = stage->config.fn(item, stage->config.user_data);
+    
+    if (next == NULL) {
+        atomic_fetch_add_explicit(&stage->items_out, 1, memory_order_relaxed);
+    } else if (out == NULL) {
+        atomic_fetch_add_explicit(&stage->items_dropped, 1, memory_order_relaxed);
+    } else {
+        if (blocking) {
+            stage_offer_blocking(pipeline, next, out);
+        } else {
+            /* 取数据前已确认有空位，单生产者下不会失败 */
+            stage_offer(pipeline, next, out);
+        }
+        atomic_fetch_add_explicit(&stage->items_out, 1, memory_order_relaxed);
+    }
+    
+    return true;
+}
+
+/**
+ * @brief 线程方式的级的工作线程
+ */
+typedef struct {
+    em_pipeline_t*  pipeline;
+    int             index;
+} em_stage_arg_t;
+
+/**
+ * @brief 某一级是否有数据可取，或上游已结束
+ */
+static bool stage_has_input(em_pipeline_t* pipeline, void* arg)
+{
+    int index = (int)(intptr_t)arg;
+    return ring_size(&pipeline->stages[index].input) > 0 || upstream_finished(pipeline, index);
+}
+
+static void* stage_thread(void* arg)
+{
+    em_stage_arg_t* sa = (em_stage_arg_t*)arg;
+    em_pipeline_t* pipeline = sa->pipeline;
+    int index = sa->index;
+    free(sa);
+    
+    em_spsc_ring_t* ring = &pipeline->stages[index].input;
+    int spins = 0;
+    
+    for (;;) {
+        /* 先检查上游是否结束，再取数据：上游结束后队列内容不会再增加 */
+        bool upstream_done = upstream_finished(pipeline, index);
+        
+        if (stage_process_one(pipeline, index, true)) {
+            spins = 0;
+            continue;
+        }
+        if (upstream_done) {
+            break;
+        }
+        backoff(pipeline, &spins, &ring, 1, stage_has_input, (void*)(intptr_t)index);
+    }
+    
+    stage_finish(pipeline, index);
+    EM_DEBUG("Pipeline stage %d finished", index);
+    return NULL;
+}
+
+/**
+ * @brief 任务线程是否有事可做：某一级有数据且下游有空位，或可以标记结束
+ */
+static bool task_has_work(em_pipeline_t* pipeline, void* arg)
+{
+    (void)arg;
+    for (int i = 0; i < pipeline->stage_count; i++) {
+        em_stage_t* stage = &pipeline->stages[i];
+        if (stage->config.mode != EM_STAGE_TASK || atomic_load(&stage->done)) {
+            continue;
+        }
+        
+        em_stage_t* next = (i + 1 < pipeline->stage_count) ? &pipeline->stages[i + 1] : NULL;
+        size_t size = ring_size(&stage->input);
+        if (size > 0 && (next == NULL || !ring_full(&next->input))) {
+            return true;
+        }
+        if (size == 0 && upstream_finished(pipeline, i)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief 共享任务线程：轮流执行所有任务方式的级
+ * 
+ * 空闲时在所有未结束的任务级的输入队列及其下游队列上休眠。
+ */
+static void* task_thread(void* arg)
+{
+    em_pipeline_t* pipeline = (em_pipeline_t*)arg;
+    em_spsc_ring_t* rings[EM_PIPELINE_MAX_STAGES * 2];
+    int spins = 0;
+    
+    for (;;) {
+        bool progress = false;
+        bool all_done = true;
+        
+        for (int i = 0; i < pipeline->stage_count; i++) {
+            em_stage_t* stage = &pipeline->stages[i];
+            if (stage->config.mode != EM_STAGE_TASK || atomic_load(&stage->done)) {
+                continue;
+            }
+            
+            bool upstream_done = upstream_finished(pipeline, i);
+            int n = 0;
+            while (n < EM_PIPELINE_TASK_BATCH && stage_process_one(pipeline, i, false)) {
+                n++;
+            }
+            
+            if (n > 0) {
+                progress = true;
+            } else if (upstream_done && ring_size(&stage->input) == 0) {
+                stage_finish(pipeline, i);
+                continue;
+            }
+            all_done = false;
+        }
+        
+        if (all_done) {
+            break;
+        }
+        if (progress) {
+            spins = 0;
+            continue;
+        }
+        
+        int count = 0;
+        for (int i = 0; i < pipeline->stage_count; i++) {
+            em_stage_t* stage = &pipeline->stages[i];
+            if (stage->config.mode != EM_STAGE_TASK || atomic_load(&stage->done)) {
+                continue;
+            }
+            rings[count++] = &stage->input;
+            if (i + 1 < pipeline->stage_count) {
+                rings[count++] = &pipeline->stages[i + 1].input;
+            }
+        }
+        backoff(pipeline, &spins, rings, count, task_has_work, NULL);
+    }
+    
+    return NULL;
+}
+
+/**
+ * @brief 启动失败时停止流水线
+ * 
+ * 没有线程运行的级永远不会标记结束，其下游线程会一直等待上游、em_pipeline_stop
+ * 也就一直阻塞在 pthread_join。此时还没有推入任何数据，把这些级直接标记为已结束。
+ */
+static void pipeline_abort_start(em_pipeline_t* pipeline)
+{
+    for (int i = 0; i < pipeline->stage_count; i++) {
+        em_stage_t* stage = &pipeline->stages[i];
+        bool running = stage->config.mode == EM_STAGE_TASK ? pipeline->task_thread_started
+                                                           : stage->thread_started;
+        if (!running) {
+            stage_finish(pipeline, i);
+        }
+    }
+    em_pipeline_stop(pipeline);
+}
+
+/*============================================================================
+ *                              API实现
+ *============================================================================*/
+
+void em_stage_config_init(em_stage_config_t* config)
+{
+    if (config == NULL) {
+        return;
+    }
+    memset(config, 0, sizeof(*config));
+    config->mode = EM_STAGE_THREAD;
+    config->cpu = -1;
+}
+
+em_pipeline_t* em_pipeline_create(void)
+{
+    em_pipeline_t* pipeline = (em_pipeline_t*)calloc(1, sizeof(em_pipeline_t));
+    if (pipeline == NULL) {
+        return NULL;
+    }
+    
+    atomic_init(&pipeline->stopping, false);
+    atomic_init(&pipeline->stop_ns, 0);
+    pthread_mutex_init(&pipeline->park_lock, NULL);
+    pthread_cond_init(&pipeline->park_cond, NULL);
+    return pipeline;
+}
+
+em_error_t em_pipeline_destroy(em_pipeline_t* pipeline)
+{
+    if (pipeline == NULL) {
+        return EM_ERR_INVALID_PARAM;
+    }
+    
+    em_pipeline_stop(pipeline);
+    
+    for (int i = 0; i < pipeline->stage_count; i++) {
+        free(pipeline->stages[i].input.slots);
+    }
+    pthread_cond_destroy(&pipeline->park_cond);
+    pthread_mutex_destroy(&pipeline->park_lock);
+    free(pipeline);
+    return EM_OK;
+}
+
+int em_pipeline_add_stage(em_pipeline_t* pipeline, const em_stage_config_t* config)
+{
+    if (pipeline == NULL || config == NULL || config->fn == NULL) {
+        return -1;
+    }
+    if (pipeline->started || pipeline->stage_count >= EM_PIPELINE_MAX_STAGES) {
+        return -1;
+    }
+    
+    int index = pipeline->stage_count;
+    em_stage_t* stage = &pipeline->stages[index];
+    memset(stage, 0, sizeof(*stage));
+    stage->config = *config;
+    
+    size_t capacity = config->capacity ? config->capacity : EM_PIPELINE_DEFAULT_CAPACITY;
+    if (!ring_init(&stage->input, capacity)) {
+        return -1;
+    }
+    atomic_init(&stage->done, false);
+    
+    pipeline->stage_count++;
+    return index;
+}
+
+em_error_t em_pipeline_start(em_pipeline_t* pipeline)
+{
+    if (pipeline == NULL || pipeline->stage_count == 0) {
+        return EM_ERR_INVALID_PARAM;
+    }
+    if (pipeline->started) {
+        return EM_ERR_ALREADY_INIT;
+    }
+    
+    pipeline->started = true;
+    pipeline->start_ns = now_ns();
+    
+    bool has_task = false;
+    for (int i = 0; i < pipeline->stage_count; i++) {
+        em_stage_t* stage = &pipeline->stages[i];
+        if (stage->config.mode == EM_STAGE_TASK) {
+            has_task = true;
+            continue;
+        }
+        
+        em_stage_arg_t* arg = (em_stage_arg_t*)malloc(sizeof(em_stage_arg_t));
+        if (arg == NULL) {
+            pipeline_abort_start(pipeline);
+            return EM_ERR_OUT_OF_MEMORY;
+        }
+        arg->pipeline = pipeline;
+        arg->index = i;
+        
+        if (pthread_create(&stage->thread, NULL, stage_thread, arg) != 0) {
+            free(arg);
+            pipeline_abort_start(pipeline);
+            return EM_ERR_OUT_OF_MEMORY;
+        }
+        stage->thread_started = true;
+
+#ifdef __linux__
+        if (stage->config.cpu >= 0) {
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            CPU_SET(stage->config.cpu, &set);
+            if (pthread_setaffinity_np(stage->thread, sizeof(set), &set) != 0) {
+                EM_DEBUG("Failed to pin stage %d to cpu %d", i, stage->config.cpu);
+            }
+        }
+#endif
+    }
+    
+    if (has_task) {
+        if (pthread_create(&pipeline->task_thread, NULL, task_thread, pipeline) != 0) {
+            pipeline_abort_start(pipeline);
+            return EM_ERR_OUT_OF_MEMORY;
+        }
+        pipeline->task_thread_started = true;
+    }
+    
+    EM_DEBUG("Pipeline started (%d stages)", pipeline->stage_count);
+    return EM_OK;
+}
+
+em_error_t em_pipeline_stop(em_pipeline_t* pipeline)
+{
+    if (pipeline == NULL) {
+        return EM_ERR_INVALID_PARAM;
+    }
+    if (!pipeline->started || atomic_load(&pipeline->stopping)) {
+        return EM_OK;
+    }
+    
+    atomic_store(&pipeline->stopping, true);
+    ring_notify(pipeline, &pipeline->stages[0].input);
+    
+    for (int i = 0; i < pipeline->stage_count; i++) {
+        if (pipeline->stages[i].thread_started) {
+            pthread_join(pipeline->stages[i].thread, NULL);
+            pipeline->stages[i].thread_started = false;
+        }
+    }
+    if (pipeline->task_thread_started) {
+        pthread_join(pipeline->task_thread, NULL);
+        pipeline->task_thread_started = false;
+    }
+    
+    atomic_store(&pipeline->stop_ns, now_ns());
+    EM_DEBUG("Pipeline stopped");
+    return EM_OK;
+}
+
+em_error_t em_pipeline_push(em_pipeline_t* pipeline, void* item)
+{
+    if (pipeline == NULL || item == NULL || pipeline->stage_count == 0) {
+        return EM_ERR_INVALID_PARAM;
+    }
+    if (atomic_load(&pipeline->stopping)) {
+        return EM_ERR_NOT_INITIALIZED;
+    }
+    
+    stage_offer_blocking(pipeline, &pipeline->stages[0], item);
+    return EM_OK;
+}
+
+em_error_t em_pipeline_try_push(em_pipeline_t* pipeline, void* item)
+{
+    if (pipeline == NULL || item == NULL || pipeline->stage_count == 0) {
+        return EM_ERR_INVALID_PARAM;
+    }
+    if (atomic_load(&pipeline->stopping)) {
+        return EM_ERR_NOT_INITIALIZED;
+    }
+    
+    if (!stage_offer(pipeline, &pipeline->stages[0], item)) {
+        atomic_fetch_add_explicit(&pipeline->stages[0].stalls, 1, memory_order_relaxed);
+        return EM_ERR_QUEUE_FULL;
+    }
+    return EM_OK;
+}
+
+em_error_t em_pipeline_get_stage_stats(em_pipeline_t* pipeline, int stage,
+                                       em_stage_stats_t* stats)
+{
+    if (pipeline == NULL || stats == NULL || stage < 0 || stage >= pipeline->stage_count) {
+        return EM_ERR_INVALID_PARAM;
+    }
+    
+    em_stage_t* st = &pipeline->stages[stage];
+    memset(stats, 0, sizeof(*stats));
+    stats->items_in = atomic_load(&st->items_in);
+    stats->items_out = atomic_load(&st->items_out);
+    stats->items_dropped = atomic_load(&st->items_dropped);
+    stats->stalls = atomic_load(&st->stalls);
+    stats->queue_current = (uint32_t)ring_size(&st->input);
+    stats->queue_max = atomic_load(&st->queue_max);
+    stats->queue_capacity = (uint32_t)(st->input.mask + 1);
+    
+    if (pipeline->started) {
+        uint64_t stop = atomic_load(&pipeline->stop_ns);
+        uint64_t end = stop ? stop : now_ns();
+        uint64_t elapsed = end - pipeline->start_ns;
+        if (elapsed > 0) {
+            stats->throughput = (uint64_t)((double)stats->items_out * 1e9 / (double)elapsed);
+        }
+    }
+    
+    return EM_OK;
+}
+
+int em_pipeline_stage_count(em_pipeline_t* pipeline)
+{
+    if (pipeline == NULL) {
+        return -1;
+    }
+    return pipeline->stage_count;
+}
+
+#endif /* EM_ENABLE_THREADING */
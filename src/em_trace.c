@@ -0,0 +1,566 @@
+/**
+ * @file em_trace.c
+ * @brief 事件流录制与紧凑编码实现
+ * 
+ * @author 梦里不知身是客
+ * @version 1.0.0
+ * @date 2026
+ * @copyright MIT License
+ */
+
+#include "em_trace.h"
+#include <stdlib.h>
+#include <string.h>
+
+#if EM_ENABLE_THREADING
+#include <pthread.h>
+#endif
+
+/*============================================================================
+ *                              内部定义
+ *============================================================================*/
+
+#define EM_TRACE_VERSION        1
+#define EM_TRACE_HEADER_SIZE    5
+
+/* 记录头字节 */
+#define REC_PRIORITY_MASK       0x03
+#define REC_ASYNC               0x04
+#define REC_SAME_ID             0x08
+#define REC_XOR                 0x10
+#define REC_HAS_DATA            0x20
+
+/** 记录头(头字节 + 三个 varint)的最大长度 */
+#define REC_HEADER_MAX          (1 + 10 + 5 + 10)
+
+/** 异或编码结果的最大长度(每个字面字节最多带两个单字节 varint) */
+#define DELTA_MAX               (EM_TRACE_MAX_DELTA_SIZE * 3 + 4)
+
+/** 定长格式下每条记录的头部大小，用于统计压缩比 */
+#define RAW_RECORD_SIZE         18
+
+/**
+ * @brief 某个事件ID上一次的数据
+ */
+typedef struct {
+    uint32_t    size;                               /**< 数据大小(0表示没有可参照的数据) */
+    uint8_t     bytes[EM_TRACE_MAX_DELTA_SIZE];     /**< 数据 */
+} em_trace_prev_t;
+
+/**
+ * @brief 编码器
+ */
+struct em_trace_writer {
+    uint32_t            flags;          /**< 编码标志 */
+    em_trace_sink_t     sink;           /**< 输出函数 */
+    void*               user_data;      /**< 输出函数的用户数据 */
+    bool                header_written; /**< 流头是否已写入缓冲 */
+    uint64_t            last_ts;        /**< 上一条记录的时间戳 */
+    uint32_t            last_id;        /**< 上一条记录的事件ID */
+    em_trace_prev_t*    prev;           /**< 各事件ID上一次的数据(仅异或编码时分配) */
+    em_trace_stats_t    stats;          /**< 统计信息 */
+    size_t              length;         /**< 缓冲中的字节数 */
+    uint8_t             buffer[EM_TRACE_BUFFER_SIZE];
+#if EM_ENABLE_THREADING
+    pthread_mutex_t     mutex;
+#endif
+};
+
+/**
+ * @brief 解码器
+ */
+struct em_trace_reader {
+    bool                header_read;    /**< 流头是否已读取 */
+    uint32_t            flags;          /**< 流头中的编码标志 */
+    uint64_t            last_ts;        /**< 上一条记录的时间戳 */
+    uint32_t            last_id;        /**< 上一条记录的事件ID */
+    em_trace_prev_t*    prev;           /**< 各事件ID上一次的数据 */
+    uint8_t*            data;           /**< 当前记录的数据 */
+    size_t              data_capacity;  /**< data 的容量 */
+};
+
+/*============================================================================
+ *                              varint 编解码
+ *============================================================================*/
+
+static size_t put_varint(uint8_t* out, uint64_t value)
+{
+    size_t n = 0;
+    while (value >= 0x80) {
+        out[n++] = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    out[n++] = (uint8_t)value;
+    return n;
+}
+
+/**
+ * @brief 读取 varint
+ * 
+ * @return 消耗的字节数；数据不足返回0，超过10字节返回-1
+ */
+static int get_varint(const uint8_t* p, const uint8_t* end, uint64_t* value)
+{
+    uint64_t result = 0;
+    for (int i = 0; i < 10; i++) {
+        if (p + i >= end) {
+            return 0;
+        }
+        result |= (uint64_t)(p[i] & 0x7f) << (7 * i);
+        if ((p[i] & 0x80) == 0) {
+            *value = result;
+            return i + 1;
+        }
+    }
+    return -1;
+}
+
+/* 时间戳差值可能为负(多个线程分发)，用 zigzag 映射为无符号数 */
+static uint64_t zigzag_encode(int64_t value)
+{
+    return ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+}
+
+static int64_t zigzag_decode(uint64_t value)
+{
+    return (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+}
+
+/*============================================================================
+ *                              编码
+ *============================================================================*/
+
+static inline void lock_writer(em_trace_writer_t* writer)
+{
+#if EM_ENABLE_THREADING
+    pthread_mutex_lock(&writer->mutex);
+#else
+    (void)writer;
+#endif
+}
+
+static inline void unlock_writer(em_trace_writer_t* writer)
+{
+#if EM_ENABLE_THREADING
+    pthread_mutex_unlock(&writer->mutex);
+#else
+    (void)writer;
+#endif
+}
+
+/**
+ * @brief 输出缓冲(调用者需持有锁)
+ */
+static bool writer_flush_locked(em_trace_writer_t* writer)
+{
+    if (writer->length == 0) {
+        return true;
+    }
+    bool ok = writer->sink(writer->buffer, writer->length, writer->user_data);
+    if (!ok) {
+        writer->stats.sink_errors++;
+    }
+    writer->length = 0;
+    return ok;
+}
+
+/**
+ * @brief 追加字节，缓冲放不下时先输出；超过缓冲大小的数据直接交给输出函数
+ */
+static void writer_append(em_trace_writer_t* writer, const void* bytes, size_t size)
+{
+    if (writer->length + size > EM_TRACE_BUFFER_SIZE) {
+        writer_flush_locked(writer);
+    }
+    if (size > EM_TRACE_BUFFER_SIZE) {
+        if (!writer->sink(bytes, size, writer->user_data)) {
+            writer->stats.sink_errors++;
+        }
+        return;
+    }
+    memcpy(writer->buffer + writer->length, bytes, size);
+    writer->length += size;
+}
+
+/**
+ * @brief 对与上一次数据的异或结果做零字节游程编码
+ * 
+ * @return 编码长度
+ */
+static size_t encode_delta(const uint8_t* data, const uint8_t* prev, size_t size, uint8_t* out)
+{
+    size_t n = 0;
+    size_t i = 0;
+    while (i < size) {
+        size_t zeros = 0;
+        while (i + zeros < size && data[i + zeros] == prev[i + zeros]) {
+            zeros++;
+        }
+        i += zeros;
+        
+        size_t literals = 0;
+        while (i + literals < size && data[i + literals] != prev[i + literals]) {
+            literals++;
+        }
+        
+        n += put_varint(out + n, zeros);
+        n += put_varint(out + n, literals);
+        for (size_t k = 0; k < literals; k++) {
+            out[n++] = data[i + k] ^ prev[i + k];
+        }
+        i += literals;
+    }
+    return n;
+}
+
+em_trace_writer_t* em_trace_writer_create(uint32_t flags, em_trace_sink_t sink, void* user_data)
+{
+    if (sink == NULL) {
+        return NULL;
+    }
+    
+    em_trace_writer_t* writer = (em_trace_writer_t*)calloc(1, sizeof(em_trace_writer_t));
+    if (writer == NULL) {
+        return NULL;
+    }
+    
+    writer->flags = flags & EM_TRACE_XOR_DELTA;
+    writer->sink = sink;
+    writer->user_data = user_data;
+    writer->last_id = UINT32_MAX;
+    
+    if (writer->flags & EM_TRACE_XOR_DELTA) {
+        writer->prev = (em_trace_prev_t*)calloc(EM_MAX_EVENT_TYPES, sizeof(em_trace_prev_t));
+        if (writer->prev == NULL) {
+            free(writer);
+            return NULL;
+        }
+    }
+
+#if EM_ENABLE_THREADING
+    if (pthread_mutex_init(&writer->mutex, NULL) != 0) {
+        free(writer->prev);
+        free(writer);
+        return NULL;
+    }
+#endif
+    
+    return writer;
+}
+
+em_error_t em_trace_writer_destroy(em_trace_writer_t* writer)
+{
+    if (writer == NULL) {
+        return EM_ERR_INVALID_PARAM;
+    }
+    
+    lock_writer(writer);
+    writer_flush_locked(writer);
+    unlock_writer(writer);
+
+#if EM_ENABLE_THREADING
+    pthread_mutex_destroy(&writer->mutex);
+#endif
+    free(writer->prev);
+    free(writer);
+    return EM_OK;
+}
+
+em_error_t em_trace_write(em_trace_writer_t* writer, const em_trace_record_t* record)
+{
+    if (writer == NULL || record == NULL || record->event.id >= EM_MAX_EVENT_TYPES) {
+        return EM_ERR_INVALID_PARAM;
+    }
+    
+    const em_event_t* event = &record->event;
+    const uint8_t* data = (const uint8_t*)event->data;
+    size_t size = (data != NULL) ? event->data_size : 0;
+    
+    lock_writer(writer);
+    
+    if (!writer->header_written) {
+        uint8_t header[EM_TRACE_HEADER_SIZE] = { 'E', 'M', 'T', EM_TRACE_VERSION, (uint8_t)writer->flags };
+        writer_append(writer, header, sizeof(header));
+        writer->stats.encoded_bytes += sizeof(header);
+        writer->header_written = true;
+    }
+    
+    /* 同一事件ID上一次的数据大小相同时尝试异或编码，更短才采用 */
+    uint8_t delta[DELTA_MAX];
+    size_t delta_size = 0;
+    em_trace_prev_t* prev = writer->prev ? &writer->prev[event->id] : NULL;
+    bool use_delta = false;
+    if (prev != NULL && size > 0 && prev->size == size) {
+        delta_size = encode_delta(data, prev->bytes, size, delta);
+        use_delta = delta_size < size;
+    }
+    
+    uint8_t head[REC_HEADER_MAX];
+    size_t n = 1;
+    head[0] = (uint8_t)(event->priority & REC_PRIORITY_MASK);
+    if (event->mode == EM_MODE_ASYNC) {
+        head[0] |= REC_ASYNC;
+    }
+    n += put_varint(head + n, zigzag_encode((int64_t)(record->timestamp_ns - writer->last_ts)));
+    if (event->id == writer->last_id) {
+        head[0] |= REC_SAME_ID;
+    } else {
+        n += put_varint(head + n, event->id);
+    }
+    if (size > 0) {
+        head[0] |= REC_HAS_DATA;
+        n += put_varint(head + n, size);
+    }
+    if (use_delta) {
+        head[0] |= REC_XOR;
+    }
+    
+    writer_append(writer, head, n);
+    if (use_delta) {
+        writer_append(writer, delta, delta_size);
+        writer->stats.delta_records++;
+    } else if (size > 0) {
+        writer_append(writer, data, size);
+    }
+    
+    /* 记住本次数据，供下一次异或编码参照；没有数据的记录不改变参照 */
+    if (prev != NULL && size > 0) {
+        if (size <= EM_TRACE_MAX_DELTA_SIZE) {
+            memcpy(prev->bytes, data, size);
+            prev->size = (uint32_t)size;
+        } else {
+            prev->size = 0;
+        }
+    }
+    writer->last_ts = record->timestamp_ns;
+    writer->last_id = event->id;
+    
+    writer->stats.records++;
+    writer->stats.raw_bytes += RAW_RECORD_SIZE + size;
+    writer->stats.encoded_bytes += n + (use_delta ? delta_size : size);
+    
+    unlock_writer(writer);
+    return EM_OK;
+}
+
+em_error_t em_trace_flush(em_trace_writer_t* writer)
+{
+    if (writer == NULL) {
+        return EM_ERR_INVALID_PARAM;
+    }
+    
+    lock_writer(writer);
+    bool ok = writer_flush_locked(writer);
+    unlock_writer(writer);
+    
+    return ok ? EM_OK : EM_ERR_QUEUE_FULL;
+}
+
+em_error_t em_trace_get_stats(em_trace_writer_t* writer, em_trace_stats_t* stats)
+{
+    if (writer == NULL || stats == NULL) {
+        return EM_ERR_INVALID_PARAM;
+    }
+    
+    lock_writer(writer);
+    *stats = writer->stats;
+    unlock_writer(writer);
+    
+    return EM_OK;
+}
+
+static void trace_hook(const em_event_t* event, uint64_t timestamp_ns, void* user_data)
+{
+    em_trace_record_t record = { timestamp_ns, *event };
+    em_trace_write((em_trace_writer_t*)user_data, &record);
+}
+
+em_error_t em_trace_attach(em_handle_t handle, em_trace_writer_t* writer)
+{
+    if (handle == NULL) {
+        return EM_ERR_INVALID_PARAM;
+    }
+    return em_set_trace_hook(handle, writer ? trace_hook : NULL, writer);
+}
+
+/*============================================================================
+ *                              解码
+ *============================================================================*/
+
+em_trace_reader_t* em_trace_reader_create(void)
+{
+    em_trace_reader_t* reader = (em_trace_reader_t*)calloc(1, sizeof(em_trace_reader_t));
+    if (reader == NULL) {
+        return NULL;
+    }
+    
+    reader->prev = (em_trace_prev_t*)calloc(EM_MAX_EVENT_TYPES, sizeof(em_trace_prev_t));
+    if (reader->prev == NULL) {
+        free(reader);
+        return NULL;
+    }
+    reader->last_id = UINT32_MAX;
+    return reader;
+}
+
+em_error_t em_trace_reader_destroy(em_trace_reader_t* reader)
+{
+    if (reader == NULL) {
+        return EM_ERR_INVALID_PARAM;
+    }
+    
+    free(reader->prev);
+    free(reader->data);
+    free(reader);
+    return EM_OK;
+}
+
+/**
+ * @brief 还原异或编码的数据
+ * 
+ * @return 消耗的字节数；数据不足返回0，格式错误返回-1
+ */
+static int decode_delta(const uint8_t* p, const uint8_t* end, const uint8_t* prev,
+                        size_t size, uint8_t* out)
+{
+    const uint8_t* start = p;
+    size_t i = 0;
+    while (i < size) {
+        uint64_t zeros;
+        uint64_t literals;
+        int n = get_varint(p, end, &zeros);
+        if (n <= 0) {
+            return n;
+        }
+        p += n;
+        n = get_varint(p, end, &literals);
+        if (n <= 0) {
+            return n;
+        }
+        p += n;
+        
+        if (zeros > size - i || literals > size - i - zeros) {
+            return -1;
+        }
+        if ((size_t)(end - p) < literals) {
+            return 0;
+        }
+        memcpy(out + i, prev + i, zeros);
+        i += zeros;
+        for (uint64_t k = 0; k < literals; k++) {
+            out[i] = prev[i] ^ p[k];
+            i++;
+        }
+        p += literals;
+    }
+    return (int)(p - start);
+}
+
+em_error_t em_trace_read(em_trace_reader_t* reader, const void* bytes, size_t size,
+                         size_t* consumed, em_trace_record_t* record)
+{
+    if (reader == NULL || (bytes == NULL && size > 0) || consumed == NULL || record == NULL) {
+        return EM_ERR_INVALID_PARAM;
+    }
+    
+    const uint8_t* p = (const uint8_t*)bytes;
+    const uint8_t* end = p + size;
+    *consumed = 0;
+    
+    /* 流头与第一条记录一起提交，数据不足时不改变解码器状态 */
+    uint32_t flags = reader->flags;
+    if (!reader->header_read) {
+        if (size < EM_TRACE_HEADER_SIZE) {
+            return EM_ERR_QUEUE_EMPTY;
+        }
+        if (p[0] != 'E' || p[1] != 'M' || p[2] != 'T' || p[3] != EM_TRACE_VERSION) {
+            return EM_ERR_INVALID_PARAM;
+        }
+        flags = p[4];
+        p += EM_TRACE_HEADER_SIZE;
+    }
+    
+    if (p >= end) {
+        return EM_ERR_QUEUE_EMPTY;
+    }
+    uint8_t head = *p++;
+    
+    uint64_t ts_delta;
+    int n = get_varint(p, end, &ts_delta);
+    if (n <= 0) {
+        return n == 0 ? EM_ERR_QUEUE_EMPTY : EM_ERR_INVALID_PARAM;
+    }
+    p += n;
+    
+    uint64_t id = reader->last_id;
+    if (!(head & REC_SAME_ID)) {
+        n = get_varint(p, end, &id);
+        if (n <= 0) {
+            return n == 0 ? EM_ERR_QUEUE_EMPTY : EM_ERR_INVALID_PARAM;
+        }
+        p += n;
+    }
+    if (id >= EM_MAX_EVENT_TYPES) {
+        return EM_ERR_INVALID_PARAM;
+    }
+    
+    uint64_t data_size = 0;
+    if (head & REC_HAS_DATA) {
+        n = get_varint(p, end, &data_size);
+        if (n <= 0) {
+            return n == 0 ? EM_ERR_QUEUE_EMPTY : EM_ERR_INVALID_PARAM;
+        }
+        p += n;
+    }
+    
+    em_trace_prev_t* prev = &reader->prev[id];
+    if (head & REC_XOR) {
+        if (!(flags & EM_TRACE_XOR_DELTA) || data_size == 0 || prev->size != data_size) {
+            return EM_ERR_INVALID_PARAM;
+        }
+    } else if ((uint64_t)(end - p) < data_size) {
+        return EM_ERR_QUEUE_EMPTY;
+    }
+    
+    if (data_size > reader->data_capacity) {
+        uint8_t* grown = (uint8_t*)realloc(reader->data, (size_t)data_size);
+        if (grown == NULL) {
+            return EM_ERR_OUT_OF_MEMORY;
+        }
+        reader->data = grown;
+        reader->data_capacity = (size_t)data_size;
+    }
+    
+    if (head & REC_XOR) {
+        n = decode_delta(p, end, prev->bytes, (size_t)data_size, reader->data);
+        if (n <= 0) {
+            return n == 0 ? EM_ERR_QUEUE_EMPTY : EM_ERR_INVALID_PARAM;
+        }
+        p += n;
+    } else if (data_size > 0) {
+        memcpy(reader->data, p, (size_t)data_size);
+        p += data_size;
+    }
+    
+    /* 记录完整，提交解码器状态 */
+    reader->header_read = true;
+    reader->flags = flags;
+    reader->last_ts += (uint64_t)zigzag_decode(ts_delta);
+    reader->last_id = (uint32_t)id;
+    if (data_size > 0 && data_size <= EM_TRACE_MAX_DELTA_SIZE) {
+        memcpy(prev->bytes, reader->data, (size_t)data_size);
+        prev->size = (uint32_t)data_size;
+    } else if (data_size > 0) {
+        prev->size = 0;
+    }
+    
+    record->timestamp_ns = reader->last_ts;
+    record->event.id = (em_event_id_t)id;
+    record->event.data = data_size > 0 ? reader->data : NULL;
+    record->event.data_size = (size_t)data_size;
+    record->event.priority = (em_priority_t)(head & REC_PRIORITY_MASK);
+    record->event.mode = (head & REC_ASYNC) ? EM_MODE_ASYNC : EM_MODE_SYNC;
+    
+    *consumed = (size_t)(p - (const uint8_t*)bytes);
+    return EM_OK;
+}
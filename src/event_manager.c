@@ -8,13 +8,45 @@
  * @copyright MIT License
  */
 
+#define _GNU_SOURCE  /* for clock_gettime */
 #include "event_manager.h"
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
+#include <stdatomic.h>
+#include <time.h>
+
+/* 不变 TSC 时钟 (仅 x86-64) */
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <cpuid.h>
+#include <x86intrin.h>
+#define EM_HAVE_TSC 1
+#else
+#define EM_HAVE_TSC 0
+#endif
 
 #if EM_ENABLE_THREADING
 #include <pthread.h>
+#include <sched.h>
+#include <errno.h>
+#endif
+
+/* 自旋锁的休眠使用 futex (仅 Linux) */
+#if EM_ENABLE_THREADING && defined(__linux__)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#define EM_HAVE_FUTEX 1
+#else
+#define EM_HAVE_FUTEX 0
+#endif
+
+#if defined(__x86_64__) || defined(__i386__)
+#define cpu_relax() __builtin_ia32_pause()
+#elif defined(__aarch64__)
+#define cpu_relax() __asm__ __volatile__("yield")
+#else
+#define cpu_relax() ((void)0)
 #endif
 
 /* epoll 支持 (仅 Linux) */
@@ -22,6 +54,9 @@
 #ifdef __linux__
 #include <sys/epoll.h>
 #include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <fcntl.h>
 #include <unistd.h>
 #define EM_USE_EPOLL 1
 #else
@@ -54,12 +89,135 @@
  *                              内部数据结构
  *============================================================================*/
 
+/**
+ * @brief 异步事件数据副本的头部
+ * 
+ * 数据副本带引用计数：投递到执行器的回调会各自持有一个引用，
+ * 最后一个持有者释放时才真正回收内存。
+ */
+typedef struct {
+    atomic_int  refs;           /**< 引用计数 */
+    size_t      size;           /**< 数据大小 */
+    struct em_payload_pool* pool;   /**< 所属数据块池(NULL表示由 malloc 分配) */
+} em_payload_hdr_t;
+
+/** 头部按最大对齐补齐，保证数据区满足任意类型的对齐要求 */
+#define EM_PAYLOAD_HDR_SIZE \
+    ((sizeof(em_payload_hdr_t) + _Alignof(max_align_t) - 1) & ~(_Alignof(max_align_t) - 1))
+
+/**
+ * @brief 异步事件数据块池
+ * 
+ * 固定大小的块组成无锁空闲栈，栈顶带版本标签防止 ABA。空闲块计数先于出栈
+ * 扣减，低优先级扣减时必须为更高优先级留下保留块，因此大量 LOW 事件不会让
+ * HIGH 的发布因内存不足而失败。
+ * 
+ * 块池由管理器和每个已分配的块各持有一个引用，管理器销毁后，仍被执行器
+ * 持有的块释放时才回收块池。
+ */
+typedef struct em_payload_pool {
+    _Atomic uint64_t    top;            /**< 高32位为版本标签，低32位为栈顶块号加1(0表示空) */
+    atomic_uint         free_count;     /**< 空闲块数 */
+    atomic_int          refs;           /**< 引用计数 */
+    atomic_uint         oversize;       /**< 改用 malloc 的次数 */
+    atomic_uint         exhausted[EM_PRIORITY_COUNT];   /**< 各优先级分配失败次数 */
+    uint32_t            reserve_below[EM_PRIORITY_COUNT];   /**< 该优先级分配后至少留下的空闲块数 */
+    uint32_t            block_count;    /**< 块数 */
+    size_t              block_size;     /**< 每块数据区大小 */
+    size_t              stride;         /**< 每块总大小(含头部) */
+    atomic_uint*        next;           /**< 空闲栈中下一块的块号加1 */
+    char*               blocks;         /**< 块存储 */
+} em_payload_pool_t;
+
+/**
+ * @brief em_publish_from_isr 的环形缓冲区槽位
+ */
+typedef struct {
+    _Atomic uint32_t    seq;            /**< 等于写位置时可写，等于写位置加1时可读 */
+    em_event_id_t       id;
+    uint8_t             priority;
+    uint8_t             size;           /**< 内联数据长度(0表示只传指针) */
+    em_event_data_t     ptr;            /**< size 为0时的数据指针 */
+    unsigned char       data[EM_ISR_PAYLOAD_SIZE];
+} em_isr_slot_t;
+
+/**
+ * @brief 中断/信号上下文发布的环形缓冲区
+ * 
+ * 创建时预分配的有界多生产者队列(每槽带序号)。生产者只做原子操作和内联复制，
+ * 不加锁、不分配内存；事件循环持锁取出并放入普通队列。
+ */
+typedef struct {
+    _Atomic uint32_t    tail;           /**< 生产者写位置 */
+    uint32_t            head;           /**< 消费者读位置(持锁访问) */
+    uint32_t            mask;           /**< 槽数减1 */
+    em_isr_slot_t       slots[];
+} em_isr_ring_t;
+
+/**
+ * @brief 投递到执行器的一次回调调用
+ */
+typedef struct {
+    em_callback_t   callback;   /**< 回调函数 */
+    em_event_id_t   event_id;   /**< 事件ID */
+    em_event_data_t data;       /**< 事件数据 */
+    void*           user_data;  /**< 用户数据 */
+    void*           payload;    /**< 持有引用的数据副本(可为NULL) */
+} em_invocation_t;
+
+/**
+ * @brief 执行器收件箱槽位
+ */
+typedef struct {
+    atomic_size_t   seq;        /**< 槽位序号(用于无锁同步) */
+    em_invocation_t inv;        /**< 回调调用 */
+} em_inbox_slot_t;
+
+/**
+ * @brief 执行器
+ * 
+ * 收件箱是有界无锁环形队列(基于序号的 MPMC 算法)，
+ * 多个分发线程可以同时投递，执行线程无需加锁即可取出。
+ */
+struct em_executor {
+    em_inbox_slot_t*    slots;          /**< 槽位数组 */
+    size_t              mask;           /**< 容量掩码(容量为2的幂) */
+    atomic_size_t       enqueue_pos;    /**< 投递位置 */
+    atomic_size_t       dequeue_pos;    /**< 取出位置 */
+    _Atomic(em_handle_t) owner;         /**< 所属事件管理器(可为NULL，解除挂接时在管理器锁内置空) */
+    atomic_int          users;          /**< 正在使用 owner 的线程数，解除挂接后需等待其归零 */
+    atomic_int          refs;           /**< 引用计数(用户、订阅、分发中、调度中各持有一个) */
+    atomic_bool         closed;         /**< 已销毁，不再接收投递 */
+    void              (*notify)(em_executor_t* executor);   /**< 投递后的通知钩子(NULL表示唤醒所属管理器) */
+    void              (*finalize)(em_executor_t* executor); /**< 最后一个引用释放时的清理钩子 */
+    void*               context;        /**< 钩子上下文 */
+};
+
+#if EM_ENABLE_THREADING
+/**
+ * @brief Actor
+ * 
+ * Actor 的邮箱就是一个执行器收件箱，投递后由共享工作线程池调度执行。
+ * scheduled 标志保证同一时刻最多只有一个工作线程在运行该 Actor。
+ */
+struct em_actor {
+    em_handle_t         handle;         /**< 所属事件管理器 */
+    em_executor_t*      mailbox;        /**< 邮箱(MPSC 无锁队列) */
+    em_callback_t       handler;        /**< 消息处理函数 */
+    void*               state;          /**< 私有状态 */
+    atomic_int          scheduled;      /**< 是否已在就绪队列中或正在运行 */
+    em_actor_t*         next;           /**< 就绪队列链接 */
+};
+#endif
+
 /**
  * @brief 异步事件队列节点
  */
 typedef struct {
     em_event_t  event;          /**< 事件信息 */
     void*       data_copy;      /**< 数据副本(异步事件) */
+    uint64_t    enqueue_ns;     /**< 入队时间戳 */
+    int8_t      producer;       /**< 生产者编号(-1表示未绑定) */
     bool        used;           /**< 是否使用中 */
 } em_queue_node_t;
 
@@ -67,10 +225,13 @@ typedef struct {
  * @brief 优先级队列
  */
 typedef struct {
-    em_queue_node_t nodes[EM_ASYNC_QUEUE_SIZE];   /**< 队列节点数组 */
+    em_queue_node_t* nodes;     /**< 节点数组(可在线调整容量) */
+    int             capacity;   /**< 容量 */
     int             head;       /**< 队列头 */
     int             tail;       /**< 队列尾 */
     int             count;      /**< 当前数量 */
+    uint64_t        enqueued;   /**< 累计入队数 */
+    uint64_t        removed;    /**< 累计移出数(出队或清空) */
 } em_priority_queue_t;
 
 /**
@@ -82,6 +243,229 @@ typedef struct {
     bool            sorted;     /**< 是否已排序 */
 } em_subscriber_list_t;
 
+/**
+ * @brief 订阅组成员
+ */
+typedef struct {
+    em_event_id_t   event_id;   /**< 订阅的事件ID */
+    em_callback_t   callback;   /**< 回调函数 */
+    void*           user_data;  /**< 用户数据 */
+    bool            active;     /**< 是否激活 */
+    atomic_int      load;       /**< 正在执行的回调数(槽位复用时不清零，在途回调返回后自然归零) */
+} em_group_member_t;
+
+/**
+ * @brief 订阅组
+ * 
+ * 成员不参与订阅者排序，槽位固定，分发时可以在锁外通过指针更新负载计数。
+ */
+typedef struct {
+    uint32_t            id;         /**< 订阅组ID(0表示空闲) */
+    em_group_policy_t   policy;     /**< 成员选择策略 */
+    em_group_key_fn_t   key_fn;     /**< 键值函数 */
+    atomic_uint         next;       /**< 轮询位置(分发可能只持读锁) */
+    em_group_member_t   members[EM_MAX_GROUP_MEMBERS];
+} em_group_t;
+
+/**
+ * @brief 分发时选中的订阅组成员
+ */
+typedef struct {
+    em_callback_t   callback;
+    void*           user_data;
+    atomic_int*     load;
+} em_group_pick_t;
+
+/**
+ * @brief 热点表项
+ */
+typedef struct {
+    atomic_uint         id;         /**< 事件ID加1(0表示空) */
+    _Atomic uint64_t    count;      /**< 发布次数估计 */
+    _Atomic uint64_t    bytes;      /**< 字节数估计 */
+} em_hot_entry_t;
+
+/**
+ * @brief 热点事件统计(count-min sketch + top-K 表)
+ * 
+ * 发布路径只做原子加法和比较交换。每次发布后用 sketch 的估计值更新表项，
+ * 表中没有该ID且估计值大于表中最小项时替换最小项。并发替换可能让同一ID
+ * 占两项，读取时去重。
+ */
+typedef struct {
+    atomic_bool         enabled;
+    _Atomic uint64_t    counts[EM_TOP_SKETCH_DEPTH][EM_TOP_SKETCH_WIDTH];
+    _Atomic uint64_t    bytes[EM_TOP_SKETCH_DEPTH][EM_TOP_SKETCH_WIDTH];
+    em_hot_entry_t      top[2][EM_TOP_EVENTS_K];    /**< 按次数、按字节数 */
+} em_hot_tracker_t;
+
+/**
+ * @brief 内置调度器状态
+ * 
+ * FIFO、AGING、EDF 都按"入队时间 + 该优先级的偏移"合并各队列，只是偏移不同；
+ * WFQ 按步长调度(stride scheduling)，步长与权重成反比。
+ */
+typedef struct {
+    uint64_t offset_ns[EM_PRIORITY_COUNT];  /**< 合并排序的偏移 */
+    uint64_t stride[EM_PRIORITY_COUNT];     /**< WFQ 步长 */
+    uint64_t pass[EM_PRIORITY_COUNT];       /**< WFQ 各优先级的虚拟时间 */
+    uint64_t vtime;                         /**< WFQ 最近一次出队的虚拟时间 */
+} em_sched_builtin_t;
+
+/**
+ * @brief 调度器回调看到的队列状态
+ */
+struct em_sched_view {
+    em_handle_t handle;
+    uint64_t    now_ns;
+};
+
+/**
+ * @brief 负载控制器状态(CoDel 风格)
+ * 
+ * 每个观察窗口统计出队事件的最小排队延迟：有 HIGH 样本时只看 HIGH，
+ * 否则看所有优先级。最小延迟超过目标说明存在持续积压，升高一级丢弃级别；
+ * 低于目标或窗口内没有样本时降低一级。
+ */
+typedef struct {
+    em_shed_config_t    config;             /**< 配置 */
+    int                 level;              /**< 当前丢弃级别(0~EM_PRIORITY_COUNT-1) */
+    uint64_t            interval_start_ns;  /**< 当前窗口开始时间 */
+    uint64_t            min_high_ns;        /**< 窗口内 HIGH 最小排队延迟 */
+    uint64_t            min_any_ns;         /**< 窗口内所有优先级最小排队延迟 */
+} em_shed_state_t;
+
+/**
+ * @brief 生产者配额
+ * 
+ * 计数使用原子变量，发布时可以不加锁先按上限快速拒绝，也可以不加锁读取统计；
+ * 准入判断和计数修改在持锁时进行。
+ */
+typedef struct {
+    bool        active;                         /**< 是否已注册 */
+    uint32_t    reserved[EM_PRIORITY_COUNT];    /**< 预留槽位数 */
+    uint32_t    limit[EM_PRIORITY_COUNT];       /**< 占用上限(0表示不限) */
+    atomic_uint queued[EM_PRIORITY_COUNT];      /**< 当前在队列中的事件数 */
+    atomic_uint published;                      /**< 已入队的事件数 */
+    atomic_uint rejected[EM_PRIORITY_COUNT];    /**< 因配额被拒绝的事件数 */
+} em_producer_slot_t;
+
+/**
+ * @brief 唤醒与系统调用计数
+ * 
+ * 发布端在锁内外都可能唤醒消费者，计数使用原子变量，em_get_stats 时合并到统计信息。
+ */
+typedef struct {
+    atomic_uint signals;            /**< 条件变量 signal 次数 */
+    atomic_uint eventfd_writes;     /**< eventfd 写入次数 */
+    atomic_uint eventfd_reads;      /**< eventfd 读取次数 */
+    atomic_uint wakeups;            /**< 从等待中醒来的次数 */
+    atomic_uint wakeups_empty;      /**< 醒来后没有处理任何事件的次数 */
+    atomic_uint timeouts;           /**< 等待超时次数 */
+    atomic_uint drained;            /**< 醒来后处理的事件总数 */
+} em_wake_counters_t;
+
+#if EM_ENABLE_THREADING
+/**
+ * @brief 等待队列
+ * 
+ * 互斥锁直接在 cond 上配合管理器互斥锁等待。其他锁类型使用事件计数：
+ * 等待者持管理器锁检查完条件后取当前序号，释放管理器锁，再等待序号变化；
+ * 通知者改完状态后把序号加1，没有等待者时通知只是两次原子操作。
+ */
+typedef struct {
+    atomic_uint     seq;        /**< 通知序号 */
+    atomic_int      waiters;    /**< 正在等待的线程数 */
+    pthread_mutex_t mutex;
+    pthread_cond_t  cond;
+} em_waitq_t;
+#endif
+
+/**
+ * @brief 发布线程的存活标记
+ * 
+ * 线程退出时由 pthread 键的析构函数清除 alive；线程本身和分配给它的暂存区各持有一个引用。
+ */
+typedef struct {
+    atomic_bool     alive;                          /**< 所属线程仍在运行 */
+    atomic_int      refs;                           /**< 引用计数 */
+} em_stage_owner_t;
+
+/**
+ * @brief 发布线程的自动批量暂存区
+ * 
+ * 由所属线程追加，事件循环/工作线程会刷新超时的暂存区，两者用 busy 标志互斥；
+ * 刷新期间一直持有 busy，保证同一线程的事件按发布顺序入队。
+ * 所属线程退出且暂存区清空后，槽位连同暂存区交给下一个需要暂存区的线程。
+ */
+typedef struct {
+    atomic_flag     busy;                           /**< 访问标志 */
+    uint64_t        thread_id;                      /**< 所属线程 */
+    em_stage_owner_t* owner;                        /**< 所属线程的存活标记(未启用多线程时为NULL) */
+    int             producer;                       /**< 暂存事件所属生产者 */
+    uint32_t        count;                          /**< 暂存事件数 */
+    uint64_t        first_ns;                       /**< 第一个暂存事件的时间 */
+    em_event_t      events[EM_MAX_GROUP_SIZE];      /**< 暂存事件 */
+    void*           copies[EM_MAX_GROUP_SIZE];      /**< 数据副本 */
+    uint64_t        enqueue_ns[EM_MAX_GROUP_SIZE];  /**< 发布时间戳 */
+} em_stage_buf_t;
+
+/**
+ * @brief 延时事件(按到期时间组织成最小堆)
+ */
+typedef struct {
+    uint64_t    due_ns;         /**< 到期时间 */
+    uint64_t    seq;            /**< 插入序号，同一时间到期时按发布顺序 */
+    em_event_t  event;          /**< 事件信息 */
+    void*       data_copy;      /**< 数据副本 */
+} em_timer_t;
+
+/**
+ * @brief 事件循环线程的批量状态(每个循环线程各一份)
+ * 
+ * 批量大小按 AIMD 调整：出队后队列仍然积压则加一；
+ * 上一批中有低优先级事件而 HIGH 事件在分发期间到达并等待，
+ * 或单批分发耗时超过目标时减半。
+ */
+typedef struct {
+    uint32_t    size;               /**< 当前批量大小 */
+    bool        had_lower;          /**< 上一批是否包含非 HIGH 事件 */
+    uint64_t    last_elapsed_ns;    /**< 上一批的分发耗时 */
+} em_drain_state_t;
+
+#if EM_USE_EPOLL
+/**
+ * @brief 文件描述符数据源
+ * 
+ * 读取状态只由事件循环在 reading 置位期间访问；移除时若正在读取，由事件循环
+ * 读取结束后释放未读满的帧和备用块，此前该槽位不能被复用。
+ */
+typedef struct {
+    bool                    active;
+    bool                    reading;        /**< 事件循环正在读取 */
+    int                     fd;
+    em_fd_source_config_t   config;
+    uint8_t                 header[4];      /**< 长度前缀 */
+    uint32_t                header_filled;  /**< 已读的长度前缀字节数 */
+    void*                   partial;        /**< 未读满的帧 */
+    uint32_t                frame_len;      /**< 未读满帧的长度 */
+    uint32_t                filled;         /**< 未读满帧已读的字节数 */
+    void*                   spare[EM_FD_READ_BATCH];    /**< 上次未用完的数据块 */
+    int                     spare_count;
+    bool                    starved;        /**< 本次读取时没有可用的数据块 */
+    bool                    paused;         /**< 因数据块用尽暂停监听 */
+    uint64_t                resume_ns;      /**< 重新监听的时间 */
+} em_fd_source_t;
+
+/**
+ * @brief 一次读取得到的帧
+ */
+typedef struct {
+    void*   payload;    /**< 数据块 */
+    size_t  size;       /**< 事件数据大小 */
+} em_fd_read_t;
+#endif
+
 /**
  * @brief 事件管理器内部结构
  */
@@ -95,21 +479,134 @@ struct em_manager {
     /* 统计信息 */
     em_stats_t              stats;
     
+    /* 时间源 */
+    em_clock_source_t       clock_source;   /**< 实际使用的时间源(请求不可用时已回退) */
+    bool                    virtual_time;   /**< 使用虚拟时钟 */
+    bool                    auto_advance;   /**< 空闲时虚拟时钟跳到下一个到期定时器 */
+    _Atomic uint64_t        virtual_now;    /**< 虚拟时钟当前值 */
+    
+    /* 延时事件 */
+    em_timer_t*             timers;         /**< 最小堆 */
+    int                     timer_count;
+    int                     timer_capacity;
+    uint64_t                timer_seq;
+    
+    /* 负载控制 */
+    em_shed_state_t         shed;
+    
+    /* 事件循环批量策略 */
+    em_batch_policy_t       batch_policy;
+    
+    /* 异步队列自动扩容 */
+    em_queue_autogrow_t     autogrow;
+    
+    /* 异步事件数据块池(NULL表示直接 malloc) */
+    em_payload_pool_t*      payload_pool;
+    
+    /* 中断/信号上下文发布(NULL表示未启用) */
+    em_isr_ring_t*          isr_ring;
+    atomic_uint             isr_events;     /**< 经环形缓冲区发布的事件数 */
+    atomic_uint             isr_dropped;    /**< 环形缓冲区满或转入队列失败而丢弃的事件数 */
+    
+    /* 唤醒与系统调用计数 */
+    em_wake_counters_t      wake;
+    
+    /* 事件记录钩子(分发路径在锁外读取) */
+    _Atomic(em_trace_hook_t) trace_hook;
+    void* _Atomic           trace_user;
+    
+    /* 发布端自动批量：配置可在锁外读取，暂存区指针数组由锁保护 */
+    uint64_t                serial;             /**< 管理器序号，用于校验线程局部缓存 */
+    atomic_bool             auto_batch_on;
+    atomic_uint             auto_batch_max;
+    _Atomic uint64_t        auto_batch_delay_ns;
+    atomic_uint             staged_events;      /**< 所有暂存区中的事件总数 */
+    em_stage_buf_t*         stage_bufs[EM_MAX_STAGE_THREADS];
+    
+    /* 
+     * 生产者配额：每个优先级的容量分为各生产者的预留槽位和共享槽位，
+     * 生产者超出自身预留的事件以及未绑定生产者的事件占用共享槽位
+     */
+    em_producer_slot_t      producers[EM_MAX_PRODUCERS];
+    uint32_t                reserved_total[EM_PRIORITY_COUNT];  /**< 各生产者预留之和 */
+    uint32_t                shared_used[EM_PRIORITY_COUNT];     /**< 已占用的共享槽位 */
+    
+    /* 热点事件统计(首次开启时分配，发布路径在锁外读取) */
+    em_hot_tracker_t* _Atomic hot;
+    
+    /* 只在数据变化时发布(发布路径在锁外读写) */
+    atomic_bool             change_only[EM_MAX_EVENT_TYPES];
+    atomic_size_t           change_sync_size[EM_MAX_EVENT_TYPES];
+    _Atomic uint64_t        change_last[EM_MAX_EVENT_TYPES];    /**< 上次发布数据的哈希(0表示无记录) */
+    atomic_uint             events_suppressed;
+    atomic_uint             events_inlined;     /**< em_publish_auto 内联分发的事件数 */
+    
+    /* 出队调度(sched_ops 为NULL表示严格优先级) */
+    const em_scheduler_ops_t* sched_ops;
+    void*                   sched_ctx;
+    em_sched_builtin_t      sched_builtin;
+    
+    /* 订阅组(竞争消费) */
+    em_group_t              groups[EM_MAX_GROUPS];
+    uint8_t                 group_members[EM_MAX_EVENT_TYPES];  /**< 各事件的组成员数 */
+    
+    /* 挂接到本管理器的执行器 */
+    em_executor_t*          executors[EM_MAX_EXECUTORS];
+    int                     executor_count;
+    
+    /* Actor 共享工作线程池 */
+#if EM_ENABLE_THREADING
+    pthread_mutex_t         pool_mutex;
+    pthread_cond_t          pool_cond;
+    pthread_t*              pool_workers;
+    int                     pool_worker_count;
+    bool                    pool_running;
+    em_actor_t*             ready_head;     /**< 就绪 Actor 队列头 */
+    em_actor_t*             ready_tail;     /**< 就绪 Actor 队列尾 */
+    
+    /* 弹性工作线程池(共用管理器互斥锁) */
+    em_worker_pool_config_t worker_config;
+    pthread_t               workers[EM_MAX_WORKERS];
+    em_waitq_t              park_q;             /**< 停放的线程在此等待 */
+    int                     worker_count;       /**< 已创建的线程数 */
+    int                     workers_active;     /**< 未停放的线程数 */
+    int                     unpark_tokens;      /**< 待唤醒的停放线程数 */
+    bool                    workers_running;
+    uint64_t                pressure_since_ns;  /**< 持续积压的起始时间(0表示无积压) */
+#endif
+    
     /* 事件循环控制 */
     volatile bool           running;
     
-    /* 线程安全 */
+    /* 线程安全(按 lock_type 只初始化其中一种锁) */
 #if EM_ENABLE_THREADING
+    em_lock_type_t          lock_type;
     pthread_mutex_t         mutex;
-    pthread_cond_t          cond;
+    pthread_rwlock_t        rwlock;
+    atomic_int              spin_word;      /**< 0 空闲，1 持有，2 持有且可能有等待者 */
+    em_waitq_t              wake_q;         /**< 事件循环和工作线程在此等待 */
+    
+    /* em_flush：已出队但尚未分发完的事件按轮次分两组计数 */
+    atomic_uint             inflight[2];
+    uint64_t                flush_epoch;
+    atomic_int              flush_waiters;
+    em_waitq_t              flush_q;        /**< em_flush 在此等待 */
     bool                    mutex_initialized;
 #endif
-
+    
+    /* 分发可能只持读锁，处理计数单独使用原子变量 */
+    atomic_uint             events_processed;
+    
     /* epoll 支持 */
 #if EM_USE_EPOLL
     int                     epoll_fd;       /**< epoll 文件描述符 */
     int                     event_fd;       /**< eventfd 用于通知 */
     bool                    epoll_initialized;
+    
+    /* 文件描述符数据源(epoll 数据为槽位号加1，0表示 eventfd) */
+    em_fd_source_t          fd_sources[EM_MAX_FD_SOURCES];
+    int                     fd_source_count;
+    int                     fd_paused_count;    /**< 因数据块用尽暂停监听的数据源数 */
 #endif
 };
 
@@ -118,100 +615,571 @@ struct em_manager {
  *============================================================================*/
 
 static void sort_subscribers(em_subscriber_list_t* list);
-static em_error_t enqueue_event(em_priority_queue_t* queue, const em_event_t* event, void* data_copy);
-static em_error_t dequeue_event(em_priority_queue_t* queue, em_event_t* event, void** data_copy);
-static void dispatch_event(em_handle_t handle, em_event_id_t event_id, em_event_data_t data);
+static em_group_t* group_find(em_handle_t handle, uint32_t group_id, bool create);
+static int group_pick(em_handle_t handle, em_event_id_t event_id, em_event_data_t data,
+                      em_group_pick_t* picks);
+static em_error_t enqueue_event(em_priority_queue_t* queue, const em_event_t* event,
+                                void* data_copy, uint64_t enqueue_ns);
+static em_error_t dequeue_event(em_priority_queue_t* queue, em_event_t* event,
+                                void** data_copy, uint64_t* enqueue_ns);
+static em_error_t resize_queue(em_handle_t handle, em_priority_t priority, int capacity);
+static void free_async_queues(em_handle_t handle);
+/**
+ * @brief 调用线程绑定的生产者
+ */
+static _Thread_local struct {
+    em_handle_t handle;
+    int         id;
+} bound_producer = { NULL, -1 };
+
+/** 管理器序号和线程编号的来源(从1开始，0表示未分配) */
+static _Atomic uint64_t unique_ids = 1;
+
+/**
+ * @brief 调用线程的编号和最近使用的暂存区
+ * 
+ * 缓存按管理器地址和序号校验，管理器销毁后地址被复用也不会误用旧的暂存区。
+ */
+static _Thread_local uint64_t stage_thread_id;
+static _Thread_local struct {
+    em_handle_t     handle;
+    uint64_t        serial;
+    em_stage_buf_t* buf;
+} stage_cache;
 
 #if EM_ENABLE_THREADING
-static inline void lock_manager(em_handle_t handle) {
-    if (handle && handle->mutex_initialized) {
-        pthread_mutex_lock(&handle->mutex);
-    }
-}
+/** 调用线程的存活标记，线程退出时由 stage_owner_key 的析构函数释放 */
+static _Thread_local em_stage_owner_t* stage_owner;
+static pthread_key_t stage_owner_key;
+static pthread_once_t stage_owner_once = PTHREAD_ONCE_INIT;
+#endif
 
-static inline void unlock_manager(em_handle_t handle) {
-    if (handle && handle->mutex_initialized) {
-        pthread_mutex_unlock(&handle->mutex);
-    }
-}
+/**
+ * 调用线程正在分发其队列事件的管理器(em_flush 据此拒绝在回调中等待自己，
+ * em_publish_auto 据此判断是否在事件循环的回调中)
+ */
+static _Thread_local em_handle_t dispatching_handle;
 
-static inline void signal_manager(em_handle_t handle) {
-    if (handle && handle->mutex_initialized) {
+/**
+ * @brief 事件循环线程上等待内联分发的事件(em_publish_auto)
+ * 
+ * 只在运行 em_run_loop 的线程上使用，当前回调返回后按发布顺序分发。
+ */
+static _Thread_local struct {
+    em_handle_t loop;                           /**< 本线程正在运行的事件循环 */
+    uint32_t    head;
+    uint32_t    count;
+    em_event_t  events[EM_INLINE_DEPTH];
+    void*       copies[EM_INLINE_DEPTH];
+} inline_ring;
+
+static em_error_t enqueue_locked(em_handle_t handle, const em_event_t* event,
+                                 void* data_copy, uint64_t now, int producer);
+static em_stage_buf_t* stage_buf_get(em_handle_t handle, bool create);
+static void stage_buf_acquire(em_stage_buf_t* buf);
+#if EM_ENABLE_THREADING
+static void stage_owner_release(em_stage_owner_t* owner);
+#endif
+static em_error_t stage_append(em_handle_t handle, em_stage_buf_t* buf, const em_event_t* event,
+                               void* data_copy, uint64_t now, int producer);
+static em_error_t stage_flush_locked(em_handle_t handle, em_stage_buf_t* buf);
+static int stage_flush_stale(em_handle_t handle, bool all);
+#if EM_ENABLE_THREADING
+static uint64_t stage_wait_ns(em_handle_t handle, uint64_t max_ns);
+#endif
+static void count_wakeup(em_handle_t handle, int drained);
 #if EM_USE_EPOLL
-        /* 使用 eventfd 通知 epoll */
-        if (handle->epoll_initialized) {
-            uint64_t val = 1;
-            ssize_t ret = write(handle->event_fd, &val, sizeof(val));
-            if (ret < 0) {
-                EM_DEBUG("eventfd write failed");
-            }
-        }
+static void fd_source_ready(em_handle_t handle, int source);
+static void fd_source_reset(em_fd_source_t* src);
+static uint64_t fd_resume_wait_ns(em_handle_t handle, uint64_t max_ns);
 #endif
-        pthread_cond_signal(&handle->cond);
-    }
+static int current_producer(em_handle_t handle);
+static bool producer_admit(em_handle_t handle, int producer, em_priority_t priority, uint32_t count);
+static void producer_release(em_handle_t handle, int producer, em_priority_t priority);
+static em_error_t timer_push(em_handle_t handle, const em_timer_t* timer);
+static int fire_due_timers(em_handle_t handle, uint64_t now);
+static bool timer_ready(em_handle_t handle);
+#if EM_ENABLE_THREADING
+static uint64_t timer_wait_ns(em_handle_t handle, uint64_t max_ns);
+#endif
+static uint64_t now_ns(void);
+static void clock_init(em_handle_t handle, em_clock_source_t source);
+static inline uint64_t clock_now(em_handle_t handle);
+static uint64_t oldest_wait_ns(em_handle_t handle, uint64_t now);
+static bool dequeue_next(em_handle_t handle, em_event_t* event, void** data_copy,
+                         em_priority_t* priority);
+static int sched_select(em_handle_t handle, em_priority_t* order, int max);
+static void hot_record(em_handle_t handle, em_event_id_t event_id, size_t size);
+static em_isr_ring_t* isr_ring_create(uint32_t slots);
+static int isr_drain_locked(em_handle_t handle);
+static int isr_drain(em_handle_t handle);
+#if EM_ENABLE_THREADING
+static uint64_t isr_wait_ns(em_handle_t handle, uint64_t max_ns);
+#endif
+static bool change_suppress(em_handle_t handle, em_event_id_t event_id, const void* data,
+                            size_t size, uint64_t* hash);
+static inline void change_commit(em_handle_t handle, em_event_id_t event_id, uint64_t hash);
+static inline uint32_t mix32(uint32_t h);
+static int drain_batch(em_handle_t handle, em_drain_state_t* state);
+static int inline_run(em_handle_t handle, const em_event_t* rest, int rest_count);
+static void normalize_batch_policy(em_batch_policy_t* policy);
+static void shed_update(em_handle_t handle, uint64_t now);
+static void record_queue_wait(em_handle_t handle, em_priority_t priority, uint64_t wait_ns);
+static void dispatch_event(em_handle_t handle, em_event_id_t event_id, em_event_data_t data, void* payload);
+static inline void trace_event(em_handle_t handle, const em_event_t* event);
+static void* payload_alloc(size_t size);
+static void* payload_alloc_for(em_handle_t handle, size_t size, em_priority_t priority);
+static em_payload_pool_t* payload_pool_create(const em_config_t* config);
+static void payload_pool_release(em_payload_pool_t* pool);
+static void payload_retain(void* data);
+static void payload_release(void* data);
+static bool inbox_push(em_executor_t* executor, const em_invocation_t* inv);
+static bool inbox_pop(em_executor_t* executor, em_invocation_t* inv);
+static em_executor_t* executor_new(size_t capacity);
+static void executor_retain(em_executor_t* executor);
+static void executor_release(em_executor_t* executor);
+static void executor_wait_users(em_executor_t* executor);
+static void executor_notify(em_executor_t* executor);
+static int unsubscribe_matching(em_handle_t handle, em_event_id_t event_id,
+                                em_callback_t callback, em_executor_t* executor,
+                                bool match_executor);
+static int run_attached_executors(em_handle_t handle);
+static bool executors_pending(em_handle_t handle);
+
+#if EM_ENABLE_THREADING
+/* 计算 pthread_cond_timedwait 使用的绝对时间 */
+static void deadline_after(struct timespec* ts, uint64_t timeout_ns)
+{
+    clock_gettime(CLOCK_REALTIME, ts);
+    uint64_t nsec = (uint64_t)ts->tv_nsec + timeout_ns;
+    ts->tv_sec += (time_t)(nsec / 1000000000ull);
+    ts->tv_nsec = (long)(nsec % 1000000000ull);
 }
 
-static inline void wait_manager(em_handle_t handle) {
-    if (handle && handle->mutex_initialized) {
-        pthread_cond_wait(&handle->cond, &handle->mutex);
+static bool waitq_init(em_waitq_t* q)
+{
+    atomic_init(&q->seq, 0);
+    atomic_init(&q->waiters, 0);
+    if (pthread_mutex_init(&q->mutex, NULL) != 0) {
+        return false;
     }
+    if (pthread_cond_init(&q->cond, NULL) != 0) {
+        pthread_mutex_destroy(&q->mutex);
+        return false;
+    }
+    return true;
 }
-#else
-#define lock_manager(h)   ((void)0)
-#define unlock_manager(h) ((void)0)
-#define signal_manager(h) ((void)0)
-#define wait_manager(h)   ((void)0)
-#endif
 
-/*============================================================================
- *                              初始化与销毁
- *============================================================================*/
+static void waitq_destroy(em_waitq_t* q)
+{
+    pthread_cond_destroy(&q->cond);
+    pthread_mutex_destroy(&q->mutex);
+}
 
-em_handle_t em_create(void)
+/**
+ * @brief 等待序号离开 key
+ * 
+ * @param timeout_ns 超时(UINT64_MAX表示不超时)
+ * @return bool 超时返回true
+ */
+static bool waitq_wait(em_waitq_t* q, unsigned key, uint64_t timeout_ns)
 {
-    em_handle_t handle = (em_handle_t)calloc(1, sizeof(struct em_manager));
-    if (handle == NULL) {
-        EM_DEBUG("Failed to allocate memory for event manager");
-        return NULL;
+    struct timespec ts;
+    if (timeout_ns != UINT64_MAX) {
+        deadline_after(&ts, timeout_ns);
     }
     
-    /* 初始化订阅者列表 */
-    for (int i = 0; i < EM_MAX_EVENT_TYPES; i++) {
-        handle->event_subscribers[i].count = 0;
-        handle->event_subscribers[i].sorted = true;
-        for (int j = 0; j < EM_MAX_SUBSCRIBERS; j++) {
-            handle->event_subscribers[i].subscribers[j].active = false;
+    /* 先登记再检查序号，与 waitq_notify 的先加序号再检查等待者配对，不会丢失通知 */
+    atomic_fetch_add(&q->waiters, 1);
+    pthread_mutex_lock(&q->mutex);
+    bool timed_out = false;
+    while (atomic_load(&q->seq) == key && !timed_out) {
+        if (timeout_ns == UINT64_MAX) {
+            pthread_cond_wait(&q->cond, &q->mutex);
+        } else {
+            timed_out = pthread_cond_timedwait(&q->cond, &q->mutex, &ts) == ETIMEDOUT;
         }
     }
-    
-    /* 初始化异步队列 */
-    for (int i = 0; i < EM_PRIORITY_COUNT; i++) {
-        handle->async_queues[i].head = 0;
-        handle->async_queues[i].tail = 0;
-        handle->async_queues[i].count = 0;
-        for (int j = 0; j < EM_ASYNC_QUEUE_SIZE; j++) {
-            handle->async_queues[i].nodes[j].used = false;
-            handle->async_queues[i].nodes[j].data_copy = NULL;
+    pthread_mutex_unlock(&q->mutex);
+    atomic_fetch_sub(&q->waiters, 1);
+    return timed_out;
+}
+
+static void waitq_notify(em_waitq_t* q, bool all)
+{
+    atomic_fetch_add(&q->seq, 1);
+    if (atomic_load(&q->waiters) > 0) {
+        pthread_mutex_lock(&q->mutex);
+        if (all) {
+            pthread_cond_broadcast(&q->cond);
+        } else {
+            pthread_cond_signal(&q->cond);
         }
+        pthread_mutex_unlock(&q->mutex);
+    }
+}
+
+#if EM_HAVE_FUTEX
+static void spin_lock_slow(atomic_int* word)
+{
+    for (int i = 0; i < EM_LOCK_SPIN_COUNT; i++) {
+        int expected = 0;
+        if (atomic_load_explicit(word, memory_order_relaxed) == 0 &&
+            atomic_compare_exchange_weak_explicit(word, &expected, 1,
+                                                  memory_order_acquire, memory_order_relaxed)) {
+            return;
+        }
+        cpu_relax();
     }
     
-    /* 初始化统计信息 */
-    memset(&handle->stats, 0, sizeof(em_stats_t));
-    
-    /* 初始化线程同步 */
-#if EM_ENABLE_THREADING
-    if (pthread_mutex_init(&handle->mutex, NULL) != 0) {
-        EM_DEBUG("Failed to initialize mutex");
-        free(handle);
-        return NULL;
+    /* 标记有等待者后休眠，醒来后仍以"有等待者"状态抢锁，保证解锁时会唤醒其余线程 */
+    while (atomic_exchange_explicit(word, 2, memory_order_acquire) != 0) {
+        syscall(SYS_futex, (int*)word, FUTEX_WAIT_PRIVATE, 2, NULL, NULL, 0);
     }
-    if (pthread_cond_init(&handle->cond, NULL) != 0) {
-        EM_DEBUG("Failed to initialize condition variable");
-        pthread_mutex_destroy(&handle->mutex);
+}
+
+static inline void spin_lock(atomic_int* word)
+{
+    int expected = 0;
+    if (!atomic_compare_exchange_strong_explicit(word, &expected, 1,
+                                                 memory_order_acquire, memory_order_relaxed)) {
+        spin_lock_slow(word);
+    }
+}
+
+static inline void spin_unlock(atomic_int* word)
+{
+    if (atomic_exchange_explicit(word, 0, memory_order_release) == 2) {
+        syscall(SYS_futex, (int*)word, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+    }
+}
+#endif
+
+static inline void lock_manager(em_handle_t handle) {
+    if (handle && handle->mutex_initialized) {
+        switch (handle->lock_type) {
+        case EM_LOCK_RWLOCK:
+            pthread_rwlock_wrlock(&handle->rwlock);
+            break;
+#if EM_HAVE_FUTEX
+        case EM_LOCK_SPIN:
+            spin_lock(&handle->spin_word);
+            break;
+#endif
+        case EM_LOCK_NONE:
+            break;
+        default:
+            pthread_mutex_lock(&handle->mutex);
+            break;
+        }
+    }
+}
+
+/* 只读路径使用：读写锁取读锁，其他锁与 lock_manager 相同 */
+static inline void lock_manager_shared(em_handle_t handle) {
+    if (handle && handle->mutex_initialized && handle->lock_type == EM_LOCK_RWLOCK) {
+        pthread_rwlock_rdlock(&handle->rwlock);
+        return;
+    }
+    lock_manager(handle);
+}
+
+static inline void unlock_manager(em_handle_t handle) {
+    if (handle && handle->mutex_initialized) {
+        switch (handle->lock_type) {
+        case EM_LOCK_RWLOCK:
+            pthread_rwlock_unlock(&handle->rwlock);
+            break;
+#if EM_HAVE_FUTEX
+        case EM_LOCK_SPIN:
+            spin_unlock(&handle->spin_word);
+            break;
+#endif
+        case EM_LOCK_NONE:
+            break;
+        default:
+            pthread_mutex_unlock(&handle->mutex);
+            break;
+        }
+    }
+}
+
+/**
+ * @brief 释放管理器锁等待通知，返回前重新加锁(调用者需持有写锁)
+ * 
+ * @return bool 超时返回true
+ */
+static bool wait_locked(em_handle_t handle, em_waitq_t* q, uint64_t timeout_ns)
+{
+    if (handle->lock_type == EM_LOCK_MUTEX) {
+        if (timeout_ns == UINT64_MAX) {
+            pthread_cond_wait(&q->cond, &handle->mutex);
+            return false;
+        }
+        struct timespec ts;
+        deadline_after(&ts, timeout_ns);
+        return pthread_cond_timedwait(&q->cond, &handle->mutex, &ts) == ETIMEDOUT;
+    }
+    
+    unsigned key = atomic_load(&q->seq);
+    unlock_manager(handle);
+    bool timed_out = waitq_wait(q, key, timeout_ns);
+    lock_manager(handle);
+    return timed_out;
+}
+
+/**
+ * @brief 唤醒 wait_locked 中的线程
+ * 
+ * @param all 唤醒全部等待者(否则至少一个)
+ */
+static inline void wake_waiters(em_handle_t handle, em_waitq_t* q, bool all)
+{
+    if (handle->lock_type != EM_LOCK_MUTEX) {
+        waitq_notify(q, all);
+    } else if (all) {
+        pthread_cond_broadcast(&q->cond);
+    } else {
+        pthread_cond_signal(&q->cond);
+    }
+}
+
+/**
+ * @brief 记录一批出队的事件(调用者需持有锁)
+ * 
+ * @return unsigned 所属轮次，分发完成后传给 inflight_end
+ */
+static inline unsigned inflight_begin(em_handle_t handle, unsigned n)
+{
+    unsigned bucket = (unsigned)(handle->flush_epoch & 1);
+    atomic_fetch_add_explicit(&handle->inflight[bucket], n, memory_order_relaxed);
+    return bucket;
+}
+
+/** 一批事件分发完成，有 em_flush 在等待时唤醒 */
+static inline void inflight_end(em_handle_t handle, unsigned bucket, unsigned n)
+{
+    atomic_fetch_sub(&handle->inflight[bucket], n);
+    if (atomic_load(&handle->flush_waiters) > 0) {
+        lock_manager(handle);
+        wake_waiters(handle, &handle->flush_q, true);
+        unlock_manager(handle);
+    }
+}
+
+static inline void signal_manager(em_handle_t handle) {
+    if (handle && handle->mutex_initialized) {
+#if EM_USE_EPOLL
+        /* 使用 eventfd 通知 epoll */
+        if (handle->epoll_initialized) {
+            uint64_t val = 1;
+            ssize_t ret = write(handle->event_fd, &val, sizeof(val));
+            if (ret < 0) {
+                EM_DEBUG("eventfd write failed");
+            } else {
+                atomic_fetch_add_explicit(&handle->wake.eventfd_writes, 1, memory_order_relaxed);
+            }
+        }
+#endif
+        wake_waiters(handle, &handle->wake_q, false);
+        atomic_fetch_add_explicit(&handle->wake.signals, 1, memory_order_relaxed);
+    }
+}
+
+static inline void wait_manager(em_handle_t handle) {
+    if (handle && handle->mutex_initialized) {
+        wait_locked(handle, &handle->wake_q, UINT64_MAX);
+    }
+}
+
+/* 返回 true 表示等待超时 */
+static inline bool wait_manager_timed(em_handle_t handle, uint64_t timeout_ns) {
+    if (handle && handle->mutex_initialized) {
+        return wait_locked(handle, &handle->wake_q, timeout_ns);
+    }
+    return false;
+}
+
+static inline void broadcast_manager(em_handle_t handle) {
+    if (handle && handle->mutex_initialized) {
+        wake_waiters(handle, &handle->wake_q, true);
+    }
+}
+
+/**
+ * @brief 初始化管理器锁、等待队列和 Actor 线程池的同步对象
+ */
+static bool sync_init(em_handle_t handle, em_lock_type_t type)
+{
+#if !EM_HAVE_FUTEX
+    if (type == EM_LOCK_SPIN) {
+        type = EM_LOCK_MUTEX;
+    }
+#endif
+    handle->lock_type = type;
+    
+    bool ok = true;
+    if (type == EM_LOCK_RWLOCK) {
+        ok = pthread_rwlock_init(&handle->rwlock, NULL) == 0;
+    } else if (type == EM_LOCK_SPIN) {
+        atomic_init(&handle->spin_word, 0);
+    } else if (type == EM_LOCK_MUTEX) {
+        ok = pthread_mutex_init(&handle->mutex, NULL) == 0;
+    }
+    if (!ok) {
+        EM_DEBUG("Failed to initialize manager lock");
+        return false;
+    }
+    
+    if (waitq_init(&handle->wake_q)) {
+        if (waitq_init(&handle->flush_q)) {
+            if (pthread_mutex_init(&handle->pool_mutex, NULL) == 0) {
+                if (pthread_cond_init(&handle->pool_cond, NULL) == 0) {
+                    handle->mutex_initialized = true;
+                    return true;
+                }
+                pthread_mutex_destroy(&handle->pool_mutex);
+            }
+            waitq_destroy(&handle->flush_q);
+        }
+        waitq_destroy(&handle->wake_q);
+    }
+    EM_DEBUG("Failed to initialize condition variable");
+    
+    if (type == EM_LOCK_RWLOCK) {
+        pthread_rwlock_destroy(&handle->rwlock);
+    } else if (type == EM_LOCK_MUTEX) {
+        pthread_mutex_destroy(&handle->mutex);
+    }
+    return false;
+}
+
+static void sync_destroy(em_handle_t handle)
+{
+    if (handle->lock_type == EM_LOCK_RWLOCK) {
+        pthread_rwlock_destroy(&handle->rwlock);
+    } else if (handle->lock_type == EM_LOCK_MUTEX) {
+        pthread_mutex_destroy(&handle->mutex);
+    }
+    waitq_destroy(&handle->wake_q);
+    waitq_destroy(&handle->flush_q);
+    pthread_mutex_destroy(&handle->pool_mutex);
+    pthread_cond_destroy(&handle->pool_cond);
+    handle->mutex_initialized = false;
+}
+#else
+#define lock_manager(h)   ((void)0)
+#define lock_manager_shared(h)  ((void)0)
+#define unlock_manager(h) ((void)0)
+#define signal_manager(h) ((void)0)
+#define wait_manager(h)   ((void)0)
+#define wait_manager_timed(h, ns)   (false)
+#define broadcast_manager(h)        ((void)0)
+#endif
+
+/*============================================================================
+ *                              初始化与销毁
+ *============================================================================*/
+
+void em_config_init(em_config_t* config)
+{
+    if (config == NULL) {
+        return;
+    }
+    memset(config, 0, sizeof(*config));
+    config->clock_source = EM_CLOCK_MONOTONIC;
+    config->virtual_time = false;
+    config->virtual_auto_advance = false;
+}
+
+em_handle_t em_create(void)
+{
+    return em_create_with_config(NULL);
+}
+
+em_handle_t em_create_with_config(const em_config_t* config)
+{
+    em_config_t defaults;
+    if (config == NULL) {
+        em_config_init(&defaults);
+        config = &defaults;
+    }
+    
+    /* 保留块之和必须小于块数，LOW 才有可用的块 */
+    if (config->payload_pool_blocks > 0) {
+        uint64_t reserved = (uint64_t)config->payload_reserved[EM_PRIORITY_HIGH] +
+                            config->payload_reserved[EM_PRIORITY_NORMAL];
+        if (config->payload_block_size == 0 || config->payload_pool_blocks == UINT32_MAX ||
+            reserved >= config->payload_pool_blocks) {
+            EM_DEBUG("Invalid payload pool configuration");
+            return NULL;
+        }
+    }
+    if ((unsigned)config->lock_type > EM_LOCK_NONE) {
+        EM_DEBUG("Invalid lock type");
+        return NULL;
+    }
+    if (config->isr_ring_size > EM_ISR_RING_MAX) {
+        EM_DEBUG("Invalid ISR ring size");
+        return NULL;
+    }
+    
+    em_handle_t handle = (em_handle_t)calloc(1, sizeof(struct em_manager));
+    if (handle == NULL) {
+        EM_DEBUG("Failed to allocate memory for event manager");
+        return NULL;
+    }
+    
+    handle->serial = atomic_fetch_add(&unique_ids, 1);
+    
+    /* 选择时间源 */
+    clock_init(handle, config->clock_source);
+    handle->virtual_time = config->virtual_time;
+    handle->auto_advance = config->virtual_time && config->virtual_auto_advance;
+    atomic_init(&handle->virtual_now, 0);
+    
+    /* 初始化订阅者列表 */
+    for (int i = 0; i < EM_MAX_EVENT_TYPES; i++) {
+        handle->event_subscribers[i].count = 0;
+        handle->event_subscribers[i].sorted = true;
+        for (int j = 0; j < EM_MAX_SUBSCRIBERS; j++) {
+            handle->event_subscribers[i].subscribers[j].active = false;
+        }
+    }
+    
+    /* 初始化异步队列 */
+    for (int i = 0; i < EM_PRIORITY_COUNT; i++) {
+        handle->async_queues[i].head = 0;
+        handle->async_queues[i].tail = 0;
+        handle->async_queues[i].count = 0;
+        handle->async_queues[i].capacity = EM_ASYNC_QUEUE_SIZE;
+        handle->async_queues[i].nodes =
+            (em_queue_node_t*)calloc(EM_ASYNC_QUEUE_SIZE, sizeof(em_queue_node_t));
+        if (handle->async_queues[i].nodes == NULL) {
+            EM_DEBUG("Failed to allocate async queue");
+            free_async_queues(handle);
+            free(handle);
+            return NULL;
+        }
+    }
+    
+    /* 初始化统计信息 */
+    memset(&handle->stats, 0, sizeof(em_stats_t));
+    for (int i = 0; i < EM_PRIORITY_COUNT; i++) {
+        handle->stats.queue_capacity[i] = EM_ASYNC_QUEUE_SIZE;
+    }
+    
+    
+    /* 默认批量策略 */
+    normalize_batch_policy(&handle->batch_policy);
+    
+    /* 初始化线程同步 */
+#if EM_ENABLE_THREADING
+    if (!sync_init(handle, config->lock_type)) {
+        free_async_queues(handle);
         free(handle);
         return NULL;
     }
-    handle->mutex_initialized = true;
 #endif
     
     /* 初始化 epoll */
@@ -220,9 +1188,9 @@ em_handle_t em_create(void)
     if (handle->epoll_fd < 0) {
         EM_DEBUG("Failed to create epoll fd");
 #if EM_ENABLE_THREADING
-        pthread_mutex_destroy(&handle->mutex);
-        pthread_cond_destroy(&handle->cond);
+        sync_destroy(handle);
 #endif
+        free_async_queues(handle);
         free(handle);
         return NULL;
     }
@@ -232,9 +1200,9 @@ em_handle_t em_create(void)
         EM_DEBUG("Failed to create eventfd");
         close(handle->epoll_fd);
 #if EM_ENABLE_THREADING
-        pthread_mutex_destroy(&handle->mutex);
-        pthread_cond_destroy(&handle->cond);
+        sync_destroy(handle);
 #endif
+        free_async_queues(handle);
         free(handle);
         return NULL;
     }
@@ -242,15 +1210,15 @@ em_handle_t em_create(void)
     /* 将 eventfd 添加到 epoll */
     struct epoll_event ev;
     ev.events = EPOLLIN;
-    ev.data.fd = handle->event_fd;
+    ev.data.u64 = 0;
     if (epoll_ctl(handle->epoll_fd, EPOLL_CTL_ADD, handle->event_fd, &ev) < 0) {
         EM_DEBUG("Failed to add eventfd to epoll");
         close(handle->event_fd);
         close(handle->epoll_fd);
 #if EM_ENABLE_THREADING
-        pthread_mutex_destroy(&handle->mutex);
-        pthread_cond_destroy(&handle->cond);
+        sync_destroy(handle);
 #endif
+        free_async_queues(handle);
         free(handle);
         return NULL;
     }
@@ -261,6 +1229,26 @@ em_handle_t em_create(void)
     
     handle->running = false;
     
+    /* 数据块池 */
+    if (config->payload_pool_blocks > 0) {
+        handle->payload_pool = payload_pool_create(config);
+        if (handle->payload_pool == NULL) {
+            EM_DEBUG("Failed to allocate payload pool");
+            em_destroy(handle);
+            return NULL;
+        }
+    }
+    
+    /* 中断/信号上下文发布的环形缓冲区 */
+    if (config->isr_ring_size > 0) {
+        handle->isr_ring = isr_ring_create(config->isr_ring_size);
+        if (handle->isr_ring == NULL) {
+            EM_DEBUG("Failed to allocate ISR ring");
+            em_destroy(handle);
+            return NULL;
+        }
+    }
+    
     EM_DEBUG("Event manager created successfully");
     return handle;
 }
@@ -273,42 +1261,122 @@ em_error_t em_destroy(em_handle_t handle)
     
     /* 停止事件循环 */
     handle->running = false;
-    
+
 #if EM_ENABLE_THREADING
     signal_manager(handle);  /* 唤醒可能等待的线程 */
+    
+    /* 停止弹性工作线程池 */
+    em_worker_pool_stop(handle);
+    
+    /* 停止 Actor 工作线程池，释放仍在就绪队列中的 Actor */
+    em_actor_pool_stop(handle);
+    while (handle->ready_head != NULL) {
+        em_actor_t* actor = handle->ready_head;
+        handle->ready_head = actor->next;
+        executor_release(actor->mailbox);
+    }
+    handle->ready_tail = NULL;
 #endif
     
     lock_manager(handle);
     
+    /* 释放订阅持有的执行器引用 */
+    for (int i = 0; i < EM_MAX_EVENT_TYPES; i++) {
+        for (int j = 0; j < EM_MAX_SUBSCRIBERS; j++) {
+            em_subscriber_t* sub = &handle->event_subscribers[i].subscribers[j];
+            if (sub->active && sub->executor != NULL) {
+                executor_release(sub->executor);
+                sub->executor = NULL;
+            }
+        }
+    }
+    
     /* 清理异步队列中的数据副本 */
     for (int i = 0; i < EM_PRIORITY_COUNT; i++) {
-        for (int j = 0; j < EM_ASYNC_QUEUE_SIZE; j++) {
+        for (int j = 0; j < handle->async_queues[i].capacity; j++) {
             if (handle->async_queues[i].nodes[j].data_copy != NULL) {
-                free(handle->async_queues[i].nodes[j].data_copy);
+                payload_release(handle->async_queues[i].nodes[j].data_copy);
                 handle->async_queues[i].nodes[j].data_copy = NULL;
             }
         }
     }
+    free_async_queues(handle);
+    
+    /* 清理自动批量暂存区 */
+    atomic_store(&handle->auto_batch_on, false);
+    for (int i = 0; i < EM_MAX_STAGE_THREADS; i++) {
+        em_stage_buf_t* buf = handle->stage_bufs[i];
+        if (buf == NULL) {
+            continue;
+        }
+        for (uint32_t j = 0; j < buf->count; j++) {
+            if (buf->copies[j] != NULL) {
+                payload_release(buf->copies[j]);
+            }
+        }
+#if EM_ENABLE_THREADING
+        stage_owner_release(buf->owner);
+#endif
+        free(buf);
+        handle->stage_bufs[i] = NULL;
+    }
+    
+    /* 清理未到期的延时事件 */
+    for (int i = 0; i < handle->timer_count; i++) {
+        if (handle->timers[i].data_copy != NULL) {
+            payload_release(handle->timers[i].data_copy);
+        }
+    }
+    free(handle->timers);
+    handle->timers = NULL;
+    handle->timer_count = 0;
+    
+    /* 解除执行器的挂接(执行器本身由用户销毁)，持有引用以便解锁后等待仍在使用管理器的线程 */
+    em_executor_t* detached[EM_MAX_EXECUTORS];
+    int detached_count = handle->executor_count;
+    for (int i = 0; i < detached_count; i++) {
+        detached[i] = handle->executors[i];
+        atomic_fetch_add(&detached[i]->refs, 1);
+        atomic_store(&detached[i]->owner, NULL);
+    }
+    handle->executor_count = 0;
     
     unlock_manager(handle);
     
+    /* 已取到 owner 的通知者可能正阻塞在管理器锁上，等它们退出后才能销毁锁 */
+    for (int i = 0; i < detached_count; i++) {
+        executor_wait_users(detached[i]);
+        executor_release(detached[i]);
+    }
+
 #if EM_USE_EPOLL
     /* 清理 epoll 资源 - 先设置标志位防止其他线程使用 */
     if (handle->epoll_initialized) {
         handle->epoll_initialized = false;
+        for (int i = 0; i < EM_MAX_FD_SOURCES; i++) {
+            fd_source_reset(&handle->fd_sources[i]);
+        }
         close(handle->event_fd);
         close(handle->epoll_fd);
         EM_DEBUG("epoll resources cleaned up");
     }
 #endif
-    
+
 #if EM_ENABLE_THREADING
     if (handle->mutex_initialized) {
-        pthread_mutex_destroy(&handle->mutex);
-        pthread_cond_destroy(&handle->cond);
+        sync_destroy(handle);
     }
 #endif
     
+    free(atomic_load(&handle->hot));
+    free(handle->isr_ring);
+    
+    /* 仍被执行器持有的块释放后才回收块池 */
+    if (handle->payload_pool != NULL) {
+        payload_pool_release(handle->payload_pool);
+        handle->payload_pool = NULL;
+    }
+    
     free(handle);
     
     EM_DEBUG("Event manager destroyed");
@@ -324,6 +1392,16 @@ em_error_t em_subscribe(em_handle_t handle,
                         em_callback_t callback,
                         void* user_data,
                         em_priority_t priority)
+{
+    return em_subscribe_on(handle, event_id, callback, user_data, priority, NULL);
+}
+
+em_error_t em_subscribe_on(em_handle_t handle,
+                           em_event_id_t event_id,
+                           em_callback_t callback,
+                           void* user_data,
+                           em_priority_t priority,
+                           em_executor_t* executor)
 {
     if (handle == NULL || callback == NULL) {
         return EM_ERR_INVALID_PARAM;
@@ -347,10 +1425,11 @@ em_error_t em_subscribe(em_handle_t handle,
         return EM_ERR_MAX_SUBSCRIBERS;
     }
     
-    /* 检查是否已经订阅(避免重复) */
+    /* 检查是否已经订阅(避免重复，同一回调可分别订阅到不同执行器) */
     for (int i = 0; i < EM_MAX_SUBSCRIBERS; i++) {
         if (list->subscribers[i].active && 
-            list->subscribers[i].callback == callback) {
+            list->subscribers[i].callback == callback &&
+            list->subscribers[i].executor == executor) {
             unlock_manager(handle);
             return EM_OK;  /* 已经订阅，直接返回成功 */
         }
@@ -362,9 +1441,14 @@ em_error_t em_subscribe(em_handle_t handle,
             list->subscribers[i].callback = callback;
             list->subscribers[i].user_data = user_data;
             list->subscribers[i].priority = priority;
+            list->subscribers[i].executor = executor;
             list->subscribers[i].active = true;
+            if (executor != NULL) {
+                executor_retain(executor);
+            }
             list->count++;
-            list->sorted = false;  /* 需要重新排序 */
+            list->sorted = false;
+            sort_subscribers(list);  /* 分发可能只持读锁，在写锁下排好序 */
             handle->stats.subscribers_total++;
             
             EM_DEBUG("Subscribed to event %u (priority=%d)", event_id, priority);
@@ -390,26 +1474,30 @@ em_error_t em_unsubscribe(em_handle_t handle,
     }
     
     lock_manager(handle);
+    int removed = unsubscribe_matching(handle, event_id, callback, NULL, false);
+    unlock_manager(handle);
     
-    em_subscriber_list_t* list = &handle->event_subscribers[event_id];
+    return removed > 0 ? EM_OK : EM_ERR_NOT_FOUND;
+}
+
+em_error_t em_unsubscribe_on(em_handle_t handle,
+                             em_event_id_t event_id,
+                             em_callback_t callback,
+                             em_executor_t* executor)
+{
+    if (handle == NULL || callback == NULL) {
+        return EM_ERR_INVALID_PARAM;
+    }
     
-    for (int i = 0; i < EM_MAX_SUBSCRIBERS; i++) {
-        if (list->subscribers[i].active && 
-            list->subscribers[i].callback == callback) {
-            list->subscribers[i].active = false;
-            list->subscribers[i].callback = NULL;
-            list->subscribers[i].user_data = NULL;
-            list->count--;
-            handle->stats.subscribers_total--;
-            
-            EM_DEBUG("Unsubscribed from event %u", event_id);
-            unlock_manager(handle);
-            return EM_OK;
-        }
+    if (event_id >= EM_MAX_EVENT_TYPES) {
+        return EM_ERR_INVALID_PARAM;
     }
     
+    lock_manager(handle);
+    int removed = unsubscribe_matching(handle, event_id, callback, executor, true);
     unlock_manager(handle);
-    return EM_ERR_NOT_FOUND;
+    
+    return removed > 0 ? EM_OK : EM_ERR_NOT_FOUND;
 }
 
 em_error_t em_unsubscribe_all(em_handle_t handle, em_event_id_t event_id)
@@ -428,29 +1516,151 @@ em_error_t em_unsubscribe_all(em_handle_t handle, em_event_id_t event_id)
     
     for (int i = 0; i < EM_MAX_SUBSCRIBERS; i++) {
         if (list->subscribers[i].active) {
+            if (list->subscribers[i].executor != NULL) {
+                executor_release(list->subscribers[i].executor);
+            }
             list->subscribers[i].active = false;
             list->subscribers[i].callback = NULL;
             list->subscribers[i].user_data = NULL;
+            list->subscribers[i].executor = NULL;
             handle->stats.subscribers_total--;
         }
     }
     list->count = 0;
     list->sorted = true;
     
+    /* 同时退出所有订阅组 */
+    for (int g = 0; g < EM_MAX_GROUPS; g++) {
+        for (int m = 0; m < EM_MAX_GROUP_MEMBERS; m++) {
+            em_group_member_t* member = &handle->groups[g].members[m];
+            if (member->active && member->event_id == event_id) {
+                member->active = false;
+                handle->stats.subscribers_total--;
+            }
+        }
+    }
+    handle->group_members[event_id] = 0;
+    
     EM_DEBUG("Unsubscribed all from event %u", event_id);
     unlock_manager(handle);
     return EM_OK;
 }
 
-/*============================================================================
- *                              事件发布
- *============================================================================*/
-
-em_error_t em_publish_sync(em_handle_t handle, 
-                           em_event_id_t event_id, 
-                           em_event_data_t data)
+em_error_t em_subscribe_group(em_handle_t handle,
+                              em_event_id_t event_id,
+                              uint32_t group_id,
+                              em_callback_t callback,
+                              void* user_data)
 {
-    if (handle == NULL) {
+    if (handle == NULL || callback == NULL || group_id == 0 || event_id >= EM_MAX_EVENT_TYPES) {
+        return EM_ERR_INVALID_PARAM;
+    }
+    
+    lock_manager(handle);
+    
+    em_group_t* group = group_find(handle, group_id, true);
+    if (group == NULL) {
+        unlock_manager(handle);
+        return EM_ERR_MAX_SUBSCRIBERS;
+    }
+    
+    int slot = -1;
+    for (int i = 0; i < EM_MAX_GROUP_MEMBERS; i++) {
+        em_group_member_t* member = &group->members[i];
+        if (!member->active) {
+            if (slot < 0) {
+                slot = i;
+            }
+            continue;
+        }
+        if (member->event_id == event_id && member->callback == callback &&
+            member->user_data == user_data) {
+            unlock_manager(handle);
+            return EM_OK;  /* 已经是成员 */
+        }
+    }
+    if (slot < 0) {
+        unlock_manager(handle);
+        return EM_ERR_MAX_SUBSCRIBERS;
+    }
+    
+    em_group_member_t* member = &group->members[slot];
+    member->event_id = event_id;
+    member->callback = callback;
+    member->user_data = user_data;
+    member->active = true;
+    handle->group_members[event_id]++;
+    handle->stats.subscribers_total++;
+    
+    EM_DEBUG("Event %u joined group %u", event_id, group_id);
+    unlock_manager(handle);
+    return EM_OK;
+}
+
+em_error_t em_unsubscribe_group(em_handle_t handle,
+                                em_event_id_t event_id,
+                                uint32_t group_id,
+                                em_callback_t callback,
+                                void* user_data)
+{
+    if (handle == NULL || callback == NULL || group_id == 0 || event_id >= EM_MAX_EVENT_TYPES) {
+        return EM_ERR_INVALID_PARAM;
+    }
+    
+    lock_manager(handle);
+    
+    em_group_t* group = group_find(handle, group_id, false);
+    if (group != NULL) {
+        for (int i = 0; i < EM_MAX_GROUP_MEMBERS; i++) {
+            em_group_member_t* member = &group->members[i];
+            if (member->active && member->event_id == event_id &&
+                member->callback == callback && member->user_data == user_data) {
+                member->active = false;
+                handle->group_members[event_id]--;
+                handle->stats.subscribers_total--;
+                unlock_manager(handle);
+                return EM_OK;
+            }
+        }
+    }
+    
+    unlock_manager(handle);
+    return EM_ERR_NOT_FOUND;
+}
+
+em_error_t em_set_group_policy(em_handle_t handle,
+                               uint32_t group_id,
+                               em_group_policy_t policy,
+                               em_group_key_fn_t key_fn)
+{
+    if (handle == NULL || group_id == 0 || policy > EM_GROUP_KEY_HASH ||
+        (policy == EM_GROUP_KEY_HASH && key_fn == NULL)) {
+        return EM_ERR_INVALID_PARAM;
+    }
+    
+    lock_manager(handle);
+    
+    em_group_t* group = group_find(handle, group_id, true);
+    if (group == NULL) {
+        unlock_manager(handle);
+        return EM_ERR_MAX_SUBSCRIBERS;
+    }
+    group->policy = policy;
+    group->key_fn = key_fn;
+    
+    unlock_manager(handle);
+    return EM_OK;
+}
+
+/*============================================================================
+ *                              事件发布
+ *============================================================================*/
+
+em_error_t em_publish_sync(em_handle_t handle, 
+                           em_event_id_t event_id, 
+                           em_event_data_t data)
+{
+    if (handle == NULL) {
         return EM_ERR_INVALID_PARAM;
     }
     
@@ -458,12 +1668,25 @@ em_error_t em_publish_sync(em_handle_t handle,
         return EM_ERR_INVALID_PARAM;
     }
     
+    hot_record(handle, event_id, 0);
+    
+    uint64_t hash;
+    size_t sync_size = atomic_load_explicit(&handle->change_sync_size[event_id], memory_order_relaxed);
+    if (change_suppress(handle, event_id, data, sync_size, &hash)) {
+        return EM_SUPPRESSED;
+    }
+    change_commit(handle, event_id, hash);
+    
     lock_manager(handle);
     handle->stats.events_published++;
     unlock_manager(handle);
     
     /* 同步事件直接分发 */
-    dispatch_event(handle, event_id, data);
+    if (atomic_load_explicit(&handle->trace_hook, memory_order_relaxed) != NULL) {
+        em_event_t event = { event_id, data, 0, EM_PRIORITY_NORMAL, EM_MODE_SYNC };
+        trace_event(handle, &event);
+    }
+    dispatch_event(handle, event_id, data, NULL);
     
     EM_DEBUG("Published sync event %u", event_id);
     return EM_OK;
@@ -487,10 +1710,39 @@ em_error_t em_publish_async(em_handle_t handle,
         return EM_ERR_INVALID_PARAM;
     }
     
+    hot_record(handle, event_id, data_size);
+    
+    uint64_t hash;
+    if (change_suppress(handle, event_id, data, data_size, &hash)) {
+        return EM_SUPPRESSED;
+    }
+    
+    /* 
+     * 自动批量：HIGH 事件不暂存，发布前先刷新本线程已暂存的事件；
+     * 关闭后仍有暂存事件(关闭时队列已满)时同样先刷新，保持本线程的发布顺序
+     */
+    bool staging = atomic_load_explicit(&handle->auto_batch_on, memory_order_relaxed);
+    if ((staging && priority == EM_PRIORITY_HIGH) ||
+        (!staging && atomic_load_explicit(&handle->staged_events, memory_order_relaxed) > 0)) {
+        em_flush_thread(handle);
+        staging = false;
+    }
+    
+    /* 生产者已达占用上限时不加锁直接拒绝，省去数据复制 */
+    int producer = current_producer(handle);
+    if (producer >= 0) {
+        em_producer_slot_t* slot = &handle->producers[producer];
+        if (slot->limit[priority] > 0 &&
+            atomic_load(&slot->queued[priority]) >= slot->limit[priority]) {
+            atomic_fetch_add(&slot->rejected[priority], 1);
+            return EM_ERR_QUEUE_FULL;
+        }
+    }
+    
     /* 准备事件数据副本 */
     void* data_copy = NULL;
     if (data != NULL && data_size > 0) {
-        data_copy = malloc(data_size);
+        data_copy = payload_alloc_for(handle, data_size, priority);
         if (data_copy == NULL) {
             return EM_ERR_OUT_OF_MEMORY;
         }
@@ -505,32 +1757,45 @@ em_error_t em_publish_async(em_handle_t handle,
         .mode = EM_MODE_ASYNC
     };
     
+    uint64_t now = clock_now(handle);
+    
+    /* 放入本线程的暂存区，暂存区已分配完时直接入队 */
+    if (staging) {
+        em_stage_buf_t* buf = stage_buf_get(handle, true);
+        if (buf != NULL) {
+            em_error_t staged = stage_append(handle, buf, &event, data_copy, now, producer);
+            if (staged == EM_OK) {
+                change_commit(handle, event_id, hash);
+            }
+            return staged;
+        }
+    }
+    
     lock_manager(handle);
     
-    em_error_t result = enqueue_event(&handle->async_queues[priority], &event, data_copy);
+    /* 负载控制：过载时在发布处丢弃低优先级事件，保护 HIGH 的分发延迟 */
+    em_error_t result;
+    if (handle->shed.config.enabled) {
+        shed_update(handle, now);
+    }
+    if (handle->shed.level > 0 && (int)priority >= EM_PRIORITY_COUNT - handle->shed.level) {
+        handle->stats.events_shed[priority]++;
+        result = EM_ERR_OVERLOADED;
+    } else {
+        result = enqueue_locked(handle, &event, data_copy, now, producer);
+    }
     
     if (result == EM_OK) {
-        handle->stats.events_published++;
-        
-        /* 更新队列统计 */
-        uint32_t total = 0;
-        for (int i = 0; i < EM_PRIORITY_COUNT; i++) {
-            total += handle->async_queues[i].count;
-        }
-        handle->stats.async_queue_current = total;
-        if (total > handle->stats.async_queue_max) {
-            handle->stats.async_queue_max = total;
-        }
-        
         EM_DEBUG("Published async event %u (priority=%d)", event_id, priority);
-        
+        change_commit(handle, event_id, hash);
+
 #if EM_ENABLE_THREADING
         signal_manager(handle);  /* 通知事件循环有新事件 */
 #endif
     } else {
-        /* 入队失败，释放数据副本 */
+        /* 入队失败或被丢弃，释放数据副本 */
         if (data_copy != NULL) {
-            free(data_copy);
+            payload_release(data_copy);
         }
     }
     
@@ -538,428 +1803,4700 @@ em_error_t em_publish_async(em_handle_t handle,
     return result;
 }
 
-em_error_t em_publish(em_handle_t handle, const em_event_t* event)
+em_error_t em_publish_auto(em_handle_t handle,
+                           em_event_id_t event_id,
+                           em_event_data_t data,
+                           size_t data_size,
+                           em_priority_t priority)
 {
-    if (handle == NULL || event == NULL) {
+    if (handle == NULL || event_id >= EM_MAX_EVENT_TYPES || priority >= EM_PRIORITY_COUNT) {
         return EM_ERR_INVALID_PARAM;
     }
     
-    if (event->mode == EM_MODE_SYNC) {
-        return em_publish_sync(handle, event->id, event->data);
-    } else {
-        return em_publish_async(handle, event->id, event->data, 
-                               event->data_size, event->priority);
+    /* 不在本管理器事件循环的回调中，或暂存已满：正常入队 */
+    if (inline_ring.loop != handle || dispatching_handle != handle ||
+        inline_ring.count == EM_INLINE_DEPTH) {
+        return em_publish_async(handle, event_id, data, data_size, priority);
     }
+    
+    hot_record(handle, event_id, data_size);
+    
+    uint64_t hash;
+    if (change_suppress(handle, event_id, data, data_size, &hash)) {
+        return EM_SUPPRESSED;
+    }
+    
+    /* 本线程暂存的自动批量事件先入队，内联分发时据此判断先后 */
+    if (atomic_load_explicit(&handle->auto_batch_on, memory_order_relaxed)) {
+        em_flush_thread(handle);
+    }
+    
+    void* data_copy = NULL;
+    if (data != NULL && data_size > 0) {
+        data_copy = payload_alloc_for(handle, data_size, priority);
+        if (data_copy == NULL) {
+            return EM_ERR_OUT_OF_MEMORY;
+        }
+        memcpy(data_copy, data, data_size);
+    }
+    
+    uint32_t slot = (inline_ring.head + inline_ring.count) % EM_INLINE_DEPTH;
+    inline_ring.events[slot] = (em_event_t){
+        .id = event_id,
+        .data = data_copy ? data_copy : data,
+        .data_size = data_size,
+        .priority = priority,
+        .mode = EM_MODE_ASYNC
+    };
+    inline_ring.copies[slot] = data_copy;
+    inline_ring.count++;
+    change_commit(handle, event_id, hash);
+    
+    EM_DEBUG("Published auto event %u (priority=%d)", event_id, priority);
+    return EM_OK;
 }
 
-/*============================================================================
- *                              事件处理
- *============================================================================*/
-
-em_error_t em_process_one(em_handle_t handle)
+em_error_t em_publish_from_isr(em_handle_t handle,
+                               em_event_id_t event_id,
+                               em_event_data_t data,
+                               size_t data_size,
+                               em_priority_t priority)
 {
-    if (handle == NULL) {
+    if (handle == NULL || event_id >= EM_MAX_EVENT_TYPES || priority >= EM_PRIORITY_COUNT ||
+        data_size > EM_ISR_PAYLOAD_SIZE || (data == NULL && data_size > 0)) {
         return EM_ERR_INVALID_PARAM;
     }
     
-    em_event_t event;
-    void* data_copy = NULL;
-    em_error_t result = EM_ERR_QUEUE_EMPTY;
-    
-    lock_manager(handle);
+    em_isr_ring_t* ring = handle->isr_ring;
+    if (ring == NULL) {
+        return EM_ERR_NOT_SUPPORTED;
+    }
     
-    /* 
-     * 按优先级顺序处理(HIGH -> NORMAL -> LOW)
-     * 注意: 此处依赖于优先级枚举值按升序排列:
-     * EM_PRIORITY_HIGH=0, EM_PRIORITY_NORMAL=1, EM_PRIORITY_LOW=2
-     */
-    for (int i = 0; i < EM_PRIORITY_COUNT; i++) {
-        if (handle->async_queues[i].count > 0) {
-            result = dequeue_event(&handle->async_queues[i], &event, &data_copy);
-            if (result == EM_OK) {
-                /* 更新队列统计 */
-                uint32_t total = 0;
-                for (int j = 0; j < EM_PRIORITY_COUNT; j++) {
-                    total += handle->async_queues[j].count;
-                }
-                handle->stats.async_queue_current = total;
+    /* 占用一个槽位：只有原子操作，被打断的生产者不会阻塞其他生产者 */
+    em_isr_slot_t* slot;
+    uint32_t pos = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    for (;;) {
+        slot = &ring->slots[pos & ring->mask];
+        uint32_t seq = atomic_load_explicit(&slot->seq, memory_order_acquire);
+        int32_t diff = (int32_t)(seq - pos);
+        if (diff == 0) {
+            if (atomic_compare_exchange_weak_explicit(&ring->tail, &pos, pos + 1,
+                                                      memory_order_relaxed, memory_order_relaxed)) {
                 break;
             }
+        } else if (diff < 0) {
+            atomic_fetch_add_explicit(&handle->isr_dropped, 1, memory_order_relaxed);
+            return EM_ERR_QUEUE_FULL;
+        } else {
+            pos = atomic_load_explicit(&ring->tail, memory_order_relaxed);
         }
     }
     
-    unlock_manager(handle);
+    slot->id = event_id;
+    slot->priority = (uint8_t)priority;
+    slot->size = (uint8_t)data_size;
+    slot->ptr = data;
+    for (size_t i = 0; i < data_size; i++) {
+        slot->data[i] = ((const unsigned char*)data)[i];
+    }
+    atomic_store_explicit(&slot->seq, pos + 1, memory_order_release);
+    atomic_fetch_add_explicit(&handle->isr_events, 1, memory_order_relaxed);
+
+#if EM_USE_EPOLL
+    /* write 是异步信号安全的；保留被打断代码的 errno */
+    if (handle->epoll_initialized) {
+        int saved_errno = errno;
+        uint64_t val = 1;
+        if (write(handle->event_fd, &val, sizeof(val)) > 0) {
+            atomic_fetch_add_explicit(&handle->wake.eventfd_writes, 1, memory_order_relaxed);
+        }
+        errno = saved_errno;
+    }
+#endif
     
-    /* 在锁外执行事件分发(避免死锁) */
-    if (result == EM_OK) {
-        dispatch_event(handle, event.id, event.data);
-        
-        /* 释放数据副本 */
-        if (data_copy != NULL) {
-            free(data_copy);
+    return EM_OK;
+}
+
+em_error_t em_publish_delayed(em_handle_t handle,
+                              em_event_id_t event_id,
+                              em_event_data_t data,
+                              size_t data_size,
+                              em_priority_t priority,
+                              uint64_t delay_ns)
+{
+    if (handle == NULL || event_id >= EM_MAX_EVENT_TYPES || priority >= EM_PRIORITY_COUNT) {
+        return EM_ERR_INVALID_PARAM;
+    }
+    
+    hot_record(handle, event_id, data_size);
+    
+    void* data_copy = NULL;
+    if (data != NULL && data_size > 0) {
+        data_copy = payload_alloc_for(handle, data_size, priority);
+        if (data_copy == NULL) {
+            return EM_ERR_OUT_OF_MEMORY;
         }
+        memcpy(data_copy, data, data_size);
+    }
+    
+    em_timer_t timer = {
+        .event = {
+            .id = event_id,
+            .data = data_copy ? data_copy : data,
+            .data_size = data_size,
+            .priority = priority,
+            .mode = EM_MODE_ASYNC
+        },
+        .data_copy = data_copy
+    };
+    
+    lock_manager(handle);
+    
+    timer.due_ns = clock_now(handle) + delay_ns;
+    em_error_t result = timer_push(handle, &timer);
+    if (result == EM_OK) {
+        /* 唤醒事件循环，按新的最早到期时间重新计算等待时长 */
+        signal_manager(handle);
+    } else if (data_copy != NULL) {
+        payload_release(data_copy);
     }
     
+    unlock_manager(handle);
     return result;
 }
 
-int em_process_all(em_handle_t handle)
+em_error_t em_publish(em_handle_t handle, const em_event_t* event)
 {
-    if (handle == NULL) {
-        return -1;
+    if (handle == NULL || event == NULL) {
+        return EM_ERR_INVALID_PARAM;
     }
     
-    int count = 0;
-    while (em_process_one(handle) == EM_OK) {
-        count++;
+    if (event->mode == EM_MODE_SYNC) {
+        return em_publish_sync(handle, event->id, event->data);
+    } else {
+        return em_publish_async(handle, event->id, event->data, 
+                               event->data_size, event->priority);
     }
-    
-    return count;
 }
 
-em_error_t em_run_loop(em_handle_t handle)
+em_error_t em_publish_group(em_handle_t handle, const em_event_t* events, size_t count)
 {
-    if (handle == NULL) {
+    if (handle == NULL || events == NULL || count == 0 || count > EM_MAX_GROUP_SIZE) {
         return EM_ERR_INVALID_PARAM;
     }
     
-    handle->running = true;
+    int needed[EM_PRIORITY_COUNT] = { 0 };
+    for (size_t i = 0; i < count; i++) {
+        if (events[i].id >= EM_MAX_EVENT_TYPES || events[i].priority >= EM_PRIORITY_COUNT) {
+            return EM_ERR_INVALID_PARAM;
+        }
+        needed[events[i].priority]++;
+    }
+    for (size_t i = 0; i < count; i++) {
+        hot_record(handle, events[i].id, events[i].data_size);
+    }
     
-    EM_DEBUG("Event loop started");
+    /* 本线程暂存的自动批量事件先入队，保持本线程的发布顺序 */
+    if (atomic_load_explicit(&handle->auto_batch_on, memory_order_relaxed)) {
+        em_flush_thread(handle);
+    }
     
-#if EM_USE_EPOLL
-    /* 使用 epoll 的事件循环 */
-    struct epoll_event events[1];
+    /* 在锁外准备所有数据副本 */
+    em_event_t group[EM_MAX_GROUP_SIZE];
+    void* copies[EM_MAX_GROUP_SIZE];
+    for (size_t i = 0; i < count; i++) {
+        group[i] = events[i];
+        group[i].mode = EM_MODE_ASYNC;
+        copies[i] = NULL;
+        if (events[i].data != NULL && events[i].data_size > 0) {
+            copies[i] = payload_alloc_for(handle, events[i].data_size, events[i].priority);
+            if (copies[i] == NULL) {
+                for (size_t j = 0; j < i; j++) {
+                    if (copies[j] != NULL) {
+                        payload_release(copies[j]);
+                    }
+                }
+                return EM_ERR_OUT_OF_MEMORY;
+            }
+            memcpy(copies[i], events[i].data, events[i].data_size);
+            group[i].data = copies[i];
+        }
+    }
     
-    while (handle->running) {
-        lock_manager(handle);
-        
-        /* 检查是否有待处理的事件 */
-        bool has_events = false;
-        for (int i = 0; i < EM_PRIORITY_COUNT; i++) {
-            if (handle->async_queues[i].count > 0) {
-                has_events = true;
-                break;
+    uint64_t now = clock_now(handle);
+    em_error_t result = EM_OK;
+    
+    lock_manager(handle);
+    
+    /* 负载控制：任一事件会被丢弃则整组拒绝 */
+    if (handle->shed.config.enabled) {
+        shed_update(handle, now);
+    }
+    if (handle->shed.level > 0) {
+        for (int p = EM_PRIORITY_COUNT - handle->shed.level; p < EM_PRIORITY_COUNT; p++) {
+            if (needed[p] > 0) {
+                handle->stats.events_shed[p] += (uint32_t)needed[p];
+                result = EM_ERR_OVERLOADED;
             }
         }
-        
-        unlock_manager(handle);
-        
-        if (has_events) {
-            /* 处理所有待处理的事件 */
-            em_process_all(handle);
-        } else if (handle->running && handle->epoll_initialized) {
-            /* 使用 epoll 等待新事件，超时 100ms */
-            int nfds = epoll_wait(handle->epoll_fd, events, 1, 100);
-            if (nfds > 0) {
-                /* 清空 eventfd 的计数器 */
-                uint64_t val;
-                ssize_t ret = read(handle->event_fd, &val, sizeof(val));
-                if (ret > 0) {
-                    EM_DEBUG("epoll woke up, eventfd val=%lu", (unsigned long)val);
-                } else if (ret < 0) {
-                    EM_DEBUG("eventfd read failed");
-                }
+    }
+    
+    /* 检查每个优先级的剩余空间，必要时按自动扩容策略先扩容 */
+    for (int p = 0; p < EM_PRIORITY_COUNT && result == EM_OK; p++) {
+        em_priority_queue_t* queue = &handle->async_queues[p];
+        int required = queue->count + needed[p];
+        if (needed[p] == 0 || required <= queue->capacity) {
+            continue;
+        }
+        if (handle->autogrow.enabled && required <= (int)handle->autogrow.max_capacity) {
+            int capacity = queue->capacity * 2 > required ? queue->capacity * 2 : required;
+            if (capacity > (int)handle->autogrow.max_capacity) {
+                capacity = (int)handle->autogrow.max_capacity;
             }
+            result = resize_queue(handle, (em_priority_t)p, capacity);
+        } else {
+            result = EM_ERR_QUEUE_FULL;
         }
     }
-#else
-    /* 原始的条件变量事件循环 */
-    while (handle->running) {
-        lock_manager(handle);
-        
-        /* 检查是否有待处理的事件 */
-        bool has_events = false;
-        for (int i = 0; i < EM_PRIORITY_COUNT; i++) {
-            if (handle->async_queues[i].count > 0) {
-                has_events = true;
-                break;
+    
+    /* 生产者配额同样按整组判断 */
+    int producer = current_producer(handle);
+    for (int p = 0; p < EM_PRIORITY_COUNT && result == EM_OK; p++) {
+        if (needed[p] > 0 && !producer_admit(handle, producer, (em_priority_t)p, (uint32_t)needed[p])) {
+            if (producer >= 0) {
+                atomic_fetch_add(&handle->producers[producer].rejected[p], (unsigned)needed[p]);
             }
+            result = EM_ERR_QUEUE_FULL;
         }
-        
-        if (!has_events && handle->running) {
-#if EM_ENABLE_THREADING
-            /* 等待新事件 */
-            wait_manager(handle);
-#endif
+    }
+    
+    /* 空间已确认，整组连续入队，其他生产者无法插入其中 */
+    if (result == EM_OK) {
+        for (size_t i = 0; i < count; i++) {
+            enqueue_locked(handle, &group[i], copies[i], now, producer);
         }
-        
-        unlock_manager(handle);
-        
-        /* 处理所有待处理的事件 */
-        em_process_all(handle);
+        signal_manager(handle);
     }
-#endif
     
-    EM_DEBUG("Event loop stopped");
-    return EM_OK;
+    unlock_manager(handle);
+    
+    if (result != EM_OK) {
+        for (size_t i = 0; i < count; i++) {
+            if (copies[i] != NULL) {
+                payload_release(copies[i]);
+            }
+        }
+    }
+    return result;
 }
 
-em_error_t em_stop_loop(em_handle_t handle)
+em_error_t em_set_auto_batch(em_handle_t handle, const em_auto_batch_t* config)
 {
     if (handle == NULL) {
         return EM_ERR_INVALID_PARAM;
     }
     
-    handle->running = false;
-    
-#if EM_ENABLE_THREADING
+    if (config == NULL || !config->enabled) {
+        /* 
+         * 先关闭再刷新，之后的发布不再进入暂存区。已返回 EM_OK 的暂存事件不能丢弃：
+         * 队列满时留在暂存区，由超时刷新或所属线程的下一次发布继续入队
+         */
+        atomic_store(&handle->auto_batch_on, false);
+        stage_flush_stale(handle, true);
+        if (atomic_load_explicit(&handle->staged_events, memory_order_relaxed) > 0) {
+            return EM_ERR_QUEUE_FULL;
+        }
+        return EM_OK;
+    }
+    
+    if (config->max_events > EM_MAX_GROUP_SIZE) {
+        return EM_ERR_INVALID_PARAM;
+    }
+    
+    uint32_t max_events = config->max_events > 0 ? config->max_events : EM_MAX_GROUP_SIZE;
+    uint32_t delay_us = config->max_delay_us > 0 ? config->max_delay_us : EM_AUTO_BATCH_DEFAULT_DELAY_US;
+    atomic_store(&handle->auto_batch_max, max_events);
+    atomic_store(&handle->auto_batch_delay_ns, (uint64_t)delay_us * 1000);
+    atomic_store(&handle->auto_batch_on, true);
+    
+    return EM_OK;
+}
+
+em_error_t em_flush_thread(em_handle_t handle)
+{
+    if (handle == NULL) {
+        return EM_ERR_INVALID_PARAM;
+    }
+    
+    em_stage_buf_t* buf = stage_buf_get(handle, false);
+    if (buf == NULL) {
+        return EM_OK;
+    }
+    
+    stage_buf_acquire(buf);
+    em_error_t result = stage_flush_locked(handle, buf);
+    atomic_flag_clear_explicit(&buf->busy, memory_order_release);
+    return result;
+}
+
+/*============================================================================
+ *                              文件描述符数据源
+ *============================================================================*/
+
+int em_add_fd_source(em_handle_t handle, int fd, const em_fd_source_config_t* config)
+{
+    if (handle == NULL || fd < 0 || config == NULL ||
+        config->event_id >= EM_MAX_EVENT_TYPES || config->priority >= EM_PRIORITY_COUNT ||
+        config->framing > EM_FD_FRAME_DATAGRAM || config->frame_size == 0) {
+        return EM_ERR_INVALID_PARAM;
+    }
+
+#if EM_USE_EPOLL
+    em_fd_source_config_t cfg = *config;
+    if (cfg.length_bytes == 0) {
+        cfg.length_bytes = 4;
+    }
+    if (cfg.framing == EM_FD_FRAME_LENGTH &&
+        cfg.length_bytes != 1 && cfg.length_bytes != 2 && cfg.length_bytes != 4) {
+        return EM_ERR_INVALID_PARAM;
+    }
+    
     lock_manager(handle);
-    signal_manager(handle);  /* 唤醒事件循环 */
+    
+    if (!handle->epoll_initialized) {
+        unlock_manager(handle);
+        return EM_ERR_NOT_INITIALIZED;
+    }
+    
+    int id = -1;
+    for (int i = 0; i < EM_MAX_FD_SOURCES; i++) {
+        if (!handle->fd_sources[i].active && !handle->fd_sources[i].reading) {
+            id = i;
+            break;
+        }
+    }
+    if (id < 0) {
+        unlock_manager(handle);
+        return EM_ERR_MAX_SUBSCRIBERS;
+    }
+    
+    /* 读到 EAGAIN 为止，不能阻塞事件循环；注册失败时恢复调用者的标志 */
+    int flags = fcntl(fd, F_GETFL);
+    if (flags < 0 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) < 0) {
+        unlock_manager(handle);
+        return EM_ERR_INVALID_PARAM;
+    }
+    
+    em_fd_source_t* src = &handle->fd_sources[id];
+    memset(src, 0, sizeof(*src));
+    src->fd = fd;
+    src->config = cfg;
+    
+    struct epoll_event ev;
+    ev.events = EPOLLIN;
+    ev.data.u64 = (uint64_t)id + 1;
+    if (epoll_ctl(handle->epoll_fd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+        fcntl(fd, F_SETFL, flags);
+        unlock_manager(handle);
+        return EM_ERR_INVALID_PARAM;
+    }
+    src->active = true;
+    handle->fd_source_count++;
+    
     unlock_manager(handle);
+    
+    EM_DEBUG("Added fd source %d (fd=%d, framing=%d)", id, fd, cfg.framing);
+    return id;
+#else
+    return EM_ERR_NOT_SUPPORTED;
 #endif
+}
+
+em_error_t em_remove_fd_source(em_handle_t handle, int source)
+{
+    if (handle == NULL || source < 0 || source >= EM_MAX_FD_SOURCES) {
+        return EM_ERR_INVALID_PARAM;
+    }
+
+#if EM_USE_EPOLL
+    lock_manager(handle);
     
-    EM_DEBUG("Event loop stop requested");
+    em_fd_source_t* src = &handle->fd_sources[source];
+    if (!src->active) {
+        unlock_manager(handle);
+        return EM_ERR_NOT_FOUND;
+    }
+    src->active = false;
+    handle->fd_source_count--;
+    if (src->paused) {
+        src->paused = false;
+        handle->fd_paused_count--;
+    }
+    epoll_ctl(handle->epoll_fd, EPOLL_CTL_DEL, src->fd, NULL);
+    if (!src->reading) {
+        fd_source_reset(src);
+    }
+    
+    unlock_manager(handle);
     return EM_OK;
+#else
+    return EM_ERR_NOT_SUPPORTED;
+#endif
 }
 
 /*============================================================================
- *                              工具函数
+ *                              事件处理
  *============================================================================*/
 
-em_error_t em_get_stats(em_handle_t handle, em_stats_t* stats)
+em_error_t em_process_one(em_handle_t handle)
 {
-    if (handle == NULL || stats == NULL) {
+    if (handle == NULL) {
         return EM_ERR_INVALID_PARAM;
     }
     
+    em_event_t event;
+    void* data_copy = NULL;
+    em_priority_t priority;
+    
     lock_manager(handle);
-    memcpy(stats, &handle->stats, sizeof(em_stats_t));
+    em_error_t result = dequeue_next(handle, &event, &data_copy, &priority)
+                        ? EM_OK : EM_ERR_QUEUE_EMPTY;
+#if EM_ENABLE_THREADING
+    unsigned bucket = result == EM_OK ? inflight_begin(handle, 1) : 0;
+#endif
+    unlock_manager(handle);
+    
+    /* 在锁外执行事件分发(避免死锁) */
+    if (result == EM_OK) {
+        em_handle_t outer = dispatching_handle;
+        dispatching_handle = handle;
+        trace_event(handle, &event);
+        dispatch_event(handle, event.id, event.data, data_copy);
+        
+        /* 释放数据副本(投递到执行器的回调各自持有引用) */
+        if (data_copy != NULL) {
+            payload_release(data_copy);
+        }
+        dispatching_handle = outer;
+#if EM_ENABLE_THREADING
+        inflight_end(handle, bucket, 1);
+#endif
+    }
+    
+    return result;
+}
+
+int em_process_all(em_handle_t handle)
+{
+    if (handle == NULL) {
+        return -1;
+    }
+    
+    /* 刷新暂存超时的自动批量暂存区，取出中断上下文发布的事件 */
+    stage_flush_stale(handle, false);
+    isr_drain(handle);
+    
+    int count = 0;
+    while (em_process_one(handle) == EM_OK) {
+        count++;
+    }
+    
+    /* 执行挂接到本管理器的执行器中的回调 */
+    count += run_attached_executors(handle);
+    
+    return count;
+}
+
+em_error_t em_run_loop(em_handle_t handle)
+{
+    if (handle == NULL) {
+        return EM_ERR_INVALID_PARAM;
+    }
+    
+    handle->running = true;
+    em_handle_t outer_loop = inline_ring.loop;
+    inline_ring.loop = handle;
+    
+    em_drain_state_t drain = { 0, false, 0 };
+    lock_manager(handle);
+    drain.size = handle->batch_policy.min_batch;
+    unlock_manager(handle);
+    
+    EM_DEBUG("Event loop started");
+
+#if EM_USE_EPOLL
+    /* 使用 epoll 的事件循环 */
+    struct epoll_event events[1 + EM_MAX_FD_SOURCES];
+    bool woke = false;
+    
+    while (handle->running) {
+        stage_flush_stale(handle, false);
+        isr_drain(handle);
+        lock_manager(handle);
+        
+        /* 检查是否有待处理的事件 */
+        bool has_events = executors_pending(handle) || timer_ready(handle);
+        for (int i = 0; i < EM_PRIORITY_COUNT; i++) {
+            if (handle->async_queues[i].count > 0) {
+                has_events = true;
+                break;
+            }
+        }
+        
+        /* 有延时事件、暂存事件或暂停的数据源时最多等到其到期 */
+        uint64_t wait_ns = stage_wait_ns(handle, timer_wait_ns(handle, 100000000ull));
+        wait_ns = fd_resume_wait_ns(handle, wait_ns);
+        int timeout_ms = (int)((wait_ns + 999999) / 1000000);
+        bool fd_sources = handle->fd_source_count > 0;
+        
+        unlock_manager(handle);
+        
+        if (has_events) {
+            /* 分批处理所有待处理的事件 */
+            int drained = 0;
+            int n;
+            while ((n = drain_batch(handle, &drain)) > 0) {
+                drained += n;
+            }
+            drained += run_attached_executors(handle);
+            if (woke) {
+                count_wakeup(handle, drained);
+                woke = false;
+            }
+        } else if (woke) {
+            count_wakeup(handle, 0);
+            woke = false;
+        }
+        
+        /* 
+         * 使用 epoll 等待新事件，超时 100ms；有数据源时即使队列非空也不等待地
+         * 检查一次，避免持续积压时数据源得不到读取
+         */
+        if ((!has_events || fd_sources) && handle->running && handle->epoll_initialized) {
+            int nfds = epoll_wait(handle->epoll_fd, events, 1 + EM_MAX_FD_SOURCES,
+                                  has_events ? 0 : timeout_ms);
+            if (!has_events) {
+                woke = true;
+                if (nfds == 0) {
+                    atomic_fetch_add_explicit(&handle->wake.timeouts, 1, memory_order_relaxed);
+                }
+            }
+            for (int i = 0; i < nfds; i++) {
+                if (events[i].data.u64 != 0) {
+                    fd_source_ready(handle, (int)events[i].data.u64 - 1);
+                    continue;
+                }
+                
+                /* 清空 eventfd 的计数器 */
+                uint64_t val;
+                ssize_t ret = read(handle->event_fd, &val, sizeof(val));
+                if (ret > 0) {
+                    atomic_fetch_add_explicit(&handle->wake.eventfd_reads, 1, memory_order_relaxed);
+                    EM_DEBUG("epoll woke up, eventfd val=%lu", (unsigned long)val);
+                } else if (ret < 0) {
+                    EM_DEBUG("eventfd read failed");
+                }
+            }
+        }
+    }
+#else
+    /* 原始的条件变量事件循环 */
+    bool woke = false;
+    while (handle->running) {
+        stage_flush_stale(handle, false);
+        isr_drain(handle);
+        lock_manager(handle);
+        
+        /* 检查是否有待处理的事件 */
+        bool has_events = executors_pending(handle) || timer_ready(handle);
+        for (int i = 0; i < EM_PRIORITY_COUNT; i++) {
+            if (handle->async_queues[i].count > 0) {
+                has_events = true;
+                break;
+            }
+        }
+        
+        if (!has_events && handle->running) {
+#if EM_ENABLE_THREADING
+            /* 等待新事件，有延时事件、暂存事件或中断上下文发布时最多等到其到期 */
+            uint64_t wait_ns = isr_wait_ns(handle, stage_wait_ns(handle, timer_wait_ns(handle, UINT64_MAX)));
+            if (wait_ns != UINT64_MAX) {
+                if (wait_manager_timed(handle, wait_ns)) {
+                    atomic_fetch_add_explicit(&handle->wake.timeouts, 1, memory_order_relaxed);
+                }
+            } else {
+                wait_manager(handle);
+            }
+            woke = true;
+#endif
+        }
+        
+        unlock_manager(handle);
+        
+        /* 分批处理所有待处理的事件 */
+        int drained = 0;
+        int n;
+        while ((n = drain_batch(handle, &drain)) > 0) {
+            drained += n;
+        }
+        drained += run_attached_executors(handle);
+        if (woke) {
+            count_wakeup(handle, drained);
+            woke = false;
+        }
+    }
+#endif
+    
+    inline_ring.loop = outer_loop;
+    EM_DEBUG("Event loop stopped");
+    return EM_OK;
+}
+
+em_error_t em_stop_loop(em_handle_t handle)
+{
+    if (handle == NULL) {
+        return EM_ERR_INVALID_PARAM;
+    }
+    
+    handle->running = false;
+
+#if EM_ENABLE_THREADING
+    lock_manager(handle);
+    signal_manager(handle);  /* 唤醒事件循环 */
     unlock_manager(handle);
+#endif
     
+    EM_DEBUG("Event loop stop requested");
     return EM_OK;
 }
 
-em_error_t em_reset_stats(em_handle_t handle)
+#if EM_ENABLE_THREADING
+/** flush 开始时入队的事件是否都已出队(调用者需持有锁) */
+static bool flush_dequeued(em_handle_t handle, const uint64_t* target)
+{
+    for (int p = 0; p < EM_PRIORITY_COUNT; p++) {
+        if (handle->async_queues[p].removed < target[p]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/** 在 flush_q 上等待一次，已过截止时间返回false(调用者需持有锁) */
+static bool flush_wait(em_handle_t handle, uint64_t deadline)
+{
+    uint64_t now = now_ns();
+    if (now >= deadline) {
+        return false;
+    }
+    wait_locked(handle, &handle->flush_q, deadline == UINT64_MAX ? UINT64_MAX : deadline - now);
+    return true;
+}
+#endif
+
+em_error_t em_flush(em_handle_t handle, uint64_t timeout_ns)
+{
+    if (handle == NULL) {
+        return EM_ERR_INVALID_PARAM;
+    }
+
+#if EM_ENABLE_THREADING
+    /* 不加锁的管理器没有其他消费者；在回调中等待会等到自己 */
+    if (handle->lock_type == EM_LOCK_NONE || dispatching_handle == handle) {
+        return EM_ERR_NOT_SUPPORTED;
+    }
+    
+    /* 各线程暂存的自动批量事件也算已发布，先整批入队 */
+    stage_flush_stale(handle, true);
+    
+    uint64_t deadline = UINT64_MAX;
+    if (timeout_ns != UINT64_MAX) {
+        deadline = now_ns() + timeout_ns;
+    }
+    
+    lock_manager(handle);
+    atomic_fetch_add(&handle->flush_waiters, 1);
+    
+    /* 中断上下文已写入环形缓冲区的事件同样先入队 */
+    isr_drain_locked(handle);
+    
+    uint64_t target[EM_PRIORITY_COUNT];
+    for (int p = 0; p < EM_PRIORITY_COUNT; p++) {
+        target[p] = handle->async_queues[p].enqueued;
+    }
+    
+    /* 1. 之前入队的事件全部出队 */
+    em_error_t result = EM_OK;
+    while (result == EM_OK && !flush_dequeued(handle, target)) {
+        if (!flush_wait(handle, deadline)) {
+            result = EM_ERR_TIMEOUT;
+        }
+    }
+    
+    /* 
+     * 2. 已出队的事件还可能在任何消费者中分发。等上一轮的计数归零后切换轮次，
+     *    此后出队的事件计入另一组，本轮的计数只减不增
+     */
+    unsigned bucket = 0;
+    while (result == EM_OK) {
+        bucket = (unsigned)(handle->flush_epoch & 1);
+        if (atomic_load(&handle->inflight[bucket ^ 1]) == 0) {
+            handle->flush_epoch++;
+            break;
+        }
+        if (!flush_wait(handle, deadline)) {
+            result = EM_ERR_TIMEOUT;
+        }
+    }
+    
+    /* 3. 切换前出队的事件全部分发完 */
+    while (result == EM_OK && atomic_load(&handle->inflight[bucket]) != 0) {
+        if (!flush_wait(handle, deadline)) {
+            result = EM_ERR_TIMEOUT;
+        }
+    }
+    
+    atomic_fetch_sub(&handle->flush_waiters, 1);
+    unlock_manager(handle);
+    return result;
+#else
+    (void)timeout_ns;
+    return EM_ERR_NOT_SUPPORTED;
+#endif
+}
+
+/*============================================================================
+ *                              执行器
+ *============================================================================*/
+
+em_executor_t* em_executor_create(em_handle_t owner, size_t capacity)
+{
+    em_executor_t* executor = executor_new(capacity);
+    if (executor == NULL) {
+        return NULL;
+    }
+    
+    if (owner != NULL) {
+        lock_manager(owner);
+        if (owner->executor_count >= EM_MAX_EXECUTORS) {
+            unlock_manager(owner);
+            executor_release(executor);
+            return NULL;
+        }
+        owner->executors[owner->executor_count++] = executor;
+        atomic_store(&executor->owner, owner);
+        unlock_manager(owner);
+    }
+    
+    return executor;
+}
+
+em_error_t em_executor_destroy(em_executor_t* executor)
+{
+    if (executor == NULL) {
+        return EM_ERR_INVALID_PARAM;
+    }
+    
+    /* 与 em_destroy 并发时，users 计数保证 owner 在本线程解锁前不会被回收 */
+    atomic_fetch_add(&executor->users, 1);
+    em_handle_t owner = atomic_load(&executor->owner);
+    if (owner != NULL) {
+        lock_manager(owner);
+        if (atomic_load(&executor->owner) == owner) {
+            for (int i = 0; i < owner->executor_count; i++) {
+                if (owner->executors[i] == executor) {
+                    owner->executors[i] = owner->executors[--owner->executor_count];
+                    break;
+                }
+            }
+            atomic_store(&executor->owner, NULL);
+        }
+        unlock_manager(owner);
+    }
+    atomic_fetch_sub(&executor->users, 1);
+    executor_wait_users(executor);
+    
+    /* 仍被订阅引用时，内存在最后一个订阅取消后才释放 */
+    atomic_store(&executor->closed, true);
+    executor_release(executor);
+    
+    EM_DEBUG("Executor destroyed");
+    return EM_OK;
+}
+
+int em_executor_run(em_executor_t* executor, int max_count)
+{
+    if (executor == NULL) {
+        return -1;
+    }
+    
+    int count = 0;
+    em_invocation_t inv;
+    
+    while ((max_count <= 0 || count < max_count) && inbox_pop(executor, &inv)) {
+        inv.callback(inv.event_id, inv.data, inv.user_data);
+        if (inv.payload != NULL) {
+            payload_release(inv.payload);
+        }
+        count++;
+    }
+    
+    return count;
+}
+
+int em_executor_pending(em_executor_t* executor)
+{
+    if (executor == NULL) {
+        return -1;
+    }
+    
+    size_t head = atomic_load_explicit(&executor->dequeue_pos, memory_order_acquire);
+    size_t tail = atomic_load_explicit(&executor->enqueue_pos, memory_order_acquire);
+    return tail > head ? (int)(tail - head) : 0;
+}
+
+/*============================================================================
+ *                              Actor
+ *============================================================================*/
+
+#if EM_ENABLE_THREADING
+
+/**
+ * @brief 把 Actor 放入就绪队列(若尚未调度)
+ */
+static void actor_schedule(em_actor_t* actor)
+{
+    int expected = 0;
+    if (!atomic_compare_exchange_strong(&actor->scheduled, &expected, 1)) {
+        return;  /* 已在就绪队列中或正在运行 */
+    }
+    
+    /* 调度期间持有邮箱引用，保证 Actor 不会在运行中被释放 */
+    executor_retain(actor->mailbox);
+    
+    em_handle_t handle = actor->handle;
+    pthread_mutex_lock(&handle->pool_mutex);
+    actor->next = NULL;
+    if (handle->ready_tail != NULL) {
+        handle->ready_tail->next = actor;
+    } else {
+        handle->ready_head = actor;
+    }
+    handle->ready_tail = actor;
+    pthread_cond_signal(&handle->pool_cond);
+    pthread_mutex_unlock(&handle->pool_mutex);
+}
+
+static void actor_notify(em_executor_t* executor)
+{
+    actor_schedule((em_actor_t*)executor->context);
+}
+
+static void actor_finalize(em_executor_t* executor)
+{
+    free(executor->context);
+}
+
+/**
+ * @brief Actor 工作线程
+ */
+static void* actor_worker(void* arg)
+{
+    em_handle_t handle = (em_handle_t)arg;
+    
+    for (;;) {
+        pthread_mutex_lock(&handle->pool_mutex);
+        while (handle->pool_running && handle->ready_head == NULL) {
+            pthread_cond_wait(&handle->pool_cond, &handle->pool_mutex);
+        }
+        if (!handle->pool_running) {
+            pthread_mutex_unlock(&handle->pool_mutex);
+            break;
+        }
+        em_actor_t* actor = handle->ready_head;
+        handle->ready_head = actor->next;
+        if (handle->ready_head == NULL) {
+            handle->ready_tail = NULL;
+        }
+        pthread_mutex_unlock(&handle->pool_mutex);
+        
+        /* 每次最多处理一批消息，避免单个 Actor 长期占用工作线程 */
+        if (!atomic_load(&actor->mailbox->closed)) {
+            em_executor_run(actor->mailbox, EM_ACTOR_BATCH_SIZE);
+        }
+        
+        atomic_store(&actor->scheduled, 0);
+        
+        /* 清除标志后仍有消息，且没有其他投递者抢先调度，则重新入队(沿用当前引用) */
+        int expected = 0;
+        if (em_executor_pending(actor->mailbox) > 0 &&
+            !atomic_load(&actor->mailbox->closed) &&
+            atomic_compare_exchange_strong(&actor->scheduled, &expected, 1)) {
+            pthread_mutex_lock(&handle->pool_mutex);
+            actor->next = NULL;
+            if (handle->ready_tail != NULL) {
+                handle->ready_tail->next = actor;
+            } else {
+                handle->ready_head = actor;
+            }
+            handle->ready_tail = actor;
+            pthread_mutex_unlock(&handle->pool_mutex);
+        } else {
+            executor_release(actor->mailbox);
+        }
+    }
+    
+    return NULL;
+}
+
+em_actor_t* em_actor_create(em_handle_t handle,
+                            em_callback_t handler,
+                            void* state,
+                            size_t mailbox_capacity)
+{
+    if (handle == NULL || handler == NULL) {
+        return NULL;
+    }
+    
+    em_actor_t* actor = (em_actor_t*)calloc(1, sizeof(em_actor_t));
+    if (actor == NULL) {
+        return NULL;
+    }
+    
+    actor->mailbox = executor_new(mailbox_capacity);
+    if (actor->mailbox == NULL) {
+        free(actor);
+        return NULL;
+    }
+    
+    actor->handle = handle;
+    actor->handler = handler;
+    actor->state = state;
+    atomic_init(&actor->scheduled, 0);
+    actor->mailbox->notify = actor_notify;
+    actor->mailbox->finalize = actor_finalize;
+    actor->mailbox->context = actor;
+    
+    return actor;
+}
+
+em_error_t em_actor_destroy(em_actor_t* actor)
+{
+    if (actor == NULL) {
+        return EM_ERR_INVALID_PARAM;
+    }
+    
+    em_handle_t handle = actor->handle;
+    em_executor_t* mailbox = actor->mailbox;
+    
+    /* 取消该 Actor 的所有订阅 */
+    lock_manager(handle);
+    for (em_event_id_t id = 0; id < EM_MAX_EVENT_TYPES; id++) {
+        unsubscribe_matching(handle, id, NULL, mailbox, true);
+    }
+    unlock_manager(handle);
+    
+    /* 正在运行或调度中的 Actor 持有引用，内存在其结束后释放 */
+    atomic_store(&mailbox->closed, true);
+    executor_release(mailbox);
+    return EM_OK;
+}
+
+em_error_t em_actor_send(em_actor_t* actor,
+                         em_event_id_t event_id,
+                         em_event_data_t data,
+                         size_t data_size)
+{
+    if (actor == NULL) {
+        return EM_ERR_INVALID_PARAM;
+    }
+    
+    void* data_copy = NULL;
+    if (data != NULL && data_size > 0) {
+        data_copy = payload_alloc(data_size);
+        if (data_copy == NULL) {
+            return EM_ERR_OUT_OF_MEMORY;
+        }
+        memcpy(data_copy, data, data_size);
+    }
+    
+    em_invocation_t inv = {
+        .callback = actor->handler,
+        .event_id = event_id,
+        .data = data_copy ? data_copy : data,
+        .user_data = actor->state,
+        .payload = data_copy
+    };
+    
+    if (!inbox_push(actor->mailbox, &inv)) {
+        if (data_copy != NULL) {
+            payload_release(data_copy);
+        }
+        return EM_ERR_QUEUE_FULL;
+    }
+    
+    actor_schedule(actor);
+    return EM_OK;
+}
+
+em_error_t em_actor_subscribe(em_actor_t* actor,
+                              em_event_id_t event_id,
+                              em_priority_t priority)
+{
+    if (actor == NULL) {
+        return EM_ERR_INVALID_PARAM;
+    }
+    
+    return em_subscribe_on(actor->handle, event_id, actor->handler, actor->state,
+                           priority, actor->mailbox);
+}
+
+em_error_t em_actor_unsubscribe(em_actor_t* actor, em_event_id_t event_id)
+{
+    if (actor == NULL || event_id >= EM_MAX_EVENT_TYPES) {
+        return EM_ERR_INVALID_PARAM;
+    }
+    
+    lock_manager(actor->handle);
+    int removed = unsubscribe_matching(actor->handle, event_id, NULL, actor->mailbox, true);
+    unlock_manager(actor->handle);
+    
+    return removed > 0 ? EM_OK : EM_ERR_NOT_FOUND;
+}
+
+int em_actor_pending(em_actor_t* actor)
+{
+    if (actor == NULL) {
+        return -1;
+    }
+    
+    return em_executor_pending(actor->mailbox);
+}
+
+em_error_t em_actor_pool_start(em_handle_t handle, int num_workers)
+{
+    if (handle == NULL || num_workers <= 0) {
+        return EM_ERR_INVALID_PARAM;
+    }
+    if (handle->lock_type == EM_LOCK_NONE) {
+        return EM_ERR_NOT_SUPPORTED;
+    }
+    
+    pthread_mutex_lock(&handle->pool_mutex);
+    if (handle->pool_running) {
+        pthread_mutex_unlock(&handle->pool_mutex);
+        return EM_ERR_ALREADY_INIT;
+    }
+    
+    handle->pool_workers = (pthread_t*)calloc((size_t)num_workers, sizeof(pthread_t));
+    if (handle->pool_workers == NULL) {
+        pthread_mutex_unlock(&handle->pool_mutex);
+        return EM_ERR_OUT_OF_MEMORY;
+    }
+    handle->pool_running = true;
+    pthread_mutex_unlock(&handle->pool_mutex);
+    
+    int started = 0;
+    for (; started < num_workers; started++) {
+        if (pthread_create(&handle->pool_workers[started], NULL, actor_worker, handle) != 0) {
+            break;
+        }
+    }
+    handle->pool_worker_count = started;
+    
+    if (started == 0) {
+        em_actor_pool_stop(handle);
+        return EM_ERR_OUT_OF_MEMORY;
+    }
+    
+    EM_DEBUG("Actor pool started (%d workers)", started);
+    return EM_OK;
+}
+
+em_error_t em_actor_pool_stop(em_handle_t handle)
+{
+    if (handle == NULL) {
+        return EM_ERR_INVALID_PARAM;
+    }
+    
+    pthread_mutex_lock(&handle->pool_mutex);
+    handle->pool_running = false;
+    pthread_cond_broadcast(&handle->pool_cond);
+    pthread_mutex_unlock(&handle->pool_mutex);
+    
+    for (int i = 0; i < handle->pool_worker_count; i++) {
+        pthread_join(handle->pool_workers[i], NULL);
+    }
+    free(handle->pool_workers);
+    handle->pool_workers = NULL;
+    handle->pool_worker_count = 0;
+    
+    return EM_OK;
+}
+
+/*============================================================================
+ *                              弹性工作线程池
+ *============================================================================*/
+
+static void* queue_worker(void* arg);
+
+/**
+ * @brief 更新活动线程数统计(调用者需持有锁)
+ */
+static void update_worker_stats(em_handle_t handle)
+{
+    handle->stats.workers_active = (uint32_t)handle->workers_active;
+    if (handle->stats.workers_active > handle->stats.workers_peak) {
+        handle->stats.workers_peak = handle->stats.workers_active;
+    }
+}
+
+/**
+ * @brief 积压持续超过阈值时增加一个活动线程(调用者需持有锁)
+ * 
+ * @param now 真实单调时间(持续时间按真实时间计算，即使使用虚拟时钟)
+ */
+static void worker_pool_scale(em_handle_t handle, uint64_t now)
+{
+    const em_worker_pool_config_t* cfg = &handle->worker_config;
+    
+    bool pressure = handle->stats.async_queue_current >= cfg->scale_up_depth ||
+                    oldest_wait_ns(handle, clock_now(handle)) >= (uint64_t)cfg->scale_up_wait_us * 1000;
+    if (!pressure) {
+        handle->pressure_since_ns = 0;
+        return;
+    }
+    if (handle->pressure_since_ns == 0) {
+        handle->pressure_since_ns = now;
+    }
+    if (now - handle->pressure_since_ns < (uint64_t)cfg->scale_up_hold_us * 1000 ||
+        handle->workers_active >= cfg->max_workers) {
+        return;
+    }
+    
+    /* 扩容后重新计时，压力再持续一个周期才继续扩容 */
+    handle->pressure_since_ns = now;
+    
+    if (handle->worker_count > handle->workers_active) {
+        /* 优先唤醒停放的线程 */
+        handle->unpark_tokens++;
+        wake_waiters(handle, &handle->park_q, false);
+    } else if (pthread_create(&handle->workers[handle->worker_count], NULL,
+                              queue_worker, handle) == 0) {
+        handle->worker_count++;
+    } else {
+        EM_DEBUG("Failed to spawn worker thread");
+        return;
+    }
+    handle->workers_active++;
+    update_worker_stats(handle);
+    EM_DEBUG("Worker pool scaled up to %d", handle->workers_active);
+}
+
+/**
+ * @brief 弹性工作线程
+ */
+static void* queue_worker(void* arg)
+{
+    em_handle_t handle = (em_handle_t)arg;
+    em_drain_state_t drain = { 0, false, 0 };
+    uint64_t idle_since = now_ns();
+    bool woke = false;
+    
+    lock_manager(handle);
+    drain.size = handle->batch_policy.min_batch;
+    
+    while (handle->workers_running) {
+        uint64_t now = now_ns();
+        uint64_t park_ns = (uint64_t)handle->worker_config.idle_park_us * 1000;
+        
+        /* 取出中断上下文发布的事件 */
+        isr_drain_locked(handle);
+        
+        if (handle->stats.async_queue_current == 0 && !executors_pending(handle) &&
+            !timer_ready(handle)) {
+            if (woke) {
+                count_wakeup(handle, 0);
+                woke = false;
+            }
+            if (handle->workers_active > handle->worker_config.min_workers &&
+                now - idle_since >= park_ns) {
+                /* 空闲过久：停放，直到扩容时被唤醒 */
+                handle->workers_active--;
+                update_worker_stats(handle);
+                EM_DEBUG("Worker parked, %d active", handle->workers_active);
+                while (handle->workers_running && handle->unpark_tokens == 0) {
+                    wait_locked(handle, &handle->park_q, UINT64_MAX);
+                }
+                if (handle->unpark_tokens > 0) {
+                    handle->unpark_tokens--;
+                }
+                idle_since = now_ns();
+                continue;
+            }
+            
+            /* 刷新暂存超时的暂存区，刷出了事件则直接处理 */
+            if (atomic_load_explicit(&handle->staged_events, memory_order_relaxed) > 0) {
+                unlock_manager(handle);
+                int flushed = stage_flush_stale(handle, false);
+                lock_manager(handle);
+                if (flushed > 0) {
+                    continue;
+                }
+            }
+            if (wait_manager_timed(handle, isr_wait_ns(handle, stage_wait_ns(handle, timer_wait_ns(handle, park_ns))))) {
+                atomic_fetch_add_explicit(&handle->wake.timeouts, 1, memory_order_relaxed);
+            }
+            woke = true;
+            continue;
+        }
+        
+        worker_pool_scale(handle, now);
+        unlock_manager(handle);
+        
+        int drained = drain_batch(handle, &drain);
+        drained += run_attached_executors(handle);
+        if (woke) {
+            count_wakeup(handle, drained);
+            woke = false;
+        }
+        idle_since = now_ns();
+        
+        lock_manager(handle);
+    }
+    
+    unlock_manager(handle);
+    return NULL;
+}
+
+em_error_t em_worker_pool_start(em_handle_t handle, const em_worker_pool_config_t* config)
+{
+    if (handle == NULL) {
+        return EM_ERR_INVALID_PARAM;
+    }
+    if (handle->lock_type == EM_LOCK_NONE) {
+        return EM_ERR_NOT_SUPPORTED;
+    }
+    
+    em_worker_pool_config_t cfg;
+    if (config != NULL) {
+        cfg = *config;
+    } else {
+        memset(&cfg, 0, sizeof(cfg));
+    }
+    if (cfg.max_workers <= 0 || cfg.max_workers > EM_MAX_WORKERS) {
+        cfg.max_workers = EM_MAX_WORKERS;
+    }
+    if (cfg.min_workers <= 0) {
+        cfg.min_workers = 1;
+    }
+    if (cfg.min_workers > cfg.max_workers) {
+        cfg.min_workers = cfg.max_workers;
+    }
+    if (cfg.scale_up_depth == 0) {
+        cfg.scale_up_depth = EM_ASYNC_QUEUE_SIZE / 2;
+    }
+    if (cfg.scale_up_wait_us == 0) {
+        cfg.scale_up_wait_us = 1000;
+    }
+    if (cfg.scale_up_hold_us == 0) {
+        cfg.scale_up_hold_us = 10000;
+    }
+    if (cfg.idle_park_us == 0) {
+        cfg.idle_park_us = EM_WORKER_IDLE_PARK_US;
+    }
+    
+    lock_manager(handle);
+    
+    if (handle->workers_running) {
+        unlock_manager(handle);
+        return EM_ERR_ALREADY_INIT;
+    }
+    if (!waitq_init(&handle->park_q)) {
+        unlock_manager(handle);
+        return EM_ERR_MUTEX_FAILED;
+    }
+    
+    handle->worker_config = cfg;
+    handle->worker_count = 0;
+    handle->workers_active = 0;
+    handle->unpark_tokens = 0;
+    handle->pressure_since_ns = 0;
+    handle->workers_running = true;
+    
+    for (int i = 0; i < cfg.min_workers; i++) {
+        if (pthread_create(&handle->workers[i], NULL, queue_worker, handle) != 0) {
+            EM_DEBUG("Failed to create worker thread %d", i);
+            break;
+        }
+        handle->worker_count++;
+        handle->workers_active++;
+    }
+    update_worker_stats(handle);
+    
+    bool ok = handle->worker_count == cfg.min_workers;
+    unlock_manager(handle);
+    
+    if (!ok) {
+        em_worker_pool_stop(handle);
+        return EM_ERR_OUT_OF_MEMORY;
+    }
+    
+    EM_DEBUG("Worker pool started with %d workers (max %d)", cfg.min_workers, cfg.max_workers);
+    return EM_OK;
+}
+
+em_error_t em_worker_pool_stop(em_handle_t handle)
+{
+    if (handle == NULL) {
+        return EM_ERR_INVALID_PARAM;
+    }
+    
+    lock_manager(handle);
+    if (!handle->workers_running) {
+        unlock_manager(handle);
+        return EM_OK;
+    }
+    handle->workers_running = false;
+    broadcast_manager(handle);
+    wake_waiters(handle, &handle->park_q, true);
+    int count = handle->worker_count;
+    unlock_manager(handle);
+    
+    /* 扩容只发生在持锁的工作线程中，停止后 worker_count 不再变化 */
+    for (int i = 0; i < count; i++) {
+        pthread_join(handle->workers[i], NULL);
+    }
+    
+    lock_manager(handle);
+    waitq_destroy(&handle->park_q);
+    handle->worker_count = 0;
+    handle->workers_active = 0;
+    update_worker_stats(handle);
+    unlock_manager(handle);
+    
+    return EM_OK;
+}
+
+#endif /* EM_ENABLE_THREADING */
+
+em_error_t em_set_batch_policy(em_handle_t handle, const em_batch_policy_t* policy)
+{
+    if (handle == NULL) {
+        return EM_ERR_INVALID_PARAM;
+    }
+    
+    em_batch_policy_t normalized;
+    if (policy != NULL) {
+        normalized = *policy;
+    } else {
+        memset(&normalized, 0, sizeof(normalized));
+    }
+    normalize_batch_policy(&normalized);
+    
+    lock_manager(handle);
+    handle->batch_policy = normalized;
+    unlock_manager(handle);
+    
+    return EM_OK;
+}
+
+/*============================================================================
+ *                              负载控制
+ *============================================================================*/
+
+em_error_t em_set_load_shedding(em_handle_t handle, const em_shed_config_t* config)
+{
+    if (handle == NULL) {
+        return EM_ERR_INVALID_PARAM;
+    }
+    
+    lock_manager(handle);
+    
+    if (config == NULL || !config->enabled) {
+        memset(&handle->shed, 0, sizeof(handle->shed));
+    } else {
+        handle->shed.config = *config;
+        if (handle->shed.config.target_us == 0) {
+            handle->shed.config.target_us = EM_SHED_DEFAULT_TARGET_US;
+        }
+        if (handle->shed.config.interval_us == 0) {
+            handle->shed.config.interval_us = EM_SHED_DEFAULT_INTERVAL_US;
+        }
+        handle->shed.level = 0;
+        handle->shed.interval_start_ns = clock_now(handle);
+        handle->shed.min_high_ns = UINT64_MAX;
+        handle->shed.min_any_ns = UINT64_MAX;
+    }
+    handle->stats.shed_level = (uint32_t)handle->shed.level;
+    
+    unlock_manager(handle);
+    return EM_OK;
+}
+
+/*============================================================================
+ *                              热点事件
+ *============================================================================*/
+
+/** sketch 第 row 行中事件ID对应的列 */
+static inline uint32_t hot_slot(em_event_id_t event_id, int row)
+{
+    return mix32((uint32_t)event_id * 0x9E3779B1u + (uint32_t)row * 0x85EBCA77u) %
+           EM_TOP_SKETCH_WIDTH;
+}
+
+/**
+ * @brief 用最新估计值更新热点表(无锁)
+ * 
+ * @param key 本表的排序值(次数或字节数)
+ */
+static void hot_offer(em_hot_entry_t* table, em_event_id_t event_id,
+                      uint64_t count, uint64_t bytes, uint64_t key, bool by_bytes)
+{
+    unsigned want = (unsigned)event_id + 1;
+    int victim = -1;
+    unsigned victim_id = 0;
+    uint64_t victim_key = UINT64_MAX;
+    
+    for (int i = 0; i < EM_TOP_EVENTS_K; i++) {
+        unsigned id = atomic_load_explicit(&table[i].id, memory_order_relaxed);
+        if (id == want) {
+            atomic_store_explicit(&table[i].count, count, memory_order_relaxed);
+            atomic_store_explicit(&table[i].bytes, bytes, memory_order_relaxed);
+            return;
+        }
+        uint64_t k = 0;
+        if (id != 0) {
+            k = atomic_load_explicit(by_bytes ? &table[i].bytes : &table[i].count,
+                                     memory_order_relaxed);
+        }
+        if (k < victim_key) {
+            victim = i;
+            victim_id = id;
+            victim_key = k;
+        }
+    }
+    
+    if (key > victim_key &&
+        atomic_compare_exchange_strong(&table[victim].id, &victim_id, want)) {
+        atomic_store_explicit(&table[victim].count, count, memory_order_relaxed);
+        atomic_store_explicit(&table[victim].bytes, bytes, memory_order_relaxed);
+    }
+}
+
+/**
+ * @brief 发布时记录一次事件(未开启时只有一次原子读取)
+ */
+static void hot_record(em_handle_t handle, em_event_id_t event_id, size_t size)
+{
+    em_hot_tracker_t* hot = atomic_load_explicit(&handle->hot, memory_order_acquire);
+    if (hot == NULL || !atomic_load_explicit(&hot->enabled, memory_order_relaxed)) {
+        return;
+    }
+    
+    /* 各行计数都可能被其他ID共用，取最小值作为估计 */
+    uint64_t count = UINT64_MAX;
+    uint64_t bytes = UINT64_MAX;
+    for (int row = 0; row < EM_TOP_SKETCH_DEPTH; row++) {
+        uint32_t slot = hot_slot(event_id, row);
+        uint64_t c = atomic_fetch_add_explicit(&hot->counts[row][slot], 1, memory_order_relaxed) + 1;
+        uint64_t b = atomic_fetch_add_explicit(&hot->bytes[row][slot], (uint64_t)size,
+                                               memory_order_relaxed) + size;
+        if (c < count) {
+            count = c;
+        }
+        if (b < bytes) {
+            bytes = b;
+        }
+    }
+    
+    hot_offer(hot->top[EM_TOP_BY_COUNT], event_id, count, bytes, count, false);
+    if (size > 0) {
+        hot_offer(hot->top[EM_TOP_BY_BYTES], event_id, count, bytes, bytes, true);
+    }
+}
+
+em_error_t em_set_top_events(em_handle_t handle, bool enabled)
+{
+    if (handle == NULL) {
+        return EM_ERR_INVALID_PARAM;
+    }
+    
+    lock_manager(handle);
+    em_hot_tracker_t* hot = atomic_load(&handle->hot);
+    if (!enabled) {
+        if (hot != NULL) {
+            atomic_store(&hot->enabled, false);
+        }
+        unlock_manager(handle);
+        return EM_OK;
+    }
+    
+    if (hot == NULL) {
+        hot = (em_hot_tracker_t*)calloc(1, sizeof(*hot));
+        if (hot == NULL) {
+            unlock_manager(handle);
+            return EM_ERR_OUT_OF_MEMORY;
+        }
+        atomic_store_explicit(&handle->hot, hot, memory_order_release);
+    } else {
+        /* 重新开启时清零(并发的发布可能留下少量旧计数) */
+        atomic_store(&hot->enabled, false);
+        for (int row = 0; row < EM_TOP_SKETCH_DEPTH; row++) {
+            for (int i = 0; i < EM_TOP_SKETCH_WIDTH; i++) {
+                atomic_store_explicit(&hot->counts[row][i], 0, memory_order_relaxed);
+                atomic_store_explicit(&hot->bytes[row][i], 0, memory_order_relaxed);
+            }
+        }
+        for (int t = 0; t < 2; t++) {
+            for (int i = 0; i < EM_TOP_EVENTS_K; i++) {
+                atomic_store_explicit(&hot->top[t][i].id, 0, memory_order_relaxed);
+            }
+        }
+    }
+    atomic_store(&hot->enabled, true);
+    unlock_manager(handle);
+    
+    return EM_OK;
+}
+
+int em_get_top_events(em_handle_t handle, int k, em_top_order_t order, em_top_event_t* out)
+{
+    if (handle == NULL || k < 0 || (k > 0 && out == NULL) || (unsigned)order > EM_TOP_BY_BYTES) {
+        return EM_ERR_INVALID_PARAM;
+    }
+    
+    em_hot_tracker_t* hot = atomic_load_explicit(&handle->hot, memory_order_acquire);
+    if (hot == NULL) {
+        return 0;
+    }
+    
+    /* 复制表项并去重 */
+    em_top_event_t items[EM_TOP_EVENTS_K];
+    int n = 0;
+    for (int i = 0; i < EM_TOP_EVENTS_K; i++) {
+        unsigned id = atomic_load_explicit(&hot->top[order][i].id, memory_order_relaxed);
+        if (id == 0) {
+            continue;
+        }
+        em_top_event_t item = {
+            .id = (em_event_id_t)(id - 1),
+            .count = atomic_load_explicit(&hot->top[order][i].count, memory_order_relaxed),
+            .bytes = atomic_load_explicit(&hot->top[order][i].bytes, memory_order_relaxed)
+        };
+        int j = 0;
+        while (j < n && items[j].id != item.id) {
+            j++;
+        }
+        if (j == n) {
+            items[n++] = item;
+        } else if (item.count > items[j].count) {
+            items[j] = item;
+        }
+    }
+    
+    /* 按排序依据从大到小插入排序 */
+    for (int i = 1; i < n; i++) {
+        em_top_event_t item = items[i];
+        uint64_t key = order == EM_TOP_BY_BYTES ? item.bytes : item.count;
+        int j = i - 1;
+        while (j >= 0 && (order == EM_TOP_BY_BYTES ? items[j].bytes : items[j].count) < key) {
+            items[j + 1] = items[j];
+            j--;
+        }
+        items[j + 1] = item;
+    }
+    
+    if (n > k) {
+        n = k;
+    }
+    if (n > 0) {
+        memcpy(out, items, (size_t)n * sizeof(em_top_event_t));
+    }
+    return n;
+}
+
+/*============================================================================
+ *                              中断上下文发布
+ *============================================================================*/
+
+/**
+ * @brief 创建环形缓冲区，槽数向上取2的幂
+ */
+static em_isr_ring_t* isr_ring_create(uint32_t slots)
+{
+    uint32_t n = 2;
+    while (n < slots) {
+        n <<= 1;
+    }
+    
+    em_isr_ring_t* ring = (em_isr_ring_t*)calloc(1, sizeof(em_isr_ring_t) + n * sizeof(em_isr_slot_t));
+    if (ring == NULL) {
+        return NULL;
+    }
+    
+    ring->mask = n - 1;
+    for (uint32_t i = 0; i < n; i++) {
+        atomic_init(&ring->slots[i].seq, i);
+    }
+    atomic_init(&ring->tail, 0);
+    return ring;
+}
+
+/**
+ * @brief 把环形缓冲区中已写完的事件放入普通队列(调用者需持有锁)
+ * 
+ * 在事件循环、工作线程和 em_process_all 中调用，复制数据、负载控制和配额都在这里按
+ * em_publish_async 的规则处理；转入失败的事件计入 isr_dropped。转入了事件时唤醒消费者。
+ * 
+ * @return int 转入队列的事件数
+ */
+static int isr_drain_locked(em_handle_t handle)
+{
+    em_isr_ring_t* ring = handle->isr_ring;
+    if (ring == NULL) {
+        return 0;
+    }
+    
+    int moved = 0;
+    bool shed_checked = false;
+    uint64_t now = clock_now(handle);
+    for (;;) {
+        em_isr_slot_t* slot = &ring->slots[ring->head & ring->mask];
+        uint32_t seq = atomic_load_explicit(&slot->seq, memory_order_acquire);
+        if (seq != ring->head + 1) {
+            break;
+        }
+        
+        em_priority_t priority = (em_priority_t)slot->priority;
+        void* data_copy = NULL;
+        em_error_t result = EM_OK;
+        if (slot->size > 0) {
+            data_copy = payload_alloc_for(handle, slot->size, priority);
+            if (data_copy != NULL) {
+                memcpy(data_copy, slot->data, slot->size);
+            } else {
+                result = EM_ERR_OUT_OF_MEMORY;
+            }
+        }
+        em_event_t event = {
+            .id = slot->id,
+            .data = data_copy ? data_copy : slot->ptr,
+            .data_size = slot->size,
+            .priority = priority,
+            .mode = EM_MODE_ASYNC
+        };
+        
+        /* 槽位内容已取出，交还给生产者 */
+        atomic_store_explicit(&slot->seq, ring->head + ring->mask + 1, memory_order_release);
+        ring->head++;
+        
+        hot_record(handle, event.id, event.data_size);
+        if (!shed_checked && handle->shed.config.enabled) {
+            shed_update(handle, now);
+            shed_checked = true;
+        }
+        if (result == EM_OK && handle->shed.level > 0 &&
+            (int)priority >= EM_PRIORITY_COUNT - handle->shed.level) {
+            handle->stats.events_shed[priority]++;
+            result = EM_ERR_OVERLOADED;
+        }
+        if (result == EM_OK) {
+            result = enqueue_locked(handle, &event, data_copy, now, -1);
+        }
+        if (result == EM_OK) {
+            moved++;
+        } else {
+            if (data_copy != NULL) {
+                payload_release(data_copy);
+            }
+            atomic_fetch_add_explicit(&handle->isr_dropped, 1, memory_order_relaxed);
+        }
+    }
+    
+    if (moved > 0) {
+        signal_manager(handle);
+    }
+    return moved;
+}
+
+/** 加锁后把环形缓冲区中的事件放入普通队列 */
+static int isr_drain(em_handle_t handle)
+{
+    if (handle->isr_ring == NULL) {
+        return 0;
+    }
+    
+    lock_manager(handle);
+    int moved = isr_drain_locked(handle);
+    unlock_manager(handle);
+    return moved;
+}
+
+#if EM_ENABLE_THREADING
+/**
+ * @brief 限制等待时间
+ * 
+ * 中断上下文无法唤醒条件变量，启用了环形缓冲区时最多等待 EM_ISR_POLL_US
+ * (epoll 事件循环由 eventfd 唤醒，不需要限制)
+ */
+static uint64_t isr_wait_ns(em_handle_t handle, uint64_t max_ns)
+{
+    uint64_t poll_ns = (uint64_t)EM_ISR_POLL_US * 1000;
+    if (handle->isr_ring != NULL && max_ns > poll_ns) {
+        return poll_ns;
+    }
+    return max_ns;
+}
+#endif
+
+/*============================================================================
+ *                              变化发布
+ *============================================================================*/
+
+/** 数据的 64 位哈希(size 为0时对指针值本身求哈希)，结果非0 */
+static uint64_t change_hash(const void* data, size_t size)
+{
+    uintptr_t pointer = (uintptr_t)data;
+    const uint8_t* p = (const uint8_t*)data;
+    if (size == 0 || data == NULL) {
+        p = (const uint8_t*)&pointer;
+        size = sizeof(pointer);
+    }
+    
+    uint64_t h = 0xcbf29ce484222325ull ^ (uint64_t)size;
+    while (size >= sizeof(uint64_t)) {
+        uint64_t word;
+        memcpy(&word, p, sizeof(word));
+        h = (h ^ word) * 0x100000001b3ull;
+        h ^= h >> 29;
+        p += sizeof(word);
+        size -= sizeof(word);
+    }
+    while (size > 0) {
+        h = (h ^ *p++) * 0x100000001b3ull;
+        size--;
+    }
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdull;
+    h ^= h >> 33;
+    return h != 0 ? h : 1;
+}
+
+/**
+ * @brief 检查数据是否与上次成功发布的相同(无锁)
+ * 
+ * @param hash 输出本次数据的哈希，未开启时为0
+ * @return true 表示未变化，本次发布应被抑制
+ */
+static bool change_suppress(em_handle_t handle, em_event_id_t event_id, const void* data,
+                            size_t size, uint64_t* hash)
+{
+    *hash = 0;
+    if (!atomic_load_explicit(&handle->change_only[event_id], memory_order_relaxed)) {
+        return false;
+    }
+    
+    *hash = change_hash(data, size);
+    if (atomic_load_explicit(&handle->change_last[event_id], memory_order_relaxed) != *hash) {
+        return false;
+    }
+    atomic_fetch_add_explicit(&handle->events_suppressed, 1, memory_order_relaxed);
+    return true;
+}
+
+/** 发布成功后记录数据哈希(hash 为0表示未开启) */
+static inline void change_commit(em_handle_t handle, em_event_id_t event_id, uint64_t hash)
+{
+    if (hash != 0) {
+        atomic_store_explicit(&handle->change_last[event_id], hash, memory_order_relaxed);
+    }
+}
+
+em_error_t em_set_publish_on_change(em_handle_t handle, em_event_id_t event_id,
+                                    bool enabled, size_t sync_size)
+{
+    if (handle == NULL || event_id >= EM_MAX_EVENT_TYPES) {
+        return EM_ERR_INVALID_PARAM;
+    }
+    
+    lock_manager(handle);
+    atomic_store(&handle->change_only[event_id], false);
+    atomic_store(&handle->change_sync_size[event_id], sync_size);
+    atomic_store(&handle->change_last[event_id], 0);
+    atomic_store(&handle->change_only[event_id], enabled);
+    unlock_manager(handle);
+    
+    return EM_OK;
+}
+
+/*============================================================================
+ *                              调度策略
+ *============================================================================*/
+
+/** WFQ 权重为1时的步长 */
+#define SCHED_STRIDE_BASE   (1u << 20)
+
+/**
+ * @brief 严格优先级：按 HIGH -> NORMAL -> LOW 依次取完(调用者需持有锁)
+ * 
+ * 注意: 此处依赖于优先级枚举值按升序排列:
+ * EM_PRIORITY_HIGH=0, EM_PRIORITY_NORMAL=1, EM_PRIORITY_LOW=2
+ */
+static int sched_strict(em_handle_t handle, em_priority_t* order, int max)
+{
+    int n = 0;
+    for (int i = 0; i < EM_PRIORITY_COUNT && n < max; i++) {
+        for (int j = 0; j < handle->async_queues[i].count && n < max; j++) {
+            order[n++] = (em_priority_t)i;
+        }
+    }
+    return n;
+}
+
+/**
+ * @brief 决定接下来最多 max 个事件的出队优先级(调用者需持有锁)
+ * 
+ * 丢弃自定义调度器输出中超出队列长度的项，没有有效项时按严格优先级出队。
+ */
+static int sched_select(em_handle_t handle, em_priority_t* order, int max)
+{
+    const em_scheduler_ops_t* ops = handle->sched_ops;
+    if (ops != NULL && handle->stats.async_queue_current > 0) {
+        em_sched_view_t view = { handle, clock_now(handle) };
+        int n = ops->dequeue_batch(handle->sched_ctx, &view, order, max);
+        
+        uint32_t left[EM_PRIORITY_COUNT];
+        for (int i = 0; i < EM_PRIORITY_COUNT; i++) {
+            left[i] = (uint32_t)handle->async_queues[i].count;
+        }
+        int valid = 0;
+        for (int k = 0; k < n && k < max; k++) {
+            if ((unsigned)order[k] < EM_PRIORITY_COUNT && left[order[k]] > 0) {
+                left[order[k]]--;
+                order[valid++] = order[k];
+            }
+        }
+        if (valid > 0) {
+            return valid;
+        }
+    }
+    return sched_strict(handle, order, max);
+}
+
+/** 合并排序键：入队时间加偏移，没有更多事件返回 UINT64_MAX */
+static uint64_t sched_merge_key(const em_sched_view_t* view, const em_sched_builtin_t* b,
+                                int priority, uint32_t index)
+{
+    uint64_t enqueue_ns;
+    if (em_sched_peek(view, (em_priority_t)priority, index, &enqueue_ns) == NULL) {
+        return UINT64_MAX;
+    }
+    return enqueue_ns + b->offset_ns[priority];
+}
+
+/**
+ * @brief FIFO/AGING/EDF：按排序键合并各优先级队列，键相同时高优先级在前
+ */
+static int sched_merge_dequeue(void* ctx, const em_sched_view_t* view,
+                               em_priority_t* order, int max)
+{
+    const em_sched_builtin_t* b = (const em_sched_builtin_t*)ctx;
+    uint32_t cursor[EM_PRIORITY_COUNT] = { 0 };
+    uint64_t key[EM_PRIORITY_COUNT];
+    for (int i = 0; i < EM_PRIORITY_COUNT; i++) {
+        key[i] = sched_merge_key(view, b, i, 0);
+    }
+    
+    int n = 0;
+    while (n < max) {
+        int best = 0;
+        for (int i = 1; i < EM_PRIORITY_COUNT; i++) {
+            if (key[i] < key[best]) {
+                best = i;
+            }
+        }
+        if (key[best] == UINT64_MAX) {
+            break;
+        }
+        order[n++] = (em_priority_t)best;
+        key[best] = sched_merge_key(view, b, best, ++cursor[best]);
+    }
+    return n;
+}
+
+/**
+ * @brief WFQ：重新变为活跃的优先级从当前虚拟时间开始，不能攒下空闲期间的份额
+ */
+static void sched_wfq_enqueue(void* ctx, const em_sched_view_t* view, em_priority_t priority)
+{
+    em_sched_builtin_t* b = (em_sched_builtin_t*)ctx;
+    if (em_sched_size(view, priority) == 1 && b->pass[priority] < b->vtime) {
+        b->pass[priority] = b->vtime;
+    }
+}
+
+/**
+ * @brief WFQ：每次选虚拟时间最小的非空优先级，出队后前进一个步长
+ */
+static int sched_wfq_dequeue(void* ctx, const em_sched_view_t* view,
+                             em_priority_t* order, int max)
+{
+    em_sched_builtin_t* b = (em_sched_builtin_t*)ctx;
+    uint32_t left[EM_PRIORITY_COUNT];
+    for (int i = 0; i < EM_PRIORITY_COUNT; i++) {
+        left[i] = em_sched_size(view, (em_priority_t)i);
+    }
+    
+    int n = 0;
+    while (n < max) {
+        int best = -1;
+        for (int i = 0; i < EM_PRIORITY_COUNT; i++) {
+            if (left[i] > 0 && (best < 0 || b->pass[i] < b->pass[best])) {
+                best = i;
+            }
+        }
+        if (best < 0) {
+            break;
+        }
+        order[n++] = (em_priority_t)best;
+        left[best]--;
+        b->vtime = b->pass[best];
+        b->pass[best] += b->stride[best];
+    }
+    return n;
+}
+
+static const em_scheduler_ops_t sched_merge_ops = { "merge", NULL, sched_merge_dequeue };
+static const em_scheduler_ops_t sched_wfq_ops = { "wfq", sched_wfq_enqueue, sched_wfq_dequeue };
+
+em_error_t em_set_scheduler(em_handle_t handle, em_sched_policy_t policy,
+                            const em_sched_config_t* config)
+{
+    if (handle == NULL || (unsigned)policy > EM_SCHED_EDF) {
+        return EM_ERR_INVALID_PARAM;
+    }
+    
+    static const uint32_t default_weights[EM_PRIORITY_COUNT] = { 4, 2, 1 };
+    static const uint32_t default_deadline_us[EM_PRIORITY_COUNT] = { 1000, 10000, 100000 };
+    em_sched_config_t cfg;
+    if (config != NULL) {
+        cfg = *config;
+    } else {
+        memset(&cfg, 0, sizeof(cfg));
+    }
+    
+    em_sched_builtin_t b;
+    memset(&b, 0, sizeof(b));
+    for (int i = 0; i < EM_PRIORITY_COUNT; i++) {
+        uint32_t weight = cfg.weights[i] != 0 ? cfg.weights[i] : default_weights[i];
+        uint32_t deadline = cfg.deadline_us[i] != 0 ? cfg.deadline_us[i] : default_deadline_us[i];
+        uint32_t step = cfg.aging_step_us != 0 ? cfg.aging_step_us : EM_SCHED_AGING_STEP_US;
+        if (policy == EM_SCHED_AGING) {
+            b.offset_ns[i] = (uint64_t)i * step * 1000;
+        } else if (policy == EM_SCHED_EDF) {
+            b.offset_ns[i] = (uint64_t)deadline * 1000;
+        }
+        b.stride[i] = SCHED_STRIDE_BASE / weight;
+        if (b.stride[i] == 0) {
+            b.stride[i] = 1;
+        }
+    }
+    
+    lock_manager(handle);
+    handle->sched_builtin = b;
+    if (policy == EM_SCHED_STRICT) {
+        handle->sched_ops = NULL;
+    } else {
+        handle->sched_ops = policy == EM_SCHED_WFQ ? &sched_wfq_ops : &sched_merge_ops;
+    }
+    handle->sched_ctx = &handle->sched_builtin;
+    unlock_manager(handle);
+    
+    return EM_OK;
+}
+
+em_error_t em_set_scheduler_ops(em_handle_t handle, const em_scheduler_ops_t* ops, void* ctx)
+{
+    if (handle == NULL || (ops != NULL && ops->dequeue_batch == NULL)) {
+        return EM_ERR_INVALID_PARAM;
+    }
+    
+    lock_manager(handle);
+    handle->sched_ops = ops;
+    handle->sched_ctx = ctx;
+    unlock_manager(handle);
+    
+    return EM_OK;
+}
+
+uint32_t em_sched_size(const em_sched_view_t* view, em_priority_t priority)
+{
+    if (view == NULL || (unsigned)priority >= EM_PRIORITY_COUNT) {
+        return 0;
+    }
+    return (uint32_t)view->handle->async_queues[priority].count;
+}
+
+const em_event_t* em_sched_peek(const em_sched_view_t* view, em_priority_t priority,
+                                uint32_t index, uint64_t* enqueue_ns)
+{
+    if (view == NULL || (unsigned)priority >= EM_PRIORITY_COUNT) {
+        return NULL;
+    }
+    const em_priority_queue_t* queue = &view->handle->async_queues[priority];
+    if (index >= (uint32_t)queue->count) {
+        return NULL;
+    }
+    const em_queue_node_t* node = &queue->nodes[(queue->head + (int)index) % queue->capacity];
+    if (enqueue_ns != NULL) {
+        *enqueue_ns = node->enqueue_ns;
+    }
+    return &node->event;
+}
+
+uint64_t em_sched_now(const em_sched_view_t* view)
+{
+    return view != NULL ? view->now_ns : 0;
+}
+
+/*============================================================================
+ *                              工具函数
+ *============================================================================*/
+
+em_error_t em_get_stats(em_handle_t handle, em_stats_t* stats)
+{
+    if (handle == NULL || stats == NULL) {
+        return EM_ERR_INVALID_PARAM;
+    }
+    
+    lock_manager_shared(handle);
+    memcpy(stats, &handle->stats, sizeof(em_stats_t));
+    unlock_manager(handle);
+    
+    stats->events_processed = atomic_load_explicit(&handle->events_processed, memory_order_relaxed);
+    stats->events_suppressed = atomic_load_explicit(&handle->events_suppressed, memory_order_relaxed);
+    stats->events_inlined = atomic_load_explicit(&handle->events_inlined, memory_order_relaxed);
+    stats->isr_events = atomic_load_explicit(&handle->isr_events, memory_order_relaxed);
+    stats->isr_dropped = atomic_load_explicit(&handle->isr_dropped, memory_order_relaxed);
+    
+    /* 唤醒计数在锁外更新，单独读取 */
+    stats->wake_signals = atomic_load_explicit(&handle->wake.signals, memory_order_relaxed);
+    stats->eventfd_writes = atomic_load_explicit(&handle->wake.eventfd_writes, memory_order_relaxed);
+    stats->eventfd_reads = atomic_load_explicit(&handle->wake.eventfd_reads, memory_order_relaxed);
+    stats->wakeups = atomic_load_explicit(&handle->wake.wakeups, memory_order_relaxed);
+    stats->wakeups_empty = atomic_load_explicit(&handle->wake.wakeups_empty, memory_order_relaxed);
+    stats->wait_timeouts = atomic_load_explicit(&handle->wake.timeouts, memory_order_relaxed);
+    stats->wakeup_events = atomic_load_explicit(&handle->wake.drained, memory_order_relaxed);
+    
+    /* 块池计数在锁外更新，单独读取 */
+    em_payload_pool_t* pool = handle->payload_pool;
+    if (pool != NULL) {
+        stats->payload_pool_free = atomic_load_explicit(&pool->free_count, memory_order_relaxed);
+        stats->payload_pool_oversize = atomic_load_explicit(&pool->oversize, memory_order_relaxed);
+        for (int i = 0; i < EM_PRIORITY_COUNT; i++) {
+            stats->payload_pool_exhausted[i] =
+                atomic_load_explicit(&pool->exhausted[i], memory_order_relaxed);
+        }
+    }
+    
+    return EM_OK;
+}
+
+em_error_t em_reset_stats(em_handle_t handle)
+{
+    if (handle == NULL) {
+        return EM_ERR_INVALID_PARAM;
+    }
+    
+    lock_manager(handle);
+    
+    /* 保留当前订阅者数量和队列状态 */
+    uint32_t subscribers = handle->stats.subscribers_total;
+    uint32_t queue_current = handle->stats.async_queue_current;
+    uint32_t shed_level = handle->stats.shed_level;
+    uint32_t batch_current = handle->stats.drain_batch_current;
+    uint32_t workers_active = handle->stats.workers_active;
+    uint32_t timers_pending = handle->stats.timers_pending;
+    uint32_t capacity[EM_PRIORITY_COUNT];
+    memcpy(capacity, handle->stats.queue_capacity, sizeof(capacity));
+    
+    memset(&handle->stats, 0, sizeof(em_stats_t));
+    
+    handle->stats.subscribers_total = subscribers;
+    handle->stats.async_queue_current = queue_current;
+    handle->stats.shed_level = shed_level;
+    handle->stats.drain_batch_current = batch_current;
+    handle->stats.workers_active = workers_active;
+    handle->stats.timers_pending = timers_pending;
+    memcpy(handle->stats.queue_capacity, capacity, sizeof(capacity));
+    
+    atomic_store(&handle->events_processed, 0);
+    atomic_store(&handle->events_suppressed, 0);
+    atomic_store(&handle->events_inlined, 0);
+    atomic_store(&handle->isr_events, 0);
+    atomic_store(&handle->isr_dropped, 0);
+    atomic_store(&handle->wake.signals, 0);
+    atomic_store(&handle->wake.eventfd_writes, 0);
+    atomic_store(&handle->wake.eventfd_reads, 0);
+    atomic_store(&handle->wake.wakeups, 0);
+    atomic_store(&handle->wake.wakeups_empty, 0);
+    atomic_store(&handle->wake.timeouts, 0);
+    atomic_store(&handle->wake.drained, 0);
+    
+    if (handle->payload_pool != NULL) {
+        atomic_store(&handle->payload_pool->oversize, 0);
+        for (int i = 0; i < EM_PRIORITY_COUNT; i++) {
+            atomic_store(&handle->payload_pool->exhausted[i], 0);
+        }
+    }
+    
+    unlock_manager(handle);
+    
+    return EM_OK;
+}
+
+int em_get_subscriber_count(em_handle_t handle, em_event_id_t event_id)
+{
+    if (handle == NULL || event_id >= EM_MAX_EVENT_TYPES) {
+        return -1;
+    }
+    
+    lock_manager_shared(handle);
+    int count = handle->event_subscribers[event_id].count + handle->group_members[event_id];
+    unlock_manager(handle);
+    
+    return count;
+}
+
+bool em_has_subscribers(em_handle_t handle, em_event_id_t event_id)
+{
+    return em_get_subscriber_count(handle, event_id) > 0;
+}
+
+int em_get_queue_size(em_handle_t handle)
+{
+    if (handle == NULL) {
+        return -1;
+    }
+    
+    lock_manager(handle);
+    
+    int total = 0;
+    for (int i = 0; i < EM_PRIORITY_COUNT; i++) {
+        total += handle->async_queues[i].count;
+    }
+    
+    unlock_manager(handle);
+    return total;
+}
+
+em_error_t em_clear_queue(em_handle_t handle)
+{
+    if (handle == NULL) {
+        return EM_ERR_INVALID_PARAM;
+    }
+    
+    lock_manager(handle);
+    
+    for (int i = 0; i < EM_PRIORITY_COUNT; i++) {
+        em_priority_queue_t* queue = &handle->async_queues[i];
+        
+        /* 释放所有数据副本 */
+        for (int j = 0; j < queue->capacity; j++) {
+            if (queue->nodes[j].data_copy != NULL) {
+                payload_release(queue->nodes[j].data_copy);
+                queue->nodes[j].data_copy = NULL;
+            }
+            queue->nodes[j].used = false;
+        }
+        
+        queue->removed += (uint64_t)queue->count;
+        queue->head = 0;
+        queue->tail = 0;
+        queue->count = 0;
+    }
+    
+    handle->stats.async_queue_current = 0;
+#if EM_ENABLE_THREADING
+    if (atomic_load(&handle->flush_waiters) > 0) {
+        wake_waiters(handle, &handle->flush_q, true);
+    }
+#endif
+    
+    /* 清空后释放所有生产者占用的槽位 */
+    for (int p = 0; p < EM_PRIORITY_COUNT; p++) {
+        handle->shared_used[p] = 0;
+        for (int i = 0; i < EM_MAX_PRODUCERS; i++) {
+            atomic_store(&handle->producers[i].queued[p], 0);
+        }
+    }
+    
+    /* 取消未到期的延时事件 */
+    for (int i = 0; i < handle->timer_count; i++) {
+        if (handle->timers[i].data_copy != NULL) {
+            payload_release(handle->timers[i].data_copy);
+        }
+    }
+    handle->timer_count = 0;
+    handle->stats.timers_pending = 0;
+    
+    unlock_manager(handle);
+    
+    EM_DEBUG("Async queue cleared");
+    return EM_OK;
+}
+
+em_error_t em_resize_queue(em_handle_t handle, em_priority_t priority, size_t capacity)
+{
+    if (handle == NULL || priority >= EM_PRIORITY_COUNT ||
+        capacity == 0 || capacity > EM_MAX_QUEUE_CAPACITY) {
+        return EM_ERR_INVALID_PARAM;
+    }
+    
+    lock_manager(handle);
+    em_error_t result = resize_queue(handle, priority, (int)capacity);
+    unlock_manager(handle);
+    
+    return result;
+}
+
+em_error_t em_set_queue_autogrow(em_handle_t handle, const em_queue_autogrow_t* config)
+{
+    if (handle == NULL) {
+        return EM_ERR_INVALID_PARAM;
+    }
+    
+    em_queue_autogrow_t cfg;
+    if (config != NULL) {
+        cfg = *config;
+    } else {
+        memset(&cfg, 0, sizeof(cfg));
+    }
+    if (cfg.high_watermark_pct == 0 || cfg.high_watermark_pct > 100) {
+        cfg.high_watermark_pct = 75;
+    }
+    if (cfg.max_capacity == 0 || cfg.max_capacity > EM_MAX_QUEUE_CAPACITY) {
+        cfg.max_capacity = EM_MAX_QUEUE_CAPACITY;
+    }
+    
+    lock_manager(handle);
+    handle->autogrow = cfg;
+    unlock_manager(handle);
+    
+    return EM_OK;
+}
+
+int em_producer_register(em_handle_t handle, const em_producer_config_t* config)
+{
+    if (handle == NULL || config == NULL) {
+        return EM_ERR_INVALID_PARAM;
+    }
+    
+    lock_manager(handle);
+    
+    /* 预留之和不能超过当前容量 */
+    for (int p = 0; p < EM_PRIORITY_COUNT; p++) {
+        if (config->limit[p] > 0 && config->reserved[p] > config->limit[p]) {
+            unlock_manager(handle);
+            return EM_ERR_INVALID_PARAM;
+        }
+        if (handle->reserved_total[p] + handle->shared_used[p] + config->reserved[p] >
+            (uint32_t)handle->async_queues[p].capacity) {
+            unlock_manager(handle);
+            return EM_ERR_QUEUE_FULL;
+        }
+    }
+    
+    /* 注销后仍有事件在队列中的槽位暂不复用 */
+    int id = -1;
+    for (int i = 0; i < EM_MAX_PRODUCERS; i++) {
+        em_producer_slot_t* slot = &handle->producers[i];
+        bool drained = true;
+        for (int p = 0; p < EM_PRIORITY_COUNT; p++) {
+            drained = drained && atomic_load(&slot->queued[p]) == 0;
+        }
+        if (!slot->active && drained) {
+            id = i;
+            break;
+        }
+    }
+    if (id < 0) {
+        unlock_manager(handle);
+        return EM_ERR_MAX_SUBSCRIBERS;
+    }
+    
+    em_producer_slot_t* slot = &handle->producers[id];
+    slot->active = true;
+    atomic_store(&slot->published, 0);
+    for (int p = 0; p < EM_PRIORITY_COUNT; p++) {
+        slot->reserved[p] = config->reserved[p];
+        slot->limit[p] = config->limit[p];
+        atomic_store(&slot->rejected[p], 0);
+        handle->reserved_total[p] += config->reserved[p];
+    }
+    
+    unlock_manager(handle);
+    
+    EM_DEBUG("Producer %d registered", id);
+    return id;
+}
+
+em_error_t em_producer_unregister(em_handle_t handle, int producer)
+{
+    if (handle == NULL || producer < 0 || producer >= EM_MAX_PRODUCERS) {
+        return EM_ERR_INVALID_PARAM;
+    }
+    
+    lock_manager(handle);
+    
+    em_producer_slot_t* slot = &handle->producers[producer];
+    if (!slot->active) {
+        unlock_manager(handle);
+        return EM_ERR_NOT_FOUND;
+    }
+    
+    /* 
+     * 归还预留：仍在队列中的事件改为占用共享槽位。
+     * 预留清零后，这些事件出队时都会归还共享槽位。
+     */
+    for (int p = 0; p < EM_PRIORITY_COUNT; p++) {
+        uint32_t queued = atomic_load(&slot->queued[p]);
+        handle->shared_used[p] += queued < slot->reserved[p] ? queued : slot->reserved[p];
+        handle->reserved_total[p] -= slot->reserved[p];
+        slot->reserved[p] = 0;
+        slot->limit[p] = 0;
+    }
+    slot->active = false;
+    
+    unlock_manager(handle);
+    
+    if (bound_producer.handle == handle && bound_producer.id == producer) {
+        bound_producer.handle = NULL;
+        bound_producer.id = -1;
+    }
+    return EM_OK;
+}
+
+em_error_t em_producer_bind(em_handle_t handle, int producer)
+{
+    if (handle == NULL || producer >= EM_MAX_PRODUCERS) {
+        return EM_ERR_INVALID_PARAM;
+    }
+    
+    if (producer < 0) {
+        bound_producer.handle = NULL;
+        bound_producer.id = -1;
+        return EM_OK;
+    }
+    
+    lock_manager(handle);
+    bool active = handle->producers[producer].active;
+    unlock_manager(handle);
+    if (!active) {
+        return EM_ERR_NOT_FOUND;
+    }
+    
+    bound_producer.handle = handle;
+    bound_producer.id = producer;
+    return EM_OK;
+}
+
+em_error_t em_get_producer_stats(em_handle_t handle, int producer, em_producer_stats_t* stats)
+{
+    if (handle == NULL || producer < 0 || producer >= EM_MAX_PRODUCERS || stats == NULL) {
+        return EM_ERR_INVALID_PARAM;
+    }
+    
+    /* 计数为原子变量，无需加锁 */
+    em_producer_slot_t* slot = &handle->producers[producer];
+    stats->published = atomic_load(&slot->published);
+    for (int p = 0; p < EM_PRIORITY_COUNT; p++) {
+        stats->queued[p] = atomic_load(&slot->queued[p]);
+        stats->rejected[p] = atomic_load(&slot->rejected[p]);
+    }
+    return EM_OK;
+}
+
+uint64_t em_time_ns(em_handle_t handle)
+{
+    if (handle == NULL) {
+        return 0;
+    }
+    return clock_now(handle);
+}
+
+em_clock_source_t em_get_clock_source(em_handle_t handle)
+{
+    if (handle == NULL) {
+        return EM_CLOCK_MONOTONIC;
+    }
+    return handle->clock_source;
+}
+
+em_lock_type_t em_get_lock_type(em_handle_t handle)
+{
+#if EM_ENABLE_THREADING
+    if (handle == NULL) {
+        return EM_LOCK_MUTEX;
+    }
+    return handle->lock_type;
+#else
+    (void)handle;
+    return EM_LOCK_NONE;
+#endif
+}
+
+em_error_t em_advance_time(em_handle_t handle, uint64_t delta_ns)
+{
+    if (handle == NULL) {
+        return EM_ERR_INVALID_PARAM;
+    }
+    if (!handle->virtual_time) {
+        return EM_ERR_NOT_SUPPORTED;
+    }
+    
+    lock_manager(handle);
+    
+    uint64_t now = atomic_load(&handle->virtual_now) + delta_ns;
+    atomic_store(&handle->virtual_now, now);
+    if (fire_due_timers(handle, now) > 0) {
+        signal_manager(handle);
+    }
+    
+    unlock_manager(handle);
+    return EM_OK;
+}
+
+em_error_t em_set_trace_hook(em_handle_t handle, em_trace_hook_t hook, void* user_data)
+{
+    if (handle == NULL) {
+        return EM_ERR_INVALID_PARAM;
+    }
+    
+    /* 先移除旧钩子再写用户数据，分发线程读到新钩子时一定能读到对应的用户数据 */
+    atomic_store_explicit(&handle->trace_hook, NULL, memory_order_release);
+    atomic_store_explicit(&handle->trace_user, user_data, memory_order_relaxed);
+    atomic_store_explicit(&handle->trace_hook, hook, memory_order_release);
+    return EM_OK;
+}
+
+const char* em_error_string(em_error_t error)
+{
+    switch (error) {
+        case EM_OK:                 return "Success";
+        case EM_ERR_INVALID_PARAM:  return "Invalid parameter";
+        case EM_ERR_NOT_INITIALIZED: return "Not initialized";
+        case EM_ERR_ALREADY_INIT:   return "Already initialized";
+        case EM_ERR_OUT_OF_MEMORY:  return "Out of memory";
+        case EM_ERR_QUEUE_FULL:     return "Queue is full";
+        case EM_ERR_QUEUE_EMPTY:    return "Queue is empty";
+        case EM_ERR_MAX_SUBSCRIBERS: return "Maximum subscribers reached";
+        case EM_ERR_NOT_FOUND:      return "Not found";
+        case EM_ERR_MUTEX_FAILED:   return "Mutex operation failed";
+        case EM_ERR_OVERLOADED:     return "Overloaded, event shed";
+        case EM_ERR_NOT_SUPPORTED:  return "Not supported";
+        case EM_ERR_TIMEOUT:        return "Timed out";
+        case EM_SUPPRESSED:         return "Suppressed, data unchanged";
+        default:                    return "Unknown error";
+    }
+}
+
+const char* em_version(void)
+{
+    return EM_VERSION_STRING;
+}
+
+/*============================================================================
+ *                              内部函数实现
+ *============================================================================*/
+
+/**
+ * @brief 单调时钟(纳秒)
+ */
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+#if EM_HAVE_TSC
+/**
+ * @brief TSC 校准结果(进程内共享)
+ * 
+ * ns = base_ns + ((tsc - base_tsc) * mult) >> 32
+ */
+static struct {
+    atomic_int  state;      /**< 0=未校准, 1=校准中, 2=可用, 3=不可用 */
+    uint64_t    base_tsc;
+    uint64_t    base_ns;
+    uint64_t    mult;
+} tsc_clock;
+
+/**
+ * @brief 检测不变 TSC(CPUID 0x80000007 EDX bit 8)
+ */
+static bool tsc_invariant(void)
+{
+    unsigned int eax, ebx, ecx, edx;
+    if (__get_cpuid(0x80000000, &eax, &ebx, &ecx, &edx) == 0 || eax < 0x80000007) {
+        return false;
+    }
+    __get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx);
+    return (edx & (1u << 8)) != 0;
+}
+
+/**
+ * @brief 对照 CLOCK_MONOTONIC 校准 TSC 频率(约10ms，只做一次)
+ */
+static bool tsc_calibrate(void)
+{
+    int expected = 0;
+    if (atomic_compare_exchange_strong(&tsc_clock.state, &expected, 1)) {
+        bool ok = tsc_invariant();
+        if (ok) {
+            uint64_t ns0 = now_ns();
+            uint64_t tsc0 = __rdtsc();
+            while (now_ns() - ns0 < 10000000ull) {
+            }
+            uint64_t tsc1 = __rdtsc();
+            uint64_t ns1 = now_ns();
+            
+            uint64_t cycles = tsc1 - tsc0;
+            ok = cycles > 0;
+            if (ok) {
+                tsc_clock.mult = (uint64_t)(((unsigned __int128)(ns1 - ns0) << 32) / cycles);
+                tsc_clock.base_tsc = tsc1;
+                tsc_clock.base_ns = ns1;
+            }
+        }
+        atomic_store(&tsc_clock.state, ok ? 2 : 3);
+    }
+    
+    /* 其他线程正在校准时等待结果 */
+    while (atomic_load(&tsc_clock.state) == 1) {
+    }
+    return atomic_load(&tsc_clock.state) == 2;
+}
+
+static inline uint64_t tsc_now(void)
+{
+    uint64_t delta = __rdtsc() - tsc_clock.base_tsc;
+    return tsc_clock.base_ns + (uint64_t)(((unsigned __int128)delta * tsc_clock.mult) >> 32);
+}
+#endif /* EM_HAVE_TSC */
+
+/**
+ * @brief 选择时间源，不可用时回退到 CLOCK_MONOTONIC
+ */
+static void clock_init(em_handle_t handle, em_clock_source_t source)
+{
+    handle->clock_source = EM_CLOCK_MONOTONIC;
+    
+    switch (source) {
+        case EM_CLOCK_MONOTONIC_COARSE:
+#ifdef CLOCK_MONOTONIC_COARSE
+            handle->clock_source = EM_CLOCK_MONOTONIC_COARSE;
+#endif
+            break;
+        case EM_CLOCK_TSC:
+#if EM_HAVE_TSC
+            if (tsc_calibrate()) {
+                handle->clock_source = EM_CLOCK_TSC;
+            }
+#endif
+            break;
+        default:
+            break;
+    }
+    
+    if (handle->clock_source != source) {
+        EM_DEBUG("Clock source %d unavailable, using CLOCK_MONOTONIC", source);
+    }
+}
+
+/**
+ * @brief 按管理器选择的时间源读取当前时间(纳秒)
+ */
+static inline uint64_t clock_now(em_handle_t handle)
+{
+    if (handle->virtual_time) {
+        return atomic_load_explicit(&handle->virtual_now, memory_order_relaxed);
+    }
+    
+    switch (handle->clock_source) {
+#if EM_HAVE_TSC
+        case EM_CLOCK_TSC:
+            return tsc_now();
+#endif
+#ifdef CLOCK_MONOTONIC_COARSE
+        case EM_CLOCK_MONOTONIC_COARSE: {
+            struct timespec ts;
+            clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+            return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+        }
+#endif
+        default:
+            return now_ns();
+    }
+}
+
+/**
+ * @brief 各队列队首中最长的已等待时间(调用者需持有锁，队列全空返回0)
+ */
+static uint64_t oldest_wait_ns(em_handle_t handle, uint64_t now)
+{
+    uint64_t oldest = 0;
+    for (int i = 0; i < EM_PRIORITY_COUNT; i++) {
+        em_priority_queue_t* queue = &handle->async_queues[i];
+        if (queue->count > 0) {
+            uint64_t age = now - queue->nodes[queue->head].enqueue_ns;
+            if (age > oldest) {
+                oldest = age;
+            }
+        }
+    }
+    return oldest;
+}
+
+/**
+ * @brief 记录一次出队的排队延迟(调用者需持有锁)
+ */
+static void record_queue_wait(em_handle_t handle, em_priority_t priority, uint64_t wait_ns)
+{
+    uint32_t wait_us = wait_ns / 1000 > UINT32_MAX ? UINT32_MAX : (uint32_t)(wait_ns / 1000);
+    
+    /* 指数滑动平均(权重1/8) */
+    int64_t avg = handle->stats.queue_wait_avg_us[priority];
+    avg += ((int64_t)wait_us - avg) / 8;
+    handle->stats.queue_wait_avg_us[priority] = (uint32_t)avg;
+    if (wait_us > handle->stats.queue_wait_max_us[priority]) {
+        handle->stats.queue_wait_max_us[priority] = wait_us;
+    }
+    
+    if (handle->shed.config.enabled) {
+        if (priority == EM_PRIORITY_HIGH && wait_ns < handle->shed.min_high_ns) {
+            handle->shed.min_high_ns = wait_ns;
+        }
+        if (wait_ns < handle->shed.min_any_ns) {
+            handle->shed.min_any_ns = wait_ns;
+        }
+    }
+}
+
+/**
+ * @brief 窗口结束时更新丢弃级别(调用者需持有锁)
+ */
+static void shed_update(em_handle_t handle, uint64_t now)
+{
+    em_shed_state_t* shed = &handle->shed;
+    uint64_t interval_ns = (uint64_t)shed->config.interval_us * 1000;
+    
+    if (now - shed->interval_start_ns < interval_ns) {
+        return;
+    }
+    
+    uint64_t target_ns = (uint64_t)shed->config.target_us * 1000;
+    uint64_t observed = shed->min_high_ns != UINT64_MAX ? shed->min_high_ns : shed->min_any_ns;
+    
+    /* 窗口内没有出队：队列非空说明消费者停滞，以最老的队首等待时间为准 */
+    if (observed == UINT64_MAX && handle->stats.async_queue_current > 0) {
+        observed = oldest_wait_ns(handle, now);
+    }
+    
+    if (observed != UINT64_MAX && observed > target_ns) {
+        /* 整个窗口内延迟都超过目标：逐级丢弃 LOW、NORMAL */
+        if (shed->level < EM_PRIORITY_COUNT - 1) {
+            shed->level++;
+            EM_DEBUG("Load shedding level raised to %d", shed->level);
+        }
+    } else if (shed->level > 0) {
+        shed->level--;
+        EM_DEBUG("Load shedding level lowered to %d", shed->level);
+    }
+    
+    handle->stats.shed_level = (uint32_t)shed->level;
+    shed->interval_start_ns = now;
+    shed->min_high_ns = UINT64_MAX;
+    shed->min_any_ns = UINT64_MAX;
+}
+
+/**
+ * @brief 把到期的延时事件放入队列(调用者需持有锁)
+ */
+static void fire_timers_locked(em_handle_t handle)
+{
+    if (handle->timer_count > 0) {
+        fire_due_timers(handle, clock_now(handle));
+        
+        /* 虚拟时钟：队列已空时直接跳到下一个到期时间 */
+        if (handle->auto_advance && handle->stats.async_queue_current == 0 &&
+            handle->timer_count > 0) {
+            uint64_t due = handle->timers[0].due_ns;
+            if (due > atomic_load(&handle->virtual_now)) {
+                atomic_store(&handle->virtual_now, due);
+            }
+            fire_due_timers(handle, due);
+        }
+    }
+}
+
+/**
+ * @brief 取出指定优先级的队首事件并更新统计(调用者需持有锁)
+ */
+static bool dequeue_from(em_handle_t handle, em_priority_t priority, em_event_t* event,
+                         void** data_copy)
+{
+    em_priority_queue_t* queue = &handle->async_queues[priority];
+    uint64_t enqueue_ns;
+    if (queue->count == 0) {
+        return false;
+    }
+    int producer = queue->nodes[queue->head].producer;
+    if (dequeue_event(queue, event, data_copy, &enqueue_ns) != EM_OK) {
+        return false;
+    }
+    producer_release(handle, producer, priority);
+    
+    /* 更新队列统计 */
+    uint32_t total = 0;
+    for (int j = 0; j < EM_PRIORITY_COUNT; j++) {
+        total += handle->async_queues[j].count;
+    }
+    handle->stats.async_queue_current = total;
+    
+    uint64_t now = clock_now(handle);
+    record_queue_wait(handle, priority, now - enqueue_ns);
+    if (handle->shed.config.enabled) {
+        shed_update(handle, now);
+    }
+    return true;
+}
+
+/**
+ * @brief 按调度策略取出下一个事件并更新统计(调用者需持有锁)
+ */
+static bool dequeue_next(em_handle_t handle, em_event_t* event, void** data_copy,
+                         em_priority_t* priority)
+{
+    fire_timers_locked(handle);
+    
+    em_priority_t next;
+    if (sched_select(handle, &next, 1) != 1 || !dequeue_from(handle, next, event, data_copy)) {
+        return false;
+    }
+    *priority = next;
+    return true;
+}
+
+/**
+ * @brief 补全批量策略的默认值
+ */
+static void normalize_batch_policy(em_batch_policy_t* policy)
+{
+    if (policy->max_batch == 0 || policy->max_batch > EM_DRAIN_BATCH_MAX) {
+        policy->max_batch = EM_DRAIN_BATCH_MAX;
+    }
+    if (policy->min_batch == 0) {
+        policy->min_batch = 1;
+    }
+    if (policy->min_batch > policy->max_batch) {
+        policy->min_batch = policy->max_batch;
+    }
+    if (policy->latency_target_us == 0) {
+        policy->latency_target_us = EM_DRAIN_LATENCY_TARGET_US;
+    }
+}
+
+/**
+ * @brief 一次加锁取出一批事件并在锁外分发
+ * 
+ * @return int 本批处理的事件数
+ */
+static int drain_batch(em_handle_t handle, em_drain_state_t* state)
+{
+    em_event_t events[EM_DRAIN_BATCH_MAX];
+    void* copies[EM_DRAIN_BATCH_MAX];
+    int n = 0;
+    
+    lock_manager(handle);
+    
+    const em_batch_policy_t* policy = &handle->batch_policy;
+    uint64_t target_ns = (uint64_t)policy->latency_target_us * 1000;
+    uint32_t size = state->size;
+    
+    /* 
+     * 上一批分发期间有 HIGH 事件到达并排在低优先级事件之后，
+     * 或分发耗时超过目标：批量减半
+     */
+    bool shrink = (state->had_lower && handle->async_queues[EM_PRIORITY_HIGH].count > 0) ||
+                  state->last_elapsed_ns > target_ns;
+    if (shrink) {
+        size /= 2;
+    }
+    if (size < policy->min_batch) {
+        size = policy->min_batch;
+    }
+    if (size > policy->max_batch) {
+        size = policy->max_batch;
+    }
+    
+    /* 调度器一次决定整批的出队顺序 */
+    em_priority_t order[EM_DRAIN_BATCH_MAX];
+    fire_timers_locked(handle);
+    int picked = sched_select(handle, order, (int)size);
+    state->had_lower = false;
+    while (n < picked && dequeue_from(handle, order[n], &events[n], &copies[n])) {
+        if (order[n] != EM_PRIORITY_HIGH) {
+            state->had_lower = true;
+        }
+        n++;
+    }
+    
+    /* 取满一批后队列仍然积压：批量加一 */
+    if (!shrink && (uint32_t)n == size &&
+        handle->stats.async_queue_current >= size && size < policy->max_batch) {
+        size++;
+    }
+    state->size = size;
+    
+    if (n > 0) {
+        handle->stats.drain_batches++;
+        handle->stats.drain_batch_current = (uint32_t)n;
+        if ((uint32_t)n > handle->stats.drain_batch_max) {
+            handle->stats.drain_batch_max = (uint32_t)n;
+        }
+    }
+#if EM_ENABLE_THREADING
+    unsigned bucket = n > 0 ? inflight_begin(handle, (unsigned)n) : 0;
+#endif
+    
+    unlock_manager(handle);
+    
+    if (n == 0) {
+        state->last_elapsed_ns = 0;
+        return 0;
+    }
+    
+    em_handle_t outer = dispatching_handle;
+    dispatching_handle = handle;
+    uint64_t start = now_ns();
+    int inlined = 0;
+    for (int i = 0; i < n; i++) {
+        trace_event(handle, &events[i]);
+        dispatch_event(handle, events[i].id, events[i].data, copies[i]);
+        if (copies[i] != NULL) {
+            payload_release(copies[i]);
+        }
+        
+        /* 回调中 em_publish_auto 的事件紧接着分发 */
+        if (inline_ring.count > 0 && inline_ring.loop == handle) {
+            inlined += inline_run(handle, &events[i + 1], n - i - 1);
+        }
+    }
+    state->last_elapsed_ns = now_ns() - start;
+    dispatching_handle = outer;
+#if EM_ENABLE_THREADING
+    inflight_end(handle, bucket, (unsigned)n);
+#endif
+    
+    return n + inlined;
+}
+
+/**
+ * @brief 内联分发会越过已排队的事件时返回true(调用者需持有锁)
+ * 
+ * @param rest 本批尚未分发的事件
+ */
+static bool inline_blocked(em_handle_t handle, em_priority_t priority,
+                           const em_event_t* rest, int rest_count)
+{
+    /* 严格优先级只需看不低于该优先级的事件，其他调度策略下任何等待的事件都可能先出队 */
+    int last = handle->sched_ops == NULL ? (int)priority : EM_PRIORITY_COUNT - 1;
+    for (int p = 0; p <= last; p++) {
+        if (handle->async_queues[p].count > 0) {
+            return true;
+        }
+    }
+    for (int i = 0; i < rest_count; i++) {
+        if ((int)rest[i].priority <= last) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief 当前回调返回后分发 em_publish_auto 暂存的事件
+ * 
+ * 内联分发的事件中再次调用 em_publish_auto 时继续追加，直到暂存为空。会越过已排队
+ * 的事件时改为入队；入队失败时仍内联分发，不丢弃已经接受的事件。
+ * 
+ * @return int 内联分发的事件数
+ */
+static int inline_run(em_handle_t handle, const em_event_t* rest, int rest_count)
+{
+    int n = 0;
+    while (inline_ring.count > 0) {
+        uint32_t slot = inline_ring.head;
+        em_event_t event = inline_ring.events[slot];
+        void* data_copy = inline_ring.copies[slot];
+        inline_ring.head = (slot + 1) % EM_INLINE_DEPTH;
+        inline_ring.count--;
+        
+        lock_manager(handle);
+        bool queued = inline_blocked(handle, event.priority, rest, rest_count) &&
+                      enqueue_locked(handle, &event, data_copy, clock_now(handle),
+                                     current_producer(handle)) == EM_OK;
+        if (queued) {
+#if EM_ENABLE_THREADING
+            signal_manager(handle);
+#endif
+        } else {
+            handle->stats.events_published++;
+        }
+        unlock_manager(handle);
+        if (queued) {
+            continue;
+        }
+        
+        atomic_fetch_add_explicit(&handle->events_inlined, 1, memory_order_relaxed);
+        trace_event(handle, &event);
+        dispatch_event(handle, event.id, event.data, data_copy);
+        if (data_copy != NULL) {
+            payload_release(data_copy);
+        }
+        n++;
+    }
+    return n;
+}
+
+/**
+ * @brief 分配带引用计数的数据副本，返回数据区指针
+ */
+static void* payload_alloc(size_t size)
+{
+    em_payload_hdr_t* hdr = (em_payload_hdr_t*)malloc(EM_PAYLOAD_HDR_SIZE + size);
+    if (hdr == NULL) {
+        return NULL;
+    }
+    
+    atomic_init(&hdr->refs, 1);
+    hdr->size = size;
+    hdr->pool = NULL;
+    return (char*)hdr + EM_PAYLOAD_HDR_SIZE;
+}
+
+/**
+ * @brief 创建数据块池，所有块初始都在空闲栈中
+ */
+static em_payload_pool_t* payload_pool_create(const em_config_t* config)
+{
+    em_payload_pool_t* pool = (em_payload_pool_t*)calloc(1, sizeof(em_payload_pool_t));
+    if (pool == NULL) {
+        return NULL;
+    }
+    
+    pool->block_count = config->payload_pool_blocks;
+    pool->block_size = config->payload_block_size;
+    pool->stride = (EM_PAYLOAD_HDR_SIZE + pool->block_size + _Alignof(max_align_t) - 1) &
+                   ~(_Alignof(max_align_t) - 1);
+    pool->next = (atomic_uint*)calloc(pool->block_count, sizeof(atomic_uint));
+    pool->blocks = (char*)malloc(pool->stride * pool->block_count);
+    if (pool->next == NULL || pool->blocks == NULL) {
+        free(pool->next);
+        free(pool->blocks);
+        free(pool);
+        return NULL;
+    }
+    
+    /* 块 i 的下一块是 i+1，栈顶为块 0 */
+    for (uint32_t i = 0; i < pool->block_count; i++) {
+        atomic_init(&pool->next[i], i + 1 < pool->block_count ? i + 2 : 0);
+    }
+    atomic_init(&pool->top, 1);
+    atomic_init(&pool->free_count, pool->block_count);
+    atomic_init(&pool->refs, 1);
+    
+    uint32_t below = 0;
+    for (int p = 0; p < EM_PRIORITY_COUNT; p++) {
+        pool->reserve_below[p] = below;
+        below += config->payload_reserved[p];
+    }
+    return pool;
+}
+
+/**
+ * @brief 释放块池的一个引用，最后一个引用释放时回收块池
+ */
+static void payload_pool_release(em_payload_pool_t* pool)
+{
+    if (atomic_fetch_sub_explicit(&pool->refs, 1, memory_order_acq_rel) == 1) {
+        free(pool->next);
+        free(pool->blocks);
+        free(pool);
+    }
+}
+
+/**
+ * @brief 从块池分配数据副本
+ * 
+ * 先扣减空闲块计数(扣减后不能少于更高优先级的保留块)，成功后空闲栈中
+ * 一定有块可取。
+ */
+static void* payload_pool_alloc(em_payload_pool_t* pool, size_t size, em_priority_t priority)
+{
+    uint32_t floor = pool->reserve_below[priority];
+    unsigned free_count = atomic_load_explicit(&pool->free_count, memory_order_relaxed);
+    do {
+        if (free_count <= floor) {
+            atomic_fetch_add_explicit(&pool->exhausted[priority], 1, memory_order_relaxed);
+            return NULL;
+        }
+    } while (!atomic_compare_exchange_weak_explicit(&pool->free_count, &free_count, free_count - 1,
+                                                    memory_order_acquire, memory_order_relaxed));
+    
+    uint64_t top = atomic_load_explicit(&pool->top, memory_order_acquire);
+    uint32_t index;
+    for (;;) {
+        index = (uint32_t)top;
+        if (index == 0) {
+            /* 归还时先入栈再增加计数，扣减成功后栈不会为空，这里只做防御 */
+            top = atomic_load_explicit(&pool->top, memory_order_acquire);
+            continue;
+        }
+        uint64_t next = atomic_load_explicit(&pool->next[index - 1], memory_order_relaxed);
+        uint64_t desired = (((top >> 32) + 1) << 32) | next;
+        if (atomic_compare_exchange_weak_explicit(&pool->top, &top, desired,
+                                                  memory_order_acq_rel, memory_order_acquire)) {
+            break;
+        }
+    }
+    
+    atomic_fetch_add_explicit(&pool->refs, 1, memory_order_relaxed);
+    em_payload_hdr_t* hdr = (em_payload_hdr_t*)(pool->blocks + (size_t)(index - 1) * pool->stride);
+    atomic_init(&hdr->refs, 1);
+    hdr->size = size;
+    hdr->pool = pool;
+    return (char*)hdr + EM_PAYLOAD_HDR_SIZE;
+}
+
+/**
+ * @brief 将块归还到空闲栈
+ */
+static void payload_pool_free(em_payload_pool_t* pool, em_payload_hdr_t* hdr)
+{
+    uint32_t index = (uint32_t)(((char*)hdr - pool->blocks) / pool->stride) + 1;
+    uint64_t top = atomic_load_explicit(&pool->top, memory_order_relaxed);
+    uint64_t desired;
+    do {
+        atomic_store_explicit(&pool->next[index - 1], (uint32_t)top, memory_order_relaxed);
+        desired = (((top >> 32) + 1) << 32) | index;
+    } while (!atomic_compare_exchange_weak_explicit(&pool->top, &top, desired,
+                                                    memory_order_release, memory_order_relaxed));
+    
+    atomic_fetch_add_explicit(&pool->free_count, 1, memory_order_release);
+    payload_pool_release(pool);
+}
+
+/**
+ * @brief 为某优先级的异步事件分配数据副本
+ * 
+ * 配置了块池时从块池分配，超过块大小的数据改用 malloc；块池对该优先级
+ * 已无可用块时返回NULL。
+ */
+static void* payload_alloc_for(em_handle_t handle, size_t size, em_priority_t priority)
+{
+    em_payload_pool_t* pool = handle->payload_pool;
+    if (pool == NULL) {
+        return payload_alloc(size);
+    }
+    if (size > pool->block_size) {
+        atomic_fetch_add_explicit(&pool->oversize, 1, memory_order_relaxed);
+        return payload_alloc(size);
+    }
+    return payload_pool_alloc(pool, size, priority);
+}
+
+/**
+ * @brief 增加数据副本的引用
+ */
+static void payload_retain(void* data)
+{
+    em_payload_hdr_t* hdr = (em_payload_hdr_t*)((char*)data - EM_PAYLOAD_HDR_SIZE);
+    atomic_fetch_add_explicit(&hdr->refs, 1, memory_order_relaxed);
+}
+
+/**
+ * @brief 释放数据副本的引用，最后一个引用释放时回收内存
+ */
+static void payload_release(void* data)
+{
+    em_payload_hdr_t* hdr = (em_payload_hdr_t*)((char*)data - EM_PAYLOAD_HDR_SIZE);
+    if (atomic_fetch_sub_explicit(&hdr->refs, 1, memory_order_acq_rel) == 1) {
+        if (hdr->pool != NULL) {
+            payload_pool_free(hdr->pool, hdr);
+        } else {
+            free(hdr);
+        }
+    }
+}
+
+/**
+ * @brief 向执行器收件箱投递回调(无锁，队列满时返回false)
+ */
+static bool inbox_push(em_executor_t* executor, const em_invocation_t* inv)
+{
+    em_inbox_slot_t* slot;
+    size_t pos = atomic_load_explicit(&executor->enqueue_pos, memory_order_relaxed);
+    
+    for (;;) {
+        slot = &executor->slots[pos & executor->mask];
+        size_t seq = atomic_load_explicit(&slot->seq, memory_order_acquire);
+        intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+        
+        if (diff == 0) {
+            if (atomic_compare_exchange_weak_explicit(&executor->enqueue_pos, &pos, pos + 1,
+                                                      memory_order_relaxed,
+                                                      memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            return false;  /* 收件箱已满 */
+        } else {
+            pos = atomic_load_explicit(&executor->enqueue_pos, memory_order_relaxed);
+        }
+    }
+    
+    slot->inv = *inv;
+    atomic_store_explicit(&slot->seq, pos + 1, memory_order_release);
+    return true;
+}
+
+/**
+ * @brief 从执行器收件箱取出回调(无锁，为空时返回false)
+ */
+static bool inbox_pop(em_executor_t* executor, em_invocation_t* inv)
+{
+    em_inbox_slot_t* slot;
+    size_t pos = atomic_load_explicit(&executor->dequeue_pos, memory_order_relaxed);
+    
+    for (;;) {
+        slot = &executor->slots[pos & executor->mask];
+        size_t seq = atomic_load_explicit(&slot->seq, memory_order_acquire);
+        intptr_t diff = (intptr_t)seq - (intptr_t)(pos + 1);
+        
+        if (diff == 0) {
+            if (atomic_compare_exchange_weak_explicit(&executor->dequeue_pos, &pos, pos + 1,
+                                                      memory_order_relaxed,
+                                                      memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            return false;  /* 收件箱为空 */
+        } else {
+            pos = atomic_load_explicit(&executor->dequeue_pos, memory_order_relaxed);
+        }
+    }
+    
+    *inv = slot->inv;
+    atomic_store_explicit(&slot->seq, pos + executor->mask + 1, memory_order_release);
+    return true;
+}
+
+/**
+ * @brief 创建执行器(不挂接到任何管理器)，初始引用属于调用者
+ */
+static em_executor_t* executor_new(size_t capacity)
+{
+    if (capacity == 0) {
+        capacity = EM_EXECUTOR_DEFAULT_CAPACITY;
+    }
+    
+    /* 容量向上取整为2的幂，便于用掩码取模 */
+    size_t cap = 2;
+    while (cap < capacity) {
+        cap <<= 1;
+    }
+    
+    em_executor_t* executor = (em_executor_t*)calloc(1, sizeof(em_executor_t));
+    if (executor == NULL) {
+        return NULL;
+    }
+    
+    executor->slots = (em_inbox_slot_t*)calloc(cap, sizeof(em_inbox_slot_t));
+    if (executor->slots == NULL) {
+        free(executor);
+        return NULL;
+    }
+    
+    for (size_t i = 0; i < cap; i++) {
+        atomic_init(&executor->slots[i].seq, i);
+    }
+    executor->mask = cap - 1;
+    atomic_init(&executor->enqueue_pos, 0);
+    atomic_init(&executor->dequeue_pos, 0);
+    atomic_init(&executor->refs, 1);
+    atomic_init(&executor->closed, false);
+    
+    EM_DEBUG("Executor created (capacity=%zu)", cap);
+    return executor;
+}
+
+static void executor_retain(em_executor_t* executor)
+{
+    atomic_fetch_add_explicit(&executor->refs, 1, memory_order_relaxed);
+}
+
+/**
+ * @brief 释放执行器引用，最后一个引用释放时丢弃未执行的回调并回收内存
+ */
+static void executor_release(em_executor_t* executor)
+{
+    if (atomic_fetch_sub_explicit(&executor->refs, 1, memory_order_acq_rel) != 1) {
+        return;
+    }
+    
+    em_invocation_t inv;
+    while (inbox_pop(executor, &inv)) {
+        if (inv.payload != NULL) {
+            payload_release(inv.payload);
+        }
+    }
+    
+    if (executor->finalize != NULL) {
+        executor->finalize(executor);
+    }
+    free(executor->slots);
+    free(executor);
+}
+
+/**
+ * @brief 投递成功后通知执行器的消费者
+ */
+static void executor_notify(em_executor_t* executor)
+{
+    if (executor->notify != NULL) {
+        executor->notify(executor);
+        return;
+    }
+    
+    /* 唤醒执行器所属的事件循环；先登记再读取 owner，解除挂接的一方会等待登记归零 */
+    atomic_fetch_add(&executor->users, 1);
+    em_handle_t owner = atomic_load(&executor->owner);
+    if (owner != NULL) {
+        lock_manager(owner);
+        signal_manager(owner);
+        unlock_manager(owner);
+    }
+    atomic_fetch_sub(&executor->users, 1);
+}
+
+/**
+ * @brief 等待所有已取到 owner 的线程退出(owner 已置空后调用，调用者不能持有管理器锁)
+ */
+static void executor_wait_users(em_executor_t* executor)
+{
+    while (atomic_load(&executor->users) > 0) {
+        cpu_relax();
+    }
+}
+
+/**
+ * @brief 取消匹配的订阅(调用者需持有锁)
+ * 
+ * @param callback 要匹配的回调(NULL表示不按回调匹配)
+ * @param executor 要匹配的执行器
+ * @param match_executor 是否同时要求执行器一致(NULL执行器表示直接订阅)
+ * @return int 取消的订阅数量
+ */
+static int unsubscribe_matching(em_handle_t handle, em_event_id_t event_id,
+                                em_callback_t callback, em_executor_t* executor,
+                                bool match_executor)
+{
+    em_subscriber_list_t* list = &handle->event_subscribers[event_id];
+    int removed = 0;
+    
+    for (int i = 0; i < EM_MAX_SUBSCRIBERS; i++) {
+        em_subscriber_t* sub = &list->subscribers[i];
+        if (!sub->active) {
+            continue;
+        }
+        if (callback != NULL && sub->callback != callback) {
+            continue;
+        }
+        if (match_executor && sub->executor != executor) {
+            continue;
+        }
+        
+        if (sub->executor != NULL) {
+            executor_release(sub->executor);
+        }
+        sub->active = false;
+        sub->callback = NULL;
+        sub->user_data = NULL;
+        sub->executor = NULL;
+        list->count--;
+        handle->stats.subscribers_total--;
+        removed++;
+        
+        EM_DEBUG("Unsubscribed from event %u", event_id);
+        
+        /* 按回调取消时只移除第一个匹配项 */
+        if (callback != NULL) {
+            break;
+        }
+    }
+    
+    return removed;
+}
+
+/**
+ * @brief 执行挂接到管理器的所有执行器中的回调
+ */
+static int run_attached_executors(em_handle_t handle)
+{
+    em_executor_t* executors[EM_MAX_EXECUTORS];
+    
+    lock_manager(handle);
+    int n = handle->executor_count;
+    memcpy(executors, handle->executors, sizeof(em_executor_t*) * (size_t)n);
+    unlock_manager(handle);
+    
+    int count = 0;
+    for (int i = 0; i < n; i++) {
+        count += em_executor_run(executors[i], 0);
+    }
+    return count;
+}
+
+/**
+ * @brief 检查挂接的执行器中是否有待执行的回调(调用者需持有锁)
+ */
+static bool executors_pending(em_handle_t handle)
+{
+    for (int i = 0; i < handle->executor_count; i++) {
+        if (em_executor_pending(handle->executors[i]) > 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief 查找订阅组，不存在且 create 为true时占用一个空闲槽位(调用者需持有锁)
+ */
+static em_group_t* group_find(em_handle_t handle, uint32_t group_id, bool create)
+{
+    em_group_t* free_group = NULL;
+    for (int i = 0; i < EM_MAX_GROUPS; i++) {
+        if (handle->groups[i].id == group_id) {
+            return &handle->groups[i];
+        }
+        if (handle->groups[i].id == 0 && free_group == NULL) {
+            free_group = &handle->groups[i];
+        }
+    }
+    if (!create || free_group == NULL) {
+        return NULL;
+    }
+    
+    free_group->id = group_id;
+    free_group->policy = EM_GROUP_ROUND_ROBIN;
+    free_group->key_fn = NULL;
+    atomic_store_explicit(&free_group->next, 0, memory_order_relaxed);
+    return free_group;
+}
+
+/** 键值打散(murmur3 终结函数)，避免连续键值集中到相邻成员 */
+static inline uint32_t mix32(uint32_t h)
+{
+    h ^= h >> 16;
+    h *= 0x85ebca6b;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35;
+    h ^= h >> 16;
+    return h;
+}
+
+/**
+ * @brief 为事件在每个订阅组中选出一个成员，并增加其负载计数(调用者需持有锁)
+ * 
+ * @return int 选中的成员数
+ */
+static int group_pick(em_handle_t handle, em_event_id_t event_id, em_event_data_t data,
+                      em_group_pick_t* picks)
+{
+    int count = 0;
+    
+    for (int g = 0; g < EM_MAX_GROUPS; g++) {
+        em_group_t* group = &handle->groups[g];
+        if (group->id == 0) {
+            continue;
+        }
+        
+        int candidates[EM_MAX_GROUP_MEMBERS];
+        int n = 0;
+        for (int i = 0; i < EM_MAX_GROUP_MEMBERS; i++) {
+            if (group->members[i].active && group->members[i].event_id == event_id) {
+                candidates[n++] = i;
+            }
+        }
+        if (n == 0) {
+            continue;
+        }
+        
+        int chosen;
+        if (group->policy == EM_GROUP_KEY_HASH) {
+            chosen = candidates[mix32(group->key_fn(event_id, data)) % (uint32_t)n];
+        } else if (group->policy == EM_GROUP_LEAST_LOADED) {
+            /* 从轮询位置开始比较，负载相同时轮流选择 */
+            int start = (int)(atomic_fetch_add_explicit(&group->next, 1, memory_order_relaxed) %
+                              (uint32_t)n);
+            chosen = candidates[start];
+            int best = atomic_load_explicit(&group->members[chosen].load, memory_order_relaxed);
+            for (int k = 1; k < n && best > 0; k++) {
+                int c = candidates[(start + k) % n];
+                int load = atomic_load_explicit(&group->members[c].load, memory_order_relaxed);
+                if (load < best) {
+                    best = load;
+                    chosen = c;
+                }
+            }
+        } else {
+            chosen = candidates[atomic_fetch_add_explicit(&group->next, 1, memory_order_relaxed) %
+                                (uint32_t)n];
+        }
+        
+        em_group_member_t* member = &group->members[chosen];
+        atomic_fetch_add_explicit(&member->load, 1, memory_order_relaxed);
+        picks[count].callback = member->callback;
+        picks[count].user_data = member->user_data;
+        picks[count].load = &member->load;
+        count++;
+    }
+    return count;
+}
+
+/**
+ * @brief 对订阅者列表按优先级排序(插入排序)
+ */
+static void sort_subscribers(em_subscriber_list_t* list)
+{
+    if (list->sorted || list->count <= 1) {
+        return;
+    }
+    
+    /* 简单的插入排序 */
+    for (int i = 1; i < EM_MAX_SUBSCRIBERS; i++) {
+        if (!list->subscribers[i].active) continue;
+        
+        em_subscriber_t temp = list->subscribers[i];
+        int j = i - 1;
+        
+        while (j >= 0 && list->subscribers[j].active && 
+               list->subscribers[j].priority > temp.priority) {
+            list->subscribers[j + 1] = list->subscribers[j];
+            j--;
+        }
+        
+        list->subscribers[j + 1] = temp;
+    }
+    
+    list->sorted = true;
+}
+
+/**
+ * @brief 将事件加入队列
+ */
+static em_error_t enqueue_event(em_priority_queue_t* queue, 
+                                const em_event_t* event, 
+                                void* data_copy,
+                                uint64_t enqueue_ns)
+{
+    if (queue->count >= queue->capacity) {
+        return EM_ERR_QUEUE_FULL;
+    }
+    
+    int idx = queue->tail;
+    queue->nodes[idx].event = *event;
+    queue->nodes[idx].data_copy = data_copy;
+    queue->nodes[idx].enqueue_ns = enqueue_ns;
+    queue->nodes[idx].used = true;
+    
+    queue->tail = (queue->tail + 1) % queue->capacity;
+    queue->count++;
+    queue->enqueued++;
+    
+    return EM_OK;
+}
+
+/**
+ * @brief 从队列取出事件
+ */
+static em_error_t dequeue_event(em_priority_queue_t* queue, 
+                                em_event_t* event, 
+                                void** data_copy,
+                                uint64_t* enqueue_ns)
+{
+    if (queue->count == 0) {
+        return EM_ERR_QUEUE_EMPTY;
+    }
+    
+    int idx = queue->head;
+    *event = queue->nodes[idx].event;
+    *data_copy = queue->nodes[idx].data_copy;
+    *enqueue_ns = queue->nodes[idx].enqueue_ns;
+    
+    queue->nodes[idx].used = false;
+    queue->nodes[idx].data_copy = NULL;
+    
+    queue->head = (queue->head + 1) % queue->capacity;
+    queue->count--;
+    queue->removed++;
+    
+    return EM_OK;
+}
+
+/**
+ * @brief 事件入队并更新统计(调用者需持有锁)
+ * 
+ * 占用达到自动扩容高水位时先将容量翻倍(不超过上限)。
+ */
+static em_error_t enqueue_locked(em_handle_t handle, const em_event_t* event,
+                                 void* data_copy, uint64_t now, int producer)
+{
+    em_priority_queue_t* queue = &handle->async_queues[event->priority];
+    if (handle->autogrow.enabled && queue->capacity < (int)handle->autogrow.max_capacity &&
+        (uint64_t)queue->count * 100 >= (uint64_t)queue->capacity * handle->autogrow.high_watermark_pct) {
+        int capacity = queue->capacity * 2;
+        if (capacity > (int)handle->autogrow.max_capacity) {
+            capacity = (int)handle->autogrow.max_capacity;
+        }
+        resize_queue(handle, event->priority, capacity);
+    }
+    
+    if (!producer_admit(handle, producer, event->priority, 1)) {
+        if (producer >= 0) {
+            atomic_fetch_add(&handle->producers[producer].rejected[event->priority], 1);
+        }
+        return EM_ERR_QUEUE_FULL;
+    }
+    
+    em_error_t result = enqueue_event(queue, event, data_copy, now);
+    if (result != EM_OK) {
+        return result;
+    }
+    
+    /* 记录生产者并占用其预留或共享槽位 */
+    queue->nodes[(queue->tail + queue->capacity - 1) % queue->capacity].producer = (int8_t)producer;
+    if (producer >= 0) {
+        em_producer_slot_t* slot = &handle->producers[producer];
+        if (atomic_fetch_add(&slot->queued[event->priority], 1) >= slot->reserved[event->priority]) {
+            handle->shared_used[event->priority]++;
+        }
+        atomic_fetch_add(&slot->published, 1);
+    } else {
+        handle->shared_used[event->priority]++;
+    }
+    
+    handle->stats.events_published++;
+    
+    const em_scheduler_ops_t* sched = handle->sched_ops;
+    if (sched != NULL && sched->enqueue != NULL) {
+        em_sched_view_t view = { handle, now };
+        sched->enqueue(handle->sched_ctx, &view, event->priority);
+    }
+    
+    /* 更新队列统计 */
+    uint32_t total = 0;
+    for (int i = 0; i < EM_PRIORITY_COUNT; i++) {
+        total += handle->async_queues[i].count;
+    }
+    handle->stats.async_queue_current = total;
+    if (total > handle->stats.async_queue_max) {
+        handle->stats.async_queue_max = total;
+    }
+    return EM_OK;
+}
+
+/**
+ * @brief 调用线程在该管理器上绑定的生产者编号(未绑定返回-1)
+ */
+static int current_producer(em_handle_t handle)
+{
+    return bound_producer.handle == handle ? bound_producer.id : -1;
+}
+
+/**
+ * @brief 生产者能否再放入 count 个事件(调用者需持有锁)
+ * 
+ * 预留内的部分总能放入；超出预留的部分需要有足够的共享槽位。
+ */
+static bool producer_admit(em_handle_t handle, int producer, em_priority_t priority, uint32_t count)
+{
+    uint32_t capacity = (uint32_t)handle->async_queues[priority].capacity;
+    uint32_t reserved_total = handle->reserved_total[priority];
+    uint32_t shared_total = capacity > reserved_total ? capacity - reserved_total : 0;
+    uint32_t shared_free = shared_total > handle->shared_used[priority] ?
+                           shared_total - handle->shared_used[priority] : 0;
+    
+    if (producer < 0) {
+        return count <= shared_free;
+    }
+    
+    em_producer_slot_t* slot = &handle->producers[producer];
+    uint32_t queued = atomic_load(&slot->queued[priority]);
+    if (slot->limit[priority] > 0 && queued + count > slot->limit[priority]) {
+        return false;
+    }
+    uint32_t guaranteed = slot->reserved[priority] > queued ? slot->reserved[priority] - queued : 0;
+    return count <= guaranteed || count - guaranteed <= shared_free;
+}
+
+/**
+ * @brief 事件出队后归还槽位(调用者需持有锁)
+ */
+static void producer_release(em_handle_t handle, int producer, em_priority_t priority)
+{
+    if (producer < 0) {
+        handle->shared_used[priority]--;
+        return;
+    }
+    em_producer_slot_t* slot = &handle->producers[producer];
+    if (atomic_fetch_sub(&slot->queued[priority], 1) > slot->reserved[priority]) {
+        handle->shared_used[priority]--;
+    }
+}
+
+#if EM_ENABLE_THREADING
+/**
+ * @brief 释放存活标记的一个引用
+ */
+static void stage_owner_release(em_stage_owner_t* owner)
+{
+    if (owner != NULL && atomic_fetch_sub(&owner->refs, 1) == 1) {
+        free(owner);
+    }
+}
+
+/** 线程退出时标记其暂存区可以回收 */
+static void stage_owner_exit(void* arg)
+{
+    em_stage_owner_t* owner = (em_stage_owner_t*)arg;
+    atomic_store(&owner->alive, false);
+    stage_owner_release(owner);
+}
+
+static void stage_owner_key_create(void)
+{
+    pthread_key_create(&stage_owner_key, stage_owner_exit);
+}
+
+/**
+ * @brief 取调用线程的存活标记，首次调用时创建并登记线程退出时的析构函数
+ */
+static em_stage_owner_t* stage_owner_get(void)
+{
+    if (stage_owner != NULL) {
+        return stage_owner;
+    }
+    
+    em_stage_owner_t* owner = (em_stage_owner_t*)calloc(1, sizeof(em_stage_owner_t));
+    if (owner == NULL) {
+        return NULL;
+    }
+    atomic_init(&owner->alive, true);
+    atomic_init(&owner->refs, 1);
+    pthread_once(&stage_owner_once, stage_owner_key_create);
+    if (pthread_setspecific(stage_owner_key, owner) != 0) {
+        free(owner);
+        return NULL;
+    }
+    stage_owner = owner;
+    return owner;
+}
+
+/**
+ * @brief 接管所属线程已退出且已清空的暂存区(调用者需持有锁)
+ * 
+ * 只尝试一次 busy 标志：正在刷新它的线程会等待管理器锁，不能在这里等它。
+ * 仍有事件(入队时队列已满)的暂存区由超时刷新清空后再接管。
+ */
+static bool stage_buf_adopt(em_stage_buf_t* buf, em_stage_owner_t* owner)
+{
+    if (buf->owner == NULL || atomic_load(&buf->owner->alive)) {
+        return false;
+    }
+    if (atomic_flag_test_and_set_explicit(&buf->busy, memory_order_acquire)) {
+        return false;
+    }
+    
+    bool empty = buf->count == 0;
+    if (empty) {
+        stage_owner_release(buf->owner);
+        atomic_fetch_add(&owner->refs, 1);
+        buf->owner = owner;
+        buf->thread_id = stage_thread_id;
+        buf->producer = -1;
+    }
+    atomic_flag_clear_explicit(&buf->busy, memory_order_release);
+    return empty;
+}
+#endif
+
+/**
+ * @brief 查找调用线程在该管理器上的暂存区，create 为 true 时按需分配
+ * 
+ * 槽位已满时接管所属线程已退出的空暂存区。
+ * 
+ * @return 暂存区，不存在或已达 EM_MAX_STAGE_THREADS 时返回NULL
+ */
+static em_stage_buf_t* stage_buf_get(em_handle_t handle, bool create)
+{
+    if (stage_cache.handle == handle && stage_cache.serial == handle->serial) {
+        return stage_cache.buf;
+    }
+    if (stage_thread_id == 0) {
+        stage_thread_id = atomic_fetch_add(&unique_ids, 1);
+    }
+
+#if EM_ENABLE_THREADING
+    em_stage_owner_t* owner = NULL;
+    if (create) {
+        owner = stage_owner_get();
+        if (owner == NULL) {
+            return NULL;
+        }
+    }
+#endif
+    
+    em_stage_buf_t* buf = NULL;
+    int free_slot = -1;
+    
+    lock_manager(handle);
+    for (int i = 0; i < EM_MAX_STAGE_THREADS; i++) {
+        em_stage_buf_t* candidate = handle->stage_bufs[i];
+        if (candidate == NULL) {
+            if (free_slot < 0) {
+                free_slot = i;
+            }
+        } else if (candidate->thread_id == stage_thread_id) {
+            buf = candidate;
+            break;
+        }
+    }
+    if (buf == NULL && create && free_slot >= 0) {
+        buf = (em_stage_buf_t*)calloc(1, sizeof(em_stage_buf_t));
+        if (buf != NULL) {
+            atomic_flag_clear(&buf->busy);
+            buf->thread_id = stage_thread_id;
+            buf->producer = -1;
+#if EM_ENABLE_THREADING
+            atomic_fetch_add(&owner->refs, 1);
+            buf->owner = owner;
+#endif
+            handle->stage_bufs[free_slot] = buf;
+        }
+    }
+#if EM_ENABLE_THREADING
+    for (int i = 0; buf == NULL && create && free_slot < 0 && i < EM_MAX_STAGE_THREADS; i++) {
+        if (stage_buf_adopt(handle->stage_bufs[i], owner)) {
+            buf = handle->stage_bufs[i];
+        }
+    }
+#endif
+    unlock_manager(handle);
+    
+    if (buf != NULL) {
+        stage_cache.handle = handle;
+        stage_cache.serial = handle->serial;
+        stage_cache.buf = buf;
+    }
+    return buf;
+}
+
+/**
+ * @brief 等待并取得暂存区的 busy 标志
+ * 
+ * 持有者刷新时会等待管理器锁，可能阻塞很久：先短暂自旋，之后让出CPU，
+ * 仍拿不到时每次休眠 50 微秒，不占满一个核。
+ */
+static void stage_buf_acquire(em_stage_buf_t* buf)
+{
+    int spins = 0;
+    while (atomic_flag_test_and_set_explicit(&buf->busy, memory_order_acquire)) {
+        if (spins < EM_LOCK_SPIN_COUNT) {
+            cpu_relax();
+        } else if (spins < 2 * EM_LOCK_SPIN_COUNT) {
+#if EM_ENABLE_THREADING
+            sched_yield();
+#endif
+        } else {
+            struct timespec ts = {0, 50000};  /* 50us */
+            nanosleep(&ts, NULL);
+            continue;
+        }
+        spins++;
+    }
+}
+
+/**
+ * @brief 把事件放入暂存区，满或超时则整批入队
+ * 
+ * 队列满时暂存事件留在暂存区，暂存区也满时拒绝新事件，背压传回发布者。
+ */
+static em_error_t stage_append(em_handle_t handle, em_stage_buf_t* buf, const em_event_t* event,
+                               void* data_copy, uint64_t now, int producer)
+{
+    uint32_t max_events = atomic_load_explicit(&handle->auto_batch_max, memory_order_relaxed);
+    uint64_t real_now = now_ns();
+    
+    stage_buf_acquire(buf);
+    
+    /* 一批事件只属于一个生产者，绑定变化或暂存区已满时先刷新 */
+    if (buf->count > 0 && (buf->producer != producer || buf->count >= max_events)) {
+        stage_flush_locked(handle, buf);
+    }
+    if (buf->count >= max_events || (buf->count > 0 && buf->producer != producer)) {
+        atomic_flag_clear_explicit(&buf->busy, memory_order_release);
+        if (data_copy != NULL) {
+            payload_release(data_copy);
+        }
+        return EM_ERR_QUEUE_FULL;
+    }
+    
+    if (buf->count == 0) {
+        buf->first_ns = real_now;
+        buf->producer = producer;
+    }
+    buf->events[buf->count] = *event;
+    buf->copies[buf->count] = data_copy;
+    buf->enqueue_ns[buf->count] = now;
+    buf->count++;
+    atomic_fetch_add_explicit(&handle->staged_events, 1, memory_order_relaxed);
+    
+    if (buf->count >= max_events ||
+        real_now - buf->first_ns >= atomic_load_explicit(&handle->auto_batch_delay_ns, memory_order_relaxed)) {
+        stage_flush_locked(handle, buf);
+    }
+    
+    atomic_flag_clear_explicit(&buf->busy, memory_order_release);
+    return EM_OK;
+}
+
+/**
+ * @brief 将暂存区中的事件整批入队(调用者需持有暂存区的 busy 标志)
+ * 
+ * 只加一次管理器锁、只唤醒一次消费者；每个事件仍按 em_publish_async 的规则
+ * 单独做负载控制、配额和容量检查。因队列满失败的事件按原顺序留在暂存区
+ * (同优先级的后续事件也一并保留)，被负载控制或配额拒绝的事件被丢弃。
+ * 
+ * @return em_error_t 第一个失败事件的错误码，全部入队返回 EM_OK
+ */
+static em_error_t stage_flush_locked(em_handle_t handle, em_stage_buf_t* buf)
+{
+    uint32_t count = buf->count;
+    if (count == 0) {
+        return EM_OK;
+    }
+    
+    em_error_t first_error = EM_OK;
+    bool blocked[EM_PRIORITY_COUNT] = { false };
+    uint32_t enqueued = 0;
+    uint32_t kept = 0;
+    
+    lock_manager(handle);
+    
+    if (handle->shed.config.enabled) {
+        shed_update(handle, clock_now(handle));
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        em_priority_t priority = buf->events[i].priority;
+        em_error_t result;
+        if (blocked[priority]) {
+            result = EM_ERR_QUEUE_FULL;
+        } else if (handle->shed.level > 0 && (int)priority >= EM_PRIORITY_COUNT - handle->shed.level) {
+            handle->stats.events_shed[priority]++;
+            result = EM_ERR_OVERLOADED;
+        } else {
+            result = enqueue_locked(handle, &buf->events[i], buf->copies[i],
+                                    buf->enqueue_ns[i], buf->producer);
+        }
+        
+        if (result == EM_OK) {
+            enqueued++;
+            continue;
+        }
+        if (first_error == EM_OK) {
+            first_error = result;
+        }
+        if (result == EM_ERR_QUEUE_FULL) {
+            blocked[priority] = true;
+            buf->events[kept] = buf->events[i];
+            buf->copies[kept] = buf->copies[i];
+            buf->enqueue_ns[kept] = buf->enqueue_ns[i];
+            kept++;
+        } else {
+            if (buf->copies[i] != NULL) {
+                payload_release(buf->copies[i]);
+            }
+            handle->stats.auto_batch_dropped++;
+        }
+    }
+    handle->stats.auto_batch_flushes++;
+    
+    if (enqueued > 0) {
+        signal_manager(handle);
+    }
+    
+    unlock_manager(handle);
+    
+    buf->count = kept;
+    atomic_fetch_sub_explicit(&handle->staged_events, count - kept, memory_order_relaxed);
+    return first_error;
+}
+
+/**
+ * @brief 刷新暂存超时(all 为 true 时为全部)的暂存区
+ * 
+ * 所属线程正在访问的暂存区跳过，该线程追加时自己会检查超时。all 为 true 时
+ * (关闭自动批量、em_flush)等待所属线程。队列已满放不下的事件留在暂存区。
+ * 
+ * @return int 刷新的事件数
+ */
+static int stage_flush_stale(em_handle_t handle, bool all)
+{
+    if (atomic_load_explicit(&handle->staged_events, memory_order_relaxed) == 0) {
+        return 0;
+    }
+    
+    em_stage_buf_t* bufs[EM_MAX_STAGE_THREADS];
+    lock_manager(handle);
+    memcpy(bufs, handle->stage_bufs, sizeof(bufs));
+    unlock_manager(handle);
+    
+    uint64_t now = now_ns();
+    uint64_t delay_ns = atomic_load_explicit(&handle->auto_batch_delay_ns, memory_order_relaxed);
+    int flushed = 0;
+    
+    for (int i = 0; i < EM_MAX_STAGE_THREADS; i++) {
+        em_stage_buf_t* buf = bufs[i];
+        if (buf == NULL) {
+            continue;
+        }
+        if (all) {
+            stage_buf_acquire(buf);
+        } else if (atomic_flag_test_and_set_explicit(&buf->busy, memory_order_acquire)) {
+            continue;
+        }
+        if (buf->count > 0 && (all || now - buf->first_ns >= delay_ns)) {
+            uint32_t before = buf->count;
+            stage_flush_locked(handle, buf);
+            flushed += (int)(before - buf->count);
+        }
+        atomic_flag_clear_explicit(&buf->busy, memory_order_release);
+    }
+    return flushed;
+}
+
+/**
+ * @brief 定时器堆比较：先比到期时间，再比插入序号
+ */
+static inline bool timer_before(const em_timer_t* a, const em_timer_t* b)
+{
+    return a->due_ns < b->due_ns || (a->due_ns == b->due_ns && a->seq < b->seq);
+}
+
+/**
+ * @brief 加入延时事件(调用者需持有锁)
+ */
+static em_error_t timer_push(em_handle_t handle, const em_timer_t* timer)
+{
+    if (handle->timer_count >= EM_MAX_TIMERS) {
+        return EM_ERR_QUEUE_FULL;
+    }
+    if (handle->timer_count == handle->timer_capacity) {
+        int capacity = handle->timer_capacity ? handle->timer_capacity * 2 : 16;
+        if (capacity > EM_MAX_TIMERS) {
+            capacity = EM_MAX_TIMERS;
+        }
+        em_timer_t* timers = (em_timer_t*)realloc(handle->timers, (size_t)capacity * sizeof(em_timer_t));
+        if (timers == NULL) {
+            return EM_ERR_OUT_OF_MEMORY;
+        }
+        handle->timers = timers;
+        handle->timer_capacity = capacity;
+    }
+    
+    /* 上浮 */
+    int i = handle->timer_count++;
+    em_timer_t item = *timer;
+    item.seq = handle->timer_seq++;
+    while (i > 0) {
+        int parent = (i - 1) / 2;
+        if (!timer_before(&item, &handle->timers[parent])) {
+            break;
+        }
+        handle->timers[i] = handle->timers[parent];
+        i = parent;
+    }
+    handle->timers[i] = item;
+    
+    handle->stats.timers_pending = (uint32_t)handle->timer_count;
+    return EM_OK;
+}
+
+/**
+ * @brief 取出堆顶(调用者需持有锁，堆非空)
+ */
+static void timer_pop(em_handle_t handle, em_timer_t* out)
+{
+    *out = handle->timers[0];
+    em_timer_t last = handle->timers[--handle->timer_count];
+    
+    /* 下沉 */
+    int i = 0;
+    for (;;) {
+        int child = 2 * i + 1;
+        if (child >= handle->timer_count) {
+            break;
+        }
+        if (child + 1 < handle->timer_count &&
+            timer_before(&handle->timers[child + 1], &handle->timers[child])) {
+            child++;
+        }
+        if (!timer_before(&handle->timers[child], &last)) {
+            break;
+        }
+        handle->timers[i] = handle->timers[child];
+        i = child;
+    }
+    if (handle->timer_count > 0) {
+        handle->timers[i] = last;
+    }
+    
+    handle->stats.timers_pending = (uint32_t)handle->timer_count;
+}
+
+/**
+ * @brief 把到期的延时事件移入异步队列(调用者需持有锁)
+ * 
+ * @return int 移入的事件数
+ */
+static int fire_due_timers(em_handle_t handle, uint64_t now)
+{
+    int fired = 0;
+    while (handle->timer_count > 0 && handle->timers[0].due_ns <= now) {
+        em_timer_t timer;
+        timer_pop(handle, &timer);
+        
+        /* 以到期时间作为入队时间，排队延迟从到期开始计算 */
+        if (enqueue_locked(handle, &timer.event, timer.data_copy, timer.due_ns, -1) == EM_OK) {
+            fired++;
+        } else {
+            handle->stats.timers_dropped++;
+            if (timer.data_copy != NULL) {
+                payload_release(timer.data_copy);
+            }
+        }
+    }
+    return fired;
+}
+
+/**
+ * @brief 是否有可以立即移入队列的延时事件(调用者需持有锁)
+ */
+static bool timer_ready(em_handle_t handle)
+{
+    if (handle->timer_count == 0) {
+        return false;
+    }
+    return handle->auto_advance || handle->timers[0].due_ns <= clock_now(handle);
+}
+
+#if EM_ENABLE_THREADING
+/**
+ * @brief 距下一个延时事件到期的等待时间，不超过 max_ns(调用者需持有锁)
+ * 
+ * 虚拟时钟只由 em_advance_time 推进，不需要按到期时间醒来。
+ */
+static uint64_t timer_wait_ns(em_handle_t handle, uint64_t max_ns)
+{
+    if (handle->timer_count == 0 || handle->virtual_time) {
+        return max_ns;
+    }
+    uint64_t now = clock_now(handle);
+    uint64_t due = handle->timers[0].due_ns;
+    if (due <= now) {
+        return 0;
+    }
+    return due - now < max_ns ? due - now : max_ns;
+}
+
+/**
+ * @brief 有暂存事件时等待时间不超过暂存时限
+ */
+static uint64_t stage_wait_ns(em_handle_t handle, uint64_t max_ns)
+{
+    if (atomic_load_explicit(&handle->staged_events, memory_order_relaxed) == 0) {
+        return max_ns;
+    }
+    uint64_t delay_ns = atomic_load_explicit(&handle->auto_batch_delay_ns, memory_order_relaxed);
+    return delay_ns < max_ns ? delay_ns : max_ns;
+}
+#endif
+
+/**
+ * @brief 记录一次唤醒及醒来后处理的事件数
+ */
+static void count_wakeup(em_handle_t handle, int drained)
+{
+    atomic_fetch_add_explicit(&handle->wake.wakeups, 1, memory_order_relaxed);
+    if (drained > 0) {
+        atomic_fetch_add_explicit(&handle->wake.drained, (unsigned)drained, memory_order_relaxed);
+    } else {
+        atomic_fetch_add_explicit(&handle->wake.wakeups_empty, 1, memory_order_relaxed);
+    }
+}
+
+/**
+ * @brief 调整队列容量(调用者需持有锁)
+ * 
+ * 持锁期间生产者和消费者都无法访问队列；事件按原顺序从队头开始
+ * 搬到新数组，迁移后队头位于下标0。
+ */
+static em_error_t resize_queue(em_handle_t handle, em_priority_t priority, int capacity)
 {
-    if (handle == NULL) {
-        return EM_ERR_INVALID_PARAM;
-    }
-    
-    lock_manager(handle);
+    em_priority_queue_t* queue = &handle->async_queues[priority];
     
-    /* 保留当前订阅者数量和队列状态 */
-    uint32_t subscribers = handle->stats.subscribers_total;
-    uint32_t queue_current = handle->stats.async_queue_current;
+    if (capacity < queue->count ||
+        (uint32_t)capacity < handle->reserved_total[priority] + handle->shared_used[priority]) {
+        return EM_ERR_QUEUE_FULL;
+    }
+    if (capacity == queue->capacity) {
+        return EM_OK;
+    }
     
-    memset(&handle->stats, 0, sizeof(em_stats_t));
+    em_queue_node_t* nodes = (em_queue_node_t*)calloc((size_t)capacity, sizeof(em_queue_node_t));
+    if (nodes == NULL) {
+        return EM_ERR_OUT_OF_MEMORY;
+    }
     
-    handle->stats.subscribers_total = subscribers;
-    handle->stats.async_queue_current = queue_current;
+    for (int i = 0; i < queue->count; i++) {
+        nodes[i] = queue->nodes[(queue->head + i) % queue->capacity];
+    }
     
-    unlock_manager(handle);
+    free(queue->nodes);
+    queue->nodes = nodes;
+    queue->capacity = capacity;
+    queue->head = 0;
+    queue->tail = queue->count % capacity;
     
+    handle->stats.queue_capacity[priority] = (uint32_t)capacity;
+    handle->stats.queue_resizes++;
+    EM_DEBUG("Queue %d resized to %d", priority, capacity);
     return EM_OK;
 }
 
-int em_get_subscriber_count(em_handle_t handle, em_event_id_t event_id)
+/**
+ * @brief 释放异步队列的节点数组
+ */
+static void free_async_queues(em_handle_t handle)
 {
-    if (handle == NULL || event_id >= EM_MAX_EVENT_TYPES) {
-        return -1;
+    for (int i = 0; i < EM_PRIORITY_COUNT; i++) {
+        free(handle->async_queues[i].nodes);
+        handle->async_queues[i].nodes = NULL;
+        handle->async_queues[i].capacity = 0;
     }
-    
-    lock_manager(handle);
-    int count = handle->event_subscribers[event_id].count;
-    unlock_manager(handle);
-    
-    return count;
 }
 
-bool em_has_subscribers(em_handle_t handle, em_event_id_t event_id)
+/**
+ * @brief 调用事件记录钩子(未设置时只有一次原子读取)
+ */
+static inline void trace_event(em_handle_t handle, const em_event_t* event)
 {
-    return em_get_subscriber_count(handle, event_id) > 0;
+    em_trace_hook_t hook = atomic_load_explicit(&handle->trace_hook, memory_order_acquire);
+    if (hook != NULL) {
+        hook(event, clock_now(handle), atomic_load_explicit(&handle->trace_user, memory_order_relaxed));
+    }
 }
 
-int em_get_queue_size(em_handle_t handle)
+/**
+ * @brief 分发事件到所有订阅者
+ * 
+ * @param payload 异步事件的数据副本(同步事件为NULL)，投递到执行器时持有其引用
+ */
+static void dispatch_event(em_handle_t handle, 
+                          em_event_id_t event_id, 
+                          em_event_data_t data,
+                          void* payload)
 {
-    if (handle == NULL) {
-        return -1;
+    if (event_id >= EM_MAX_EVENT_TYPES) {
+        return;
     }
     
-    lock_manager(handle);
+    lock_manager_shared(handle);
     
-    int total = 0;
-    for (int i = 0; i < EM_PRIORITY_COUNT; i++) {
-        total += handle->async_queues[i].count;
+    em_subscriber_list_t* list = &handle->event_subscribers[event_id];
+    
+    /* 复制订阅者列表(避免在回调中修改) */
+    em_subscriber_t subscribers_copy[EM_MAX_SUBSCRIBERS];
+    int count = 0;
+    
+    for (int i = 0; i < EM_MAX_SUBSCRIBERS; i++) {
+        if (list->subscribers[i].active) {
+            subscribers_copy[count++] = list->subscribers[i];
+            /* 分发期间持有执行器引用，防止并发取消订阅后被释放 */
+            if (list->subscribers[i].executor != NULL) {
+                executor_retain(list->subscribers[i].executor);
+            }
+        }
     }
     
-    unlock_manager(handle);
-    return total;
-}
-
-em_error_t em_clear_queue(em_handle_t handle)
-{
-    if (handle == NULL) {
-        return EM_ERR_INVALID_PARAM;
+    /* 每个订阅组选出一个成员 */
+    em_group_pick_t picks[EM_MAX_GROUPS];
+    int pick_count = 0;
+    if (handle->group_members[event_id] > 0) {
+        pick_count = group_pick(handle, event_id, data, picks);
     }
     
-    lock_manager(handle);
+    unlock_manager(handle);
     
-    for (int i = 0; i < EM_PRIORITY_COUNT; i++) {
-        em_priority_queue_t* queue = &handle->async_queues[i];
+    atomic_fetch_add_explicit(&handle->events_processed, 1, memory_order_relaxed);
+    
+    /* 在锁外调用回调(避免死锁) */
+    uint32_t dropped = 0;
+    for (int i = 0; i < count; i++) {
+        if (subscribers_copy[i].callback == NULL) {
+            continue;
+        }
         
-        /* 释放所有数据副本 */
-        for (int j = 0; j < EM_ASYNC_QUEUE_SIZE; j++) {
-            if (queue->nodes[j].data_copy != NULL) {
-                free(queue->nodes[j].data_copy);
-                queue->nodes[j].data_copy = NULL;
-            }
-            queue->nodes[j].used = false;
+        if (subscribers_copy[i].executor == NULL) {
+            subscribers_copy[i].callback(event_id, data, subscribers_copy[i].user_data);
+            continue;
         }
         
-        queue->head = 0;
-        queue->tail = 0;
-        queue->count = 0;
+        /* 投递到执行器收件箱，由执行器所属线程执行 */
+        em_executor_t* executor = subscribers_copy[i].executor;
+        if (atomic_load(&executor->closed)) {
+            executor_release(executor);
+            continue;
+        }
+        
+        em_invocation_t inv = {
+            .callback = subscribers_copy[i].callback,
+            .event_id = event_id,
+            .data = data,
+            .user_data = subscribers_copy[i].user_data,
+            .payload = payload
+        };
+        
+        if (payload != NULL) {
+            payload_retain(payload);
+        }
+        
+        if (inbox_push(executor, &inv)) {
+            executor_notify(executor);
+        } else {
+            if (payload != NULL) {
+                payload_release(payload);
+            }
+            dropped++;
+        }
+        executor_release(executor);
     }
     
-    handle->stats.async_queue_current = 0;
+    for (int i = 0; i < pick_count; i++) {
+        picks[i].callback(event_id, data, picks[i].user_data);
+        atomic_fetch_sub_explicit(picks[i].load, 1, memory_order_relaxed);
+    }
     
-    unlock_manager(handle);
+    if (dropped > 0) {
+        lock_manager(handle);
+        handle->stats.executor_dropped += dropped;
+        unlock_manager(handle);
+    }
     
-    EM_DEBUG("Async queue cleared");
-    return EM_OK;
+    EM_DEBUG("Dispatched event %u to %d subscribers and %d groups", event_id, count, pick_count);
 }
 
-const char* em_error_string(em_error_t error)
+#if EM_USE_EPOLL
+/**
+ * @brief 释放数据源未读满的帧和备用块(调用者需持有锁，且事件循环未在读取)
+ */
+static void fd_source_reset(em_fd_source_t* src)
 {
-    switch (error) {
-        case EM_OK:                 return "Success";
-        case EM_ERR_INVALID_PARAM:  return "Invalid parameter";
-        case EM_ERR_NOT_INITIALIZED: return "Not initialized";
-        case EM_ERR_ALREADY_INIT:   return "Already initialized";
-        case EM_ERR_OUT_OF_MEMORY:  return "Out of memory";
-        case EM_ERR_QUEUE_FULL:     return "Queue is full";
-        case EM_ERR_QUEUE_EMPTY:    return "Queue is empty";
-        case EM_ERR_MAX_SUBSCRIBERS: return "Maximum subscribers reached";
-        case EM_ERR_NOT_FOUND:      return "Not found";
-        case EM_ERR_MUTEX_FAILED:   return "Mutex operation failed";
-        default:                    return "Unknown error";
+    if (src->partial != NULL) {
+        payload_release(src->partial);
+        src->partial = NULL;
     }
+    for (int i = 0; i < src->spare_count; i++) {
+        payload_release(src->spare[i]);
+    }
+    src->spare_count = 0;
+    src->header_filled = 0;
+    src->filled = 0;
 }
 
-const char* em_version(void)
-{
-    return EM_VERSION_STRING;
-}
-
-/*============================================================================
- *                              内部函数实现
- *============================================================================*/
-
 /**
- * @brief 对订阅者列表按优先级排序(插入排序)
+ * @brief 恢复监听已到重试时间的暂停数据源，返回不超过 max_ns 的等待时间(调用者需持有锁)
  */
-static void sort_subscribers(em_subscriber_list_t* list)
+static uint64_t fd_resume_wait_ns(em_handle_t handle, uint64_t max_ns)
 {
-    if (list->sorted || list->count <= 1) {
-        return;
+    if (handle->fd_paused_count == 0) {
+        return max_ns;
     }
     
-    /* 简单的插入排序 */
-    for (int i = 1; i < EM_MAX_SUBSCRIBERS; i++) {
-        if (!list->subscribers[i].active) continue;
-        
-        em_subscriber_t temp = list->subscribers[i];
-        int j = i - 1;
-        
-        while (j >= 0 && list->subscribers[j].active && 
-               list->subscribers[j].priority > temp.priority) {
-            list->subscribers[j + 1] = list->subscribers[j];
-            j--;
+    uint64_t now = now_ns();
+    uint64_t wait_ns = max_ns;
+    for (int i = 0; i < EM_MAX_FD_SOURCES; i++) {
+        em_fd_source_t* src = &handle->fd_sources[i];
+        if (!src->paused) {
+            continue;
+        }
+        if (src->resume_ns > now) {
+            if (src->resume_ns - now < wait_ns) {
+                wait_ns = src->resume_ns - now;
+            }
+            continue;
         }
         
-        list->subscribers[j + 1] = temp;
+        struct epoll_event ev;
+        ev.events = EPOLLIN;
+        ev.data.u64 = (uint64_t)i + 1;
+        epoll_ctl(handle->epoll_fd, EPOLL_CTL_MOD, src->fd, &ev);
+        src->paused = false;
+        handle->fd_paused_count--;
     }
-    
-    list->sorted = true;
+    return wait_ns;
 }
 
 /**
- * @brief 将事件加入队列
+ * @brief 取一个最大帧大小的数据块，优先使用上次未用完的块
  */
-static em_error_t enqueue_event(em_priority_queue_t* queue, 
-                                const em_event_t* event, 
-                                void* data_copy)
+static void* fd_source_block(em_handle_t handle, em_fd_source_t* src)
 {
-    if (queue->count >= EM_ASYNC_QUEUE_SIZE) {
-        return EM_ERR_QUEUE_FULL;
+    if (src->spare_count > 0) {
+        return src->spare[--src->spare_count];
+    }
+    size_t size = src->config.frame_size;
+    if (src->config.framing == EM_FD_FRAME_DATAGRAM) {
+        size += sizeof(em_frame_t);
+    }
+    return payload_alloc_for(handle, size, src->config.priority);
+}
+
+static void fd_source_keep(em_fd_source_t* src, void* block)
+{
+    if (src->spare_count < EM_FD_READ_BATCH) {
+        src->spare[src->spare_count++] = block;
+    } else {
+        payload_release(block);
     }
+}
+
+/** 读返回错误时，是否只是暂时没有数据 */
+static bool fd_transient_error(void)
+{
+    return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+}
+
+/**
+ * @brief 定长帧：一次 readv 读入多个数据块，不足一帧的部分留到下次
+ * 
+ * @return bool 对端关闭或读错误时返回true
+ */
+static bool fd_read_fixed(em_handle_t handle, em_fd_source_t* src,
+                          em_fd_read_t* frames, int* count, uint32_t* reads)
+{
+    size_t frame_size = src->config.frame_size;
+    struct iovec iov[EM_FD_READ_BATCH];
+    void* blocks[EM_FD_READ_BATCH];
+    size_t base = 0;
+    int n = 0;
     
-    int idx = queue->tail;
-    queue->nodes[idx].event = *event;
-    queue->nodes[idx].data_copy = data_copy;
-    queue->nodes[idx].used = true;
+    if (src->partial != NULL) {
+        base = src->filled;
+        blocks[0] = src->partial;
+        iov[0].iov_base = (char*)src->partial + base;
+        iov[0].iov_len = frame_size - base;
+        src->partial = NULL;
+        n = 1;
+    }
+    while (n < EM_FD_READ_BATCH) {
+        void* block = fd_source_block(handle, src);
+        if (block == NULL) {
+            break;
+        }
+        blocks[n] = block;
+        iov[n].iov_base = block;
+        iov[n].iov_len = frame_size;
+        n++;
+    }
+    if (n == 0) {
+        src->starved = true;
+        return false;
+    }
     
-    queue->tail = (queue->tail + 1) % EM_ASYNC_QUEUE_SIZE;
-    queue->count++;
+    ssize_t got = readv(src->fd, iov, n);
+    (*reads)++;
+    bool closed = (got == 0) || (got < 0 && !fd_transient_error());
+    size_t left = got > 0 ? (size_t)got : 0;
     
-    return EM_OK;
+    for (int i = 0; i < n; i++) {
+        size_t have = (i == 0) ? base : 0;
+        size_t take = left < frame_size - have ? left : frame_size - have;
+        left -= take;
+        have += take;
+        
+        if (have == frame_size) {
+            frames[*count].payload = blocks[i];
+            frames[*count].size = frame_size;
+            (*count)++;
+        } else if (have > 0) {
+            src->partial = blocks[i];
+            src->filled = (uint32_t)have;
+        } else {
+            fd_source_keep(src, blocks[i]);
+        }
+    }
+    return closed;
 }
 
 /**
- * @brief 从队列取出事件
+ * @brief 长度前缀帧：读出长度后按帧长分配 em_frame_t，读帧体时顺带读下一帧的长度前缀
+ * 
+ * @return bool 对端关闭、读错误或长度超过 frame_size 时返回true
  */
-static em_error_t dequeue_event(em_priority_queue_t* queue, 
-                                em_event_t* event, 
-                                void** data_copy)
+static bool fd_read_length(em_handle_t handle, em_fd_source_t* src,
+                           em_fd_read_t* frames, int* count, uint32_t* reads)
 {
-    if (queue->count == 0) {
-        return EM_ERR_QUEUE_EMPTY;
-    }
+    uint32_t prefix = src->config.length_bytes;
     
-    int idx = queue->head;
-    *event = queue->nodes[idx].event;
-    *data_copy = queue->nodes[idx].data_copy;
+    while (*count < EM_FD_READ_BATCH) {
+        if (src->partial == NULL) {
+            if (src->header_filled < prefix) {
+                ssize_t got = read(src->fd, src->header + src->header_filled,
+                                   prefix - src->header_filled);
+                (*reads)++;
+                if (got <= 0) {
+                    return got == 0 || !fd_transient_error();
+                }
+                src->header_filled += (uint32_t)got;
+                continue;
+            }
+            
+            uint32_t len = 0;
+            for (uint32_t i = 0; i < prefix; i++) {
+                len = (len << 8) | src->header[i];
+            }
+            if (len > src->config.frame_size) {
+                EM_DEBUG("fd source frame too long: %u", len);
+                return true;
+            }
+            
+            /* 分配失败时保留已读的长度前缀，下次就绪时重试 */
+            em_frame_t* frame = (em_frame_t*)payload_alloc_for(handle, sizeof(em_frame_t) + len,
+                                                               src->config.priority);
+            if (frame == NULL) {
+                src->starved = true;
+                return false;
+            }
+            frame->size = len;
+            src->header_filled = 0;
+            src->partial = frame;
+            src->frame_len = len;
+            src->filled = 0;
+            if (len == 0) {
+                frames[*count].payload = frame;
+                frames[*count].size = sizeof(em_frame_t);
+                (*count)++;
+                src->partial = NULL;
+                continue;
+            }
+        }
+        
+        struct iovec iov[2];
+        iov[0].iov_base = ((em_frame_t*)src->partial)->data + src->filled;
+        iov[0].iov_len = src->frame_len - src->filled;
+        iov[1].iov_base = src->header;
+        iov[1].iov_len = prefix;
+        ssize_t got = readv(src->fd, iov, 2);
+        (*reads)++;
+        if (got <= 0) {
+            return got == 0 || !fd_transient_error();
+        }
+        
+        size_t body = (size_t)got < iov[0].iov_len ? (size_t)got : iov[0].iov_len;
+        src->filled += (uint32_t)body;
+        if (src->filled == src->frame_len) {
+            frames[*count].payload = src->partial;
+            frames[*count].size = sizeof(em_frame_t) + src->frame_len;
+            (*count)++;
+            src->partial = NULL;
+            src->header_filled = (uint32_t)((size_t)got - body);
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief 数据报：一次 recvmmsg 接收多个数据报，每个读入一个数据块
+ * 
+ * @return bool 读错误时返回true
+ */
+static bool fd_read_datagram(em_handle_t handle, em_fd_source_t* src,
+                             em_fd_read_t* frames, int* count, uint32_t* reads,
+                             uint32_t* dropped)
+{
+    struct mmsghdr msgs[EM_FD_READ_BATCH];
+    struct iovec iov[EM_FD_READ_BATCH];
+    void* blocks[EM_FD_READ_BATCH];
+    int n = 0;
     
-    queue->nodes[idx].used = false;
-    queue->nodes[idx].data_copy = NULL;
+    while (n < EM_FD_READ_BATCH) {
+        void* block = fd_source_block(handle, src);
+        if (block == NULL) {
+            break;
+        }
+        blocks[n] = block;
+        iov[n].iov_base = ((em_frame_t*)block)->data;
+        iov[n].iov_len = src->config.frame_size;
+        memset(&msgs[n], 0, sizeof(msgs[n]));
+        msgs[n].msg_hdr.msg_iov = &iov[n];
+        msgs[n].msg_hdr.msg_iovlen = 1;
+        n++;
+    }
+    if (n == 0) {
+        src->starved = true;
+        return false;
+    }
     
-    queue->head = (queue->head + 1) % EM_ASYNC_QUEUE_SIZE;
-    queue->count--;
+    int got = recvmmsg(src->fd, msgs, (unsigned int)n, MSG_DONTWAIT, NULL);
+    (*reads)++;
+    bool closed = got < 0 && !fd_transient_error() && errno != ECONNREFUSED;
     
-    return EM_OK;
+    for (int i = 0; i < n; i++) {
+        if (i < got && !(msgs[i].msg_hdr.msg_flags & MSG_TRUNC)) {
+            ((em_frame_t*)blocks[i])->size = msgs[i].msg_len;
+            frames[*count].payload = blocks[i];
+            frames[*count].size = sizeof(em_frame_t) + msgs[i].msg_len;
+            (*count)++;
+        } else {
+            if (i < got) {
+                (*dropped)++;
+            }
+            fd_source_keep(src, blocks[i]);
+        }
+    }
+    return closed;
 }
 
 /**
- * @brief 分发事件到所有订阅者
+ * @brief 读取就绪的数据源并以异步事件发布读到的帧(在事件循环线程调用)
  */
-static void dispatch_event(em_handle_t handle, 
-                          em_event_id_t event_id, 
-                          em_event_data_t data)
+static void fd_source_ready(em_handle_t handle, int source)
 {
-    if (event_id >= EM_MAX_EVENT_TYPES) {
+    if (source < 0 || source >= EM_MAX_FD_SOURCES) {
         return;
     }
+    em_fd_source_t* src = &handle->fd_sources[source];
     
     lock_manager(handle);
-    
-    em_subscriber_list_t* list = &handle->event_subscribers[event_id];
-    
-    /* 确保按优先级排序 */
-    if (!list->sorted) {
-        sort_subscribers(list);
+    if (!src->active || src->reading) {
+        unlock_manager(handle);
+        return;
     }
+    src->reading = true;
+    unlock_manager(handle);
     
-    /* 复制订阅者列表(避免在回调中修改) */
-    em_subscriber_t subscribers_copy[EM_MAX_SUBSCRIBERS];
+    /* 在锁外读取，读到的数据块就是事件的数据副本 */
+    em_fd_read_t frames[EM_FD_READ_BATCH];
     int count = 0;
+    uint32_t reads = 0;
+    uint32_t dropped = 0;
+    bool closed;
+    switch (src->config.framing) {
+    case EM_FD_FRAME_FIXED:
+        closed = fd_read_fixed(handle, src, frames, &count, &reads);
+        break;
+    case EM_FD_FRAME_LENGTH:
+        closed = fd_read_length(handle, src, frames, &count, &reads);
+        break;
+    default:
+        closed = fd_read_datagram(handle, src, frames, &count, &reads, &dropped);
+        break;
+    }
     
-    for (int i = 0; i < EM_MAX_SUBSCRIBERS; i++) {
-        if (list->subscribers[i].active) {
-            subscribers_copy[count++] = list->subscribers[i];
-        }
+    lock_manager(handle);
+    
+    src->reading = false;
+    if (closed && src->active) {
+        src->active = false;
+        handle->fd_source_count--;
+        epoll_ctl(handle->epoll_fd, EPOLL_CTL_DEL, src->fd, NULL);
+        handle->stats.fd_closed++;
+        EM_DEBUG("fd source %d closed", source);
+    }
+    if (!src->active) {
+        fd_source_reset(src);
     }
     
-    handle->stats.events_processed++;
+    /* 
+     * 没有可用的数据块时不读取，fd 仍可读，水平触发下 epoll_wait 会立即返回。
+     * 暂停监听，块被释放后(EM_FD_STALL_RETRY_US 之后)再重试
+     */
+    if (src->starved && src->active && !src->paused) {
+        struct epoll_event ev;
+        ev.events = 0;
+        ev.data.u64 = (uint64_t)source + 1;
+        if (epoll_ctl(handle->epoll_fd, EPOLL_CTL_MOD, src->fd, &ev) == 0) {
+            src->paused = true;
+            src->resume_ns = now_ns() + (uint64_t)EM_FD_STALL_RETRY_US * 1000;
+            handle->fd_paused_count++;
+        }
+        handle->stats.fd_stalls++;
+    }
+    src->starved = false;
     
-    unlock_manager(handle);
+    uint64_t now = clock_now(handle);
+    em_priority_t priority = src->config.priority;
+    if (count > 0 && handle->shed.config.enabled) {
+        shed_update(handle, now);
+    }
+    bool shed = handle->shed.level > 0 && (int)priority >= EM_PRIORITY_COUNT - handle->shed.level;
     
-    /* 在锁外调用回调(避免死锁) */
+    int queued = 0;
     for (int i = 0; i < count; i++) {
-        if (subscribers_copy[i].callback != NULL) {
-            subscribers_copy[i].callback(event_id, data, subscribers_copy[i].user_data);
+        em_event_t event = {
+            .id = src->config.event_id,
+            .data = frames[i].payload,
+            .data_size = frames[i].size,
+            .priority = priority,
+            .mode = EM_MODE_ASYNC
+        };
+        if (shed) {
+            handle->stats.events_shed[priority]++;
+        } else if (enqueue_locked(handle, &event, frames[i].payload, now, -1) == EM_OK) {
+            queued++;
+            continue;
         }
+        payload_release(frames[i].payload);
+        dropped++;
+    }
+    
+    handle->stats.fd_reads += reads;
+    handle->stats.fd_events += (uint32_t)queued;
+    handle->stats.fd_dropped += dropped;
+    
+    /* 本线程就是事件循环，下一轮会处理这些事件，只需唤醒等待的工作线程 */
+    if (queued > 0) {
+        wake_waiters(handle, &handle->wake_q, false);
+        atomic_fetch_add_explicit(&handle->wake.signals, 1, memory_order_relaxed);
     }
     
-    EM_DEBUG("Dispatched event %u to %d subscribers", event_id, count);
+    unlock_manager(handle);
 }
+#endif
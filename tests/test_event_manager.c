@@ -381,6 +381,108 @@ void test_publish_async_with_data_copy(void)
     TEST_PASS();
 }
 
+void test_publish_group(void)
+{
+    TEST_START("原子发布事件组");
+    
+    em_handle_t em = em_create();
+    em_subscribe(em, 0, test_callback, NULL, EM_PRIORITY_NORMAL);
+    reset_counters();
+    
+    int values[4] = { 1, 2, 3, 9 };
+    em_event_t group[4];
+    for (int i = 0; i < 4; i++) {
+        group[i].id = 0;
+        group[i].data = &values[i];
+        group[i].data_size = sizeof(int);
+        group[i].priority = i < 3 ? EM_PRIORITY_NORMAL : EM_PRIORITY_HIGH;
+        group[i].mode = EM_MODE_SYNC;   /* 被忽略 */
+    }
+    
+    int other = 5;
+    em_publish_async(em, 0, &other, sizeof(int), EM_PRIORITY_NORMAL);
+    ASSERT_EQ(em_publish_group(em, group, 4), EM_OK, "发布事件组失败");
+    ASSERT_EQ(em_get_queue_size(em), 5, "队列大小不正确");
+    
+    /* 数据已复制 */
+    values[0] = 100;
+    
+    /* HIGH 先出队，其余保持数组顺序 */
+    int expected[5] = { 9, 5, 1, 2, 3 };
+    for (int i = 0; i < 5; i++) {
+        ASSERT_EQ(em_process_one(em), EM_OK, "处理失败");
+        ASSERT_EQ(last_data_value, expected[i], "事件顺序不正确");
+    }
+    
+    /* 放不下整组时一个也不入队 */
+    for (int i = 0; i < EM_ASYNC_QUEUE_SIZE - 2; i++) {
+        em_publish_async(em, 0, NULL, 0, EM_PRIORITY_NORMAL);
+    }
+    ASSERT_EQ(em_publish_group(em, group, 3), EM_ERR_QUEUE_FULL, "应返回队列已满");
+    ASSERT_EQ(em_get_queue_size(em), EM_ASYNC_QUEUE_SIZE - 2, "部分事件被入队");
+    ASSERT_EQ(em_publish_group(em, group, 2), EM_OK, "空间足够时应成功");
+    
+    ASSERT_EQ(em_publish_group(em, group, 0), EM_ERR_INVALID_PARAM, "空组应失败");
+    ASSERT_EQ(em_publish_group(em, NULL, 1), EM_ERR_INVALID_PARAM, "空指针应失败");
+    
+    em_destroy(em);
+    TEST_PASS();
+}
+
+void test_publish_on_change(void)
+{
+    TEST_START("只在数据变化时发布");
+    reset_counters();
+    
+    em_handle_t em = em_create();
+    em_subscribe(em, 1, test_callback, NULL, EM_PRIORITY_NORMAL);
+    ASSERT_EQ(em_set_publish_on_change(em, 1, true, sizeof(int)), EM_OK, "开启失败");
+    
+    /* 异步：相同的值只发布一次 */
+    int value = 5;
+    ASSERT_EQ(em_publish_async(em, 1, &value, sizeof(value), EM_PRIORITY_NORMAL), EM_OK, "首次发布应通过");
+    ASSERT_EQ(em_publish_async(em, 1, &value, sizeof(value), EM_PRIORITY_NORMAL), EM_SUPPRESSED, "未变化应抑制");
+    ASSERT_EQ(em_get_queue_size(em), 1, "被抑制的事件不应入队");
+    value = 6;
+    ASSERT_EQ(em_publish_async(em, 1, &value, sizeof(value), EM_PRIORITY_NORMAL), EM_OK, "变化后应发布");
+    em_process_all(em);
+    ASSERT_EQ(callback_counter, 2, "应分发2次");
+    ASSERT_EQ(last_data_value, 6, "应收到最新的值");
+    
+    /* 同步按 sync_size 比较，与异步共用上次的记录 */
+    ASSERT_EQ(em_publish_sync(em, 1, &value), EM_SUPPRESSED, "同步未变化应抑制");
+    value = 7;
+    ASSERT_EQ(em_publish_sync(em, 1, &value), EM_OK, "同步变化后应发布");
+    ASSERT_EQ(callback_counter, 3, "同步应分发1次");
+    
+    /* 入队失败不更新记录 */
+    em_resize_queue(em, EM_PRIORITY_LOW, 1);
+    int other = 100;
+    ASSERT_EQ(em_publish_async(em, 1, &other, sizeof(other), EM_PRIORITY_LOW), EM_OK, "应入队");
+    other = 101;
+    ASSERT_EQ(em_publish_async(em, 1, &other, sizeof(other), EM_PRIORITY_LOW), EM_ERR_QUEUE_FULL, "队列应满");
+    em_process_all(em);
+    ASSERT_EQ(em_publish_async(em, 1, &other, sizeof(other), EM_PRIORITY_LOW), EM_OK, "未送达的值应能重发");
+    em_process_all(em);
+    
+    em_stats_t stats;
+    em_get_stats(em, &stats);
+    ASSERT_EQ(stats.events_suppressed, 2, "抑制计数应为2");
+    
+    /* 关闭后不再比较；其他事件不受影响 */
+    em_set_publish_on_change(em, 1, false, 0);
+    ASSERT_EQ(em_publish_sync(em, 1, &other), EM_OK, "关闭后应发布");
+    ASSERT_EQ(em_publish_sync(em, 1, &other), EM_OK, "关闭后重复也应发布");
+    ASSERT_EQ(em_publish_sync(em, 2, NULL), EM_OK, "未开启的事件应正常发布");
+    
+    ASSERT_EQ(em_set_publish_on_change(em, EM_MAX_EVENT_TYPES, true, 0), EM_ERR_INVALID_PARAM,
+              "无效事件ID应失败");
+    ASSERT_EQ(em_set_publish_on_change(NULL, 1, true, 0), EM_ERR_INVALID_PARAM, "空句柄应失败");
+    
+    em_destroy(em);
+    TEST_PASS();
+}
+
 void test_process_all(void)
 {
     TEST_START("处理所有异步事件");
@@ -431,6 +533,94 @@ static void low_priority_handler(em_event_id_t id, em_event_data_t data, void* u
     priority_order[priority_index++] = 2;
 }
 
+/* 订阅组测试：按 user_data 指向的计数器记录每个成员收到的事件 */
+static em_handle_t group_test_em = NULL;
+static int group_nested = 0;
+
+static void group_member_callback(em_event_id_t event_id, em_event_data_t data, void* user_data)
+{
+    (void)event_id; (void)data;
+    (*(int*)user_data)++;
+}
+
+/* 第一次执行时同步发布同一事件，此时本成员负载为1 */
+static void group_nesting_callback(em_event_id_t event_id, em_event_data_t data, void* user_data)
+{
+    (*(int*)user_data)++;
+    if (group_nested++ == 0) {
+        em_publish_sync(group_test_em, event_id, data);
+    }
+}
+
+static uint32_t group_key(em_event_id_t event_id, em_event_data_t data)
+{
+    (void)event_id;
+    return (uint32_t)*(const int*)data;
+}
+
+void test_subscriber_groups(void)
+{
+    TEST_START("订阅组竞争消费");
+    
+    em_handle_t em = em_create();
+    int broadcast = 0;
+    int hits[3] = { 0, 0, 0 };
+    
+    em_subscribe(em, 0, group_member_callback, &broadcast, EM_PRIORITY_NORMAL);
+    for (int i = 0; i < 3; i++) {
+        ASSERT_EQ(em_subscribe_group(em, 0, 1, group_member_callback, &hits[i]), EM_OK, "加入订阅组失败");
+    }
+    ASSERT_EQ(em_subscribe_group(em, 0, 1, group_member_callback, &hits[0]), EM_OK, "重复加入应成功");
+    ASSERT_EQ(em_subscribe_group(em, 0, 0, group_member_callback, &hits[0]), EM_ERR_INVALID_PARAM,
+              "组ID为0应被拒绝");
+    ASSERT_EQ(em_get_subscriber_count(em, 0), 4, "订阅者数量应包括组成员");
+    
+    /* 轮询：每个成员各收到三分之一，普通订阅者收到全部 */
+    for (int i = 0; i < 6; i++) {
+        em_publish_async(em, 0, NULL, 0, EM_PRIORITY_NORMAL);
+    }
+    em_process_all(em);
+    ASSERT_EQ(broadcast, 6, "普通订阅者应收到全部事件");
+    ASSERT_TRUE(hits[0] == 2 && hits[1] == 2 && hits[2] == 2, "轮询分配不均");
+    
+    /* 键值哈希：同一键值总由同一成员处理 */
+    ASSERT_EQ(em_set_group_policy(em, 1, EM_GROUP_KEY_HASH, NULL), EM_ERR_INVALID_PARAM,
+              "键值哈希必须提供键值函数");
+    ASSERT_EQ(em_set_group_policy(em, 1, EM_GROUP_KEY_HASH, group_key), EM_OK, "设置策略失败");
+    memset(hits, 0, sizeof(hits));
+    int key = 42;
+    for (int i = 0; i < 5; i++) {
+        em_publish_async(em, 0, &key, sizeof(key), EM_PRIORITY_NORMAL);
+    }
+    em_process_all(em);
+    ASSERT_EQ(hits[0] + hits[1] + hits[2], 5, "每个事件应只投递给一个成员");
+    ASSERT_TRUE(hits[0] == 5 || hits[1] == 5 || hits[2] == 5, "同一键值应由同一成员处理");
+    
+    /* 最少负载：执行中的成员负载为1，嵌套发布的事件交给其他成员 */
+    ASSERT_EQ(em_unsubscribe_group(em, 0, 1, group_member_callback, &hits[2]), EM_OK, "退出订阅组失败");
+    ASSERT_EQ(em_unsubscribe_group(em, 0, 1, group_member_callback, &hits[2]), EM_ERR_NOT_FOUND,
+              "重复退出应返回未找到");
+    em_unsubscribe_all(em, 0);
+    ASSERT_EQ(em_get_subscriber_count(em, 0), 0, "取消所有订阅应包括组成员");
+    
+    group_test_em = em;
+    group_nested = 0;
+    memset(hits, 0, sizeof(hits));
+    em_set_group_policy(em, 2, EM_GROUP_LEAST_LOADED, NULL);
+    em_subscribe_group(em, 0, 2, group_nesting_callback, &hits[0]);
+    em_subscribe_group(em, 0, 2, group_nesting_callback, &hits[1]);
+    em_publish_sync(em, 0, NULL);
+    ASSERT_TRUE(hits[0] == 1 && hits[1] == 1, "嵌套事件应交给负载较低的成员");
+    
+    em_stats_t stats;
+    em_get_stats(em, &stats);
+    ASSERT_EQ(stats.subscribers_total, 2, "总订阅者数不正确");
+    
+    em_destroy(em);
+    group_test_em = NULL;
+    TEST_PASS();
+}
+
 void test_subscriber_priority(void)
 {
     TEST_START("订阅者优先级");
@@ -577,6 +767,59 @@ void test_reset_statistics(void)
     TEST_PASS();
 }
 
+void test_top_events(void)
+{
+    TEST_START("热点事件统计");
+    
+    em_handle_t em = em_create();
+    ASSERT_NOT_NULL(em, "创建失败");
+    
+    em_top_event_t top[EM_TOP_EVENTS_K];
+    ASSERT_EQ(em_get_top_events(em, 4, EM_TOP_BY_COUNT, top), 0, "未开启时应无结果");
+    ASSERT_EQ(em_set_top_events(em, true), EM_OK, "开启失败");
+    
+    /* 5: 次数最多但数据小；7: 次数第二但字节最多；10..40: 长尾 */
+    uint8_t small[4] = {0};
+    uint8_t large[100] = {0};
+    for (int i = 0; i < 1000; i++) {
+        em_publish_async(em, 5, small, sizeof(small), EM_PRIORITY_NORMAL);
+        if (i % 2 == 0) {
+            em_publish_async(em, 7, large, sizeof(large), EM_PRIORITY_NORMAL);
+        }
+        em_process_all(em);
+    }
+    for (int id = 10; id <= 40; id++) {
+        for (int i = 0; i < 10; i++) {
+            em_publish_sync(em, (em_event_id_t)id, NULL);
+        }
+    }
+    
+    int n = em_get_top_events(em, 2, EM_TOP_BY_COUNT, top);
+    ASSERT_EQ(n, 2, "应返回2项");
+    ASSERT_EQ(top[0].id, 5, "次数最多应为事件5");
+    ASSERT_EQ(top[1].id, 7, "次数第二应为事件7");
+    ASSERT_TRUE(top[0].count >= 1000 && top[1].count >= 500, "估计值不应偏小");
+    
+    n = em_get_top_events(em, EM_TOP_EVENTS_K, EM_TOP_BY_BYTES, top);
+    ASSERT_TRUE(n >= 2, "按字节数应至少2项");
+    ASSERT_EQ(top[0].id, 7, "字节最多应为事件7");
+    ASSERT_TRUE(top[0].bytes >= 50000, "字节估计不应偏小");
+    
+    /* 重新开启清零 */
+    ASSERT_EQ(em_set_top_events(em, true), EM_OK, "重新开启失败");
+    ASSERT_EQ(em_get_top_events(em, 4, EM_TOP_BY_COUNT, top), 0, "重新开启应清零");
+    em_publish_sync(em, 3, NULL);
+    n = em_get_top_events(em, 4, EM_TOP_BY_COUNT, top);
+    ASSERT_TRUE(n == 1 && top[0].id == 3 && top[0].count == 1, "应只统计新的发布");
+    
+    ASSERT_EQ(em_get_top_events(em, -1, EM_TOP_BY_COUNT, top), EM_ERR_INVALID_PARAM, "k为负应失败");
+    ASSERT_EQ(em_get_top_events(em, 1, (em_top_order_t)5, top), EM_ERR_INVALID_PARAM, "排序依据无效应失败");
+    ASSERT_EQ(em_set_top_events(NULL, true), EM_ERR_INVALID_PARAM, "空句柄应失败");
+    
+    em_destroy(em);
+    TEST_PASS();
+}
+
 /*============================================================================
  *                              工具函数测试
  *============================================================================*/
@@ -627,127 +870,1828 @@ void test_version(void)
     TEST_PASS();
 }
 
-/*============================================================================
- *                              事件循环测试
- *============================================================================*/
-
-#if EM_ENABLE_THREADING
-#include <pthread.h>
-
-static em_handle_t loop_test_em = NULL;
-static volatile int loop_callback_count = 0;
+void test_clock_sources(void)
+{
+    TEST_START("时间源选择与回退");
+    
+    em_clock_source_t sources[] = { EM_CLOCK_MONOTONIC, EM_CLOCK_MONOTONIC_COARSE, EM_CLOCK_TSC };
+    for (int i = 0; i < 3; i++) {
+        em_config_t cfg;
+        em_config_init(&cfg);
+        ASSERT_EQ(cfg.clock_source, EM_CLOCK_MONOTONIC, "默认时间源不正确");
+        cfg.clock_source = sources[i];
+        
+        em_handle_t em = em_create_with_config(&cfg);
+        ASSERT_NOT_NULL(em, "创建失败");
+        
+        /* 不可用时回退到 CLOCK_MONOTONIC */
+        em_clock_source_t actual = em_get_clock_source(em);
+        ASSERT_TRUE(actual == sources[i] || actual == EM_CLOCK_MONOTONIC, "时间源不正确");
+        
+        /* 单调递增，且与真实时间大致一致 */
+        uint64_t t0 = em_time_ns(em);
+        struct timespec ts = {0, 20000000};  /* 20ms */
+        nanosleep(&ts, NULL);
+        uint64_t t1 = em_time_ns(em);
+        ASSERT_TRUE(t1 > t0, "时间未递增");
+        ASSERT_TRUE(t1 - t0 >= 10000000ull && t1 - t0 < 500000000ull, "时间间隔不正确");
+        
+        em_destroy(em);
+    }
+    
+    ASSERT_EQ(em_time_ns(NULL), 0, "空句柄应返回0");
+    TEST_PASS();
+}
 
-static void loop_callback(em_event_id_t id, em_event_data_t data, void* user)
+void test_virtual_time(void)
 {
-    (void)id; (void)data; (void)user;
-    loop_callback_count++;
+    TEST_START("虚拟时钟与延时事件");
+    
+    const uint64_t sec = 1000000000ull;
+    em_config_t cfg;
+    em_config_init(&cfg);
+    cfg.virtual_time = true;
+    
+    em_handle_t em = em_create_with_config(&cfg);
+    em_subscribe(em, 0, test_callback, NULL, EM_PRIORITY_NORMAL);
+    reset_counters();
+    ASSERT_EQ(em_time_ns(em), 0, "虚拟时钟应从0开始");
+    
+    int a = 1, b = 2, c = 3;
+    em_publish_delayed(em, 0, &a, sizeof(int), EM_PRIORITY_NORMAL, 10 * sec);
+    em_publish_delayed(em, 0, &b, sizeof(int), EM_PRIORITY_NORMAL, 5 * sec);
+    em_publish_delayed(em, 0, &c, sizeof(int), EM_PRIORITY_NORMAL, 5 * sec);
+    ASSERT_EQ(em_process_all(em), 0, "未到期的事件不应被处理");
+    
+    /* 同一时间到期的按发布顺序 */
+    ASSERT_EQ(em_advance_time(em, 5 * sec), EM_OK, "推进时钟失败");
+    ASSERT_EQ(em_process_one(em), EM_OK, "处理失败");
+    ASSERT_EQ(last_data_value, 2, "到期顺序不正确");
+    ASSERT_EQ(em_process_one(em), EM_OK, "处理失败");
+    ASSERT_EQ(last_data_value, 3, "到期顺序不正确");
+    ASSERT_EQ(em_process_all(em), 0, "事件提前到期");
+    
+    em_advance_time(em, 5 * sec);
+    ASSERT_EQ(em_process_all(em), 1, "事件未到期");
+    ASSERT_EQ(last_data_value, 1, "数据不正确");
+    ASSERT_EQ(em_time_ns(em), 10 * sec, "虚拟时钟不正确");
+    em_destroy(em);
+    
+    /* 空闲时自动跳到下一个到期时间 */
+    cfg.virtual_auto_advance = true;
+    em = em_create_with_config(&cfg);
+    em_subscribe(em, 0, test_callback, NULL, EM_PRIORITY_NORMAL);
+    reset_counters();
+    for (int i = 1; i <= 3; i++) {
+        em_publish_delayed(em, 0, &i, sizeof(int), EM_PRIORITY_NORMAL, (uint64_t)i * 3600 * sec);
+    }
+    ASSERT_EQ(em_process_all(em), 3, "自动推进未处理全部事件");
+    ASSERT_EQ(last_data_value, 3, "数据不正确");
+    ASSERT_EQ(em_time_ns(em), 3 * 3600 * sec, "虚拟时钟不正确");
+    em_destroy(em);
+    
+    /* 真实时钟 */
+    em = em_create();
+    em_subscribe(em, 0, test_callback, NULL, EM_PRIORITY_NORMAL);
+    ASSERT_EQ(em_advance_time(em, sec), EM_ERR_NOT_SUPPORTED, "真实时钟不应支持推进");
+    em_publish_delayed(em, 0, NULL, 0, EM_PRIORITY_NORMAL, 20000000ull);  /* 20ms */
+    ASSERT_EQ(em_process_all(em), 0, "事件提前到期");
+    struct timespec ts = {0, 30000000};  /* 30ms */
+    nanosleep(&ts, NULL);
+    ASSERT_EQ(em_process_all(em), 1, "事件未到期");
+    
+    /* 清空队列时取消未到期的延时事件 */
+    em_publish_delayed(em, 0, &a, sizeof(int), EM_PRIORITY_NORMAL, sec);
+    em_stats_t stats;
+    em_get_stats(em, &stats);
+    ASSERT_EQ(stats.timers_pending, 1, "延时事件计数不正确");
+    em_clear_queue(em);
+    em_get_stats(em, &stats);
+    ASSERT_EQ(stats.timers_pending, 0, "延时事件未取消");
+    
+    em_destroy(em);
+    TEST_PASS();
 }
 
-static void* event_loop_thread(void* arg)
+/*============================================================================
+ *                              执行器测试
+ *============================================================================*/
+
+void test_executor_user_polled(void)
 {
-    em_handle_t em = (em_handle_t)arg;
-    em_run_loop(em);
-    return NULL;
+    TEST_START("用户轮询的执行器");
+    
+    em_handle_t em = em_create();
+    em_executor_t* ex = em_executor_create(NULL, 4);
+    ASSERT_NOT_NULL(ex, "创建执行器失败");
+    
+    em_error_t err = em_subscribe_on(em, 0, test_callback, NULL, EM_PRIORITY_NORMAL, ex);
+    ASSERT_EQ(err, EM_OK, "订阅失败");
+    
+    reset_counters();
+    
+    int data = 7;
+    em_publish_async(em, 0, &data, sizeof(int), EM_PRIORITY_NORMAL);
+    em_process_one(em);
+    
+    /* 分发后回调只进入收件箱，尚未执行 */
+    ASSERT_EQ(callback_counter, 0, "回调不应在分发线程执行");
+    ASSERT_EQ(em_executor_pending(ex), 1, "收件箱数量不正确");
+    
+    /* 数据副本在执行器执行前仍然有效 */
+    ASSERT_EQ(em_executor_run(ex, 0), 1, "执行数量不正确");
+    ASSERT_EQ(callback_counter, 1, "回调未执行");
+    ASSERT_EQ(last_data_value, 7, "数据不正确");
+    ASSERT_EQ(em_executor_pending(ex), 0, "收件箱应为空");
+    
+    /* 同一回调可同时直接订阅 */
+    em_subscribe(em, 0, test_callback, NULL, EM_PRIORITY_NORMAL);
+    ASSERT_EQ(em_get_subscriber_count(em, 0), 2, "订阅者数量不正确");
+    
+    /* 按执行器取消只移除该执行器上的订阅，直接订阅保留 */
+    em_executor_t* other = em_executor_create(NULL, 4);
+    ASSERT_EQ(em_unsubscribe_on(em, 0, test_callback, other), EM_ERR_NOT_FOUND, "未订阅的执行器应返回未找到");
+    ASSERT_EQ(em_unsubscribe_on(em, 0, test_callback, ex), EM_OK, "按执行器取消失败");
+    ASSERT_EQ(em_get_subscriber_count(em, 0), 1, "订阅者数量不正确");
+    ASSERT_EQ(em_unsubscribe_on(em, 0, test_callback, ex), EM_ERR_NOT_FOUND, "重复取消应返回未找到");
+    
+    em_publish_async(em, 0, &data, sizeof(int), EM_PRIORITY_NORMAL);
+    em_process_one(em);
+    ASSERT_EQ(callback_counter, 2, "直接订阅应仍然有效");
+    ASSERT_EQ(em_executor_pending(ex), 0, "已取消的执行器不应收到投递");
+    
+    ASSERT_EQ(em_unsubscribe_on(em, 0, test_callback, NULL), EM_OK, "取消直接订阅失败");
+    ASSERT_EQ(em_get_subscriber_count(em, 0), 0, "订阅者数量不正确");
+    
+    em_executor_destroy(other);
+    em_destroy(em);
+    em_executor_destroy(ex);
+    TEST_PASS();
 }
 
-void test_event_loop_basic(void)
+void test_executor_overflow(void)
 {
-    TEST_START("事件循环基本功能");
+    TEST_START("执行器收件箱溢出");
     
-    loop_test_em = em_create();
-    ASSERT_NOT_NULL(loop_test_em, "创建失败");
+    em_handle_t em = em_create();
+    em_executor_t* ex = em_executor_create(NULL, 2);
+    em_subscribe_on(em, 0, test_callback, NULL, EM_PRIORITY_NORMAL, ex);
     
-    loop_callback_count = 0;
-    em_subscribe(loop_test_em, 0, loop_callback, NULL, EM_PRIORITY_NORMAL);
+    int data = 1;
+    for (int i = 0; i < 3; i++) {
+        em_publish_async(em, 0, &data, sizeof(int), EM_PRIORITY_NORMAL);
+    }
+    em_process_all(em);
     
-    /* 在另一个线程中运行事件循环 */
-    pthread_t thread;
-    int ret = pthread_create(&thread, NULL, event_loop_thread, loop_test_em);
-    ASSERT_EQ(ret, 0, "创建线程失败");
+    em_stats_t stats;
+    em_get_stats(em, &stats);
+    ASSERT_EQ(em_executor_pending(ex), 2, "收件箱数量不正确");
+    ASSERT_EQ(stats.executor_dropped, 1, "丢弃计数不正确");
     
-    /* 等待一小段时间让事件循环启动 */
-    struct timespec ts = {0, 50000000};  /* 50ms */
-    nanosleep(&ts, NULL);
+    /* 销毁时释放未执行回调持有的数据副本 */
+    em_destroy(em);
+    em_executor_destroy(ex);
+    TEST_PASS();
+}
+
+void test_resize_queue(void)
+{
+    TEST_START("在线调整队列容量");
     
-    /* 发布异步事件 */
-    for (int i = 0; i < 5; i++) {
-        em_publish_async(loop_test_em, 0, NULL, 0, EM_PRIORITY_NORMAL);
+    em_handle_t em = em_create();
+    em_subscribe(em, 0, test_callback, NULL, EM_PRIORITY_NORMAL);
+    reset_counters();
+    
+    /* 填满后扩容，事件顺序不变 */
+    for (int i = 0; i < EM_ASYNC_QUEUE_SIZE; i++) {
+        em_publish_async(em, 0, &i, sizeof(int), EM_PRIORITY_NORMAL);
     }
+    int data = EM_ASYNC_QUEUE_SIZE;
+    ASSERT_EQ(em_publish_async(em, 0, &data, sizeof(int), EM_PRIORITY_NORMAL),
+              EM_ERR_QUEUE_FULL, "队列应已满");
     
-    /* 等待事件被处理 */
-    ts.tv_nsec = 200000000;  /* 200ms */
-    nanosleep(&ts, NULL);
+    /* 先取出几个，使环形队列回绕 */
+    for (int i = 0; i < 5; i++) {
+        em_process_one(em);
+    }
+    for (int i = EM_ASYNC_QUEUE_SIZE; i < EM_ASYNC_QUEUE_SIZE + 5; i++) {
+        em_publish_async(em, 0, &i, sizeof(int), EM_PRIORITY_NORMAL);
+    }
     
-    /* 停止事件循环 */
-    em_stop_loop(loop_test_em);
+    ASSERT_EQ(em_resize_queue(em, EM_PRIORITY_NORMAL, EM_ASYNC_QUEUE_SIZE * 2), EM_OK, "扩容失败");
+    for (int i = EM_ASYNC_QUEUE_SIZE + 5; i < EM_ASYNC_QUEUE_SIZE * 2; i++) {
+        ASSERT_EQ(em_publish_async(em, 0, &i, sizeof(int), EM_PRIORITY_NORMAL), EM_OK, "扩容后发布失败");
+    }
     
-    /* 等待线程结束 */
-    pthread_join(thread, NULL);
+    for (int i = 5; i < EM_ASYNC_QUEUE_SIZE * 2; i++) {
+        ASSERT_EQ(em_process_one(em), EM_OK, "处理失败");
+        ASSERT_EQ(last_data_value, i, "事件顺序不正确");
+    }
     
-    /* 验证所有事件都被处理 */
-    ASSERT_EQ(loop_callback_count, 5, "回调执行次数不正确");
+    /* 缩容：不能小于当前事件数 */
+    for (int i = 0; i < 3; i++) {
+        em_publish_async(em, 0, &i, sizeof(int), EM_PRIORITY_NORMAL);
+    }
+    ASSERT_EQ(em_resize_queue(em, EM_PRIORITY_NORMAL, 2), EM_ERR_QUEUE_FULL, "不应缩容到小于事件数");
+    ASSERT_EQ(em_resize_queue(em, EM_PRIORITY_NORMAL, 4), EM_OK, "缩容失败");
+    ASSERT_EQ(em_resize_queue(em, EM_PRIORITY_NORMAL, 0), EM_ERR_INVALID_PARAM, "容量为0应失败");
+    ASSERT_EQ(em_process_all(em), 3, "缩容后事件丢失");
     
-    em_destroy(loop_test_em);
-    loop_test_em = NULL;
+    em_stats_t stats;
+    em_get_stats(em, &stats);
+    ASSERT_EQ(stats.queue_capacity[EM_PRIORITY_NORMAL], 4, "容量统计不正确");
+    ASSERT_EQ(stats.queue_resizes, 2, "调整次数不正确");
+    
+    /* 自动扩容 */
+    em_queue_autogrow_t grow = { true, 50, 64 };
+    em_set_queue_autogrow(em, &grow);
+    for (int i = 0; i < 64; i++) {
+        ASSERT_EQ(em_publish_async(em, 0, &i, sizeof(int), EM_PRIORITY_LOW), EM_OK, "自动扩容后发布失败");
+    }
+    ASSERT_EQ(em_publish_async(em, 0, &data, sizeof(int), EM_PRIORITY_LOW),
+              EM_ERR_QUEUE_FULL, "不应超过容量上限");
+    em_get_stats(em, &stats);
+    ASSERT_EQ(stats.queue_capacity[EM_PRIORITY_LOW], 64, "自动扩容容量不正确");
     
+    em_destroy(em);
     TEST_PASS();
 }
-#endif
 
 /*============================================================================
- *                              主函数
+ *                              负载控制测试
  *============================================================================*/
 
-int main(void)
+static void sleep_ms(long ms)
 {
-    printf("=== 事件管理器单元测试 ===\n");
-    printf("版本: %s\n\n", em_version());
-    
-    /* 创建/销毁 */
-    test_create_destroy();
-    test_destroy_null();
+    struct timespec ts = { ms / 1000, (ms % 1000) * 1000000L };
+    nanosleep(&ts, NULL);
+}
+
+/* 虚拟时钟经过 idle_ms 后发布一个 HIGH 事件，排队 wait_ms 后取出 */
+static void shed_sample(em_handle_t em, long idle_ms, long wait_ms)
+{
+    int data = 0;
+    em_advance_time(em, (uint64_t)idle_ms * 1000000);
+    em_publish_async(em, 0, &data, sizeof(int), EM_PRIORITY_HIGH);
+    em_advance_time(em, (uint64_t)wait_ms * 1000000);
+    em_process_all(em);
+}
+
+void test_payload_pool_reserve(void)
+{
+    TEST_START("数据块池为高优先级保留");
+    
+    em_config_t cfg;
+    em_config_init(&cfg);
+    cfg.payload_pool_blocks = 8;
+    cfg.payload_block_size = 16;
+    cfg.payload_reserved[EM_PRIORITY_HIGH] = 2;
+    cfg.payload_reserved[EM_PRIORITY_NORMAL] = 1;
+    em_handle_t em = em_create_with_config(&cfg);
+    ASSERT_NOT_NULL(em, "创建失败");
+    em_subscribe(em, 0, test_callback, NULL, EM_PRIORITY_NORMAL);
+    reset_counters();
     
-    /* 订阅 */
-    test_subscribe_basic();
-    test_subscribe_with_user_data();
-    test_subscribe_multiple();
-    test_subscribe_duplicate();
-    test_subscribe_invalid_params();
+    /* LOW 只能用保留之外的 5 块 */
+    int data = 7;
+    for (int i = 0; i < 5; i++) {
+        ASSERT_EQ(em_publish_async(em, 0, &data, sizeof(int), EM_PRIORITY_LOW), EM_OK, "LOW 发布失败");
+    }
+    ASSERT_EQ(em_publish_async(em, 0, &data, sizeof(int), EM_PRIORITY_LOW),
+              EM_ERR_OUT_OF_MEMORY, "LOW 不应使用保留块");
+    
+    /* NORMAL 可再用 1 块，HIGH 可用剩下的全部 */
+    ASSERT_EQ(em_publish_async(em, 0, &data, sizeof(int), EM_PRIORITY_NORMAL), EM_OK, "NORMAL 发布失败");
+    ASSERT_EQ(em_publish_async(em, 0, &data, sizeof(int), EM_PRIORITY_NORMAL),
+              EM_ERR_OUT_OF_MEMORY, "NORMAL 不应使用 HIGH 的保留块");
+    ASSERT_EQ(em_publish_async(em, 0, &data, sizeof(int), EM_PRIORITY_HIGH), EM_OK, "HIGH 发布失败");
+    ASSERT_EQ(em_publish_async(em, 0, &data, sizeof(int), EM_PRIORITY_HIGH), EM_OK, "HIGH 发布失败");
+    ASSERT_EQ(em_publish_async(em, 0, &data, sizeof(int), EM_PRIORITY_HIGH),
+              EM_ERR_OUT_OF_MEMORY, "块池已用完");
+    
+    /* 超过块大小的数据改用 malloc */
+    char big[64] = { 0 };
+    ASSERT_EQ(em_publish_async(em, 0, big, sizeof(big), EM_PRIORITY_LOW), EM_OK, "大数据发布失败");
     
-    /* 取消订阅 */
-    test_unsubscribe_basic();
-    test_unsubscribe_not_found();
-    test_unsubscribe_all();
+    em_stats_t stats;
+    em_get_stats(em, &stats);
+    ASSERT_EQ(stats.payload_pool_free, 0, "空闲块数不正确");
+    ASSERT_EQ(stats.payload_pool_oversize, 1, "malloc 次数不正确");
+    ASSERT_EQ(stats.payload_pool_exhausted[EM_PRIORITY_LOW], 1, "LOW 失败数不正确");
+    ASSERT_EQ(stats.payload_pool_exhausted[EM_PRIORITY_HIGH], 1, "HIGH 失败数不正确");
+    
+    /* 处理后块全部归还，数据完整 */
+    ASSERT_EQ(em_process_all(em), 9, "处理数不正确");
+    ASSERT_EQ(last_data_value, 0, "大数据内容不正确");
+    em_get_stats(em, &stats);
+    ASSERT_EQ(stats.payload_pool_free, 8, "块未归还");
     
-    /* 同步事件 */
-    test_publish_sync_basic();
-    test_publish_sync_no_subscribers();
+    em_destroy(em);
     
-    /* 异步事件 */
-    test_publish_async_basic();
-    test_publish_async_with_data_copy();
-    test_process_all();
+    /* 保留块之和必须小于块数 */
+    cfg.payload_reserved[EM_PRIORITY_HIGH] = 8;
+    ASSERT_TRUE(em_create_with_config(&cfg) == NULL, "非法配置应创建失败");
     
-    /* 优先级 */
-    test_subscriber_priority();
-    test_event_priority();
+    TEST_PASS();
+}
+
+void test_auto_batch(void)
+{
+    TEST_START("发布端自动批量");
     
-    /* 队列管理 */
+    em_handle_t em = em_create();
+    em_subscribe(em, 0, test_callback, NULL, EM_PRIORITY_NORMAL);
+    reset_counters();
+    
+    em_auto_batch_t cfg = { true, 4, 1000000 };
+    ASSERT_EQ(em_set_auto_batch(em, &cfg), EM_OK, "启用失败");
+    
+    /* 未满时留在暂存区 */
+    em_stats_t stats;
+    for (int i = 0; i < 3; i++) {
+        ASSERT_EQ(em_publish_async(em, 0, &i, sizeof(int), EM_PRIORITY_NORMAL), EM_OK, "发布失败");
+    }
+    em_get_stats(em, &stats);
+    ASSERT_EQ(stats.async_queue_current, 0, "事件不应已入队");
+    ASSERT_EQ(em_flush_thread(em), EM_OK, "刷新失败");
+    ASSERT_EQ(em_process_all(em), 3, "刷新后处理数不正确");
+    ASSERT_EQ(last_data_value, 2, "事件顺序不正确");
+    
+    /* 满后整批入队 */
+    for (int i = 0; i < 4; i++) {
+        em_publish_async(em, 0, &i, sizeof(int), EM_PRIORITY_LOW);
+    }
+    em_get_stats(em, &stats);
+    ASSERT_EQ(stats.async_queue_current, 4, "满后应整批入队");
+    
+    /* HIGH 事件先刷新暂存区 */
+    int data = 9;
+    em_publish_async(em, 0, &data, sizeof(int), EM_PRIORITY_NORMAL);
+    em_publish_async(em, 0, &data, sizeof(int), EM_PRIORITY_HIGH);
+    em_get_stats(em, &stats);
+    ASSERT_EQ(stats.async_queue_current, 6, "HIGH 发布前应刷新");
+    ASSERT_EQ(em_process_all(em), 6, "处理数不正确");
+    
+    /* 原子发布事件组前先刷新，保持本线程的发布顺序 */
+    int values[3] = { 1, 2, 3 };
+    em_publish_async(em, 0, &values[0], sizeof(int), EM_PRIORITY_NORMAL);
+    em_event_t group[2] = {
+        { 0, &values[1], sizeof(int), EM_PRIORITY_NORMAL, EM_MODE_ASYNC },
+        { 0, &values[2], sizeof(int), EM_PRIORITY_NORMAL, EM_MODE_ASYNC },
+    };
+    ASSERT_EQ(em_publish_group(em, group, 2), EM_OK, "发布事件组失败");
+    ASSERT_EQ(em_process_all(em), 3, "处理数不正确");
+    ASSERT_EQ(last_data_value, 3, "事件组越过了之前暂存的事件");
+    
+    /* 队列满时事件留在暂存区，暂存区也满后拒绝 */
+    for (int i = 0; i < EM_ASYNC_QUEUE_SIZE + 4; i++) {
+        ASSERT_EQ(em_publish_async(em, 0, &i, sizeof(int), EM_PRIORITY_NORMAL), EM_OK, "发布失败");
+    }
+    ASSERT_EQ(em_publish_async(em, 0, &data, sizeof(int), EM_PRIORITY_NORMAL),
+              EM_ERR_QUEUE_FULL, "暂存区满应拒绝");
+    ASSERT_EQ(em_process_all(em), EM_ASYNC_QUEUE_SIZE, "处理数不正确");
+    ASSERT_EQ(em_flush_thread(em), EM_OK, "刷新失败");
+    ASSERT_EQ(em_process_all(em), 4, "暂存事件丢失");
+    ASSERT_EQ(last_data_value, EM_ASYNC_QUEUE_SIZE + 3, "事件顺序不正确");
+    
+    /* 暂存超时后由 em_process_all 刷新：未超时的检查用 1s，不受调度抖动影响 */
+    cfg.max_delay_us = 1000000;
+    em_set_auto_batch(em, &cfg);
+    em_publish_async(em, 0, &data, sizeof(int), EM_PRIORITY_NORMAL);
+    ASSERT_EQ(em_process_all(em), 0, "未超时不应刷新");
+    cfg.max_delay_us = 1000;
+    em_set_auto_batch(em, &cfg);
+    sleep_ms(5);
+    ASSERT_EQ(em_process_all(em), 1, "超时后应刷新");
+    
+    /* 关闭时刷新所有暂存区 */
+    em_publish_async(em, 0, &data, sizeof(int), EM_PRIORITY_NORMAL);
+    ASSERT_EQ(em_set_auto_batch(em, NULL), EM_OK, "关闭失败");
+    ASSERT_EQ(em_process_all(em), 1, "关闭后应刷新");
+    
+    /* 关闭时队列已满：已接受的暂存事件不丢弃，本线程的下一次发布先把它们入队 */
+    cfg.max_delay_us = 10000000;
+    em_set_auto_batch(em, &cfg);
+    for (int i = 0; i < EM_ASYNC_QUEUE_SIZE + 2; i++) {
+        ASSERT_EQ(em_publish_async(em, 0, &i, sizeof(int), EM_PRIORITY_NORMAL), EM_OK, "发布失败");
+    }
+    ASSERT_EQ(em_set_auto_batch(em, NULL), EM_ERR_QUEUE_FULL, "仍有暂存事件时应返回队列已满");
+    ASSERT_EQ(em_process_all(em), EM_ASYNC_QUEUE_SIZE, "处理数不正确");
+    ASSERT_EQ(em_publish_async(em, 0, &data, sizeof(int), EM_PRIORITY_NORMAL), EM_OK, "发布失败");
+    ASSERT_EQ(em_process_all(em), 3, "暂存事件丢失");
+    ASSERT_EQ(last_data_value, data, "应先入队之前暂存的事件");
+    ASSERT_EQ(em_set_auto_batch(em, NULL), EM_OK, "暂存区已空时关闭应成功");
+    
+    em_get_stats(em, &stats);
+    ASSERT_TRUE(stats.auto_batch_flushes >= 5, "刷新次数不正确");
+    ASSERT_EQ(stats.auto_batch_dropped, 0, "不应有丢弃");
+    
+    cfg.max_events = EM_MAX_GROUP_SIZE + 1;
+    ASSERT_EQ(em_set_auto_batch(em, &cfg), EM_ERR_INVALID_PARAM, "容量超限应失败");
+    
+    em_destroy(em);
+    TEST_PASS();
+}
+
+void test_producer_quota(void)
+{
+    TEST_START("生产者配额");
+    
+    em_handle_t em = em_create();
+    em_subscribe(em, 0, test_callback, NULL, EM_PRIORITY_NORMAL);
+    reset_counters();
+    em_resize_queue(em, EM_PRIORITY_NORMAL, 32);
+    
+    em_producer_config_t chatty = { { 0 }, { 0 } };
+    em_producer_config_t quiet = { .reserved = { 0, 8, 0 } };
+    em_producer_config_t capped = { .limit = { 0, 4, 0 } };
+    int a = em_producer_register(em, &chatty);
+    int b = em_producer_register(em, &quiet);
+    int c = em_producer_register(em, &capped);
+    ASSERT_TRUE(a >= 0 && b >= 0 && c >= 0, "注册失败");
+    
+    em_producer_config_t huge = { .reserved = { 0, 32, 0 } };
+    ASSERT_EQ(em_producer_register(em, &huge), EM_ERR_QUEUE_FULL, "预留超过容量应失败");
+    
+    /* 繁忙的生产者只能占满共享槽位 */
+    em_producer_bind(em, a);
+    int data = 1;
+    for (int i = 0; i < 24; i++) {
+        ASSERT_EQ(em_publish_async(em, 0, &data, sizeof(int), EM_PRIORITY_NORMAL), EM_OK, "共享槽位内发布失败");
+    }
+    ASSERT_EQ(em_publish_async(em, 0, &data, sizeof(int), EM_PRIORITY_NORMAL),
+              EM_ERR_QUEUE_FULL, "共享槽位已满应拒绝");
+    
+    /* 预留槽位仍然可用 */
+    em_producer_bind(em, b);
+    for (int i = 0; i < 8; i++) {
+        ASSERT_EQ(em_publish_async(em, 0, &data, sizeof(int), EM_PRIORITY_NORMAL), EM_OK, "预留槽位内发布失败");
+    }
+    ASSERT_EQ(em_publish_async(em, 0, &data, sizeof(int), EM_PRIORITY_NORMAL),
+              EM_ERR_QUEUE_FULL, "预留用完且无共享槽位应拒绝");
+    ASSERT_EQ(em_resize_queue(em, EM_PRIORITY_NORMAL, 16), EM_ERR_QUEUE_FULL, "不应缩容到小于占用");
+    
+    em_process_all(em);
+    
+    /* 占用上限 */
+    em_producer_bind(em, c);
+    for (int i = 0; i < 4; i++) {
+        ASSERT_EQ(em_publish_async(em, 0, &data, sizeof(int), EM_PRIORITY_NORMAL), EM_OK, "上限内发布失败");
+    }
+    ASSERT_EQ(em_publish_async(em, 0, &data, sizeof(int), EM_PRIORITY_NORMAL),
+              EM_ERR_QUEUE_FULL, "超过上限应拒绝");
+    em_producer_bind(em, -1);
+    
+    em_producer_stats_t ps;
+    em_get_producer_stats(em, a, &ps);
+    ASSERT_EQ(ps.published, 24, "发布数不正确");
+    ASSERT_EQ(ps.rejected[EM_PRIORITY_NORMAL], 1, "拒绝数不正确");
+    ASSERT_EQ(ps.queued[EM_PRIORITY_NORMAL], 0, "出队后占用应归零");
+    em_get_producer_stats(em, c, &ps);
+    ASSERT_EQ(ps.queued[EM_PRIORITY_NORMAL], 4, "占用数不正确");
+    ASSERT_EQ(ps.rejected[EM_PRIORITY_NORMAL], 1, "拒绝数不正确");
+    
+    /* 仍有事件在队列中的生产者注销后，槽位暂不复用 */
+    ASSERT_EQ(em_producer_unregister(em, c), EM_OK, "注销失败");
+    ASSERT_EQ(em_producer_unregister(em, c), EM_ERR_NOT_FOUND, "重复注销应失败");
+    ASSERT_EQ(em_producer_bind(em, c), EM_ERR_NOT_FOUND, "绑定已注销的生产者应失败");
+    ASSERT_TRUE(em_producer_register(em, &chatty) != c, "未排空的槽位不应复用");
+    ASSERT_EQ(em_process_all(em), 4, "处理数不正确");
+    ASSERT_EQ(em_producer_register(em, &chatty), c, "排空后槽位应可复用");
+    
+    em_destroy(em);
+    TEST_PASS();
+}
+
+void test_load_shedding(void)
+{
+    TEST_START("自适应负载控制");
+    
+    /* 排队延迟由虚拟时钟给出，不受调度抖动影响 */
+    em_config_t em_cfg;
+    em_config_init(&em_cfg);
+    em_cfg.virtual_time = true;
+    em_handle_t em = em_create_with_config(&em_cfg);
+    ASSERT_NOT_NULL(em, "创建失败");
+    em_subscribe(em, 0, test_callback, NULL, EM_PRIORITY_NORMAL);
+    
+    em_shed_config_t cfg = { .enabled = true, .target_us = 1000, .interval_us = 20000 };
+    ASSERT_EQ(em_set_load_shedding(em, &cfg), EM_OK, "配置失败");
+    
+    int data = 1;
+    em_stats_t stats;
+    
+    /* HIGH 排队延迟超过目标：先丢弃 LOW */
+    shed_sample(em, 0, 25);
+    em_get_stats(em, &stats);
+    ASSERT_EQ(stats.shed_level, 1, "丢弃级别应为1");
+    ASSERT_TRUE(stats.queue_wait_max_us[EM_PRIORITY_HIGH] >= 25000, "排队延迟统计不正确");
+    ASSERT_EQ(em_publish_async(em, 0, &data, sizeof(int), EM_PRIORITY_LOW),
+              EM_ERR_OVERLOADED, "LOW 应被丢弃");
+    
+    /* 持续过载：再丢弃 NORMAL，HIGH 始终可发布 */
+    shed_sample(em, 0, 25);
+    em_get_stats(em, &stats);
+    ASSERT_EQ(stats.shed_level, 2, "丢弃级别应为2");
+    ASSERT_EQ(em_publish_async(em, 0, &data, sizeof(int), EM_PRIORITY_NORMAL),
+              EM_ERR_OVERLOADED, "NORMAL 应被丢弃");
+    ASSERT_EQ(em_publish_async(em, 0, &data, sizeof(int), EM_PRIORITY_HIGH),
+              EM_OK, "HIGH 不应被丢弃");
+    em_process_all(em);
+    
+    em_get_stats(em, &stats);
+    ASSERT_EQ(stats.events_shed[EM_PRIORITY_LOW], 1, "LOW 丢弃计数不正确");
+    ASSERT_EQ(stats.events_shed[EM_PRIORITY_NORMAL], 1, "NORMAL 丢弃计数不正确");
+    
+    /* 延迟恢复后每个窗口恢复一级 */
+    shed_sample(em, 25, 0);
+    em_get_stats(em, &stats);
+    ASSERT_EQ(stats.shed_level, 1, "丢弃级别应恢复为1");
+    shed_sample(em, 25, 0);
+    em_get_stats(em, &stats);
+    ASSERT_EQ(stats.shed_level, 0, "丢弃级别应恢复为0");
+    ASSERT_EQ(em_publish_async(em, 0, &data, sizeof(int), EM_PRIORITY_LOW),
+              EM_OK, "LOW 应可发布");
+    
+    /* 关闭后不再丢弃 */
+    ASSERT_EQ(em_set_load_shedding(em, NULL), EM_OK, "关闭失败");
+    
+    em_destroy(em);
+    TEST_PASS();
+}
+
+/*============================================================================
+ *                              事件循环测试
+ *============================================================================*/
+
+#if EM_ENABLE_THREADING
+#include <pthread.h>
+#include <signal.h>
+#include <stdatomic.h>
+
+static em_handle_t loop_test_em = NULL;
+static volatile int loop_callback_count = 0;
+
+static void loop_callback(em_event_id_t id, em_event_data_t data, void* user)
+{
+    (void)id; (void)data; (void)user;
+    loop_callback_count++;
+}
+
+static void* event_loop_thread(void* arg)
+{
+    em_handle_t em = (em_handle_t)arg;
+    em_run_loop(em);
+    return NULL;
+}
+
+void test_event_loop_basic(void)
+{
+    TEST_START("事件循环基本功能");
+    
+    loop_test_em = em_create();
+    ASSERT_NOT_NULL(loop_test_em, "创建失败");
+    
+    loop_callback_count = 0;
+    em_subscribe(loop_test_em, 0, loop_callback, NULL, EM_PRIORITY_NORMAL);
+    
+    /* 在另一个线程中运行事件循环 */
+    pthread_t thread;
+    int ret = pthread_create(&thread, NULL, event_loop_thread, loop_test_em);
+    ASSERT_EQ(ret, 0, "创建线程失败");
+    
+    /* 等待一小段时间让事件循环启动 */
+    struct timespec ts = {0, 50000000};  /* 50ms */
+    nanosleep(&ts, NULL);
+    
+    /* 发布异步事件 */
+    for (int i = 0; i < 5; i++) {
+        em_publish_async(loop_test_em, 0, NULL, 0, EM_PRIORITY_NORMAL);
+    }
+    
+    /* 等待事件被处理 */
+    ts.tv_nsec = 200000000;  /* 200ms */
+    nanosleep(&ts, NULL);
+    
+    /* 停止事件循环 */
+    em_stop_loop(loop_test_em);
+    
+    /* 等待线程结束 */
+    pthread_join(thread, NULL);
+    
+    /* 验证所有事件都被处理 */
+    ASSERT_EQ(loop_callback_count, 5, "回调执行次数不正确");
+    
+    em_destroy(loop_test_em);
+    loop_test_em = NULL;
+    
+    TEST_PASS();
+}
+
+void test_wakeup_counters(void)
+{
+    TEST_START("唤醒与系统调用计数");
+    
+    loop_test_em = em_create();
+    ASSERT_NOT_NULL(loop_test_em, "创建失败");
+    loop_callback_count = 0;
+    em_subscribe(loop_test_em, 0, loop_callback, NULL, EM_PRIORITY_NORMAL);
+    
+    pthread_t thread;
+    ASSERT_EQ(pthread_create(&thread, NULL, event_loop_thread, loop_test_em), 0, "创建线程失败");
+    struct timespec ts = {0, 20000000};  /* 20ms */
+    nanosleep(&ts, NULL);
+    
+    /* 每次发布之间留出时间，事件循环每个事件醒来一次 */
+    for (int i = 0; i < 5; i++) {
+        em_publish_async(loop_test_em, 0, NULL, 0, EM_PRIORITY_NORMAL);
+        nanosleep(&ts, NULL);
+    }
+    
+    em_stats_t stats;
+    em_get_stats(loop_test_em, &stats);
+    ASSERT_EQ(loop_callback_count, 5, "回调执行次数不正确");
+    ASSERT_EQ(stats.wake_signals, 5, "signal 次数不正确");
+    ASSERT_TRUE(stats.wakeups >= 5, "唤醒次数不正确");
+    ASSERT_EQ(stats.wakeup_events, 5, "唤醒后处理的事件数不正确");
+    ASSERT_TRUE(stats.wakeups_empty <= stats.wakeups - 5, "空唤醒次数不正确");
+#if EM_ENABLE_EPOLL
+    ASSERT_EQ(stats.eventfd_writes, 5, "eventfd 写入次数不正确");
+    ASSERT_TRUE(stats.eventfd_reads >= 1, "eventfd 读取次数不正确");
+#else
+    ASSERT_EQ(stats.eventfd_writes, 0, "未启用 epoll 时不应写 eventfd");
+#endif
+    
+    em_reset_stats(loop_test_em);
+    em_get_stats(loop_test_em, &stats);
+    ASSERT_EQ(stats.wake_signals, 0, "重置后计数应为0");
+    
+    em_stop_loop(loop_test_em);
+    pthread_join(thread, NULL);
+    em_destroy(loop_test_em);
+    loop_test_em = NULL;
+    
+    TEST_PASS();
+}
+
+#define LOCK_TEST_EVENTS    500
+
+static void* lock_test_producer(void* arg)
+{
+    em_handle_t em = (em_handle_t)arg;
+    struct timespec ts = {0, 100000};  /* 0.1ms */
+    for (int i = 0; i < LOCK_TEST_EVENTS; i++) {
+        while (em_publish_async(em, 0, NULL, 0, EM_PRIORITY_NORMAL) == EM_ERR_QUEUE_FULL) {
+            nanosleep(&ts, NULL);
+        }
+    }
+    return NULL;
+}
+
+void test_lock_types(void)
+{
+    TEST_START("可选的管理器锁");
+    
+    em_lock_type_t types[] = { EM_LOCK_MUTEX, EM_LOCK_RWLOCK, EM_LOCK_SPIN };
+    for (int i = 0; i < 3; i++) {
+        em_config_t cfg;
+        em_config_init(&cfg);
+        ASSERT_EQ(cfg.lock_type, EM_LOCK_MUTEX, "默认锁类型不正确");
+        cfg.lock_type = types[i];
+        
+        loop_test_em = em_create_with_config(&cfg);
+        ASSERT_NOT_NULL(loop_test_em, "创建失败");
+        em_lock_type_t actual = em_get_lock_type(loop_test_em);
+        ASSERT_TRUE(actual == types[i] || actual == EM_LOCK_MUTEX, "锁类型不正确");
+        
+        loop_callback_count = 0;
+        em_subscribe(loop_test_em, 0, loop_callback, NULL, EM_PRIORITY_NORMAL);
+        
+        pthread_t loop, producers[2];
+        ASSERT_EQ(pthread_create(&loop, NULL, event_loop_thread, loop_test_em), 0, "创建线程失败");
+        for (int p = 0; p < 2; p++) {
+            ASSERT_EQ(pthread_create(&producers[p], NULL, lock_test_producer, loop_test_em), 0,
+                      "创建线程失败");
+        }
+        
+        /* 发布的同时修改订阅和读取统计 */
+        for (int k = 0; k < 200; k++) {
+            em_subscribe(loop_test_em, 1, test_callback, NULL, EM_PRIORITY_NORMAL);
+            ASSERT_EQ(em_get_subscriber_count(loop_test_em, 1), 1, "订阅者数量不正确");
+            em_unsubscribe(loop_test_em, 1, test_callback);
+            em_stats_t stats;
+            em_get_stats(loop_test_em, &stats);
+        }
+        
+        for (int p = 0; p < 2; p++) {
+            pthread_join(producers[p], NULL);
+        }
+        struct timespec ts = {0, 1000000};  /* 1ms */
+        for (int k = 0; k < 2000 && loop_callback_count < 2 * LOCK_TEST_EVENTS; k++) {
+            nanosleep(&ts, NULL);
+        }
+        ASSERT_EQ(loop_callback_count, 2 * LOCK_TEST_EVENTS, "回调执行次数不正确");
+        
+        em_stats_t stats;
+        em_get_stats(loop_test_em, &stats);
+        ASSERT_EQ(stats.events_processed, 2 * LOCK_TEST_EVENTS, "处理计数不正确");
+        
+        em_stop_loop(loop_test_em);
+        pthread_join(loop, NULL);
+        em_destroy(loop_test_em);
+        loop_test_em = NULL;
+    }
+    
+    /* 不加锁：只在当前线程使用，不能启动线程池 */
+    em_config_t cfg;
+    em_config_init(&cfg);
+    cfg.lock_type = EM_LOCK_NONE;
+    em_handle_t em = em_create_with_config(&cfg);
+    ASSERT_NOT_NULL(em, "创建失败");
+    ASSERT_EQ(em_get_lock_type(em), EM_LOCK_NONE, "锁类型不正确");
+    ASSERT_EQ(em_worker_pool_start(em, NULL), EM_ERR_NOT_SUPPORTED, "不加锁时不能启动线程池");
+    ASSERT_EQ(em_actor_pool_start(em, 1), EM_ERR_NOT_SUPPORTED, "不加锁时不能启动线程池");
+    loop_callback_count = 0;
+    em_subscribe(em, 0, loop_callback, NULL, EM_PRIORITY_NORMAL);
+    em_publish_sync(em, 0, NULL);
+    em_publish_async(em, 0, NULL, 0, EM_PRIORITY_NORMAL);
+    ASSERT_EQ(em_process_all(em), 1, "异步事件处理数量不正确");
+    ASSERT_EQ(loop_callback_count, 2, "回调执行次数不正确");
+    em_destroy(em);
+    
+    cfg.lock_type = (em_lock_type_t)99;
+    ASSERT_NULL(em_create_with_config(&cfg), "非法锁类型应创建失败");
+    
+    TEST_PASS();
+}
+
+#if EM_ENABLE_EPOLL
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/socket.h>
+
+static volatile int fd_frame_count = 0;
+static volatile long fd_frame_sum = 0;
+
+/* 定长帧：data 指向帧本身 */
+static void fd_fixed_callback(em_event_id_t id, em_event_data_t data, void* user)
+{
+    (void)id; (void)user;
+    fd_frame_sum += ((const uint32_t*)data)[0];
+    fd_frame_count++;
+}
+
+/* 变长帧：data 指向 em_frame_t，按字节求和 */
+static void fd_frame_callback(em_event_id_t id, em_event_data_t data, void* user)
+{
+    (void)id; (void)user;
+    const em_frame_t* frame = (const em_frame_t*)data;
+    for (uint32_t i = 0; i < frame->size; i++) {
+        fd_frame_sum += frame->data[i];
+    }
+    fd_frame_count++;
+}
+#endif
+
+void test_fd_sources(void)
+{
+    TEST_START("文件描述符数据源");
+    
+    em_handle_t em = em_create();
+    em_fd_source_config_t cfg = { 0, EM_PRIORITY_NORMAL, EM_FD_FRAME_FIXED, 8, 0 };
+
+#if EM_ENABLE_EPOLL
+    int fixed[2];
+    int length[2];
+    int dgram[2];
+    ASSERT_EQ(pipe(fixed), 0, "创建管道失败");
+    ASSERT_EQ(pipe(length), 0, "创建管道失败");
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_DGRAM, 0, dgram), 0, "创建套接字失败");
+    
+    em_subscribe(em, 0, fd_fixed_callback, NULL, EM_PRIORITY_NORMAL);
+    em_subscribe(em, 1, fd_frame_callback, NULL, EM_PRIORITY_NORMAL);
+    em_subscribe(em, 2, fd_frame_callback, NULL, EM_PRIORITY_NORMAL);
+    ASSERT_EQ(em_add_fd_source(em, fixed[0], &cfg), 0, "注册定长数据源失败");
+    cfg = (em_fd_source_config_t){ 1, EM_PRIORITY_NORMAL, EM_FD_FRAME_LENGTH, 16, 2 };
+    ASSERT_EQ(em_add_fd_source(em, length[0], &cfg), 1, "注册长度前缀数据源失败");
+    cfg = (em_fd_source_config_t){ 2, EM_PRIORITY_HIGH, EM_FD_FRAME_DATAGRAM, 4, 0 };
+    int dgram_src = em_add_fd_source(em, dgram[0], &cfg);
+    ASSERT_EQ(dgram_src, 2, "注册数据报数据源失败");
+    cfg.length_bytes = 3;
+    cfg.framing = EM_FD_FRAME_LENGTH;
+    ASSERT_EQ(em_add_fd_source(em, length[0], &cfg), EM_ERR_INVALID_PARAM, "非法前缀长度应被拒绝");
+    
+    /* 普通文件不能加入 epoll，注册失败时不应改动调用者的文件状态标志 */
+    FILE* file = tmpfile();
+    ASSERT_NOT_NULL(file, "创建临时文件失败");
+    int file_flags = fcntl(fileno(file), F_GETFL);
+    cfg = (em_fd_source_config_t){ 0, EM_PRIORITY_NORMAL, EM_FD_FRAME_FIXED, 8, 0 };
+    ASSERT_EQ(em_add_fd_source(em, fileno(file), &cfg), EM_ERR_INVALID_PARAM, "普通文件应注册失败");
+    ASSERT_EQ(fcntl(fileno(file), F_GETFL), file_flags, "注册失败后应恢复文件状态标志");
+    fclose(file);
+    
+    fd_frame_count = 0;
+    fd_frame_sum = 0;
+    pthread_t thread;
+    ASSERT_EQ(pthread_create(&thread, NULL, event_loop_thread, em), 0, "创建线程失败");
+    struct timespec ts = {0, 20000000};  /* 20ms */
+    
+    /* 定长帧：3帧分两次写入，第二帧跨越两次写入 */
+    uint32_t words[6] = { 1, 0, 2, 0, 3, 0 };
+    ASSERT_EQ(write(fixed[1], words, 12), 12, "写入失败");
+    nanosleep(&ts, NULL);
+    ASSERT_EQ(write(fixed[1], (char*)words + 12, 12), 12, "写入失败");
+    
+    /* 长度前缀帧：长度5、0、3，最后一帧的长度前缀被拆开 */
+    const uint8_t stream[] = { 0, 5, 1, 2, 3, 4, 5, 0, 0, 0 };
+    const uint8_t tail[] = { 3, 10, 20, 30 };
+    ASSERT_EQ(write(length[1], stream, sizeof(stream)), (ssize_t)sizeof(stream), "写入失败");
+    nanosleep(&ts, NULL);
+    ASSERT_EQ(write(length[1], tail, sizeof(tail)), (ssize_t)sizeof(tail), "写入失败");
+    
+    /* 数据报：超过最大帧大小的被截断并丢弃 */
+    const uint8_t small[] = { 7, 8 };
+    const uint8_t big[] = { 1, 1, 1, 1, 1, 1 };
+    send(dgram[1], small, sizeof(small), 0);
+    send(dgram[1], big, sizeof(big), 0);
+    send(dgram[1], small, sizeof(small), 0);
+    
+    for (int i = 0; i < 50 && fd_frame_count < 8; i++) {
+        nanosleep(&ts, NULL);
+    }
+    ASSERT_EQ(fd_frame_count, 8, "事件数不正确");
+    ASSERT_EQ(fd_frame_sum, 1 + 2 + 3 + 15 + 60 + 30, "帧数据不正确");
+    
+    /* 对端关闭后自动移除 */
+    close(fixed[1]);
+    for (int i = 0; i < 50; i++) {
+        em_stats_t s;
+        em_get_stats(em, &s);
+        if (s.fd_closed > 0) {
+            break;
+        }
+        nanosleep(&ts, NULL);
+    }
+    
+    em_stats_t stats;
+    em_get_stats(em, &stats);
+    ASSERT_EQ(stats.fd_events, 8, "数据源事件数不正确");
+    ASSERT_EQ(stats.fd_dropped, 1, "丢弃的帧数不正确");
+    ASSERT_EQ(stats.fd_closed, 1, "自动移除数不正确");
+    ASSERT_TRUE(stats.fd_reads >= 4, "读调用次数不正确");
+    ASSERT_EQ(em_remove_fd_source(em, 0), EM_ERR_NOT_FOUND, "已移除的数据源应返回未找到");
+    ASSERT_EQ(em_remove_fd_source(em, dgram_src), EM_OK, "移除失败");
+    
+    em_stop_loop(em);
+    pthread_join(thread, NULL);
+    close(fixed[0]);
+    close(length[0]);
+    close(length[1]);
+    close(dgram[0]);
+    close(dgram[1]);
+#else
+    ASSERT_EQ(em_add_fd_source(em, 0, &cfg), EM_ERR_NOT_SUPPORTED, "非 epoll 构建应返回不支持");
+    ASSERT_EQ(em_remove_fd_source(em, 0), EM_ERR_NOT_SUPPORTED, "非 epoll 构建应返回不支持");
+#endif
+    
+    em_destroy(em);
+    TEST_PASS();
+}
+
+void test_fd_source_stall(void)
+{
+    TEST_START("数据块用尽时暂停读取数据源");
+
+#if EM_ENABLE_EPOLL
+    em_config_t cfg;
+    em_config_init(&cfg);
+    cfg.payload_pool_blocks = 2;
+    cfg.payload_block_size = 8;
+    em_handle_t em = em_create_with_config(&cfg);
+    ASSERT_NOT_NULL(em, "创建失败");
+    
+    /* 回调投递到未运行的执行器，收件箱中的调用一直持有数据块 */
+    em_executor_t* ex = em_executor_create(NULL, 8);
+    em_subscribe_on(em, 0, fd_fixed_callback, NULL, EM_PRIORITY_NORMAL, ex);
+    int fds[2];
+    ASSERT_EQ(pipe(fds), 0, "创建管道失败");
+    em_fd_source_config_t src = { 0, EM_PRIORITY_NORMAL, EM_FD_FRAME_FIXED, 8, 0 };
+    ASSERT_EQ(em_add_fd_source(em, fds[0], &src), 0, "注册数据源失败");
+    
+    fd_frame_count = 0;
+    fd_frame_sum = 0;
+    pthread_t thread;
+    ASSERT_EQ(pthread_create(&thread, NULL, event_loop_thread, em), 0, "创建线程失败");
+    
+    uint32_t words[8] = { 1, 0, 2, 0, 3, 0, 4, 0 };
+    ASSERT_EQ(write(fds[1], words, sizeof(words)), (ssize_t)sizeof(words), "写入失败");
+    struct timespec ts = {0, 50000000};  /* 50ms */
+    nanosleep(&ts, NULL);
+    
+    /* 只读出两帧；fd 仍可读，但事件循环按 EM_FD_STALL_RETRY_US 重试而不是空转 */
+    em_stats_t stats;
+    em_get_stats(em, &stats);
+    ASSERT_EQ(stats.fd_events, 2, "数据块用尽后不应继续读取");
+    ASSERT_TRUE(stats.fd_stalls >= 1, "应记录暂停次数");
+    ASSERT_TRUE(stats.fd_stalls < 50000 / EM_FD_STALL_RETRY_US + 50, "暂停期间不应空转");
+    
+    /* 执行回调释放数据块后恢复读取 */
+    struct timespec step = {0, 5000000};  /* 5ms */
+    for (int i = 0; i < 100 && fd_frame_count < 4; i++) {
+        em_executor_run(ex, 0);
+        nanosleep(&step, NULL);
+    }
+    ASSERT_EQ(fd_frame_count, 4, "释放数据块后应恢复读取");
+    ASSERT_EQ(fd_frame_sum, 1 + 2 + 3 + 4, "帧数据不正确");
+    
+    em_stop_loop(em);
+    pthread_join(thread, NULL);
+    em_destroy(em);
+    em_executor_destroy(ex);
+    close(fds[0]);
+    close(fds[1]);
+#endif
+    
+    TEST_PASS();
+}
+
+void test_event_loop_batching(void)
+{
+    TEST_START("事件循环自适应批量");
+    
+    em_handle_t em = em_create();
+    loop_callback_count = 0;
+    em_subscribe(em, 0, loop_callback, NULL, EM_PRIORITY_NORMAL);
+    
+    /* 启动前填满队列，积压时批量应逐步增大 */
+    for (int i = 0; i < EM_ASYNC_QUEUE_SIZE; i++) {
+        em_publish_async(em, 0, NULL, 0, EM_PRIORITY_NORMAL);
+        em_publish_async(em, 0, NULL, 0, EM_PRIORITY_LOW);
+    }
+    
+    pthread_t thread;
+    int ret = pthread_create(&thread, NULL, event_loop_thread, em);
+    ASSERT_EQ(ret, 0, "创建线程失败");
+    
+    struct timespec ts = {0, 100000000};  /* 100ms */
+    nanosleep(&ts, NULL);
+    
+    em_stats_t stats;
+    em_get_stats(em, &stats);
+    ASSERT_EQ(loop_callback_count, EM_ASYNC_QUEUE_SIZE * 2, "回调执行次数不正确");
+    ASSERT_TRUE(stats.drain_batch_max > 1, "批量未增大");
+    ASSERT_TRUE(stats.drain_batches < EM_ASYNC_QUEUE_SIZE * 2, "批数不正确");
+    
+    /* 固定批量 */
+    em_batch_policy_t policy = { 4, 4, 0 };
+    ASSERT_EQ(em_set_batch_policy(em, &policy), EM_OK, "设置批量策略失败");
+    em_reset_stats(em);
+    
+    /* 暂停循环后再填充队列 */
+    em_stop_loop(em);
+    pthread_join(thread, NULL);
+    for (int i = 0; i < 20; i++) {
+        em_publish_async(em, 0, NULL, 0, EM_PRIORITY_NORMAL);
+    }
+    ret = pthread_create(&thread, NULL, event_loop_thread, em);
+    ASSERT_EQ(ret, 0, "创建线程失败");
+    nanosleep(&ts, NULL);
+    em_stop_loop(em);
+    pthread_join(thread, NULL);
+    
+    em_get_stats(em, &stats);
+    ASSERT_EQ(stats.drain_batch_max, 4, "固定批量不正确");
+    ASSERT_EQ(stats.drain_batches, 5, "批数不正确");
+    
+    em_destroy(em);
+    TEST_PASS();
+}
+
+static atomic_int flush_test_count;
+static em_error_t flush_self_result;
+
+static void flush_slow_callback(em_event_id_t id, em_event_data_t data, void* user)
+{
+    (void)id; (void)data; (void)user;
+    struct timespec ts = {0, 1000000};  /* 1ms */
+    nanosleep(&ts, NULL);
+    atomic_fetch_add(&flush_test_count, 1);
+}
+
+static void flush_self_callback(em_event_id_t id, em_event_data_t data, void* user)
+{
+    (void)id; (void)data;
+    flush_self_result = em_flush((em_handle_t)user, 0);
+}
+
+static void* flush_stage_publisher(void* arg)
+{
+    em_handle_t em = (em_handle_t)arg;
+    for (int i = 0; i < 5; i++) {
+        em_publish_async(em, 0, NULL, 0, EM_PRIORITY_NORMAL);
+    }
+    return NULL;
+}
+
+void test_flush(void)
+{
+    TEST_START("完成屏障 em_flush");
+    
+    ASSERT_EQ(em_flush(NULL, 0), EM_ERR_INVALID_PARAM, "空句柄应返回参数错误");
+    
+    em_handle_t em = em_create();
+    ASSERT_NOT_NULL(em, "创建失败");
+    em_subscribe(em, 0, flush_slow_callback, NULL, EM_PRIORITY_NORMAL);
+    em_subscribe(em, 1, flush_self_callback, em, EM_PRIORITY_NORMAL);
+    atomic_store(&flush_test_count, 0);
+    
+    /* 队列为空时立即返回 */
+    ASSERT_EQ(em_flush(em, 0), EM_OK, "空队列应立即完成");
+    
+    /* 没有消费者时只能等到超时 */
+    em_publish_async(em, 0, NULL, 0, EM_PRIORITY_NORMAL);
+    ASSERT_EQ(em_flush(em, 1000000), EM_ERR_TIMEOUT, "应超时");
+    
+    pthread_t thread;
+    ASSERT_EQ(pthread_create(&thread, NULL, event_loop_thread, em), 0, "创建线程失败");
+    
+    /* 返回时之前发布的事件都已分发完 */
+    for (int i = 1; i < 20; i++) {
+        em_publish_async(em, 0, NULL, 0, (em_priority_t)(i % EM_PRIORITY_COUNT));
+    }
+    ASSERT_EQ(em_flush(em, UINT64_MAX), EM_OK, "等待失败");
+    ASSERT_EQ(atomic_load(&flush_test_count), 20, "返回时仍有事件未分发");
+    
+    /* 在回调中等待自己会死锁，直接拒绝 */
+    flush_self_result = EM_OK;
+    em_publish_async(em, 1, NULL, 0, EM_PRIORITY_NORMAL);
+    ASSERT_EQ(em_flush(em, UINT64_MAX), EM_OK, "等待失败");
+    ASSERT_EQ(flush_self_result, EM_ERR_NOT_SUPPORTED, "回调中调用应被拒绝");
+    
+    /* 其他线程暂存的自动批量事件也在等待范围内(暂存时间足够长，不会自行刷新) */
+    em_auto_batch_t batch = { .enabled = true, .max_delay_us = 10000000 };
+    ASSERT_EQ(em_set_auto_batch(em, &batch), EM_OK, "启用自动批量失败");
+    pthread_t publisher;
+    ASSERT_EQ(pthread_create(&publisher, NULL, flush_stage_publisher, em), 0, "创建线程失败");
+    pthread_join(publisher, NULL);
+    ASSERT_EQ(em_get_queue_size(em), 0, "事件应仍在暂存区");
+    ASSERT_EQ(em_flush(em, UINT64_MAX), EM_OK, "等待失败");
+    ASSERT_EQ(atomic_load(&flush_test_count), 25, "其他线程暂存的事件未分发");
+    em_set_auto_batch(em, NULL);
+    
+    em_stop_loop(em);
+    pthread_join(thread, NULL);
+    em_destroy(em);
+    
+    /* 环形缓冲区中的事件同样计入：没有消费者时应超时，有消费者时返回前已分发 */
+    em_config_t isr_cfg;
+    em_config_init(&isr_cfg);
+    isr_cfg.isr_ring_size = 4;
+    em = em_create_with_config(&isr_cfg);
+    ASSERT_NOT_NULL(em, "创建失败");
+    em_subscribe(em, 0, flush_slow_callback, NULL, EM_PRIORITY_NORMAL);
+    atomic_store(&flush_test_count, 0);
+    ASSERT_EQ(em_publish_from_isr(em, 0, NULL, 0, EM_PRIORITY_NORMAL), EM_OK, "写入环形缓冲区失败");
+    ASSERT_EQ(em_flush(em, 1000000), EM_ERR_TIMEOUT, "环形缓冲区中的事件应计入等待");
+    ASSERT_EQ(em_publish_from_isr(em, 0, NULL, 0, EM_PRIORITY_NORMAL), EM_OK, "写入环形缓冲区失败");
+    ASSERT_EQ(pthread_create(&thread, NULL, event_loop_thread, em), 0, "创建线程失败");
+    ASSERT_EQ(em_flush(em, UINT64_MAX), EM_OK, "等待失败");
+    ASSERT_EQ(atomic_load(&flush_test_count), 2, "环形缓冲区中的事件未分发");
+    em_stop_loop(em);
+    pthread_join(thread, NULL);
+    em_destroy(em);
+    
+    em_config_t cfg;
+    em_config_init(&cfg);
+    cfg.lock_type = EM_LOCK_NONE;
+    em = em_create_with_config(&cfg);
+    ASSERT_EQ(em_flush(em, 0), EM_ERR_NOT_SUPPORTED, "不加锁时不支持");
+    em_destroy(em);
+    
+    TEST_PASS();
+}
+
+static void* auto_batch_short_thread(void* arg)
+{
+    em_handle_t em = (em_handle_t)arg;
+    int data = 1;
+    em_publish_async(em, 0, &data, sizeof(int), EM_PRIORITY_NORMAL);
+    em_flush_thread(em);
+    return NULL;
+}
+
+void test_auto_batch_thread_exit(void)
+{
+    TEST_START("自动批量暂存区在线程退出后回收");
+    
+    em_handle_t em = em_create();
+    em_subscribe(em, 0, test_callback, NULL, EM_PRIORITY_NORMAL);
+    em_auto_batch_t cfg = { .enabled = true, .max_delay_us = 10000000 };
+    ASSERT_EQ(em_set_auto_batch(em, &cfg), EM_OK, "启用失败");
+    
+    /* 线程数超过暂存区槽位，退出线程的槽位应交给后来的线程，每个线程都走暂存路径 */
+    int threads = EM_MAX_STAGE_THREADS + 4;
+    for (int i = 0; i < threads; i++) {
+        pthread_t thread;
+        ASSERT_EQ(pthread_create(&thread, NULL, auto_batch_short_thread, em), 0, "创建线程失败");
+        pthread_join(thread, NULL);
+    }
+    
+    em_stats_t stats;
+    em_get_stats(em, &stats);
+    ASSERT_EQ(stats.auto_batch_flushes, (uint32_t)threads, "退出线程的暂存区未被回收");
+    ASSERT_EQ(em_process_all(em), threads, "处理数不正确");
+    
+    em_destroy(em);
+    TEST_PASS();
+}
+
+static char auto_trace[16];
+static atomic_int auto_trace_len;
+
+static void auto_mark(char c)
+{
+    int i = atomic_fetch_add(&auto_trace_len, 1);
+    if (i < (int)sizeof(auto_trace) - 1) {
+        auto_trace[i] = c;
+    }
+}
+
+static void auto_chain_callback(em_event_id_t id, em_event_data_t data, void* user)
+{
+    (void)data;
+    em_handle_t em = (em_handle_t)user;
+    auto_mark('A');
+    if (id == 1) {
+        /* 先有 HIGH 事件排队，内联会越过它，应改为入队 */
+        em_publish_async(em, 3, NULL, 0, EM_PRIORITY_HIGH);
+    }
+    int value = 42;
+    em_publish_auto(em, 2, &value, sizeof(value), EM_PRIORITY_NORMAL);
+    auto_mark('a');
+}
+
+static void auto_next_callback(em_event_id_t id, em_event_data_t data, void* user)
+{
+    (void)user;
+    auto_mark(id == 2 && data != NULL && *(const int*)data == 42 ? 'B' : '?');
+}
+
+static void auto_high_callback(em_event_id_t id, em_event_data_t data, void* user)
+{
+    (void)id; (void)data; (void)user;
+    auto_mark('H');
+}
+
+void test_publish_auto(void)
+{
+    TEST_START("事件循环空闲时内联分发");
+    
+    em_handle_t em = em_create();
+    ASSERT_NOT_NULL(em, "创建失败");
+    em_subscribe(em, 0, auto_chain_callback, em, EM_PRIORITY_NORMAL);
+    em_subscribe(em, 1, auto_chain_callback, em, EM_PRIORITY_NORMAL);
+    em_subscribe(em, 2, auto_next_callback, NULL, EM_PRIORITY_NORMAL);
+    em_subscribe(em, 3, auto_high_callback, NULL, EM_PRIORITY_NORMAL);
+    
+    /* 不在事件循环线程上：等同于异步发布 */
+    int value = 42;
+    ASSERT_EQ(em_publish_auto(em, 2, &value, sizeof(value), EM_PRIORITY_NORMAL), EM_OK, "发布失败");
+    ASSERT_EQ(em_get_queue_size(em), 1, "应入队");
+    em_clear_queue(em);
+    
+    pthread_t thread;
+    ASSERT_EQ(pthread_create(&thread, NULL, event_loop_thread, em), 0, "创建线程失败");
+    
+    /* 队列空闲：当前回调返回后紧接着分发，不入队 */
+    memset(auto_trace, 0, sizeof(auto_trace));
+    atomic_store(&auto_trace_len, 0);
+    em_publish_async(em, 0, NULL, 0, EM_PRIORITY_NORMAL);
+    ASSERT_EQ(em_flush(em, UINT64_MAX), EM_OK, "等待失败");
+    ASSERT_TRUE(strcmp(auto_trace, "AaB") == 0, "内联分发顺序不正确");
+    
+    em_stats_t stats;
+    em_get_stats(em, &stats);
+    ASSERT_EQ(stats.events_inlined, 1, "内联分发计数不正确");
+    
+    /* 更高优先级的事件在排队：改为入队，排在它之后 */
+    memset(auto_trace, 0, sizeof(auto_trace));
+    atomic_store(&auto_trace_len, 0);
+    em_publish_async(em, 1, NULL, 0, EM_PRIORITY_NORMAL);
+    ASSERT_EQ(em_flush(em, UINT64_MAX), EM_OK, "等待失败");
+    ASSERT_EQ(em_flush(em, UINT64_MAX), EM_OK, "等待失败");  /* 回调中入队的事件 */
+    ASSERT_TRUE(strcmp(auto_trace, "AaHB") == 0, "不应越过已排队的事件");
+    em_get_stats(em, &stats);
+    ASSERT_EQ(stats.events_inlined, 1, "不应内联分发");
+    
+    em_stop_loop(em);
+    pthread_join(thread, NULL);
+    em_destroy(em);
+    TEST_PASS();
+}
+
+static em_handle_t isr_test_em;
+static atomic_int isr_test_count;
+static atomic_int isr_test_sum;
+
+static void isr_callback(em_event_id_t id, em_event_data_t data, void* user)
+{
+    (void)id; (void)user;
+    if (data != NULL) {
+        atomic_fetch_add(&isr_test_sum, *(const int*)data);
+    }
+    atomic_fetch_add(&isr_test_count, 1);
+}
+
+static void isr_signal_handler(int sig)
+{
+    int value = sig;
+    em_publish_from_isr(isr_test_em, 0, &value, sizeof(value), EM_PRIORITY_HIGH);
+}
+
+void test_publish_from_isr(void)
+{
+    TEST_START("中断/信号上下文发布");
+    
+    em_handle_t em = em_create();
+    int value = 1;
+    ASSERT_EQ(em_publish_from_isr(em, 0, &value, sizeof(value), EM_PRIORITY_NORMAL),
+              EM_ERR_NOT_SUPPORTED, "未启用时不支持");
+    em_destroy(em);
+    
+    em_config_t cfg;
+    em_config_init(&cfg);
+    cfg.isr_ring_size = 3;  /* 向上取为4 */
+    em = em_create_with_config(&cfg);
+    ASSERT_NOT_NULL(em, "创建失败");
+    em_subscribe(em, 0, isr_callback, NULL, EM_PRIORITY_NORMAL);
+    atomic_store(&isr_test_count, 0);
+    atomic_store(&isr_test_sum, 0);
+    
+    char big[EM_ISR_PAYLOAD_SIZE + 1] = {0};
+    ASSERT_EQ(em_publish_from_isr(em, 0, big, sizeof(big), EM_PRIORITY_NORMAL),
+              EM_ERR_INVALID_PARAM, "数据超长应被拒绝");
+    
+    /* 数据内联复制，环满时拒绝 */
+    for (value = 1; value <= 4; value++) {
+        ASSERT_EQ(em_publish_from_isr(em, 0, &value, sizeof(value), EM_PRIORITY_NORMAL), EM_OK, "发布失败");
+    }
+    ASSERT_EQ(em_publish_from_isr(em, 0, &value, sizeof(value), EM_PRIORITY_NORMAL),
+              EM_ERR_QUEUE_FULL, "环满时应拒绝");
+    ASSERT_EQ(em_process_all(em), 4, "处理数量不正确");
+    ASSERT_EQ(atomic_load(&isr_test_sum), 1 + 2 + 3 + 4, "数据不正确");
+    
+    em_stats_t stats;
+    em_get_stats(em, &stats);
+    ASSERT_EQ(stats.isr_events, 4, "发布计数不正确");
+    ASSERT_EQ(stats.isr_dropped, 1, "丢弃计数不正确");
+    
+    /* 从信号处理函数发布，唤醒另一个线程上的事件循环 */
+    isr_test_em = em;
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = isr_signal_handler;
+    sigemptyset(&sa.sa_mask);
+    ASSERT_EQ(sigaction(SIGUSR1, &sa, NULL), 0, "安装信号处理函数失败");
+    pthread_t thread;
+    ASSERT_EQ(pthread_create(&thread, NULL, event_loop_thread, em), 0, "创建线程失败");
+    struct timespec ts = {0, 20000000};  /* 20ms */
+    nanosleep(&ts, NULL);
+    
+    atomic_store(&isr_test_count, 0);
+    atomic_store(&isr_test_sum, 0);
+    for (int i = 0; i < 3; i++) {
+        raise(SIGUSR1);
+    }
+    for (int wait = 0; wait < 100 && atomic_load(&isr_test_count) < 3; wait++) {
+        ts.tv_nsec = 10000000;  /* 10ms */
+        nanosleep(&ts, NULL);
+    }
+    ASSERT_EQ(atomic_load(&isr_test_count), 3, "事件未被分发");
+    ASSERT_EQ(atomic_load(&isr_test_sum), SIGUSR1 * 3, "数据不正确");
+    
+    em_stop_loop(em);
+    pthread_join(thread, NULL);
+    sa.sa_handler = SIG_DFL;
+    sigaction(SIGUSR1, &sa, NULL);
+    
+    /* 只由工作线程池消费时同样能取出 */
+    ASSERT_EQ(em_worker_pool_start(em, NULL), EM_OK, "启动线程池失败");
+    nanosleep(&ts, NULL);
+    atomic_store(&isr_test_count, 0);
+    value = 5;
+    ASSERT_EQ(em_publish_from_isr(em, 0, &value, sizeof(value), EM_PRIORITY_NORMAL), EM_OK, "发布失败");
+    for (int wait = 0; wait < 100 && atomic_load(&isr_test_count) < 1; wait++) {
+        nanosleep(&ts, NULL);
+    }
+    ASSERT_EQ(atomic_load(&isr_test_count), 1, "工作线程未取出事件");
+    em_worker_pool_stop(em);
+    em_destroy(em);
+    isr_test_em = NULL;
+    
+    TEST_PASS();
+}
+
+static int sched_order[64];
+static volatile int sched_order_count = 0;
+
+/* 按处理顺序记录事件ID(发布时事件ID取优先级) */
+static void sched_record_callback(em_event_id_t id, em_event_data_t data, void* user)
+{
+    (void)data; (void)user;
+    if (sched_order_count < 64) {
+        sched_order[sched_order_count] = (int)id;
+    }
+    sched_order_count++;
+}
+
+/* 发布 LOW(t=0)、NORMAL(t=0.2ms)、HIGH(t=2.5ms) 后逐个处理 */
+static void sched_run_three(em_handle_t em)
+{
+    sched_order_count = 0;
+    em_publish_async(em, EM_PRIORITY_LOW, NULL, 0, EM_PRIORITY_LOW);
+    em_advance_time(em, 200000);
+    em_publish_async(em, EM_PRIORITY_NORMAL, NULL, 0, EM_PRIORITY_NORMAL);
+    em_advance_time(em, 2300000);
+    em_publish_async(em, EM_PRIORITY_HIGH, NULL, 0, EM_PRIORITY_HIGH);
+    em_process_all(em);
+}
+
+/* 自定义调度器：LOW 优先 */
+static int low_first_dequeue(void* ctx, const em_sched_view_t* view, em_priority_t* order, int max)
+{
+    (void)ctx;
+    int n = 0;
+    for (int p = EM_PRIORITY_LOW; p >= EM_PRIORITY_HIGH && n < max; p--) {
+        for (uint32_t i = 0; i < em_sched_size(view, (em_priority_t)p) && n < max; i++) {
+            order[n++] = (em_priority_t)p;
+        }
+    }
+    return n;
+}
+
+/* 故意输出无效结果，应回退到严格优先级 */
+static int broken_dequeue(void* ctx, const em_sched_view_t* view, em_priority_t* order, int max)
+{
+    (void)ctx; (void)view;
+    for (int i = 0; i < max; i++) {
+        order[i] = (em_priority_t)7;
+    }
+    return max;
+}
+
+void test_schedulers(void)
+{
+    TEST_START("可替换的出队调度策略");
+    
+    em_config_t cfg;
+    em_config_init(&cfg);
+    cfg.virtual_time = true;
+    em_handle_t em = em_create_with_config(&cfg);
+    ASSERT_NOT_NULL(em, "创建失败");
+    for (int p = 0; p < EM_PRIORITY_COUNT; p++) {
+        em_subscribe(em, (em_event_id_t)p, sched_record_callback, NULL, EM_PRIORITY_NORMAL);
+    }
+    
+    /* 严格优先级(默认) */
+    sched_run_three(em);
+    ASSERT_TRUE(sched_order[0] == 0 && sched_order[1] == 1 && sched_order[2] == 2, "严格优先级顺序不正确");
+    
+    /* 全局先进先出 */
+    ASSERT_EQ(em_set_scheduler(em, EM_SCHED_FIFO, NULL), EM_OK, "设置调度策略失败");
+    sched_run_three(em);
+    ASSERT_TRUE(sched_order[0] == 2 && sched_order[1] == 1 && sched_order[2] == 0, "FIFO 顺序不正确");
+    
+    /* 老化(1ms 一级)：LOW 排序键 0+2ms，NORMAL 0.2+1ms，HIGH 2.5ms */
+    ASSERT_EQ(em_set_scheduler(em, EM_SCHED_AGING, NULL), EM_OK, "设置调度策略失败");
+    sched_run_three(em);
+    ASSERT_TRUE(sched_order[0] == 1 && sched_order[1] == 2 && sched_order[2] == 0, "老化顺序不正确");
+    
+    /* EDF：截止时间 LOW 3ms，NORMAL 0.2+1ms，HIGH 2.5+5ms */
+    em_sched_config_t sc = { .deadline_us = { 5000, 1000, 3000 } };
+    ASSERT_EQ(em_set_scheduler(em, EM_SCHED_EDF, &sc), EM_OK, "设置调度策略失败");
+    sched_run_three(em);
+    ASSERT_TRUE(sched_order[0] == 1 && sched_order[1] == 2 && sched_order[2] == 0, "EDF 顺序不正确");
+    
+    /* 加权公平 2:1:1：积压时前8个事件按比例分配 */
+    sc = (em_sched_config_t){ .weights = { 2, 1, 1 } };
+    ASSERT_EQ(em_set_scheduler(em, EM_SCHED_WFQ, &sc), EM_OK, "设置调度策略失败");
+    sched_order_count = 0;
+    for (int i = 0; i < 8; i++) {
+        for (int p = 0; p < EM_PRIORITY_COUNT; p++) {
+            em_publish_async(em, (em_event_id_t)p, NULL, 0, (em_priority_t)p);
+        }
+    }
+    ASSERT_EQ(em_process_all(em), 24, "处理数量不正确");
+    int served[EM_PRIORITY_COUNT] = { 0 };
+    for (int i = 0; i < 8; i++) {
+        served[sched_order[i]]++;
+    }
+    ASSERT_TRUE(served[0] == 4 && served[1] == 2 && served[2] == 2, "WFQ 份额不正确");
+    
+    /* 自定义调度器 */
+    em_scheduler_ops_t low_first = { "low-first", NULL, low_first_dequeue };
+    ASSERT_EQ(em_set_scheduler_ops(em, &low_first, NULL), EM_OK, "安装调度器失败");
+    sched_run_three(em);
+    ASSERT_TRUE(sched_order[0] == 2 && sched_order[1] == 1 && sched_order[2] == 0, "自定义调度顺序不正确");
+    
+    em_scheduler_ops_t broken = { "broken", NULL, broken_dequeue };
+    em_set_scheduler_ops(em, &broken, NULL);
+    sched_run_three(em);
+    ASSERT_EQ(sched_order_count, 3, "无效的调度结果不应阻塞队列");
+    ASSERT_TRUE(sched_order[0] == 0 && sched_order[1] == 1 && sched_order[2] == 2, "回退顺序不正确");
+    
+    /* 事件循环按批出队：整批顺序与逐个出队一致 */
+    em_set_scheduler(em, EM_SCHED_FIFO, NULL);
+    em_batch_policy_t policy = { 8, 8, 0 };
+    em_set_batch_policy(em, &policy);
+    sched_order_count = 0;
+    for (int i = 0; i < 6; i++) {
+        em_publish_async(em, (em_event_id_t)(2 - i % 3), NULL, 0, (em_priority_t)(2 - i % 3));
+        em_advance_time(em, 1000);
+    }
+    pthread_t thread;
+    ASSERT_EQ(pthread_create(&thread, NULL, event_loop_thread, em), 0, "创建线程失败");
+    struct timespec ts = {0, 1000000};  /* 1ms */
+    for (int k = 0; k < 1000 && sched_order_count < 6; k++) {
+        nanosleep(&ts, NULL);
+    }
+    em_stop_loop(em);
+    pthread_join(thread, NULL);
+    ASSERT_EQ(sched_order_count, 6, "回调执行次数不正确");
+    for (int i = 0; i < 6; i++) {
+        ASSERT_EQ(sched_order[i], 2 - i % 3, "批量 FIFO 顺序不正确");
+    }
+    
+    ASSERT_EQ(em_set_scheduler(em, (em_sched_policy_t)9, NULL), EM_ERR_INVALID_PARAM, "非法策略应失败");
+    em_destroy(em);
+    TEST_PASS();
+}
+
+static volatile int executor_on_loop_thread = 0;
+static pthread_t executor_loop_thread;
+
+static void executor_loop_callback(em_event_id_t id, em_event_data_t data, void* user)
+{
+    (void)id; (void)data; (void)user;
+    if (pthread_equal(pthread_self(), executor_loop_thread)) {
+        executor_on_loop_thread++;
+    }
+}
+
+void test_executor_on_loop(void)
+{
+    TEST_START("执行器挂接到另一个事件循环");
+    
+    em_handle_t bus = em_create();
+    em_handle_t gui = em_create();
+    em_executor_t* ex = em_executor_create(gui, 0);
+    ASSERT_NOT_NULL(ex, "创建执行器失败");
+    
+    executor_on_loop_thread = 0;
+    em_subscribe_on(bus, 0, executor_loop_callback, NULL, EM_PRIORITY_NORMAL, ex);
+    
+    int ret = pthread_create(&executor_loop_thread, NULL, event_loop_thread, gui);
+    ASSERT_EQ(ret, 0, "创建线程失败");
+    
+    /* 在当前线程分发，回调应在 gui 的事件循环线程中执行 */
+    for (int i = 0; i < 3; i++) {
+        em_publish_async(bus, 0, NULL, 0, EM_PRIORITY_NORMAL);
+    }
+    em_process_all(bus);
+    
+    struct timespec ts = {0, 200000000};  /* 200ms */
+    nanosleep(&ts, NULL);
+    
+    em_stop_loop(gui);
+    pthread_join(executor_loop_thread, NULL);
+    
+    ASSERT_EQ(executor_on_loop_thread, 3, "回调未在目标线程执行");
+    
+    em_destroy(bus);
+    em_executor_destroy(ex);
+    em_destroy(gui);
+    TEST_PASS();
+}
+
+static atomic_bool owner_race_stop;
+
+static void* owner_race_publisher(void* arg)
+{
+    em_handle_t bus = (em_handle_t)arg;
+    em_event_t event = {0};
+    while (!atomic_load(&owner_race_stop)) {
+        em_publish(bus, &event);
+    }
+    return NULL;
+}
+
+void test_executor_owner_destroy_race(void)
+{
+    TEST_START("所属管理器销毁时执行器仍在被通知");
+    
+    for (int round = 0; round < 20; round++) {
+        em_handle_t bus = em_create();
+        em_handle_t gui = em_create();
+        em_executor_t* ex = em_executor_create(gui, 0);
+        ASSERT_NOT_NULL(ex, "创建执行器失败");
+        em_subscribe_on(bus, 0, test_callback, NULL, EM_PRIORITY_NORMAL, ex);
+        
+        atomic_store(&owner_race_stop, false);
+        pthread_t thread;
+        int ret = pthread_create(&thread, NULL, owner_race_publisher, bus);
+        ASSERT_EQ(ret, 0, "创建线程失败");
+        
+        /* 分发线程持续通知 gui 时销毁 gui，不能访问已释放的管理器 */
+        struct timespec ts = {0, 1000000};  /* 1ms */
+        nanosleep(&ts, NULL);
+        em_destroy(gui);
+        nanosleep(&ts, NULL);
+        
+        atomic_store(&owner_race_stop, true);
+        pthread_join(thread, NULL);
+        em_destroy(bus);
+        em_executor_destroy(ex);
+    }
+    TEST_PASS();
+}
+
+/*============================================================================
+ *                              Actor 测试
+ *============================================================================*/
+
+typedef struct {
+    atomic_int  inside;     /* 正在运行处理函数的线程数 */
+    atomic_int  count;      /* 已处理的消息数 */
+    atomic_int  overlap;    /* 检测到并发运行的次数 */
+    int         sum;        /* 私有状态，只在处理函数中访问 */
+} actor_state_t;
+
+static void actor_handler(em_event_id_t id, em_event_data_t data, void* state)
+{
+    (void)id;
+    actor_state_t* st = (actor_state_t*)state;
+    if (atomic_fetch_add(&st->inside, 1) != 0) {
+        atomic_fetch_add(&st->overlap, 1);
+    }
+    if (data != NULL) {
+        st->sum += *(int*)data;
+    }
+    atomic_fetch_sub(&st->inside, 1);
+    atomic_fetch_add(&st->count, 1);
+}
+
+void test_actor_mailbox(void)
+{
+    TEST_START("Actor 邮箱(未启动线程池)");
+    
+    em_handle_t em = em_create();
+    actor_state_t st;
+    memset(&st, 0, sizeof(st));
+    
+    em_actor_t* actor = em_actor_create(em, actor_handler, &st, 2);
+    ASSERT_NOT_NULL(actor, "创建 Actor 失败");
+    
+    int v = 1;
+    ASSERT_EQ(em_actor_send(actor, 0, &v, sizeof(v)), EM_OK, "发送失败");
+    ASSERT_EQ(em_actor_send(actor, 0, &v, sizeof(v)), EM_OK, "发送失败");
+    ASSERT_EQ(em_actor_send(actor, 0, &v, sizeof(v)), EM_ERR_QUEUE_FULL, "邮箱应已满");
+    ASSERT_EQ(em_actor_pending(actor), 2, "邮箱数量不正确");
+    ASSERT_EQ(atomic_load(&st.count), 0, "未启动线程池时不应运行");
+    
+    ASSERT_EQ(em_actor_subscribe(actor, 3, EM_PRIORITY_NORMAL), EM_OK, "订阅失败");
+    ASSERT_EQ(em_get_subscriber_count(em, 3), 1, "订阅者数量不正确");
+    
+    /* 销毁时取消订阅并丢弃未处理的消息 */
+    em_actor_destroy(actor);
+    ASSERT_EQ(em_get_subscriber_count(em, 3), 0, "订阅未取消");
+    
+    em_destroy(em);
+    TEST_PASS();
+}
+
+#define ACTOR_TEST_COUNT    64
+#define ACTOR_TEST_EVENTS   20
+
+void test_actor_pool(void)
+{
+    TEST_START("Actor 共享线程池调度");
+    
+    em_handle_t em = em_create();
+    static actor_state_t states[ACTOR_TEST_COUNT];
+    em_actor_t* actors[ACTOR_TEST_COUNT];
+    memset(states, 0, sizeof(states));
+    
+    ASSERT_EQ(em_actor_pool_start(em, 3), EM_OK, "启动线程池失败");
+    
+    for (int i = 0; i < ACTOR_TEST_COUNT; i++) {
+        actors[i] = em_actor_create(em, actor_handler, &states[i], 0);
+        ASSERT_NOT_NULL(actors[i], "创建 Actor 失败");
+    }
+    
+    /* 事件经订阅直接投递到邮箱 */
+    em_actor_subscribe(actors[0], 1, EM_PRIORITY_NORMAL);
+    em_actor_subscribe(actors[1], 1, EM_PRIORITY_NORMAL);
+    
+    for (int n = 0; n < ACTOR_TEST_EVENTS; n++) {
+        int v = n;
+        em_publish_async(em, 1, &v, sizeof(v), EM_PRIORITY_NORMAL);
+        for (int i = 0; i < ACTOR_TEST_COUNT; i++) {
+            em_actor_send(actors[i], 2, &v, sizeof(v));
+        }
+        em_process_all(em);
+    }
+    
+    /* 等待所有消息处理完成 */
+    int expected_total = ACTOR_TEST_COUNT * ACTOR_TEST_EVENTS + 2 * ACTOR_TEST_EVENTS;
+    for (int wait = 0; wait < 200; wait++) {
+        int total = 0;
+        for (int i = 0; i < ACTOR_TEST_COUNT; i++) {
+            total += atomic_load(&states[i].count);
+        }
+        if (total == expected_total) {
+            break;
+        }
+        struct timespec ts = {0, 10000000};  /* 10ms */
+        nanosleep(&ts, NULL);
+    }
+    
+    int sum_expected = ACTOR_TEST_EVENTS * (ACTOR_TEST_EVENTS - 1) / 2;
+    for (int i = 0; i < ACTOR_TEST_COUNT; i++) {
+        int mul = i < 2 ? 2 : 1;
+        ASSERT_EQ(atomic_load(&states[i].count), ACTOR_TEST_EVENTS * mul, "消息数量不正确");
+        ASSERT_EQ(states[i].sum, sum_expected * mul, "消息内容不正确");
+        ASSERT_EQ(atomic_load(&states[i].overlap), 0, "Actor 被并发运行");
+    }
+    
+    for (int i = 0; i < ACTOR_TEST_COUNT; i++) {
+        em_actor_destroy(actors[i]);
+    }
+    em_destroy(em);
+    TEST_PASS();
+}
+
+/*============================================================================
+ *                              弹性工作线程池测试
+ *============================================================================*/
+
+static atomic_int worker_test_count;
+
+static void slow_callback(em_event_id_t id, em_event_data_t data, void* user)
+{
+    (void)id; (void)data; (void)user;
+    struct timespec ts = {0, 2000000};  /* 2ms */
+    nanosleep(&ts, NULL);
+    atomic_fetch_add(&worker_test_count, 1);
+}
+
+void test_worker_pool_elastic(void)
+{
+    TEST_START("弹性工作线程池伸缩");
+    
+    em_handle_t em = em_create();
+    em_subscribe(em, 0, slow_callback, NULL, EM_PRIORITY_NORMAL);
+    atomic_store(&worker_test_count, 0);
+    
+    em_worker_pool_config_t cfg = {
+        .min_workers = 1, .max_workers = 4,
+        .scale_up_depth = 4, .scale_up_hold_us = 1000, .idle_park_us = 20000
+    };
+    ASSERT_EQ(em_worker_pool_start(em, &cfg), EM_OK, "启动线程池失败");
+    ASSERT_EQ(em_worker_pool_start(em, &cfg), EM_ERR_ALREADY_INIT, "不应重复启动");
+    
+    /* 积压时扩容 */
+    for (int i = 0; i < EM_ASYNC_QUEUE_SIZE; i++) {
+        em_publish_async(em, 0, NULL, 0, EM_PRIORITY_NORMAL);
+    }
+    for (int wait = 0; wait < 200 && atomic_load(&worker_test_count) < EM_ASYNC_QUEUE_SIZE; wait++) {
+        struct timespec ts = {0, 10000000};  /* 10ms */
+        nanosleep(&ts, NULL);
+    }
+    ASSERT_EQ(atomic_load(&worker_test_count), EM_ASYNC_QUEUE_SIZE, "事件未全部处理");
+    
+    em_stats_t stats;
+    em_get_stats(em, &stats);
+    ASSERT_TRUE(stats.workers_peak > 1, "线程池未扩容");
+    ASSERT_TRUE(stats.workers_peak <= 4, "超过最大线程数");
+    
+    /* 空闲后停放到常驻线程数 */
+    struct timespec ts = {0, 150000000};  /* 150ms */
+    nanosleep(&ts, NULL);
+    em_get_stats(em, &stats);
+    ASSERT_EQ(stats.workers_active, 1, "空闲线程未停放");
+    
+    /* 再次积压时唤醒停放的线程 */
+    for (int i = 0; i < EM_ASYNC_QUEUE_SIZE; i++) {
+        em_publish_async(em, 0, NULL, 0, EM_PRIORITY_NORMAL);
+    }
+    for (int wait = 0; wait < 200 && atomic_load(&worker_test_count) < EM_ASYNC_QUEUE_SIZE * 2; wait++) {
+        ts.tv_nsec = 10000000;
+        nanosleep(&ts, NULL);
+    }
+    ASSERT_EQ(atomic_load(&worker_test_count), EM_ASYNC_QUEUE_SIZE * 2, "事件未全部处理");
+    
+    ASSERT_EQ(em_worker_pool_stop(em), EM_OK, "停止线程池失败");
+    em_get_stats(em, &stats);
+    ASSERT_EQ(stats.workers_active, 0, "停止后仍有活动线程");
+    
+    em_destroy(em);
+    TEST_PASS();
+}
+#endif
+
+/*============================================================================
+ *                              主函数
+ *============================================================================*/
+
+int main(void)
+{
+    printf("=== 事件管理器单元测试 ===\n");
+    printf("版本: %s\n\n", em_version());
+    
+    /* 创建/销毁 */
+    test_create_destroy();
+    test_destroy_null();
+    
+    /* 订阅 */
+    test_subscribe_basic();
+    test_subscribe_with_user_data();
+    test_subscribe_multiple();
+    test_subscribe_duplicate();
+    test_subscribe_invalid_params();
+    
+    /* 取消订阅 */
+    test_unsubscribe_basic();
+    test_unsubscribe_not_found();
+    test_unsubscribe_all();
+    
+    /* 同步事件 */
+    test_publish_sync_basic();
+    test_publish_sync_no_subscribers();
+    
+    /* 异步事件 */
+    test_publish_async_basic();
+    test_publish_async_with_data_copy();
+    test_process_all();
+    test_publish_group();
+    test_publish_on_change();
+    
+    /* 优先级 */
+    test_subscriber_priority();
+    test_event_priority();
+    test_subscriber_groups();
+    
+    /* 队列管理 */
     test_clear_queue();
     test_queue_empty();
     
     /* 统计 */
     test_statistics();
     test_reset_statistics();
+    test_top_events();
     
     /* 工具函数 */
     test_has_subscribers();
     test_error_string();
     test_version();
+    test_clock_sources();
+    test_virtual_time();
+    
+    /* 执行器 */
+    test_executor_user_polled();
+    test_executor_overflow();
+    
+    /* 队列容量 */
+    test_resize_queue();
+    test_auto_batch();
+    test_producer_quota();
+    test_payload_pool_reserve();
+    
+    /* 负载控制 */
+    test_load_shedding();
     
     /* 事件循环 */
 #if EM_ENABLE_THREADING
     test_event_loop_basic();
+    test_event_loop_batching();
+    test_flush();
+    test_auto_batch_thread_exit();
+    test_publish_auto();
+    test_publish_from_isr();
+    test_schedulers();
+    test_wakeup_counters();
+    test_lock_types();
+    test_fd_sources();
+    test_fd_source_stall();
+    test_executor_on_loop();
+    test_executor_owner_destroy_race();
+    
+    /* Actor */
+    test_actor_mailbox();
+    test_actor_pool();
+    
+    /* 弹性工作线程池 */
+    test_worker_pool_elastic();
 #endif
     
     /* 结果汇总 */
@@ -0,0 +1,375 @@
+/**
+ * @file test_hsm.c
+ * @brief 表驱动层次状态机单元测试
+ *
+ * 编译: gcc -o test_hsm test_hsm.c ../src/em_hsm.c ../src/event_manager.c -I../include -lpthread
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "em_hsm.h"
+
+/*============================================================================
+ *                              测试框架
+ *============================================================================*/
+
+static int tests_run = 0;
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+#define TEST_START(name) \
+    do { \
+        printf("测试: %s ... ", name); \
+        tests_run++; \
+    } while(0)
+
+#define TEST_PASS() \
+    do { \
+        printf("通过\n"); \
+        tests_passed++; \
+    } while(0)
+
+#define TEST_FAIL(msg) \
+    do { \
+        printf("失败: %s\n", msg); \
+        tests_failed++; \
+    } while(0)
+
+#define ASSERT_TRUE(cond, msg) \
+    do { \
+        if (!(cond)) { \
+            TEST_FAIL(msg); \
+            return; \
+        } \
+    } while(0)
+
+#define ASSERT_EQ(a, b, msg) ASSERT_TRUE((a) == (b), msg)
+#define ASSERT_NOT_NULL(ptr, msg) ASSERT_TRUE((ptr) != NULL, msg)
+#define ASSERT_STR(a, b, msg) ASSERT_TRUE(strcmp((a), (b)) == 0, msg)
+
+/*============================================================================
+ *                              测试辅助
+ *============================================================================*/
+
+/*
+ * 设备状态机：
+ *   off
+ *   on (初始子状态 idle)
+ *     idle
+ *     busy
+ */
+enum { S_OFF, S_ON, S_IDLE, S_BUSY, S_COUNT };
+enum { EV_POWER = 1, EV_JOB, EV_DONE, EV_PING, EV_RESET, EV_CHAIN, EV_CHAIN_DATA, EV_VALUE };
+
+static char trace_log[256];
+
+static void log_append(const char* token)
+{
+    strncat(trace_log, token, sizeof(trace_log) - strlen(trace_log) - 1);
+}
+
+static void reset_log(void)
+{
+    trace_log[0] = '\0';
+}
+
+#define LOG_ACTION(fn, token) \
+    static void fn(em_hsm_t* hsm, em_event_id_t id, em_event_data_t data, void* user) \
+    { \
+        (void)hsm; (void)id; (void)data; (void)user; \
+        log_append(token); \
+    }
+
+LOG_ACTION(enter_off,  "+off ")
+LOG_ACTION(exit_off,   "-off ")
+LOG_ACTION(enter_on,   "+on ")
+LOG_ACTION(exit_on,    "-on ")
+LOG_ACTION(enter_idle, "+idle ")
+LOG_ACTION(exit_idle,  "-idle ")
+LOG_ACTION(enter_busy, "+busy ")
+LOG_ACTION(exit_busy,  "-busy ")
+LOG_ACTION(act_job,    "job ")
+LOG_ACTION(act_ping,   "ping ")
+
+/* 守卫：数据为非零整数时允许开始任务 */
+static bool has_work(em_hsm_t* hsm, em_event_id_t id, em_event_data_t data, void* user)
+{
+    (void)hsm; (void)id; (void)user;
+    return data != NULL && *(int*)data != 0;
+}
+
+/* 转换动作中同步发布下一个事件 */
+static void act_chain(em_hsm_t* hsm, em_event_id_t id, em_event_data_t data, void* user)
+{
+    (void)hsm; (void)id; (void)data;
+    log_append("chain ");
+    em_publish_sync((em_handle_t)user, EV_DONE, NULL);
+    log_append("chain-end ");
+}
+
+/* 转换动作中带着栈上的数据分发下一个事件，返回前改写该数据 */
+static void act_chain_data(em_hsm_t* hsm, em_event_id_t id, em_event_data_t data, void* user)
+{
+    (void)id; (void)data;
+    int local = 42;
+    em_hsm_dispatch(hsm, EV_VALUE, &local, sizeof(local));
+    em_publish_sync((em_handle_t)user, EV_VALUE, &local);
+    local = 0;
+}
+
+static int last_value = -1;
+
+static void act_value(em_hsm_t* hsm, em_event_id_t id, em_event_data_t data, void* user)
+{
+    (void)hsm; (void)id; (void)user;
+    last_value = *(const int*)data;
+}
+
+static const em_hsm_state_t device_states[S_COUNT] = {
+    [S_OFF]  = { "off",  EM_HSM_NONE, EM_HSM_NONE, enter_off,  exit_off },
+    [S_ON]   = { "on",   EM_HSM_NONE, S_IDLE,      enter_on,   exit_on },
+    [S_IDLE] = { "idle", S_ON,        EM_HSM_NONE, enter_idle, exit_idle },
+    [S_BUSY] = { "busy", S_ON,        EM_HSM_NONE, enter_busy, exit_busy },
+};
+
+static const em_hsm_transition_t device_transitions[] = {
+    { S_OFF,  EV_POWER, S_ON,        NULL,     NULL },
+    { S_ON,   EV_POWER, S_OFF,       NULL,     NULL },
+    { S_IDLE, EV_JOB,   S_BUSY,      has_work, act_job },
+    { S_IDLE, EV_JOB,   EM_HSM_NONE, NULL,     act_ping },   /* 没有任务时只记录 */
+    { S_BUSY, EV_DONE,  S_IDLE,      NULL,     NULL },
+    { S_ON,   EV_PING,  EM_HSM_NONE, NULL,     act_ping },
+    { S_ON,   EV_RESET, S_ON,        NULL,     NULL },
+    { S_IDLE, EV_CHAIN, S_BUSY,      NULL,     act_chain },
+    { S_IDLE, EV_CHAIN_DATA, S_BUSY, NULL,     act_chain_data },
+    { S_BUSY, EV_VALUE, EM_HSM_NONE, NULL,     act_value },
+};
+
+static em_hsm_config_t device_config(void* user)
+{
+    em_hsm_config_t cfg = {
+        .states = device_states,
+        .state_count = S_COUNT,
+        .transitions = device_transitions,
+        .transition_count = (int)(sizeof(device_transitions) / sizeof(device_transitions[0])),
+        .initial = S_OFF,
+        .user_data = user
+    };
+    return cfg;
+}
+
+/*============================================================================
+ *                              测试用例
+ *============================================================================*/
+
+void test_hsm_transitions(void)
+{
+    TEST_START("层次转换、守卫与内部转换");
+    reset_log();
+
+    em_hsm_config_t cfg = device_config(NULL);
+    em_hsm_t* hsm = em_hsm_create(NULL, &cfg);
+    ASSERT_NOT_NULL(hsm, "创建失败");
+    ASSERT_STR(trace_log, "+off ", "应进入初始状态");
+
+    /* 进入复合状态时沿初始子状态进入 */
+    reset_log();
+    ASSERT_EQ(em_hsm_dispatch(hsm, EV_POWER, NULL, 0), EM_OK, "开机失败");
+    ASSERT_STR(trace_log, "-off +on +idle ", "进入顺序错误");
+    ASSERT_EQ(em_hsm_current(hsm), S_IDLE, "应处于 idle");
+    ASSERT_TRUE(em_hsm_in_state(hsm, S_ON) && !em_hsm_in_state(hsm, S_OFF), "状态判断错误");
+
+    /* 守卫不成立时取下一条候选：内部转换 */
+    int work = 0;
+    reset_log();
+    ASSERT_EQ(em_hsm_dispatch(hsm, EV_JOB, &work, sizeof(work)), EM_OK, "内部转换失败");
+    ASSERT_STR(trace_log, "ping ", "内部转换不应退出或进入");
+    ASSERT_EQ(em_hsm_current(hsm), S_IDLE, "内部转换后应仍在 idle");
+
+    work = 1;
+    reset_log();
+    ASSERT_EQ(em_hsm_dispatch(hsm, EV_JOB, &work, sizeof(work)), EM_OK, "开始任务失败");
+    ASSERT_STR(trace_log, "-idle job +busy ", "兄弟状态转换顺序错误");
+
+    /* 子状态继承父状态的转换 */
+    reset_log();
+    ASSERT_EQ(em_hsm_dispatch(hsm, EV_PING, NULL, 0), EM_OK, "继承的内部转换失败");
+    ASSERT_STR(trace_log, "ping ", "继承的内部转换错误");
+
+    /* 自转换：退出到子状态再重新进入 */
+    reset_log();
+    ASSERT_EQ(em_hsm_dispatch(hsm, EV_RESET, NULL, 0), EM_OK, "自转换失败");
+    ASSERT_STR(trace_log, "-busy -on +on +idle ", "自转换应退出并重新进入");
+
+    reset_log();
+    ASSERT_EQ(em_hsm_dispatch(hsm, EV_POWER, NULL, 0), EM_OK, "关机失败");
+    ASSERT_STR(trace_log, "-idle -on +off ", "从子状态退出顺序错误");
+
+    /* 未处理的事件 */
+    ASSERT_EQ(em_hsm_dispatch(hsm, EV_DONE, NULL, 0), EM_ERR_NOT_FOUND, "off 不应处理 DONE");
+    ASSERT_EQ(em_hsm_dispatch(hsm, EM_MAX_EVENT_TYPES, NULL, 0), EM_ERR_INVALID_PARAM, "事件ID越界应失败");
+
+    em_hsm_stats_t stats;
+    ASSERT_EQ(em_hsm_get_stats(hsm, &stats), EM_OK, "获取统计失败");
+    ASSERT_EQ(stats.events, 7, "事件数错误");
+    ASSERT_EQ(stats.transitions, 6, "转换数错误");
+    ASSERT_EQ(stats.unhandled, 1, "未处理数错误");
+
+    em_hsm_destroy(hsm);
+    TEST_PASS();
+}
+
+void test_hsm_manager(void)
+{
+    TEST_START("由事件管理器驱动并共用订阅");
+
+    em_handle_t em = em_create();
+    ASSERT_NOT_NULL(em, "创建管理器失败");
+
+    em_hsm_config_t cfg = device_config(em);
+    em_hsm_t* a = em_hsm_create(em, &cfg);
+    em_hsm_t* b = em_hsm_create(em, &cfg);
+    ASSERT_TRUE(a != NULL && b != NULL, "创建状态机失败");
+    ASSERT_EQ(em_get_subscriber_count(em, EV_POWER), 1, "同一事件应只订阅一次");
+
+    em_publish_sync(em, EV_POWER, NULL);
+    ASSERT_TRUE(em_hsm_current(a) == S_IDLE && em_hsm_current(b) == S_IDLE, "同步事件应驱动两个状态机");
+
+    int work = 1;
+    em_publish_async(em, EV_JOB, &work, sizeof(work), EM_PRIORITY_NORMAL);
+    em_process_all(em);
+    ASSERT_TRUE(em_hsm_current(a) == S_BUSY && em_hsm_current(b) == S_BUSY, "异步事件应驱动两个状态机");
+
+    /* 销毁一个后另一个仍然收到事件 */
+    em_hsm_destroy(a);
+    ASSERT_EQ(em_get_subscriber_count(em, EV_DONE), 1, "仍有状态机时应保留订阅");
+    em_publish_sync(em, EV_DONE, NULL);
+    ASSERT_EQ(em_hsm_current(b), S_IDLE, "剩余的状态机应收到事件");
+
+    em_hsm_destroy(b);
+    ASSERT_EQ(em_get_subscriber_count(em, EV_DONE), 0, "全部销毁后应取消订阅");
+
+    /* 全部销毁后集合已释放，再创建时重新建立并订阅 */
+    a = em_hsm_create(em, &cfg);
+    ASSERT_NOT_NULL(a, "再次创建失败");
+    ASSERT_EQ(em_get_subscriber_count(em, EV_POWER), 1, "应重新订阅");
+    em_publish_sync(em, EV_POWER, NULL);
+    ASSERT_EQ(em_hsm_current(a), S_IDLE, "再次创建的状态机应收到事件");
+    em_hsm_destroy(a);
+    em_destroy(em);
+
+    /* 新管理器(可能分配在同一地址)上的状态机使用新的集合 */
+    em = em_create();
+    ASSERT_NOT_NULL(em, "创建管理器失败");
+    cfg = device_config(em);
+    a = em_hsm_create(em, &cfg);
+    ASSERT_NOT_NULL(a, "新管理器上创建失败");
+    ASSERT_EQ(em_get_subscriber_count(em, EV_POWER), 1, "新管理器上应订阅");
+    em_publish_sync(em, EV_POWER, NULL);
+    ASSERT_EQ(em_hsm_current(a), S_IDLE, "新管理器上的状态机应收到事件");
+    em_hsm_destroy(a);
+    em_destroy(em);
+    TEST_PASS();
+}
+
+void test_hsm_run_to_completion(void)
+{
+    TEST_START("运行到完成");
+
+    em_handle_t em = em_create();
+    em_hsm_config_t cfg = device_config(em);
+    em_hsm_t* hsm = em_hsm_create(em, &cfg);
+    ASSERT_NOT_NULL(hsm, "创建失败");
+    em_publish_sync(em, EV_POWER, NULL);
+
+    /* 转换动作中同步发布的 DONE 在进入 busy 之后才处理 */
+    reset_log();
+    em_publish_sync(em, EV_CHAIN, NULL);
+    ASSERT_STR(trace_log, "-idle chain chain-end +busy -busy +idle ", "延后事件应在转换完成后处理");
+    ASSERT_EQ(em_hsm_current(hsm), S_IDLE, "应回到 idle");
+
+    em_hsm_stats_t stats;
+    em_hsm_get_stats(hsm, &stats);
+    ASSERT_EQ(stats.deferred, 1, "应延后1个事件");
+
+    /* 延后的事件使用复制的数据；同步发布转发回来的数据无法复制，丢弃 */
+    last_value = -1;
+    em_publish_sync(em, EV_CHAIN_DATA, NULL);
+    ASSERT_EQ(last_value, 42, "延后的事件应使用复制的数据");
+    em_hsm_get_stats(hsm, &stats);
+    ASSERT_EQ(stats.deferred, 2, "应延后直接分发的事件");
+    ASSERT_EQ(stats.dropped, 1, "转发回来的带数据事件应被丢弃");
+
+    em_hsm_destroy(hsm);
+    em_destroy(em);
+    TEST_PASS();
+}
+
+void test_hsm_invalid_tables(void)
+{
+    TEST_START("无效的状态表");
+
+    em_hsm_config_t cfg = device_config(NULL);
+    cfg.initial = S_COUNT;
+    ASSERT_TRUE(em_hsm_create(NULL, &cfg) == NULL, "初始状态越界应失败");
+
+    /* 父状态成环 */
+    em_hsm_state_t cycle[2] = {
+        { "a", 1, EM_HSM_NONE, NULL, NULL },
+        { "b", 0, EM_HSM_NONE, NULL, NULL },
+    };
+    cfg = device_config(NULL);
+    cfg.states = cycle;
+    cfg.state_count = 2;
+    cfg.transition_count = 0;
+    cfg.initial = 0;
+    ASSERT_TRUE(em_hsm_create(NULL, &cfg) == NULL, "父状态成环应失败");
+
+    /* 初始子状态不是直接子状态 */
+    em_hsm_state_t bad_initial[2] = {
+        { "a", EM_HSM_NONE, 1, NULL, NULL },
+        { "b", EM_HSM_NONE, EM_HSM_NONE, NULL, NULL },
+    };
+    cfg.states = bad_initial;
+    ASSERT_TRUE(em_hsm_create(NULL, &cfg) == NULL, "初始子状态无效应失败");
+
+    /* 转换的事件ID越界 */
+    em_hsm_transition_t bad_event = { S_OFF, EM_MAX_EVENT_TYPES, S_ON, NULL, NULL };
+    cfg = device_config(NULL);
+    cfg.transitions = &bad_event;
+    cfg.transition_count = 1;
+    ASSERT_TRUE(em_hsm_create(NULL, &cfg) == NULL, "事件ID越界应失败");
+
+    ASSERT_TRUE(em_hsm_create(NULL, NULL) == NULL, "空配置应失败");
+    ASSERT_EQ(em_hsm_destroy(NULL), EM_ERR_INVALID_PARAM, "销毁空指针应失败");
+    TEST_PASS();
+}
+
+/*============================================================================
+ *                              主函数
+ *============================================================================*/
+
+int main(void)
+{
+    printf("=== 层次状态机单元测试 ===\n\n");
+
+    test_hsm_transitions();
+    test_hsm_manager();
+    test_hsm_run_to_completion();
+    test_hsm_invalid_tables();
+
+    /* 结果汇总 */
+    printf("\n=== 测试结果 ===\n");
+    printf("运行: %d\n", tests_run);
+    printf("通过: %d\n", tests_passed);
+    printf("失败: %d\n", tests_failed);
+
+    if (tests_failed == 0) {
+        printf("\n所有测试通过!\n");
+        return 0;
+    } else {
+        printf("\n有测试失败!\n");
+        return 1;
+    }
+}
@@ -0,0 +1,311 @@
+/**
+ * @file test_pipeline.c
+ * @brief 多级流水线单元测试
+ * 
+ * 编译: gcc -o test_pipeline test_pipeline.c ../src/em_pipeline.c ../src/event_manager.c -I../include -lpthread
+ */
+
+#define _POSIX_C_SOURCE 199309L  /* for nanosleep, clock_gettime */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <time.h>
+#include "em_pipeline.h"
+
+/*============================================================================
+ *                              测试框架
+ *============================================================================*/
+
+static int tests_run = 0;
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+#define TEST_START(name) \
+    do { \
+        printf("测试: %s ... ", name); \
+        tests_run++; \
+    } while(0)
+
+#define TEST_PASS() \
+    do { \
+        printf("通过\n"); \
+        tests_passed++; \
+    } while(0)
+
+#define TEST_FAIL(msg) \
+    do { \
+        printf("失败: %s\n", msg); \
+        tests_failed++; \
+    } while(0)
+
+#define ASSERT_TRUE(cond, msg) \
+    do { \
+        if (!(cond)) { \
+            TEST_FAIL(msg); \
+            return; \
+        } \
+    } while(0)
+
+#define ASSERT_EQ(a, b, msg) ASSERT_TRUE((a) == (b), msg)
+#define ASSERT_NOT_NULL(ptr, msg) ASSERT_TRUE((ptr) != NULL, msg)
+
+/*============================================================================
+ *                              测试辅助
+ *============================================================================*/
+
+#if EM_ENABLE_THREADING
+
+#define ITEM_COUNT  1000
+
+/* decode: 数值翻倍 */
+static void* stage_double(void* item, void* user)
+{
+    (void)user;
+    *(int*)item *= 2;
+    return item;
+}
+
+/* filter: 丢弃能被4整除的数据项 */
+static void* stage_filter(void* item, void* user)
+{
+    (void)user;
+    if (*(int*)item % 4 == 0) {
+        free(item);
+        return NULL;
+    }
+    return item;
+}
+
+/* sink: 累加并释放 */
+static atomic_long sink_sum;
+static atomic_int sink_count;
+
+static void* stage_sink(void* item, void* user)
+{
+    (void)user;
+    atomic_fetch_add(&sink_sum, *(int*)item);
+    atomic_fetch_add(&sink_count, 1);
+    free(item);
+    return NULL;
+}
+
+static em_pipeline_t* build_pipeline(em_stage_mode_t mode, size_t capacity)
+{
+    em_pipeline_t* p = em_pipeline_create();
+    if (p == NULL) {
+        return NULL;
+    }
+    
+    em_stage_config_t cfg;
+    em_stage_config_init(&cfg);
+    cfg.name = "decode";
+    cfg.fn = stage_double;
+    cfg.mode = mode;
+    cfg.capacity = capacity;
+    em_pipeline_add_stage(p, &cfg);
+    cfg.name = "filter";
+    cfg.fn = stage_filter;
+    em_pipeline_add_stage(p, &cfg);
+    cfg.name = "sink";
+    cfg.fn = stage_sink;
+    em_pipeline_add_stage(p, &cfg);
+    return p;
+}
+
+static long expected_sum(int n)
+{
+    long sum = 0;
+    for (int i = 0; i < n; i++) {
+        if ((i * 2) % 4 != 0) {
+            sum += i * 2;
+        }
+    }
+    return sum;
+}
+
+/*============================================================================
+ *                              流水线测试
+ *============================================================================*/
+
+static void run_pipeline_test(const char* name, em_stage_mode_t mode)
+{
+    TEST_START(name);
+    
+    atomic_store(&sink_sum, 0);
+    atomic_store(&sink_count, 0);
+    
+    /* 很小的队列容量，确保背压生效 */
+    em_pipeline_t* p = build_pipeline(mode, 4);
+    ASSERT_NOT_NULL(p, "创建流水线失败");
+    ASSERT_EQ(em_pipeline_stage_count(p), 3, "级数不正确");
+    ASSERT_EQ(em_pipeline_start(p), EM_OK, "启动失败");
+    
+    for (int i = 0; i < ITEM_COUNT; i++) {
+        int* item = (int*)malloc(sizeof(int));
+        *item = i;
+        ASSERT_EQ(em_pipeline_push(p, item), EM_OK, "推入失败");
+    }
+    
+    /* 停止时处理完已推入的数据项 */
+    em_pipeline_stop(p);
+    
+    ASSERT_EQ(atomic_load(&sink_count), ITEM_COUNT / 2, "输出数量不正确");
+    ASSERT_EQ(atomic_load(&sink_sum), expected_sum(ITEM_COUNT), "输出结果不正确");
+    
+    em_stage_stats_t stats;
+    em_pipeline_get_stage_stats(p, 0, &stats);
+    ASSERT_EQ(stats.items_in, ITEM_COUNT, "第一级输入数不正确");
+    ASSERT_EQ(stats.queue_capacity, 4, "队列容量不正确");
+    ASSERT_TRUE(stats.queue_max <= 4, "占用峰值超过容量");
+    
+    em_pipeline_get_stage_stats(p, 1, &stats);
+    ASSERT_EQ(stats.items_dropped, ITEM_COUNT / 2, "丢弃数不正确");
+    ASSERT_EQ(stats.items_out, ITEM_COUNT / 2, "第二级输出数不正确");
+    
+    em_pipeline_get_stage_stats(p, 2, &stats);
+    ASSERT_EQ(stats.items_out, ITEM_COUNT / 2, "最后一级处理数不正确");
+    ASSERT_EQ(stats.queue_current, 0, "队列应为空");
+    ASSERT_TRUE(stats.throughput > 0, "吞吐量应大于0");
+    
+    em_pipeline_destroy(p);
+    TEST_PASS();
+}
+
+void test_pipeline_threads(void)
+{
+    run_pipeline_test("线程方式的流水线", EM_STAGE_THREAD);
+}
+
+void test_pipeline_tasks(void)
+{
+    run_pipeline_test("任务方式的流水线", EM_STAGE_TASK);
+}
+
+void test_pipeline_try_push_full(void)
+{
+    TEST_START("第一级队列满时不阻塞推入");
+    
+    em_pipeline_t* p = build_pipeline(EM_STAGE_THREAD, 2);
+    ASSERT_NOT_NULL(p, "创建流水线失败");
+    
+    /* 未启动时没有消费者，队列很快被填满 */
+    int* items[3];
+    for (int i = 0; i < 3; i++) {
+        items[i] = (int*)malloc(sizeof(int));
+        *items[i] = i + 1;
+    }
+    ASSERT_EQ(em_pipeline_try_push(p, items[0]), EM_OK, "推入失败");
+    ASSERT_EQ(em_pipeline_try_push(p, items[1]), EM_OK, "推入失败");
+    ASSERT_EQ(em_pipeline_try_push(p, items[2]), EM_ERR_QUEUE_FULL, "应返回队列已满");
+    free(items[2]);
+    
+    em_stage_stats_t stats;
+    em_pipeline_get_stage_stats(p, 0, &stats);
+    ASSERT_EQ(stats.stalls, 1, "背压计数不正确");
+    ASSERT_EQ(stats.queue_current, 2, "队列占用不正确");
+    
+    /* 添加级只能在启动前进行 */
+    ASSERT_EQ(em_pipeline_start(p), EM_OK, "启动失败");
+    em_stage_config_t cfg;
+    em_stage_config_init(&cfg);
+    ASSERT_EQ(cfg.cpu, -1, "默认不应绑定CPU");
+    ASSERT_EQ(cfg.mode, EM_STAGE_THREAD, "默认应为线程方式");
+    cfg.name = "late";
+    cfg.fn = stage_sink;
+    ASSERT_EQ(em_pipeline_add_stage(p, &cfg), -1, "启动后不应允许添加级");
+    
+    em_pipeline_stop(p);
+    em_pipeline_destroy(p);
+    TEST_PASS();
+}
+
+static uint64_t cpu_time_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+void test_pipeline_idle(void)
+{
+    TEST_START("空闲的流水线不占用CPU");
+    
+    /* 线程方式与任务方式混合，覆盖两种休眠路径 */
+    em_pipeline_t* p = em_pipeline_create();
+    ASSERT_NOT_NULL(p, "创建流水线失败");
+    em_stage_config_t cfg;
+    em_stage_config_init(&cfg);
+    cfg.capacity = 4;
+    cfg.name = "decode";
+    cfg.fn = stage_double;
+    em_pipeline_add_stage(p, &cfg);
+    cfg.name = "filter";
+    cfg.fn = stage_filter;
+    cfg.mode = EM_STAGE_TASK;
+    em_pipeline_add_stage(p, &cfg);
+    cfg.name = "sink";
+    cfg.fn = stage_sink;
+    cfg.mode = EM_STAGE_THREAD;
+    em_pipeline_add_stage(p, &cfg);
+    ASSERT_EQ(em_pipeline_start(p), EM_OK, "启动失败");
+    
+    /* 各级线程与任务线程进入休眠后，空闲期间几乎不消耗CPU */
+    struct timespec ts = {0, 50000000};
+    nanosleep(&ts, NULL);
+    uint64_t before = cpu_time_ns();
+    ts.tv_nsec = 200000000;
+    nanosleep(&ts, NULL);
+    uint64_t used = cpu_time_ns() - before;
+    ASSERT_TRUE(used < 5000000ull, "空闲时CPU占用过高");
+    
+    /* 休眠的线程能被新数据和停止唤醒 */
+    atomic_store(&sink_sum, 0);
+    atomic_store(&sink_count, 0);
+    for (int i = 0; i < 100; i++) {
+        int* item = (int*)malloc(sizeof(int));
+        *item = i;
+        ASSERT_EQ(em_pipeline_push(p, item), EM_OK, "推入失败");
+    }
+    ASSERT_EQ(em_pipeline_stop(p), EM_OK, "停止失败");
+    ASSERT_EQ(atomic_load(&sink_sum), expected_sum(100), "结果不正确");
+    
+    em_stage_stats_t stats;
+    em_pipeline_get_stage_stats(p, 0, &stats);
+    ASSERT_EQ(stats.items_out, 100, "第一级输出数不正确");
+    
+    em_pipeline_destroy(p);
+    TEST_PASS();
+}
+
+#endif /* EM_ENABLE_THREADING */
+
+/*============================================================================
+ *                              主函数
+ *============================================================================*/
+
+int main(void)
+{
+    printf("=== 流水线单元测试 ===\n\n");
+
+#if EM_ENABLE_THREADING
+    test_pipeline_threads();
+    test_pipeline_tasks();
+    test_pipeline_try_push_full();
+    test_pipeline_idle();
+#endif
+    
+    /* 结果汇总 */
+    printf("\n=== 测试结果 ===\n");
+    printf("运行: %d\n", tests_run);
+    printf("通过: %d\n", tests_passed);
+    printf("失败: %d\n", tests_failed);
+    
+    if (tests_failed == 0) {
+        printf("\n所有测试通过!\n");
+        return 0;
+    } else {
+        printf("\n有测试失败!\n");
+        return 1;
+    }
+}
@@ -0,0 +1,356 @@
+/**
+ * @file test_trace.c
+ * @brief 事件流录制与紧凑编码单元测试
+ *
+ * 编译: gcc -o test_trace test_trace.c ../src/em_trace.c ../src/event_manager.c -I../include -lpthread
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "em_trace.h"
+
+/*============================================================================
+ *                              测试框架
+ *============================================================================*/
+
+static int tests_run = 0;
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+#define TEST_START(name) \
+    do { \
+        printf("测试: %s ... ", name); \
+        tests_run++; \
+    } while(0)
+
+#define TEST_PASS() \
+    do { \
+        printf("通过\n"); \
+        tests_passed++; \
+    } while(0)
+
+#define TEST_FAIL(msg) \
+    do { \
+        printf("失败: %s\n", msg); \
+        tests_failed++; \
+    } while(0)
+
+#define ASSERT_TRUE(cond, msg) \
+    do { \
+        if (!(cond)) { \
+            TEST_FAIL(msg); \
+            return; \
+        } \
+    } while(0)
+
+#define ASSERT_EQ(a, b, msg) ASSERT_TRUE((a) == (b), msg)
+#define ASSERT_NOT_NULL(ptr, msg) ASSERT_TRUE((ptr) != NULL, msg)
+
+/*============================================================================
+ *                              测试辅助
+ *============================================================================*/
+
+#define RECORD_COUNT    200
+
+/* 缓慢变化的传感器数据 */
+typedef struct {
+    uint32_t seq;
+    int16_t  values[16];
+    uint32_t flags;
+} sample_t;
+
+/* 内存中的输出缓冲 */
+typedef struct {
+    uint8_t* bytes;
+    size_t   size;
+    size_t   capacity;
+    bool     fail;
+} mem_sink_t;
+
+static bool mem_sink_write(const void* bytes, size_t size, void* user_data)
+{
+    mem_sink_t* sink = (mem_sink_t*)user_data;
+    if (sink->fail) {
+        return false;
+    }
+    if (sink->size + size > sink->capacity) {
+        size_t capacity = (sink->size + size) * 2;
+        uint8_t* grown = (uint8_t*)realloc(sink->bytes, capacity);
+        if (grown == NULL) {
+            return false;
+        }
+        sink->bytes = grown;
+        sink->capacity = capacity;
+    }
+    memcpy(sink->bytes + sink->size, bytes, size);
+    sink->size += size;
+    return true;
+}
+
+static void make_sample(sample_t* s, int i)
+{
+    memset(s, 0, sizeof(*s));
+    s->seq = (uint32_t)i;
+    for (int k = 0; k < 16; k++) {
+        s->values[k] = (int16_t)(1000 + k * 10);
+    }
+    s->values[i % 16] += (int16_t)(i % 7);
+    s->flags = 0x5a5a0000;
+}
+
+/* 两种事件交替，时间戳带抖动，偶尔倒退 */
+static void make_record(em_trace_record_t* rec, sample_t* s, int i)
+{
+    make_sample(s, i);
+    rec->timestamp_ns = 1000000000ULL + (uint64_t)i * 1000 - ((i % 10 == 9) ? 1500 : 0);
+    rec->event.id = (i % 3 == 0) ? 7 : 42;
+    rec->event.priority = (em_priority_t)(i % 3);
+    rec->event.mode = (i % 2) ? EM_MODE_ASYNC : EM_MODE_SYNC;
+    if (i % 5 == 4) {
+        rec->event.data = NULL;
+        rec->event.data_size = 0;
+    } else {
+        rec->event.data = s;
+        rec->event.data_size = sizeof(*s);
+    }
+}
+
+static bool record_matches(const em_trace_record_t* a, const em_trace_record_t* b)
+{
+    if (a->timestamp_ns != b->timestamp_ns || a->event.id != b->event.id ||
+        a->event.priority != b->event.priority || a->event.mode != b->event.mode ||
+        a->event.data_size != b->event.data_size) {
+        return false;
+    }
+    return a->event.data_size == 0 ||
+           memcmp(a->event.data, b->event.data, a->event.data_size) == 0;
+}
+
+/*============================================================================
+ *                              编解码测试
+ *============================================================================*/
+
+void test_trace_roundtrip(void)
+{
+    TEST_START("编码后逐条解码还原");
+
+    mem_sink_t sink = { NULL, 0, 0, false };
+    em_trace_writer_t* w = em_trace_writer_create(EM_TRACE_XOR_DELTA, mem_sink_write, &sink);
+    ASSERT_NOT_NULL(w, "创建编码器失败");
+
+    sample_t s;
+    em_trace_record_t rec;
+    for (int i = 0; i < RECORD_COUNT; i++) {
+        make_record(&rec, &s, i);
+        ASSERT_EQ(em_trace_write(w, &rec), EM_OK, "编码失败");
+    }
+    ASSERT_EQ(em_trace_flush(w), EM_OK, "输出失败");
+
+    em_trace_stats_t stats;
+    em_trace_get_stats(w, &stats);
+    ASSERT_EQ(stats.records, RECORD_COUNT, "记录数不正确");
+    ASSERT_EQ(stats.encoded_bytes, sink.size, "编码字节数不正确");
+    ASSERT_TRUE(stats.delta_records > 0, "应有异或编码的记录");
+    ASSERT_TRUE(stats.encoded_bytes * 3 < stats.raw_bytes, "压缩效果不足");
+    em_trace_writer_destroy(w);
+
+    em_trace_reader_t* r = em_trace_reader_create();
+    ASSERT_NOT_NULL(r, "创建解码器失败");
+
+    size_t pos = 0;
+    size_t used;
+    em_trace_record_t out;
+    for (int i = 0; i < RECORD_COUNT; i++) {
+        ASSERT_EQ(em_trace_read(r, sink.bytes + pos, sink.size - pos, &used, &out), EM_OK, "解码失败");
+        pos += used;
+        make_record(&rec, &s, i);
+        ASSERT_TRUE(record_matches(&rec, &out), "解码结果不一致");
+    }
+    ASSERT_EQ(pos, sink.size, "应消耗全部字节");
+    ASSERT_EQ(em_trace_read(r, sink.bytes + pos, 0, &used, &out), EM_ERR_QUEUE_EMPTY, "流尾应返回数据不足");
+
+    em_trace_reader_destroy(r);
+    free(sink.bytes);
+    TEST_PASS();
+}
+
+void test_trace_streaming(void)
+{
+    TEST_START("数据分块到达时流式解码");
+
+    mem_sink_t sink = { NULL, 0, 0, false };
+    em_trace_writer_t* w = em_trace_writer_create(EM_TRACE_XOR_DELTA, mem_sink_write, &sink);
+    ASSERT_NOT_NULL(w, "创建编码器失败");
+
+    sample_t s;
+    em_trace_record_t rec;
+    for (int i = 0; i < RECORD_COUNT; i++) {
+        make_record(&rec, &s, i);
+        em_trace_write(w, &rec);
+    }
+    em_trace_writer_destroy(w);
+
+    /* 每次只多给一个字节，模拟从管道或套接字读取 */
+    em_trace_reader_t* r = em_trace_reader_create();
+    ASSERT_NOT_NULL(r, "创建解码器失败");
+
+    size_t pos = 0;
+    size_t avail = 0;
+    size_t used;
+    int decoded = 0;
+    em_trace_record_t out;
+    while (avail < sink.size) {
+        avail++;
+        em_error_t err;
+        while ((err = em_trace_read(r, sink.bytes + pos, avail - pos, &used, &out)) == EM_OK) {
+            make_record(&rec, &s, decoded);
+            ASSERT_TRUE(record_matches(&rec, &out), "解码结果不一致");
+            pos += used;
+            decoded++;
+        }
+        ASSERT_EQ(err, EM_ERR_QUEUE_EMPTY, "数据不足时应返回 EM_ERR_QUEUE_EMPTY");
+        ASSERT_EQ(used, 0, "数据不足时不应消耗字节");
+    }
+    ASSERT_EQ(decoded, RECORD_COUNT, "解码记录数不正确");
+
+    em_trace_reader_destroy(r);
+    free(sink.bytes);
+    TEST_PASS();
+}
+
+void test_trace_invalid_stream(void)
+{
+    TEST_START("识别损坏的流");
+
+    em_trace_reader_t* r = em_trace_reader_create();
+    ASSERT_NOT_NULL(r, "创建解码器失败");
+
+    size_t used;
+    em_trace_record_t out;
+    const uint8_t bad_magic[] = { 'E', 'M', 'X', 1, 0, 0, 0, 1 };
+    ASSERT_EQ(em_trace_read(r, bad_magic, sizeof(bad_magic), &used, &out), EM_ERR_INVALID_PARAM,
+              "流头错误应返回 EM_ERR_INVALID_PARAM");
+
+    /* 流头未声明异或编码，记录却带异或标志 */
+    const uint8_t bad_xor[] = { 'E', 'M', 'T', 1, 0, 0x30, 0, 1, 4, 0, 1, 0xff };
+    ASSERT_EQ(em_trace_read(r, bad_xor, sizeof(bad_xor), &used, &out), EM_ERR_INVALID_PARAM,
+              "非法的异或记录应返回 EM_ERR_INVALID_PARAM");
+
+    /* 没有异或编码时原样写入 */
+    mem_sink_t sink = { NULL, 0, 0, false };
+    em_trace_writer_t* w = em_trace_writer_create(0, mem_sink_write, &sink);
+    sample_t s;
+    em_trace_record_t rec;
+    make_record(&rec, &s, 0);
+    em_trace_write(w, &rec);
+    em_trace_write(w, &rec);
+
+    /* 输出失败时计入统计 */
+    sink.fail = true;
+    ASSERT_EQ(em_trace_flush(w), EM_ERR_QUEUE_FULL, "输出失败应返回错误");
+    em_trace_stats_t stats;
+    em_trace_get_stats(w, &stats);
+    ASSERT_EQ(stats.delta_records, 0, "未开启时不应使用异或编码");
+    ASSERT_EQ(stats.sink_errors, 1, "输出失败计数不正确");
+    em_trace_writer_destroy(w);
+
+    em_trace_reader_destroy(r);
+    free(sink.bytes);
+    TEST_PASS();
+}
+
+/*============================================================================
+ *                              录制测试
+ *============================================================================*/
+
+static int handled = 0;
+
+static void on_event(em_event_id_t event_id, em_event_data_t data, void* user_data)
+{
+    (void)event_id;
+    (void)data;
+    (void)user_data;
+    handled++;
+}
+
+void test_trace_attach(void)
+{
+    TEST_START("录制管理器分发的事件");
+
+    em_handle_t em = em_create();
+    ASSERT_NOT_NULL(em, "创建管理器失败");
+    em_subscribe(em, 1, on_event, NULL, EM_PRIORITY_NORMAL);
+    em_subscribe(em, 2, on_event, NULL, EM_PRIORITY_NORMAL);
+
+    mem_sink_t sink = { NULL, 0, 0, false };
+    em_trace_writer_t* w = em_trace_writer_create(EM_TRACE_XOR_DELTA, mem_sink_write, &sink);
+    ASSERT_NOT_NULL(w, "创建编码器失败");
+    ASSERT_EQ(em_trace_attach(em, w), EM_OK, "挂接失败");
+
+    int value = 10;
+    em_publish_sync(em, 1, &value);
+    for (int i = 0; i < 5; i++) {
+        value = 100 + i;
+        em_publish_async(em, 2, &value, sizeof(value), EM_PRIORITY_HIGH);
+    }
+    em_process_all(em);
+
+    /* 同步事件没有数据大小，只记录事件ID；停止录制后的事件不再编码 */
+    ASSERT_EQ(em_trace_attach(em, NULL), EM_OK, "解除挂接失败");
+    em_publish_sync(em, 1, &value);
+    ASSERT_EQ(handled, 7, "处理数不正确");
+    em_trace_writer_destroy(w);
+
+    em_trace_reader_t* r = em_trace_reader_create();
+    size_t pos = 0;
+    size_t used;
+    int count = 0;
+    em_trace_record_t out;
+    while (em_trace_read(r, sink.bytes + pos, sink.size - pos, &used, &out) == EM_OK) {
+        pos += used;
+        if (count == 0) {
+            ASSERT_TRUE(out.event.id == 1 && out.event.mode == EM_MODE_SYNC, "同步事件记录不正确");
+            ASSERT_EQ(out.event.data_size, 0, "同步事件不记录数据");
+        } else {
+            ASSERT_TRUE(out.event.id == 2 && out.event.mode == EM_MODE_ASYNC, "异步事件记录不正确");
+            ASSERT_EQ(out.event.priority, EM_PRIORITY_HIGH, "优先级不正确");
+            ASSERT_EQ(*(const int*)out.event.data, 100 + count - 1, "异步事件数据不正确");
+        }
+        count++;
+    }
+    ASSERT_EQ(count, 6, "录制记录数不正确");
+
+    em_trace_reader_destroy(r);
+    free(sink.bytes);
+    em_destroy(em);
+    TEST_PASS();
+}
+
+/*============================================================================
+ *                              主函数
+ *============================================================================*/
+
+int main(void)
+{
+    printf("=== 事件录制单元测试 ===\n\n");
+
+    test_trace_roundtrip();
+    test_trace_streaming();
+    test_trace_invalid_stream();
+    test_trace_attach();
+
+    /* 结果汇总 */
+    printf("\n=== 测试结果 ===\n");
+    printf("运行: %d\n", tests_run);
+    printf("通过: %d\n", tests_passed);
+    printf("失败: %d\n", tests_failed);
+
+    if (tests_failed == 0) {
+        printf("\n所有测试通过!\n");
+        return 0;
+    } else {
+        printf("\n有测试失败!\n");
+        return 1;
+    }
+}